@@ -0,0 +1,56 @@
+// environment_lighting.h
+// 基于图像的光照（IBL）的预计算：从 HDR 等距柱状投影环境图得到
+//   - 漫反射：辐照度的 9 个球谐系数（SH9），着色时直接由法线求值
+//   - 镜面反射：按 GGX 预滤波的立方体贴图，mip 层 i 对应粗糙度 i / (mip 层数 - 1)
+//   - split-sum 的 BRDF 查找表：x 为 N·V，y 为粗糙度，RG 为 F0 的缩放与偏移
+// 与图形 API 无关，结果是可以直接上传的半精度浮点数据，GL 与 Vulkan 两个 PBR 渲染器按相对路径共用这一份
+//
+// 卷积在 CPU 上由全部硬件线程完成，耗时较长，结果保存到 ibl_cache/ 目录（与 shaders/ 并列）：
+// 环境部分的键为 HDR 文件内容与预计算参数的哈希，BRDF 查找表的键只有参数，所有环境共用一份。
+// 之后启动时直接读取缓存，源文件或参数变化时自动重新计算
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// 预滤波立方体贴图第 0 层的尺寸与 mip 层数（128 到 4）
+const int IBL_SPECULAR_SIZE = 128;
+const int IBL_SPECULAR_MIP_LEVELS = 6;
+
+// BRDF 查找表的尺寸
+const int IBL_BRDF_LUT_SIZE = 128;
+
+struct EnvironmentLighting {
+    // 辐照度除以 π 的球谐系数，按 L00、L1-1、L10、L11、L2-2、L2-1、L20、L21、L22 排列，
+    // 漫反射为 albedo * Σ coefficient * Y(N)，w 分量不用（便于按 std140 的 vec4 数组上传）
+    glm::vec4 irradianceSH[9] = {};
+
+    // 预滤波立方体贴图，RGBA 半精度浮点；按 mip 层、再按面（+X -X +Y -Y +Z -Z）依次排列，位置见 specularOffset
+    std::vector<uint16_t> specular;
+
+    // BRDF 查找表，RG 半精度浮点，第 0 行对应粗糙度 0
+    std::vector<uint16_t> brdfLut;
+
+    // 本次得到结果的方式与耗时（读取与计算）
+    bool environmentFromCache = false;
+    bool brdfLutFromCache = false;
+    double milliseconds = 0.0;
+};
+
+// mip 层 level 的边长
+int specularMipSize(int level);
+
+// mip 层 level 第 face 个面在 specular 中的起始位置（以 uint16_t 计）
+size_t specularOffset(int level, int face);
+
+// hdrPath 为 Radiance（.hdr）格式的等距柱状投影环境图；为空时使用程序生成的天空。
+// useCache 为 false 时既不读取也不写入缓存，用于测量冷启动。文件无法读取时返回 false
+bool loadEnvironmentLighting(const std::string& hdrPath, bool useCache, EnvironmentLighting& lighting);
+
+// 输出结果来自缓存还是重新计算，以及耗时
+void reportEnvironmentLighting(const EnvironmentLighting& lighting);
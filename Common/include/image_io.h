@@ -0,0 +1,19 @@
+// image_io.h
+// 简单的PPM（P6）图像读写，用于保存CPU参考光线追踪器与软件光栅化器的渲染结果，并与Vulkan截图比对
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// 将颜色量化为8位后写入PPM，超出 [0, 1] 的分量会被截断；失败时抛出 std::runtime_error
+void writePPM(const std::string& filename, uint32_t width, uint32_t height, const std::vector<glm::vec3>& pixels);
+
+// 读取8位PPM，像素值换算回 [0, 1]；失败时抛出 std::runtime_error
+void readPPM(const std::string& filename, uint32_t& width, uint32_t& height, std::vector<glm::vec3>& pixels);
+
+// 线性值按sRGB传递函数编码，用于模拟 VK_FORMAT_B8G8R8A8_SRGB 交换链在写入时做的转换
+glm::vec3 linearToSrgb(const glm::vec3& color);
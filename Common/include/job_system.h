@@ -0,0 +1,166 @@
+// job_system.h
+// 简单的任务线程池：把一个区间切成若干块，由工作线程和调用线程一起并行执行
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class JobSystem {
+public:
+    // threadCount 为参与计算的线程总数（包括调用线程），0 表示使用全部硬件线程
+    explicit JobSystem(unsigned int threadCount = 0) {
+        if (threadCount == 0) {
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        }
+
+        for (unsigned int i = 1; i < threadCount; i++) {
+            workers.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    ~JobSystem() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wakeCondition.notify_all();
+
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    unsigned int threadCount() const {
+        return static_cast<unsigned int>(workers.size()) + 1;
+    }
+
+    // 将 [begin, end) 按 grainSize 切块，并行调用 fn(chunkBegin, chunkEnd)，返回时所有块均已完成
+    // 注意：不支持在 fn 内部再次调用 parallelFor
+    template <typename Fn>
+    void parallelFor(size_t begin, size_t end, size_t grainSize, Fn&& fn) {
+        if (end <= begin) {
+            return;
+        }
+
+        grainSize = std::max<size_t>(grainSize, 1);
+        size_t chunkCount = (end - begin + grainSize - 1) / grainSize;
+
+        // 只有一块或者没有工作线程时直接在当前线程执行
+        if (workers.empty() || chunkCount == 1) {
+            for (size_t chunkBegin = begin; chunkBegin < end; chunkBegin += grainSize) {
+                fn(chunkBegin, std::min(end, chunkBegin + grainSize));
+            }
+            return;
+        }
+
+        std::lock_guard<std::mutex> submitLock(submitMutex);
+
+        Batch batch;
+        batch.fn = [&fn](size_t chunkBegin, size_t chunkEnd) { fn(chunkBegin, chunkEnd); };
+        batch.begin = begin;
+        batch.end = end;
+        batch.grainSize = grainSize;
+        batch.chunkCount = chunkCount;
+        batch.pendingChunks = chunkCount;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            currentBatch = &batch;
+            generation++;
+        }
+        wakeCondition.notify_all();
+
+        runChunks(batch);
+
+        // 等待所有块完成，并且没有工作线程仍持有 batch 的引用
+        std::unique_lock<std::mutex> lock(mutex);
+        doneCondition.wait(lock, [&] { return batch.pendingChunks.load() == 0 && activeWorkers == 0; });
+        currentBatch = nullptr;
+    }
+
+private:
+    struct Batch {
+        std::function<void(size_t, size_t)> fn;
+        size_t begin = 0;
+        size_t end = 0;
+        size_t grainSize = 1;
+        size_t chunkCount = 0;
+        std::atomic<size_t> nextChunk{0};
+        std::atomic<size_t> pendingChunks{0};
+    };
+
+    std::vector<std::thread> workers;
+
+    std::mutex submitMutex;
+    std::mutex mutex;
+    std::condition_variable wakeCondition;
+    std::condition_variable doneCondition;
+
+    Batch* currentBatch = nullptr;
+    uint64_t generation = 0;
+    unsigned int activeWorkers = 0;
+    bool stopping = false;
+
+    void runChunks(Batch& batch) {
+        size_t finished = 0;
+
+        for (;;) {
+            size_t chunk = batch.nextChunk.fetch_add(1);
+            if (chunk >= batch.chunkCount) {
+                break;
+            }
+
+            size_t chunkBegin = batch.begin + chunk * batch.grainSize;
+            size_t chunkEnd = std::min(batch.end, chunkBegin + batch.grainSize);
+            batch.fn(chunkBegin, chunkEnd);
+            finished++;
+        }
+
+        if (finished > 0 && batch.pendingChunks.fetch_sub(finished) == finished) {
+            std::lock_guard<std::mutex> lock(mutex);
+            doneCondition.notify_all();
+        }
+    }
+
+    void workerLoop() {
+        uint64_t seenGeneration = 0;
+
+        for (;;) {
+            Batch* batch = nullptr;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wakeCondition.wait(lock, [&] { return stopping || generation != seenGeneration; });
+
+                if (stopping) {
+                    return;
+                }
+
+                seenGeneration = generation;
+                batch = currentBatch;
+                if (batch == nullptr) {
+                    continue;
+                }
+                activeWorkers++;
+            }
+
+            runChunks(*batch);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            activeWorkers--;
+            if (activeWorkers == 0) {
+                doneCondition.notify_all();
+            }
+        }
+    }
+};
@@ -0,0 +1,210 @@
+// simd.h
+// CPU参考光线追踪器、软件光栅化器与粒子系统共用的SIMD封装
+// 定义了 __AVX2__ 时为8路（AVX2），x86-64 默认4路（SSE2），其他平台退化为1路标量实现；
+// 定义 SIMD_FORCE_SCALAR 可以强制使用标量实现
+// vuint 是与 vfloat 同宽的32位无符号整数向量，只提供计数器型随机数所需的运算
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX2__) && !defined(SIMD_FORCE_SCALAR)
+#include <immintrin.h>
+#define SIMD_AVX2 1
+#elif (defined(__SSE2__) || defined(_M_X64)) && !defined(SIMD_FORCE_SCALAR)
+#include <emmintrin.h>
+#define SIMD_SSE 1
+#endif
+
+namespace simd {
+
+#if defined(SIMD_AVX2)
+
+constexpr int WIDTH = 8;
+constexpr const char* NAME = "AVX2";
+
+struct vfloat {
+    __m256 v;
+
+    vfloat() = default;
+    vfloat(__m256 value) : v(value) {}
+    vfloat(float value) : v(_mm256_set1_ps(value)) {}
+
+    static vfloat load(const float* p) { return _mm256_loadu_ps(p); }
+    void store(float* p) const { _mm256_storeu_ps(p, v); }
+};
+
+inline vfloat operator+(vfloat a, vfloat b) { return _mm256_add_ps(a.v, b.v); }
+inline vfloat operator-(vfloat a, vfloat b) { return _mm256_sub_ps(a.v, b.v); }
+inline vfloat operator*(vfloat a, vfloat b) { return _mm256_mul_ps(a.v, b.v); }
+inline vfloat operator/(vfloat a, vfloat b) { return _mm256_div_ps(a.v, b.v); }
+inline vfloat operator&(vfloat a, vfloat b) { return _mm256_and_ps(a.v, b.v); }
+inline vfloat operator|(vfloat a, vfloat b) { return _mm256_or_ps(a.v, b.v); }
+inline vfloat andNot(vfloat mask, vfloat a) { return _mm256_andnot_ps(mask.v, a.v); }
+
+inline vfloat min(vfloat a, vfloat b) { return _mm256_min_ps(a.v, b.v); }
+inline vfloat max(vfloat a, vfloat b) { return _mm256_max_ps(a.v, b.v); }
+inline vfloat sqrt(vfloat a) { return _mm256_sqrt_ps(a.v); }
+
+inline vfloat operator<(vfloat a, vfloat b) { return _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ); }
+inline vfloat operator<=(vfloat a, vfloat b) { return _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ); }
+inline vfloat operator>(vfloat a, vfloat b) { return _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ); }
+inline vfloat operator>=(vfloat a, vfloat b) { return _mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ); }
+
+// mask 为真的通道取 a，否则取 b
+inline vfloat select(vfloat mask, vfloat a, vfloat b) { return _mm256_blendv_ps(b.v, a.v, mask.v); }
+inline int movemask(vfloat mask) { return _mm256_movemask_ps(mask.v); }
+inline vfloat trueMask() { return _mm256_castsi256_ps(_mm256_set1_epi32(-1)); }
+
+struct vuint {
+    __m256i v;
+
+    vuint() = default;
+    vuint(__m256i value) : v(value) {}
+    vuint(uint32_t value) : v(_mm256_set1_epi32(static_cast<int>(value))) {}
+};
+
+inline vuint operator+(vuint a, vuint b) { return _mm256_add_epi32(a.v, b.v); }
+inline vuint operator^(vuint a, vuint b) { return _mm256_xor_si256(a.v, b.v); }
+inline vuint operator*(vuint a, vuint b) { return _mm256_mullo_epi32(a.v, b.v); }
+template <int N> inline vuint shiftRight(vuint a) { return _mm256_srli_epi32(a.v, N); }
+
+// 各通道为 base, base + 1, ..., base + WIDTH - 1
+inline vuint laneIndex(uint32_t base) {
+    return _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(base)), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+}
+// 按有符号整数转换，调用方保证数值小于 2^31
+inline vfloat toFloat(vuint a) { return _mm256_cvtepi32_ps(a.v); }
+
+#elif defined(SIMD_SSE)
+
+constexpr int WIDTH = 4;
+constexpr const char* NAME = "SSE2";
+
+struct vfloat {
+    __m128 v;
+
+    vfloat() = default;
+    vfloat(__m128 value) : v(value) {}
+    vfloat(float value) : v(_mm_set1_ps(value)) {}
+
+    static vfloat load(const float* p) { return _mm_loadu_ps(p); }
+    void store(float* p) const { _mm_storeu_ps(p, v); }
+};
+
+inline vfloat operator+(vfloat a, vfloat b) { return _mm_add_ps(a.v, b.v); }
+inline vfloat operator-(vfloat a, vfloat b) { return _mm_sub_ps(a.v, b.v); }
+inline vfloat operator*(vfloat a, vfloat b) { return _mm_mul_ps(a.v, b.v); }
+inline vfloat operator/(vfloat a, vfloat b) { return _mm_div_ps(a.v, b.v); }
+inline vfloat operator&(vfloat a, vfloat b) { return _mm_and_ps(a.v, b.v); }
+inline vfloat operator|(vfloat a, vfloat b) { return _mm_or_ps(a.v, b.v); }
+inline vfloat andNot(vfloat mask, vfloat a) { return _mm_andnot_ps(mask.v, a.v); }
+
+inline vfloat min(vfloat a, vfloat b) { return _mm_min_ps(a.v, b.v); }
+inline vfloat max(vfloat a, vfloat b) { return _mm_max_ps(a.v, b.v); }
+inline vfloat sqrt(vfloat a) { return _mm_sqrt_ps(a.v); }
+
+inline vfloat operator<(vfloat a, vfloat b) { return _mm_cmplt_ps(a.v, b.v); }
+inline vfloat operator<=(vfloat a, vfloat b) { return _mm_cmple_ps(a.v, b.v); }
+inline vfloat operator>(vfloat a, vfloat b) { return _mm_cmpgt_ps(a.v, b.v); }
+inline vfloat operator>=(vfloat a, vfloat b) { return _mm_cmpge_ps(a.v, b.v); }
+
+// SSE2 没有 blendv，用与/或组合实现
+inline vfloat select(vfloat mask, vfloat a, vfloat b) { return _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v)); }
+inline int movemask(vfloat mask) { return _mm_movemask_ps(mask.v); }
+inline vfloat trueMask() { return _mm_castsi128_ps(_mm_set1_epi32(-1)); }
+
+struct vuint {
+    __m128i v;
+
+    vuint() = default;
+    vuint(__m128i value) : v(value) {}
+    vuint(uint32_t value) : v(_mm_set1_epi32(static_cast<int>(value))) {}
+};
+
+inline vuint operator+(vuint a, vuint b) { return _mm_add_epi32(a.v, b.v); }
+inline vuint operator^(vuint a, vuint b) { return _mm_xor_si128(a.v, b.v); }
+// SSE2 没有32位低位乘法，分别算偶数、奇数通道的64位乘积后取低32位交织回来
+inline vuint operator*(vuint a, vuint b) {
+    __m128i even = _mm_mul_epu32(a.v, b.v);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a.v, 32), _mm_srli_epi64(b.v, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+template <int N> inline vuint shiftRight(vuint a) { return _mm_srli_epi32(a.v, N); }
+
+inline vuint laneIndex(uint32_t base) {
+    return _mm_add_epi32(_mm_set1_epi32(static_cast<int>(base)), _mm_setr_epi32(0, 1, 2, 3));
+}
+inline vfloat toFloat(vuint a) { return _mm_cvtepi32_ps(a.v); }
+
+#else
+
+constexpr int WIDTH = 1;
+constexpr const char* NAME = "scalar";
+
+struct vfloat {
+    float v;
+
+    vfloat() = default;
+    vfloat(float value) : v(value) {}
+
+    static vfloat load(const float* p) { return *p; }
+    void store(float* p) const { *p = v; }
+};
+
+namespace detail {
+inline uint32_t bits(float f) { uint32_t u; std::memcpy(&u, &f, sizeof(u)); return u; }
+inline float fromBits(uint32_t u) { float f; std::memcpy(&f, &u, sizeof(f)); return f; }
+inline vfloat mask(bool b) { return fromBits(b ? 0xFFFFFFFFu : 0u); }
+}
+
+inline vfloat operator+(vfloat a, vfloat b) { return a.v + b.v; }
+inline vfloat operator-(vfloat a, vfloat b) { return a.v - b.v; }
+inline vfloat operator*(vfloat a, vfloat b) { return a.v * b.v; }
+inline vfloat operator/(vfloat a, vfloat b) { return a.v / b.v; }
+inline vfloat operator&(vfloat a, vfloat b) { return detail::fromBits(detail::bits(a.v) & detail::bits(b.v)); }
+inline vfloat operator|(vfloat a, vfloat b) { return detail::fromBits(detail::bits(a.v) | detail::bits(b.v)); }
+inline vfloat andNot(vfloat mask, vfloat a) { return detail::fromBits(~detail::bits(mask.v) & detail::bits(a.v)); }
+
+inline vfloat min(vfloat a, vfloat b) { return a.v < b.v ? a.v : b.v; }
+inline vfloat max(vfloat a, vfloat b) { return a.v > b.v ? a.v : b.v; }
+inline vfloat sqrt(vfloat a) { return std::sqrt(a.v); }
+
+inline vfloat operator<(vfloat a, vfloat b) { return detail::mask(a.v < b.v); }
+inline vfloat operator<=(vfloat a, vfloat b) { return detail::mask(a.v <= b.v); }
+inline vfloat operator>(vfloat a, vfloat b) { return detail::mask(a.v > b.v); }
+inline vfloat operator>=(vfloat a, vfloat b) { return detail::mask(a.v >= b.v); }
+
+inline vfloat select(vfloat mask, vfloat a, vfloat b) { return detail::bits(mask.v) ? a : b; }
+inline int movemask(vfloat mask) { return (detail::bits(mask.v) >> 31) & 1; }
+inline vfloat trueMask() { return detail::mask(true); }
+
+struct vuint {
+    uint32_t v;
+
+    vuint() = default;
+    vuint(uint32_t value) : v(value) {}
+};
+
+inline vuint operator+(vuint a, vuint b) { return a.v + b.v; }
+inline vuint operator^(vuint a, vuint b) { return a.v ^ b.v; }
+inline vuint operator*(vuint a, vuint b) { return a.v * b.v; }
+template <int N> inline vuint shiftRight(vuint a) { return a.v >> N; }
+
+inline vuint laneIndex(uint32_t base) { return base; }
+inline vfloat toFloat(vuint a) { return static_cast<float>(static_cast<int32_t>(a.v)); }
+
+#endif
+
+inline bool any(vfloat mask) { return movemask(mask) != 0; }
+inline bool none(vfloat mask) { return movemask(mask) == 0; }
+
+inline float lane(vfloat a, int i) {
+    alignas(32) float values[WIDTH];
+    a.store(values);
+    return values[i];
+}
+
+} // namespace simd
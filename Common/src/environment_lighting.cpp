@@ -0,0 +1,654 @@
+// environment_lighting.cpp
+// Radiance HDR 的读取、立方体贴图的重采样、SH9 投影、GGX 预滤波、BRDF 积分与磁盘缓存
+
+#include "environment_lighting.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <initializer_list>
+#include <iostream>
+#include <iterator>
+#include <thread>
+
+namespace {
+
+const float PI = 3.14159265358979f;
+
+// 环境图先重采样为这个尺寸的立方体贴图并生成 mip 链，预滤波与球谐投影都从它采样
+const int SOURCE_CUBE_SIZE = 256;
+
+// 球谐投影使用的源立方体贴图 mip 层（64x64），辐照度是极低频的信号，不需要更高的分辨率
+const int SH_SOURCE_LEVEL = 2;
+
+// 每个预滤波 texel 与每个 BRDF 查找表 texel 的重要性采样数
+const int PREFILTER_SAMPLE_COUNT = 256;
+const int BRDF_SAMPLE_COUNT = 512;
+
+// 缓存目录（相对于工作目录）、文件头与版本；预计算的算法或数据格式改变时增加版本，使旧缓存失效
+const char* IBL_CACHE_DIRECTORY = "ibl_cache";
+const uint32_t IBL_CACHE_MAGIC = 0x4c424947; // "GIBL"
+const uint32_t IBL_CACHE_VERSION = 1;
+
+// 立方体贴图的一个 mip 层，6 个面依次排列
+struct CubeLevel {
+    int size = 0;
+    std::vector<glm::vec3> texels;
+
+    glm::vec3& at(int face, int x, int y) { return texels[((size_t)face * size + y) * size + x]; }
+    const glm::vec3& at(int face, int x, int y) const { return texels[((size_t)face * size + y) * size + x]; }
+};
+
+// 等距柱状投影图像，第 0 行为图像顶部（+Y）
+struct EquirectImage {
+    int width = 0;
+    int height = 0;
+    std::vector<glm::vec3> pixels;
+};
+
+// 把 [0, count) 分给全部硬件线程，fn(index) 之间互不依赖
+template <typename Fn>
+void parallelFor(int count, Fn fn) {
+    unsigned int threadCount = std::max(1u, std::thread::hardware_concurrency());
+    std::atomic<int> next{0};
+    auto worker = [&]() {
+        for (int index = next++; index < count; index = next++) {
+            fn(index);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned int i = 1; i < threadCount; ++i) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+// 64 位 FNV-1a
+uint64_t hashBytes(uint64_t hash, const void* data, size_t size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// 舍入到最近的半精度浮点，超出范围的值截断为最大的有限值
+uint16_t floatToHalf(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign = (bits >> 16) & 0x8000;
+    uint32_t floatExponent = (bits >> 23) & 0xff;
+    uint32_t mantissa = bits & 0x7fffff;
+
+    if (floatExponent == 0xff) {
+        return (uint16_t)(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+    }
+    int exponent = (int)floatExponent - 127 + 15;
+    if (exponent >= 31) {
+        return (uint16_t)(sign | 0x7bff);
+    }
+    if (exponent <= 0) {
+        // 非规格化数
+        if (exponent < -10) {
+            return (uint16_t)sign;
+        }
+        mantissa |= 0x800000;
+        uint32_t shift = (uint32_t)(14 - exponent);
+        uint32_t half = mantissa >> shift;
+        half += (mantissa >> (shift - 1)) & 1;
+        return (uint16_t)(sign | half);
+    }
+
+    uint32_t half = ((uint32_t)exponent << 10) | (mantissa >> 13);
+    half += (mantissa >> 12) & 1;
+    return (uint16_t)(sign | std::min(half, 0x7bffu));
+}
+
+bool readFileBytes(const std::string& path, std::vector<unsigned char>& bytes) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return true;
+}
+
+// 解码 Radiance RGBE 图像：支持新式的逐行游程编码与未压缩的扫描线，只支持标准的 "-Y H +X W" 方向
+bool decodeRadianceHdr(const std::vector<unsigned char>& bytes, EquirectImage& image) {
+    size_t position = 0;
+    auto readLine = [&](std::string& line) {
+        line.clear();
+        while (position < bytes.size() && bytes[position] != '\n') {
+            line.push_back((char)bytes[position++]);
+        }
+        if (position >= bytes.size()) {
+            return false;
+        }
+        position++;
+        return true;
+    };
+
+    std::string line;
+    if (!readLine(line) || (line.rfind("#?RADIANCE", 0) != 0 && line.rfind("#?RGBE", 0) != 0)) {
+        return false;
+    }
+    // 头部以空行结束
+    while (readLine(line) && !line.empty()) {
+        if (line.rfind("FORMAT=", 0) == 0 && line != "FORMAT=32-bit_rle_rgbe") {
+            return false;
+        }
+    }
+    if (!readLine(line) || std::sscanf(line.c_str(), "-Y %d +X %d", &image.height, &image.width) != 2 ||
+        image.width <= 0 || image.height <= 0) {
+        return false;
+    }
+
+    int width = image.width;
+    image.pixels.resize((size_t)width * image.height);
+    std::vector<unsigned char> scanline((size_t)width * 4);
+
+    for (int y = 0; y < image.height; ++y) {
+        bool runLengthEncoded = width >= 8 && width < 0x8000 && position + 4 <= bytes.size() &&
+                                bytes[position] == 2 && bytes[position + 1] == 2 &&
+                                ((bytes[position + 2] << 8) | bytes[position + 3]) == width;
+        if (runLengthEncoded) {
+            // 4 个分量分别编码：计数大于 128 为重复 count - 128 次的一个字节，否则为 count 个原样的字节
+            position += 4;
+            for (int channel = 0; channel < 4; ++channel) {
+                int x = 0;
+                while (x < width) {
+                    if (position >= bytes.size()) {
+                        return false;
+                    }
+                    int count = bytes[position++];
+                    bool run = count > 128;
+                    count = run ? count - 128 : count;
+                    if (count == 0 || x + count > width || position + (run ? 1 : count) > bytes.size()) {
+                        return false;
+                    }
+                    for (int i = 0; i < count; ++i) {
+                        scanline[(size_t)(x + i) * 4 + channel] = run ? bytes[position] : bytes[position + i];
+                    }
+                    position += run ? 1 : count;
+                    x += count;
+                }
+            }
+        } else {
+            if (position + scanline.size() > bytes.size()) {
+                return false;
+            }
+            std::memcpy(scanline.data(), &bytes[position], scanline.size());
+            position += scanline.size();
+        }
+
+        for (int x = 0; x < width; ++x) {
+            const unsigned char* rgbe = &scanline[(size_t)x * 4];
+            float scale = rgbe[3] == 0 ? 0.0f : std::ldexp(1.0f, rgbe[3] - (128 + 8));
+            image.pixels[(size_t)y * width + x] = glm::vec3(rgbe[0], rgbe[1], rgbe[2]) * scale;
+        }
+    }
+    return true;
+}
+
+// 没有指定环境图时的天空：向地平线变白的蓝色渐变、暖色的太阳与深灰色的地面
+void generateSky(EquirectImage& image) {
+    image.width = 512;
+    image.height = 256;
+    image.pixels.resize((size_t)image.width * image.height);
+
+    glm::vec3 sunDirection = glm::normalize(glm::vec3(0.4f, 0.5f, -0.6f));
+    for (int y = 0; y < image.height; ++y) {
+        float theta = (y + 0.5f) / image.height * PI;
+        for (int x = 0; x < image.width; ++x) {
+            float phi = ((x + 0.5f) / image.width - 0.5f) * 2.0f * PI;
+            glm::vec3 direction(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+
+            glm::vec3 color;
+            if (direction.y >= 0.0f) {
+                float horizon = std::pow(1.0f - direction.y, 4.0f);
+                color = glm::mix(glm::vec3(0.25f, 0.45f, 0.9f), glm::vec3(0.9f, 0.9f, 0.95f), horizon);
+                float sun = glm::dot(direction, sunDirection);
+                color += sun > 0.9995f ? glm::vec3(500.0f, 450.0f, 350.0f) : glm::vec3(0.0f);
+                color += glm::vec3(1.0f, 0.8f, 0.5f) * std::pow(std::max(sun, 0.0f), 64.0f) * 2.0f;
+            } else {
+                color = glm::vec3(0.12f, 0.11f, 0.1f);
+            }
+            image.pixels[(size_t)y * image.width + x] = color;
+        }
+    }
+}
+
+// 立方体贴图面内坐标 s、t（[-1, 1]）对应的方向，面的朝向与 GL、Vulkan 的约定一致
+glm::vec3 cubeDirection(int face, float s, float t) {
+    switch (face) {
+    case 0: return glm::normalize(glm::vec3(1.0f, -t, -s));
+    case 1: return glm::normalize(glm::vec3(-1.0f, -t, s));
+    case 2: return glm::normalize(glm::vec3(s, 1.0f, t));
+    case 3: return glm::normalize(glm::vec3(s, -1.0f, -t));
+    case 4: return glm::normalize(glm::vec3(s, -t, 1.0f));
+    default: return glm::normalize(glm::vec3(-s, -t, -1.0f));
+    }
+}
+
+// cubeDirection 的逆：方向所在的面与面内坐标
+void cubeFaceCoordinates(const glm::vec3& direction, int& face, float& s, float& t) {
+    glm::vec3 a = glm::abs(direction);
+    float major, sc, tc;
+    if (a.x >= a.y && a.x >= a.z) {
+        face = direction.x > 0.0f ? 0 : 1;
+        major = a.x;
+        sc = direction.x > 0.0f ? -direction.z : direction.z;
+        tc = -direction.y;
+    } else if (a.y >= a.z) {
+        face = direction.y > 0.0f ? 2 : 3;
+        major = a.y;
+        sc = direction.x;
+        tc = direction.y > 0.0f ? direction.z : -direction.z;
+    } else {
+        face = direction.z > 0.0f ? 4 : 5;
+        major = a.z;
+        sc = direction.z > 0.0f ? direction.x : -direction.x;
+        tc = -direction.y;
+    }
+    s = sc / major;
+    t = tc / major;
+}
+
+glm::vec3 sampleEquirect(const EquirectImage& image, const glm::vec3& direction) {
+    float u = std::atan2(direction.z, direction.x) / (2.0f * PI) + 0.5f;
+    float v = std::acos(glm::clamp(direction.y, -1.0f, 1.0f)) / PI;
+
+    // 水平方向环绕，垂直方向截断
+    float x = u * image.width - 0.5f;
+    float y = glm::clamp(v * image.height - 0.5f, 0.0f, (float)(image.height - 1));
+    int x0 = (int)std::floor(x);
+    int y0 = (int)y;
+    float fx = x - x0;
+    float fy = y - y0;
+    int y1 = std::min(y0 + 1, image.height - 1);
+    x0 = (x0 % image.width + image.width) % image.width;
+    int x1 = (x0 + 1) % image.width;
+
+    auto pixel = [&](int px, int py) { return image.pixels[(size_t)py * image.width + px]; };
+    return glm::mix(glm::mix(pixel(x0, y0), pixel(x1, y0), fx), glm::mix(pixel(x0, y1), pixel(x1, y1), fx), fy);
+}
+
+// 面内双线性过滤，面的边缘截断（不跨面过滤）
+glm::vec3 sampleFace(const CubeLevel& level, int face, float s, float t) {
+    float x = glm::clamp((s * 0.5f + 0.5f) * level.size - 0.5f, 0.0f, (float)(level.size - 1));
+    float y = glm::clamp((t * 0.5f + 0.5f) * level.size - 0.5f, 0.0f, (float)(level.size - 1));
+    int x0 = (int)x;
+    int y0 = (int)y;
+    int x1 = std::min(x0 + 1, level.size - 1);
+    int y1 = std::min(y0 + 1, level.size - 1);
+    float fx = x - x0;
+    float fy = y - y0;
+    return glm::mix(glm::mix(level.at(face, x0, y0), level.at(face, x1, y0), fx),
+                    glm::mix(level.at(face, x0, y1), level.at(face, x1, y1), fx), fy);
+}
+
+// 三线性采样 mip 链
+glm::vec3 sampleCube(const std::vector<CubeLevel>& chain, const glm::vec3& direction, float lod) {
+    int face;
+    float s, t;
+    cubeFaceCoordinates(direction, face, s, t);
+    lod = glm::clamp(lod, 0.0f, (float)(chain.size() - 1));
+    int level0 = (int)lod;
+    int level1 = std::min(level0 + 1, (int)chain.size() - 1);
+    return glm::mix(sampleFace(chain[level0], face, s, t), sampleFace(chain[level1], face, s, t), lod - level0);
+}
+
+// 环境图重采样为 SOURCE_CUBE_SIZE 的立方体贴图（每个 texel 2x2 个样本），再逐层 2x2 平均生成 mip 链
+std::vector<CubeLevel> buildSourceCube(const EquirectImage& image) {
+    std::vector<CubeLevel> chain;
+    CubeLevel base;
+    base.size = SOURCE_CUBE_SIZE;
+    base.texels.resize((size_t)6 * base.size * base.size);
+    parallelFor(6 * base.size, [&](int row) {
+        int face = row / base.size;
+        int y = row % base.size;
+        for (int x = 0; x < base.size; ++x) {
+            glm::vec3 sum(0.0f);
+            for (int sy = 0; sy < 2; ++sy) {
+                for (int sx = 0; sx < 2; ++sx) {
+                    float s = 2.0f * (x + 0.25f + 0.5f * sx) / base.size - 1.0f;
+                    float t = 2.0f * (y + 0.25f + 0.5f * sy) / base.size - 1.0f;
+                    sum += sampleEquirect(image, cubeDirection(face, s, t));
+                }
+            }
+            base.at(face, x, y) = sum * 0.25f;
+        }
+    });
+    chain.push_back(std::move(base));
+
+    while (chain.back().size > 1) {
+        const CubeLevel& previous = chain.back();
+        CubeLevel level;
+        level.size = previous.size / 2;
+        level.texels.resize((size_t)6 * level.size * level.size);
+        for (int face = 0; face < 6; ++face) {
+            for (int y = 0; y < level.size; ++y) {
+                for (int x = 0; x < level.size; ++x) {
+                    level.at(face, x, y) = (previous.at(face, 2 * x, 2 * y) + previous.at(face, 2 * x + 1, 2 * y) +
+                                            previous.at(face, 2 * x, 2 * y + 1) +
+                                            previous.at(face, 2 * x + 1, 2 * y + 1)) * 0.25f;
+                }
+            }
+        }
+        chain.push_back(std::move(level));
+    }
+    return chain;
+}
+
+// 9 个实球谐基函数在单位方向上的值
+void shBasis(const glm::vec3& d, float basis[9]) {
+    basis[0] = 0.282095f;
+    basis[1] = 0.488603f * d.y;
+    basis[2] = 0.488603f * d.z;
+    basis[3] = 0.488603f * d.x;
+    basis[4] = 1.092548f * d.x * d.y;
+    basis[5] = 1.092548f * d.y * d.z;
+    basis[6] = 0.315392f * (3.0f * d.z * d.z - 1.0f);
+    basis[7] = 1.092548f * d.x * d.z;
+    basis[8] = 0.546274f * (d.x * d.x - d.y * d.y);
+}
+
+// 把辐射度投影到球谐上，再与余弦瓣卷积得到辐照度：各阶乘以 A0 = π、A1 = 2π/3、A2 = π/4，最后除以 π
+void projectIrradianceSH(const CubeLevel& level, glm::vec4 coefficients[9]) {
+    glm::vec3 faceSums[6][9] = {};
+    float faceWeights[6] = {};
+    parallelFor(6, [&](int face) {
+        for (int y = 0; y < level.size; ++y) {
+            for (int x = 0; x < level.size; ++x) {
+                float s = 2.0f * (x + 0.5f) / level.size - 1.0f;
+                float t = 2.0f * (y + 0.5f) / level.size - 1.0f;
+                // texel 对应的立体角
+                float weight = 1.0f / std::pow(1.0f + s * s + t * t, 1.5f);
+                float basis[9];
+                shBasis(cubeDirection(face, s, t), basis);
+                for (int i = 0; i < 9; ++i) {
+                    faceSums[face][i] += level.at(face, x, y) * basis[i] * weight;
+                }
+                faceWeights[face] += weight;
+            }
+        }
+    });
+
+    float totalWeight = 0.0f;
+    for (int face = 0; face < 6; ++face) {
+        totalWeight += faceWeights[face];
+    }
+    const float bandScale[9] = {1.0f, 2.0f / 3.0f, 2.0f / 3.0f, 2.0f / 3.0f, 0.25f, 0.25f, 0.25f, 0.25f, 0.25f};
+    for (int i = 0; i < 9; ++i) {
+        glm::vec3 sum(0.0f);
+        for (int face = 0; face < 6; ++face) {
+            sum += faceSums[face][i];
+        }
+        coefficients[i] = glm::vec4(sum * (4.0f * PI / totalWeight) * bandScale[i], 0.0f);
+    }
+}
+
+glm::vec2 hammersley(uint32_t i, uint32_t count) {
+    uint32_t bits = i;
+    bits = (bits << 16u) | (bits >> 16u);
+    bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+    bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+    bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+    bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+    return glm::vec2((float)i / (float)count, (float)bits * 2.3283064365386963e-10f);
+}
+
+// 切线空间（法线为 +Z）中按 GGX 分布重要性采样的半程向量
+glm::vec3 importanceSampleGGX(const glm::vec2& xi, float roughness) {
+    float a = roughness * roughness;
+    float phi = 2.0f * PI * xi.x;
+    float cosTheta = std::sqrt((1.0f - xi.y) / (1.0f + (a * a - 1.0f) * xi.y));
+    float sinTheta = std::sqrt(1.0f - cosTheta * cosTheta);
+    return glm::vec3(std::cos(phi) * sinTheta, std::sin(phi) * sinTheta, cosTheta);
+}
+
+// 预滤波的一个样本：切线空间中的光线方向、N·L 权重与采样源 mip 的 lod
+struct PrefilterSample {
+    glm::vec3 direction;
+    float weight;
+    float lod;
+};
+
+// 按 split-sum 近似（N = V = R）预滤波：样本只取决于粗糙度，切线空间中预先算好，逐 texel 只需变换方向。
+// 每个样本按其概率密度对应的立体角选择源 mip 层（filtered importance sampling），少量样本也没有噪点
+std::vector<PrefilterSample> prefilterSamples(float roughness) {
+    std::vector<PrefilterSample> samples;
+    float a2 = std::pow(roughness, 4.0f);
+    float texelSolidAngle = 4.0f * PI / (6.0f * SOURCE_CUBE_SIZE * SOURCE_CUBE_SIZE);
+    for (int i = 0; i < PREFILTER_SAMPLE_COUNT; ++i) {
+        glm::vec3 h = importanceSampleGGX(hammersley(i, PREFILTER_SAMPLE_COUNT), roughness);
+        glm::vec3 l = 2.0f * h.z * h - glm::vec3(0.0f, 0.0f, 1.0f);
+        if (l.z <= 0.0f) {
+            continue;
+        }
+        // N = V 时 pdf = D * (N·H) / (4 * V·H) = D / 4
+        float denominator = h.z * h.z * (a2 - 1.0f) + 1.0f;
+        float distribution = a2 / (PI * denominator * denominator);
+        float sampleSolidAngle = 1.0f / (PREFILTER_SAMPLE_COUNT * distribution * 0.25f + 0.0001f);
+        float lod = 0.5f * std::log2(sampleSolidAngle / texelSolidAngle) + 1.0f;
+        samples.push_back({glm::normalize(l), l.z, lod});
+    }
+    return samples;
+}
+
+void prefilterSpecular(const std::vector<CubeLevel>& source, std::vector<uint16_t>& specular) {
+    specular.assign(specularOffset(IBL_SPECULAR_MIP_LEVELS, 0), 0);
+
+    for (int level = 0; level < IBL_SPECULAR_MIP_LEVELS; ++level) {
+        int size = specularMipSize(level);
+        float roughness = (float)level / (IBL_SPECULAR_MIP_LEVELS - 1);
+        std::vector<PrefilterSample> samples = prefilterSamples(roughness);
+        // 粗糙度 0 为镜面反射，直接三线性采样源立方体贴图
+        float sourceLod = std::log2((float)SOURCE_CUBE_SIZE / size);
+
+        parallelFor(6 * size, [&](int row) {
+            int face = row / size;
+            int y = row % size;
+            uint16_t* out = &specular[specularOffset(level, face) + (size_t)y * size * 4];
+            for (int x = 0; x < size; ++x) {
+                glm::vec3 n = cubeDirection(face, 2.0f * (x + 0.5f) / size - 1.0f, 2.0f * (y + 0.5f) / size - 1.0f);
+                glm::vec3 color;
+                if (level == 0) {
+                    color = sampleCube(source, n, sourceLod);
+                } else {
+                    glm::vec3 up = std::abs(n.z) < 0.999f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+                    glm::vec3 tangent = glm::normalize(glm::cross(up, n));
+                    glm::vec3 bitangent = glm::cross(n, tangent);
+                    glm::vec3 sum(0.0f);
+                    float weight = 0.0f;
+                    for (const PrefilterSample& sample : samples) {
+                        glm::vec3 l = tangent * sample.direction.x + bitangent * sample.direction.y +
+                                      n * sample.direction.z;
+                        sum += sampleCube(source, l, sample.lod) * sample.weight;
+                        weight += sample.weight;
+                    }
+                    color = sum / std::max(weight, 0.0001f);
+                }
+                out[x * 4 + 0] = floatToHalf(color.r);
+                out[x * 4 + 1] = floatToHalf(color.g);
+                out[x * 4 + 2] = floatToHalf(color.b);
+                out[x * 4 + 3] = floatToHalf(1.0f);
+            }
+        });
+    }
+}
+
+// split-sum 的第二项：镜面反射 = 预滤波颜色 * (F0 * A + B)，A、B 只取决于 N·V 与粗糙度
+void integrateBrdfLut(std::vector<uint16_t>& lut) {
+    lut.assign((size_t)IBL_BRDF_LUT_SIZE * IBL_BRDF_LUT_SIZE * 2, 0);
+    parallelFor(IBL_BRDF_LUT_SIZE, [&](int y) {
+        float roughness = (y + 0.5f) / IBL_BRDF_LUT_SIZE;
+        // IBL 的 Schlick-GGX 几何项使用 k = α² / 2
+        float k = roughness * roughness * 0.5f;
+        for (int x = 0; x < IBL_BRDF_LUT_SIZE; ++x) {
+            float nDotV = (x + 0.5f) / IBL_BRDF_LUT_SIZE;
+            glm::vec3 v(std::sqrt(1.0f - nDotV * nDotV), 0.0f, nDotV);
+            float scale = 0.0f;
+            float bias = 0.0f;
+            for (int i = 0; i < BRDF_SAMPLE_COUNT; ++i) {
+                glm::vec3 h = importanceSampleGGX(hammersley(i, BRDF_SAMPLE_COUNT), roughness);
+                glm::vec3 l = 2.0f * glm::dot(v, h) * h - v;
+                float nDotL = l.z;
+                float nDotH = std::max(h.z, 0.0f);
+                float vDotH = std::max(glm::dot(v, h), 0.0f);
+                if (nDotL > 0.0f) {
+                    float g = (nDotV / (nDotV * (1.0f - k) + k)) * (nDotL / (nDotL * (1.0f - k) + k));
+                    float visibility = g * vDotH / (nDotH * nDotV);
+                    float fresnel = std::pow(1.0f - vDotH, 5.0f);
+                    scale += (1.0f - fresnel) * visibility;
+                    bias += fresnel * visibility;
+                }
+            }
+            size_t index = ((size_t)y * IBL_BRDF_LUT_SIZE + x) * 2;
+            lut[index] = floatToHalf(scale / BRDF_SAMPLE_COUNT);
+            lut[index + 1] = floatToHalf(bias / BRDF_SAMPLE_COUNT);
+        }
+    });
+}
+
+// 缓存文件：magic、版本与 64 位键，之后依次是各个数据块；任何一项与预期不符时视为无效
+struct CacheBlock {
+    void* data;
+    size_t size;
+};
+
+std::string cachePath(const char* prefix, uint64_t key) {
+    char name[64];
+    std::snprintf(name, sizeof(name), "%s_%016llx.bin", prefix, (unsigned long long)key);
+    return std::string(IBL_CACHE_DIRECTORY) + "/" + name;
+}
+
+bool readCacheFile(const std::string& path, uint64_t key, std::initializer_list<CacheBlock> blocks) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    uint32_t header[2] = {};
+    uint64_t fileKey = 0;
+    file.read(reinterpret_cast<char*>(header), sizeof(header));
+    file.read(reinterpret_cast<char*>(&fileKey), sizeof(fileKey));
+    if (!file || header[0] != IBL_CACHE_MAGIC || header[1] != IBL_CACHE_VERSION || fileKey != key) {
+        return false;
+    }
+    for (const CacheBlock& block : blocks) {
+        file.read(static_cast<char*>(block.data), (std::streamsize)block.size);
+    }
+    // 读完所有数据块后应恰好到达文件末尾
+    return file && file.peek() == std::char_traits<char>::eof();
+}
+
+void writeCacheFile(const std::string& path, uint64_t key, std::initializer_list<CacheBlock> blocks) {
+    std::error_code error;
+    std::filesystem::create_directories(IBL_CACHE_DIRECTORY, error);
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        std::cerr << "Failed to write IBL cache: " << path << std::endl;
+        return;
+    }
+    uint32_t header[2] = {IBL_CACHE_MAGIC, IBL_CACHE_VERSION};
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(&key), sizeof(key));
+    for (const CacheBlock& block : blocks) {
+        file.write(static_cast<const char*>(block.data), (std::streamsize)block.size);
+    }
+}
+
+} // namespace
+
+int specularMipSize(int level) {
+    return std::max(IBL_SPECULAR_SIZE >> level, 1);
+}
+
+size_t specularOffset(int level, int face) {
+    size_t offset = 0;
+    for (int i = 0; i < level; ++i) {
+        offset += (size_t)6 * specularMipSize(i) * specularMipSize(i) * 4;
+    }
+    return offset + (size_t)face * specularMipSize(level) * specularMipSize(level) * 4;
+}
+
+bool loadEnvironmentLighting(const std::string& hdrPath, bool useCache, EnvironmentLighting& lighting) {
+    auto start = std::chrono::steady_clock::now();
+
+    // 键先包含版本与所有影响结果的参数
+    const int environmentParameters[] = {(int)IBL_CACHE_VERSION, SOURCE_CUBE_SIZE, SH_SOURCE_LEVEL, IBL_SPECULAR_SIZE,
+                                         IBL_SPECULAR_MIP_LEVELS, PREFILTER_SAMPLE_COUNT};
+    const int brdfParameters[] = {(int)IBL_CACHE_VERSION, IBL_BRDF_LUT_SIZE, BRDF_SAMPLE_COUNT};
+    uint64_t environmentKey = hashBytes(14695981039346656037ull, environmentParameters, sizeof(environmentParameters));
+    uint64_t brdfKey = hashBytes(14695981039346656037ull, brdfParameters, sizeof(brdfParameters));
+
+    // 源文件只读取字节并计算哈希，缓存命中时不需要解码
+    std::vector<unsigned char> hdrBytes;
+    if (!hdrPath.empty()) {
+        if (!readFileBytes(hdrPath, hdrBytes)) {
+            std::cerr << "Failed to open environment map: " << hdrPath << std::endl;
+            return false;
+        }
+        environmentKey = hashBytes(environmentKey, hdrBytes.data(), hdrBytes.size());
+    } else {
+        const char procedural[] = "procedural sky";
+        environmentKey = hashBytes(environmentKey, procedural, sizeof(procedural));
+    }
+
+    lighting.specular.assign(specularOffset(IBL_SPECULAR_MIP_LEVELS, 0), 0);
+    std::string environmentPath = cachePath("environment", environmentKey);
+    lighting.environmentFromCache =
+        useCache && readCacheFile(environmentPath, environmentKey,
+                                  {{lighting.irradianceSH, sizeof(lighting.irradianceSH)},
+                                   {lighting.specular.data(), lighting.specular.size() * sizeof(uint16_t)}});
+    if (!lighting.environmentFromCache) {
+        EquirectImage image;
+        if (hdrPath.empty()) {
+            generateSky(image);
+        } else if (!decodeRadianceHdr(hdrBytes, image)) {
+            std::cerr << "Failed to decode Radiance HDR image: " << hdrPath << std::endl;
+            return false;
+        }
+
+        std::vector<CubeLevel> source = buildSourceCube(image);
+        projectIrradianceSH(source[SH_SOURCE_LEVEL], lighting.irradianceSH);
+        prefilterSpecular(source, lighting.specular);
+        if (useCache) {
+            writeCacheFile(environmentPath, environmentKey,
+                           {{lighting.irradianceSH, sizeof(lighting.irradianceSH)},
+                            {lighting.specular.data(), lighting.specular.size() * sizeof(uint16_t)}});
+        }
+    }
+
+    lighting.brdfLut.assign((size_t)IBL_BRDF_LUT_SIZE * IBL_BRDF_LUT_SIZE * 2, 0);
+    std::string brdfPath = cachePath("brdf_lut", brdfKey);
+    lighting.brdfLutFromCache =
+        useCache && readCacheFile(brdfPath, brdfKey, {{lighting.brdfLut.data(), lighting.brdfLut.size() * sizeof(uint16_t)}});
+    if (!lighting.brdfLutFromCache) {
+        integrateBrdfLut(lighting.brdfLut);
+        if (useCache) {
+            writeCacheFile(brdfPath, brdfKey, {{lighting.brdfLut.data(), lighting.brdfLut.size() * sizeof(uint16_t)}});
+        }
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    lighting.milliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+    return true;
+}
+
+void reportEnvironmentLighting(const EnvironmentLighting& lighting) {
+    std::cout << "Environment lighting: irradiance SH and prefiltered specular "
+              << (lighting.environmentFromCache ? "from cache" : "computed") << ", BRDF LUT "
+              << (lighting.brdfLutFromCache ? "from cache" : "computed") << ", " << lighting.milliseconds << " ms"
+              << std::endl;
+}
@@ -0,0 +1,107 @@
+// image_io.cpp
+// PPM图像读写
+
+#include "image_io.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+
+// 跳过PPM头中的空白与 # 注释
+void skipWhitespaceAndComments(std::istream& in) {
+    while (in) {
+        int c = in.peek();
+        if (c == '#') {
+            std::string comment;
+            std::getline(in, comment);
+        } else if (std::isspace(c)) {
+            in.get();
+        } else {
+            break;
+        }
+    }
+}
+
+uint8_t quantize(float value) {
+    return static_cast<uint8_t>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+} // namespace
+
+void writePPM(const std::string& filename, uint32_t width, uint32_t height, const std::vector<glm::vec3>& pixels) {
+    if (pixels.size() != static_cast<size_t>(width) * height) {
+        throw std::runtime_error("image size does not match pixel count! " + filename);
+    }
+
+    std::ofstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("failed to open file! " + filename);
+    }
+
+    file << "P6\n" << width << " " << height << "\n255\n";
+
+    std::vector<uint8_t> row(static_cast<size_t>(width) * 3);
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            const glm::vec3& color = pixels[static_cast<size_t>(y) * width + x];
+            row[x * 3 + 0] = quantize(color.r);
+            row[x * 3 + 1] = quantize(color.g);
+            row[x * 3 + 2] = quantize(color.b);
+        }
+        file.write(reinterpret_cast<const char*>(row.data()), static_cast<std::streamsize>(row.size()));
+    }
+
+    if (!file) {
+        throw std::runtime_error("failed to write file! " + filename);
+    }
+}
+
+void readPPM(const std::string& filename, uint32_t& width, uint32_t& height, std::vector<glm::vec3>& pixels) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("failed to open file! " + filename);
+    }
+
+    std::string magic;
+    file >> magic;
+    if (magic != "P6") {
+        throw std::runtime_error("only binary PPM (P6) is supported! " + filename);
+    }
+
+    uint32_t maxValue = 0;
+    skipWhitespaceAndComments(file);
+    file >> width;
+    skipWhitespaceAndComments(file);
+    file >> height;
+    skipWhitespaceAndComments(file);
+    file >> maxValue;
+    file.get();
+
+    if (!file || maxValue != 255 || width == 0 || height == 0) {
+        throw std::runtime_error("unsupported PPM header! " + filename);
+    }
+
+    std::vector<uint8_t> data(static_cast<size_t>(width) * height * 3);
+    file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    if (!file) {
+        throw std::runtime_error("unexpected end of PPM data! " + filename);
+    }
+
+    pixels.resize(static_cast<size_t>(width) * height);
+    for (size_t i = 0; i < pixels.size(); i++) {
+        pixels[i] = glm::vec3(data[i * 3 + 0], data[i * 3 + 1], data[i * 3 + 2]) / 255.0f;
+    }
+}
+
+glm::vec3 linearToSrgb(const glm::vec3& color) {
+    glm::vec3 result;
+    for (int i = 0; i < 3; i++) {
+        float c = std::clamp(color[i], 0.0f, 1.0f);
+        result[i] = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+    }
+    return result;
+}
@@ -0,0 +1,22 @@
+// gpu_timer.h
+// GPU计时：GL_TIME_ELAPSED 查询，两个查询对象交替使用，结果隔一帧读取以免等待GPU
+
+#pragma once
+
+#include <GL/glew.h>
+
+struct GpuTimer {
+    GLuint queries[2] = {};
+    bool pending[2] = {};
+    int frame = 0;
+    // 最近一次读到的耗时
+    double milliseconds = 0.0;
+};
+
+void createGpuTimer(GpuTimer& timer);
+
+// 同一时刻只能有一个 GL_TIME_ELAPSED 查询处于活动状态，计时区间不能嵌套
+void beginGpuTimer(GpuTimer& timer);
+void endGpuTimer(GpuTimer& timer);
+
+void destroyGpuTimer(GpuTimer& timer);
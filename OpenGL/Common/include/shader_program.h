@@ -0,0 +1,128 @@
+// shader_program.h
+// 着色器程序与 std140 uniform 缓冲区，OpenGL/Projects 下的各项目共用
+//
+// ShaderProgram 在链接成功后一次性反射所有活动的 uniform 与 uniform 块：逐次绘制的 uniform 在初始化时
+// 用 uniformLocation 取得位置并缓存，渲染时不再按字符串查询；每帧共享的数据（相机、光源）放在 uniform 块中，
+// 用 bindUniformBlock 连接到固定的绑定点，由 UniformBuffer 每帧更新、绑定一次，所有程序共用
+//
+// 链接好的程序用 glGetProgramBinary 保存到 shader_cache/ 目录，键为着色器源码（包含其中的 #define）、
+// 反馈变量以及驱动的厂商、渲染器、版本字符串的哈希；之后启动时直接用 glProgramBinary 加载，
+// 驱动拒绝二进制（驱动更新等）时重新编译并覆盖缓存。驱动不支持程序二进制时总是从源码编译
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// 读取着色器文件
+std::string readShaderFile(const char* filePath);
+
+// 编译着色器，失败时返回 0
+GLuint compileShader(GLenum type, const char* source);
+
+// 程序创建的统计：从缓存加载与从源码编译的程序数，以及创建程序（读取文件、编译链接或加载二进制）的总耗时
+struct ShaderCacheStats {
+    int cachedPrograms = 0;
+    int compiledPrograms = 0;
+    double milliseconds = 0.0;
+};
+
+const ShaderCacheStats& shaderCacheStats();
+
+// 输出 shaderCacheStats()，删除 shader_cache/ 后的第一次启动为冷启动
+void reportShaderCacheStats();
+
+// 关闭后既不读取也不写入缓存，用于测量冷启动
+void setShaderCacheEnabled(bool enabled);
+
+class ShaderProgram {
+public:
+    ShaderProgram() = default;
+    ~ShaderProgram();
+
+    ShaderProgram(const ShaderProgram&) = delete;
+    ShaderProgram& operator=(const ShaderProgram&) = delete;
+    ShaderProgram(ShaderProgram&& other) noexcept;
+    ShaderProgram& operator=(ShaderProgram&& other) noexcept;
+
+    // 由顶点、片段着色器组成的程序
+    bool load(const char* vertexPath, const char* fragmentPath);
+
+    // 带几何着色器的程序（例如分层渲染到纹理数组的各层）
+    bool load(const char* vertexPath, const char* geometryPath, const char* fragmentPath);
+
+    // 计算着色器程序（GL 4.3）
+    bool loadCompute(const char* computePath);
+
+    // 只有顶点着色器的变换反馈程序，varyings 按交错（GL_INTERLEAVED_ATTRIBS）顺序写入反馈缓冲区
+    bool loadFeedback(const char* vertexPath, const char* const* varyings, int varyingCount);
+
+    // 删除程序；程序为 0 时不调用 GL，上下文销毁后的析构是安全的
+    void destroy();
+
+    GLuint id() const { return program; }
+    explicit operator bool() const { return program != 0; }
+    void use() const { glUseProgram(program); }
+
+    // 反射得到的位置；数组既可以用 "name" 也可以用 "name[i]" 查询。不存在或被优化掉时返回 -1（glUniform* 会忽略）
+    GLint uniformLocation(const std::string& name) const;
+
+    // 把名为 name 的 uniform 块连接到绑定点 binding；expectedSize 不为 0 时检查块的大小与 C++ 结构体一致
+    // 程序中没有这个块时返回 false（不是错误，例如只用到一部分帧数据的程序）
+    bool bindUniformBlock(const char* name, GLuint binding, GLsizeiptr expectedSize = 0) const;
+
+private:
+    struct UniformBlock {
+        GLuint index;
+        GLint size;
+    };
+
+    struct ShaderSource {
+        GLenum type;
+        const char* path;
+        std::string code;
+    };
+
+    // 先尝试从缓存加载，失败时编译、链接并写入缓存
+    bool build(const std::vector<ShaderSource>& sources, const char* const* varyings, int varyingCount);
+    bool link(GLuint newProgram, const GLuint* shaders, int shaderCount);
+    void adopt(GLuint newProgram);
+    void reflect();
+
+    GLuint program = 0;
+    std::unordered_map<std::string, GLint> uniforms;
+    std::unordered_map<std::string, UniformBlock> blocks;
+};
+
+// 每帧更新一次的 uniform 缓冲区，内容按 std140 布局（C++ 结构体中 vec3 需补齐为 vec4）
+class UniformBuffer {
+public:
+    UniformBuffer() = default;
+    ~UniformBuffer();
+
+    UniformBuffer(const UniformBuffer&) = delete;
+    UniformBuffer& operator=(const UniformBuffer&) = delete;
+    UniformBuffer(UniformBuffer&& other) noexcept;
+    UniformBuffer& operator=(UniformBuffer&& other) noexcept;
+
+    bool create(GLsizeiptr size, GLuint binding);
+    void destroy();
+
+    // 更新全部内容并绑定到创建时指定的绑定点
+    void update(const void* data, GLsizeiptr dataSize);
+
+    template <typename T>
+    void update(const T& data) {
+        update(&data, sizeof(T));
+    }
+
+    GLuint id() const { return buffer; }
+
+private:
+    GLuint buffer = 0;
+    GLsizeiptr size = 0;
+    GLuint binding = 0;
+};
@@ -0,0 +1,30 @@
+// gpu_timer.cpp
+// GL_TIME_ELAPSED 查询的交替使用
+
+#include "gpu_timer.h"
+
+void createGpuTimer(GpuTimer& timer) {
+    glGenQueries(2, timer.queries);
+}
+
+void beginGpuTimer(GpuTimer& timer) {
+    // 读取两帧前同一个查询对象的结果，此时GPU通常早已完成
+    int query = timer.frame % 2;
+    if (timer.pending[query]) {
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(timer.queries[query], GL_QUERY_RESULT, &elapsed);
+        timer.milliseconds = elapsed / 1e6;
+    }
+    glBeginQuery(GL_TIME_ELAPSED, timer.queries[query]);
+}
+
+void endGpuTimer(GpuTimer& timer) {
+    glEndQuery(GL_TIME_ELAPSED);
+    timer.pending[timer.frame % 2] = true;
+    timer.frame++;
+}
+
+void destroyGpuTimer(GpuTimer& timer) {
+    glDeleteQueries(2, timer.queries);
+    timer = GpuTimer();
+}
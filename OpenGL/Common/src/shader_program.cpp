@@ -0,0 +1,406 @@
+// shader_program.cpp
+// 着色器编译、程序链接与反射，uniform 缓冲区
+
+#include "shader_program.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// 程序二进制缓存的目录（相对于工作目录，与 shaders/ 并列）与文件头
+const char* SHADER_CACHE_DIRECTORY = "shader_cache";
+const uint32_t SHADER_CACHE_MAGIC = 0x42504c47; // "GLPB"
+
+ShaderCacheStats cacheStats;
+bool cacheEnabled = true;
+
+// 64 位 FNV-1a
+uint64_t hashBytes(uint64_t hash, const void* data, size_t size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+uint64_t hashString(uint64_t hash, const char* text) {
+    // 连同结尾的 0 一起计入，相邻的字符串不会拼接成相同的输入
+    return text ? hashBytes(hash, text, std::strlen(text) + 1) : hashBytes(hash, "", 1);
+}
+
+bool supportsProgramBinary() {
+    if (!GLEW_VERSION_4_1 && !GLEW_ARB_get_program_binary) {
+        return false;
+    }
+    // 驱动可以支持扩展但不提供任何二进制格式
+    GLint formatCount = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+    return formatCount > 0;
+}
+
+// 加载缓存的程序二进制，文件不存在或被驱动拒绝时返回 0
+GLuint loadCachedProgram(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return 0;
+    }
+
+    uint32_t header[2] = {};
+    file.read(reinterpret_cast<char*>(header), sizeof(header));
+    if (!file || header[0] != SHADER_CACHE_MAGIC) {
+        return 0;
+    }
+    std::vector<char> binary((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (binary.empty()) {
+        return 0;
+    }
+
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, (GLenum)header[1], binary.data(), (GLsizei)binary.size());
+    GLint success = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+void saveCachedProgram(GLuint program, const std::string& path) {
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(program, length, NULL, &format, binary.data());
+
+    std::error_code error;
+    std::filesystem::create_directories(SHADER_CACHE_DIRECTORY, error);
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        std::cerr << "Failed to write shader cache: " << path << std::endl;
+        return;
+    }
+    uint32_t header[2] = {SHADER_CACHE_MAGIC, format};
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+    file.write(binary.data(), binary.size());
+}
+
+} // namespace
+
+const ShaderCacheStats& shaderCacheStats() {
+    return cacheStats;
+}
+
+void reportShaderCacheStats() {
+    std::cout << "Shader programs: " << cacheStats.cachedPrograms << " from cache, " << cacheStats.compiledPrograms
+              << " compiled, " << cacheStats.milliseconds << " ms" << std::endl;
+}
+
+void setShaderCacheEnabled(bool enabled) {
+    cacheEnabled = enabled;
+}
+
+// 读取着色器文件
+std::string readShaderFile(const char* filePath) {
+    std::ifstream file(filePath);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open shader file: " << filePath << std::endl;
+        return "";
+    }
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return buffer.str();
+}
+
+// 编译着色器
+GLuint compileShader(GLenum type, const char* source) {
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
+
+    GLint success;
+    GLchar infoLog[512];
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        glGetShaderInfoLog(shader, 512, NULL, infoLog);
+        std::cerr << "Shader compilation failed: " << infoLog << std::endl;
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+ShaderProgram::~ShaderProgram() {
+    destroy();
+}
+
+ShaderProgram::ShaderProgram(ShaderProgram&& other) noexcept {
+    *this = std::move(other);
+}
+
+ShaderProgram& ShaderProgram::operator=(ShaderProgram&& other) noexcept {
+    std::swap(program, other.program);
+    std::swap(uniforms, other.uniforms);
+    std::swap(blocks, other.blocks);
+    return *this;
+}
+
+bool ShaderProgram::load(const char* vertexPath, const char* fragmentPath) {
+    return build({{GL_VERTEX_SHADER, vertexPath, readShaderFile(vertexPath)},
+                  {GL_FRAGMENT_SHADER, fragmentPath, readShaderFile(fragmentPath)}},
+                 nullptr, 0);
+}
+
+bool ShaderProgram::load(const char* vertexPath, const char* geometryPath, const char* fragmentPath) {
+    return build({{GL_VERTEX_SHADER, vertexPath, readShaderFile(vertexPath)},
+                  {GL_GEOMETRY_SHADER, geometryPath, readShaderFile(geometryPath)},
+                  {GL_FRAGMENT_SHADER, fragmentPath, readShaderFile(fragmentPath)}},
+                 nullptr, 0);
+}
+
+bool ShaderProgram::loadCompute(const char* computePath) {
+    return build({{GL_COMPUTE_SHADER, computePath, readShaderFile(computePath)}}, nullptr, 0);
+}
+
+bool ShaderProgram::loadFeedback(const char* vertexPath, const char* const* varyings, int varyingCount) {
+    return build({{GL_VERTEX_SHADER, vertexPath, readShaderFile(vertexPath)}}, varyings, varyingCount);
+}
+
+bool ShaderProgram::build(const std::vector<ShaderSource>& sources, const char* const* varyings, int varyingCount) {
+    auto start = std::chrono::steady_clock::now();
+    auto finish = [&]() {
+        auto end = std::chrono::steady_clock::now();
+        cacheStats.milliseconds += std::chrono::duration<double, std::milli>(end - start).count();
+    };
+
+    std::string cachePath;
+    if (cacheEnabled && supportsProgramBinary()) {
+        uint64_t hash = 14695981039346656037ull;
+        for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION, GL_SHADING_LANGUAGE_VERSION}) {
+            hash = hashString(hash, reinterpret_cast<const char*>(glGetString(name)));
+        }
+        for (const ShaderSource& source : sources) {
+            hash = hashBytes(hash, &source.type, sizeof(source.type));
+            hash = hashString(hash, source.code.c_str());
+        }
+        for (int i = 0; i < varyingCount; ++i) {
+            hash = hashString(hash, varyings[i]);
+        }
+
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)hash);
+        cachePath = std::string(SHADER_CACHE_DIRECTORY) + "/" + name;
+
+        GLuint cached = loadCachedProgram(cachePath);
+        if (cached) {
+            adopt(cached);
+            cacheStats.cachedPrograms++;
+            finish();
+            return true;
+        }
+    }
+
+    std::vector<GLuint> shaders;
+    for (const ShaderSource& source : sources) {
+        GLuint shader = compileShader(source.type, source.code.c_str());
+        if (!shader) {
+            std::cerr << "Failed to compile " << source.path << std::endl;
+            for (GLuint compiled : shaders) {
+                glDeleteShader(compiled);
+            }
+            return false;
+        }
+        shaders.push_back(shader);
+    }
+
+    // 变换反馈的输出变量与二进制可读取的提示都需要在链接前指定
+    GLuint newProgram = glCreateProgram();
+    if (varyingCount > 0) {
+        glTransformFeedbackVaryings(newProgram, varyingCount, varyings, GL_INTERLEAVED_ATTRIBS);
+    }
+    if (!cachePath.empty()) {
+        glProgramParameteri(newProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    if (!link(newProgram, shaders.data(), (int)shaders.size())) {
+        return false;
+    }
+
+    if (!cachePath.empty()) {
+        saveCachedProgram(program, cachePath);
+    }
+    cacheStats.compiledPrograms++;
+    finish();
+    return true;
+}
+
+void ShaderProgram::destroy() {
+    if (program) {
+        glDeleteProgram(program);
+    }
+    program = 0;
+    uniforms.clear();
+    blocks.clear();
+}
+
+// 链接程序并检查结果，链接后着色器对象不再需要
+bool ShaderProgram::link(GLuint newProgram, const GLuint* shaders, int shaderCount) {
+    for (int i = 0; i < shaderCount; ++i) {
+        glAttachShader(newProgram, shaders[i]);
+    }
+    glLinkProgram(newProgram);
+
+    for (int i = 0; i < shaderCount; ++i) {
+        glDeleteShader(shaders[i]);
+    }
+
+    GLint success;
+    GLchar infoLog[512];
+    glGetProgramiv(newProgram, GL_LINK_STATUS, &success);
+    if (!success) {
+        glGetProgramInfoLog(newProgram, 512, NULL, infoLog);
+        std::cerr << "Program linking failed: " << infoLog << std::endl;
+        glDeleteProgram(newProgram);
+        return false;
+    }
+
+    adopt(newProgram);
+    return true;
+}
+
+void ShaderProgram::adopt(GLuint newProgram) {
+    destroy();
+    program = newProgram;
+    reflect();
+}
+
+// 记录所有活动 uniform 的位置与 uniform 块的索引、大小
+void ShaderProgram::reflect() {
+    GLint uniformCount = 0;
+    GLint maxNameLength = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &uniformCount);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+    std::vector<GLchar> nameBuffer(maxNameLength + 1);
+    for (GLint i = 0; i < uniformCount; ++i) {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(program, (GLuint)i, (GLsizei)nameBuffer.size(), &length, &size, &type, nameBuffer.data());
+        std::string name(nameBuffer.data(), length);
+
+        // uniform 块中的成员没有位置
+        GLint location = glGetUniformLocation(program, name.c_str());
+        if (location < 0) {
+            continue;
+        }
+        uniforms[name] = location;
+
+        // 数组只报告第一个元素 "name[0]"，补上不带下标的名字与其余元素
+        size_t bracket = name.rfind("[0]");
+        if (bracket != std::string::npos && bracket + 3 == name.size()) {
+            std::string base = name.substr(0, bracket);
+            uniforms[base] = location;
+            for (GLint element = 1; element < size; ++element) {
+                std::string elementName = base + "[" + std::to_string(element) + "]";
+                uniforms[elementName] = glGetUniformLocation(program, elementName.c_str());
+            }
+        }
+    }
+
+    GLint blockCount = 0;
+    GLint maxBlockNameLength = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCKS, &blockCount);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxBlockNameLength);
+
+    nameBuffer.assign(maxBlockNameLength + 1, 0);
+    for (GLint i = 0; i < blockCount; ++i) {
+        GLsizei length = 0;
+        glGetActiveUniformBlockName(program, (GLuint)i, (GLsizei)nameBuffer.size(), &length, nameBuffer.data());
+
+        UniformBlock block;
+        block.index = (GLuint)i;
+        glGetActiveUniformBlockiv(program, block.index, GL_UNIFORM_BLOCK_DATA_SIZE, &block.size);
+        blocks[std::string(nameBuffer.data(), length)] = block;
+    }
+}
+
+GLint ShaderProgram::uniformLocation(const std::string& name) const {
+    auto it = uniforms.find(name);
+    return it != uniforms.end() ? it->second : -1;
+}
+
+bool ShaderProgram::bindUniformBlock(const char* name, GLuint binding, GLsizeiptr expectedSize) const {
+    auto it = blocks.find(name);
+    if (it == blocks.end()) {
+        return false;
+    }
+
+    if (expectedSize != 0 && it->second.size != expectedSize) {
+        std::cerr << "Uniform block " << name << " is " << it->second.size << " bytes, expected " << expectedSize
+                  << " (check std140 padding)" << std::endl;
+    }
+    glUniformBlockBinding(program, it->second.index, binding);
+    return true;
+}
+
+UniformBuffer::~UniformBuffer() {
+    destroy();
+}
+
+UniformBuffer::UniformBuffer(UniformBuffer&& other) noexcept {
+    *this = std::move(other);
+}
+
+UniformBuffer& UniformBuffer::operator=(UniformBuffer&& other) noexcept {
+    std::swap(buffer, other.buffer);
+    std::swap(size, other.size);
+    std::swap(binding, other.binding);
+    return *this;
+}
+
+bool UniformBuffer::create(GLsizeiptr bufferSize, GLuint bindingPoint) {
+    destroy();
+
+    size = bufferSize;
+    binding = bindingPoint;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    glBufferData(GL_UNIFORM_BUFFER, size, NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, binding, buffer);
+    return buffer != 0;
+}
+
+void UniformBuffer::destroy() {
+    if (buffer) {
+        glDeleteBuffers(1, &buffer);
+    }
+    buffer = 0;
+    size = 0;
+}
+
+void UniformBuffer::update(const void* data, GLsizeiptr dataSize) {
+    if (dataSize > size) {
+        std::cerr << "Uniform buffer update of " << dataSize << " bytes exceeds its size " << size << std::endl;
+        return;
+    }
+
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, dataSize, data);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, binding, buffer);
+}
@@ -1,9 +1,76 @@
 #version 330 core
 
-in vec3 ourColor;
+// 前向着色：每个片段遍历所有光源，用于与延迟着色对比
+#define MAX_LIGHTS 256
+
+in vec3 viewPosition;
+in vec3 viewNormal;
 out vec4 FragColor;
 
+// 逐次绘制的材质
+uniform vec3 albedo;
+uniform float metallic;
+uniform float roughness;
+
+uniform vec3 ambient;
+
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 inverseProjection;
+    vec4 screenSize;
+    ivec4 lightParams;
+};
+
+// 每个光源两个 vec4：(世界空间位置, 作用半径)、(颜色, 0)
+layout(std140) uniform LightData {
+    vec4 lights[MAX_LIGHTS * 2];
+};
+
+const float PI = 3.14159265359;
+
+// 一个点光源的 Cook-Torrance 反射（GGX、Smith-Schlick、Schlick 菲涅尔），距离衰减在作用半径处平滑地降到 0
+vec3 shadeLight(int light, vec3 P, vec3 N, vec3 V, vec3 surfaceAlbedo, float surfaceMetallic, float surfaceRoughness)
+{
+    vec3 lightPosition = (view * vec4(lights[light * 2].xyz, 1.0)).xyz;
+    float radius = lights[light * 2].w;
+    vec3 toLight = lightPosition - P;
+    float lightDistance = length(toLight);
+    if (lightDistance >= radius)
+        return vec3(0.0);
+    vec3 L = toLight / lightDistance;
+    vec3 H = normalize(V + L);
+    float NdotL = max(dot(N, L), 0.0);
+    float NdotV = max(dot(N, V), 0.0);
+    float window = clamp(1.0 - pow(lightDistance / radius, 4.0), 0.0, 1.0);
+    vec3 radiance = lights[light * 2 + 1].rgb * window * window / max(lightDistance * lightDistance, 0.01);
+
+    float a = surfaceRoughness * surfaceRoughness;
+    float a2 = a * a;
+    float NdotH = max(dot(N, H), 0.0);
+    float denom = NdotH * NdotH * (a2 - 1.0) + 1.0;
+    float D = a2 / (PI * denom * denom);
+    float k = (surfaceRoughness + 1.0) * (surfaceRoughness + 1.0) / 8.0;
+    float G = NdotV / (NdotV * (1.0 - k) + k) * NdotL / (NdotL * (1.0 - k) + k);
+    vec3 F0 = mix(vec3(0.04), surfaceAlbedo, surfaceMetallic);
+    vec3 F = F0 + (1.0 - F0) * pow(clamp(1.0 - dot(H, V), 0.0, 1.0), 5.0);
+
+    vec3 specular = D * G * F / (4.0 * NdotV * NdotL + 0.0001);
+    vec3 kD = (vec3(1.0) - F) * (1.0 - surfaceMetallic);
+    return (kD * surfaceAlbedo / PI + specular) * radiance * NdotL;
+}
+
 void main()
 {
-    FragColor = vec4(ourColor, 1.0);
+    vec3 N = normalize(viewNormal);
+    vec3 V = normalize(-viewPosition);
+    vec3 color = ambient * albedo;
+    for (int i = 0; i < lightParams.x; ++i) {
+        color += shadeLight(i, viewPosition, N, V, albedo, metallic, roughness);
+    }
+
+    // 色调映射和伽马校正，与 resolve.frag 一致
+    color = color / (color + vec3(1.0));
+    color = pow(color, vec3(1.0 / 2.2));
+    FragColor = vec4(color, 1.0);
 }
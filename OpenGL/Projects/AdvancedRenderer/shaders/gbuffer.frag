@@ -0,0 +1,31 @@
+#version 330 core
+
+// 几何通道：材质与八面体编码的视图空间法线写入 G-buffer（见 src/gbuffer.h）
+
+in vec3 viewPosition;
+in vec3 viewNormal;
+
+layout (location = 0) out vec4 albedoMetallic;
+layout (location = 1) out vec4 normalRoughness;
+
+uniform vec3 albedo;
+uniform float metallic;
+uniform float roughness;
+
+// 单位向量投影到八面体 |x| + |y| + |z| = 1 上再展开到 [-1, 1]²，下半球沿对角线折到外侧
+vec2 encodeOctahedral(vec3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 e = n.xy;
+    if (n.z < 0.0) {
+        vec2 signs = vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+        e = (1.0 - abs(n.yx)) * signs;
+    }
+    return e * 0.5 + 0.5;
+}
+
+void main()
+{
+    albedoMetallic = vec4(albedo, metallic);
+    normalRoughness = vec4(encodeOctahedral(normalize(viewNormal)), roughness, 0.0);
+}
@@ -0,0 +1,88 @@
+#version 330 core
+
+// 光源体积覆盖的像素：从 G-buffer 读取材质，由深度重建视图空间位置，计算一个光源的反射。
+// alpha 输出 1，加法混合后为读取该像素的光源数（调试视图用）
+
+#define MAX_LIGHTS 256
+
+flat in int lightIndex;
+out vec4 FragColor;
+
+uniform sampler2D albedoMetallic;
+uniform sampler2D normalRoughness;
+uniform sampler2D depthTexture;
+
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 inverseProjection;
+    vec4 screenSize;
+    ivec4 lightParams;
+};
+
+layout(std140) uniform LightData {
+    vec4 lights[MAX_LIGHTS * 2];
+};
+
+const float PI = 3.14159265359;
+
+vec3 decodeOctahedral(vec2 e)
+{
+    vec2 f = e * 2.0 - 1.0;
+    vec3 n = vec3(f, 1.0 - abs(f.x) - abs(f.y));
+    float t = clamp(-n.z, 0.0, 1.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
+// 与 fragment.glsl 中的 shadeLight 相同
+vec3 shadeLight(int light, vec3 P, vec3 N, vec3 V, vec3 surfaceAlbedo, float surfaceMetallic, float surfaceRoughness)
+{
+    vec3 lightPosition = (view * vec4(lights[light * 2].xyz, 1.0)).xyz;
+    float radius = lights[light * 2].w;
+    vec3 toLight = lightPosition - P;
+    float lightDistance = length(toLight);
+    if (lightDistance >= radius)
+        return vec3(0.0);
+    vec3 L = toLight / lightDistance;
+    vec3 H = normalize(V + L);
+    float NdotL = max(dot(N, L), 0.0);
+    float NdotV = max(dot(N, V), 0.0);
+    float window = clamp(1.0 - pow(lightDistance / radius, 4.0), 0.0, 1.0);
+    vec3 radiance = lights[light * 2 + 1].rgb * window * window / max(lightDistance * lightDistance, 0.01);
+
+    float a = surfaceRoughness * surfaceRoughness;
+    float a2 = a * a;
+    float NdotH = max(dot(N, H), 0.0);
+    float denom = NdotH * NdotH * (a2 - 1.0) + 1.0;
+    float D = a2 / (PI * denom * denom);
+    float k = (surfaceRoughness + 1.0) * (surfaceRoughness + 1.0) / 8.0;
+    float G = NdotV / (NdotV * (1.0 - k) + k) * NdotL / (NdotL * (1.0 - k) + k);
+    vec3 F0 = mix(vec3(0.04), surfaceAlbedo, surfaceMetallic);
+    vec3 F = F0 + (1.0 - F0) * pow(clamp(1.0 - dot(H, V), 0.0, 1.0), 5.0);
+
+    vec3 specular = D * G * F / (4.0 * NdotV * NdotL + 0.0001);
+    vec3 kD = (vec3(1.0) - F) * (1.0 - surfaceMetallic);
+    return (kD * surfaceAlbedo / PI + specular) * radiance * NdotL;
+}
+
+void main()
+{
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(depthTexture, texel, 0).r;
+
+    // 深度钳制后的背面也会覆盖没有几何体的像素
+    if (depth == 1.0)
+        discard;
+
+    vec4 material = texelFetch(albedoMetallic, texel, 0);
+    vec4 normalData = texelFetch(normalRoughness, texel, 0);
+
+    vec4 ndc = vec4(vec3(gl_FragCoord.xy * screenSize.zw, depth) * 2.0 - 1.0, 1.0);
+    vec4 position = inverseProjection * ndc;
+    vec3 P = position.xyz / position.w;
+    vec3 N = decodeOctahedral(normalData.xy);
+    vec3 V = normalize(-P);
+
+    FragColor = vec4(shadeLight(lightIndex, P, N, V, material.rgb, material.a, normalData.z), 1.0);
+}
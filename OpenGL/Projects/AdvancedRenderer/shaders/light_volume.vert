@@ -0,0 +1,28 @@
+#version 330 core
+
+// 光源体积：第 gl_InstanceID 个光源的球体，按作用半径缩放
+
+#define MAX_LIGHTS 256
+
+layout (location = 0) in vec3 aPos;
+
+flat out int lightIndex;
+
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 inverseProjection;
+    vec4 screenSize;
+    ivec4 lightParams;
+};
+
+layout(std140) uniform LightData {
+    vec4 lights[MAX_LIGHTS * 2];
+};
+
+void main()
+{
+    vec4 positionRadius = lights[gl_InstanceID * 2];
+    gl_Position = projection * view * vec4(positionRadius.xyz + aPos * positionRadius.w, 1.0);
+    lightIndex = gl_InstanceID;
+}
@@ -0,0 +1,85 @@
+#version 330 core
+
+// 延迟着色的最后一步：累加的光照加上环境光并做色调映射，或显示 G-buffer 的某一部分（debugView 与 src/gbuffer.h 中的 GBufferView 一致）
+
+#define VIEW_LIT 0
+#define VIEW_ALBEDO 1
+#define VIEW_NORMAL 2
+#define VIEW_ROUGHNESS_METALLIC 3
+#define VIEW_DEPTH 4
+#define VIEW_READ_TRAFFIC 5
+
+// 热力图红色端对应的光源数
+#define TRAFFIC_SCALE_LIGHTS 16.0
+
+out vec4 FragColor;
+
+uniform sampler2D albedoMetallic;
+uniform sampler2D normalRoughness;
+uniform sampler2D depthTexture;
+uniform sampler2D lighting;
+
+uniform int debugView;
+uniform vec3 background;
+uniform vec3 ambient;
+
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 inverseProjection;
+    vec4 screenSize;
+    ivec4 lightParams;
+};
+
+vec3 decodeOctahedral(vec2 e)
+{
+    vec2 f = e * 2.0 - 1.0;
+    vec3 n = vec3(f, 1.0 - abs(f.x) - abs(f.y));
+    float t = clamp(-n.z, 0.0, 1.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
+// 蓝、青、绿、黄、红
+vec3 heat(float t)
+{
+    t = clamp(t, 0.0, 1.0);
+    return clamp(vec3(4.0 * t - 2.0, t < 0.5 ? 4.0 * t : 4.0 - 4.0 * t, 2.0 - 4.0 * t), 0.0, 1.0);
+}
+
+void main()
+{
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(depthTexture, texel, 0).r;
+    vec4 accumulated = texelFetch(lighting, texel, 0);
+
+    if (debugView == VIEW_READ_TRAFFIC) {
+        // alpha 为读取这个像素的光源数，每次读取 12 字节
+        FragColor = vec4(heat(accumulated.a / TRAFFIC_SCALE_LIGHTS), 1.0);
+        return;
+    }
+    if (depth == 1.0) {
+        FragColor = vec4(background, 1.0);
+        return;
+    }
+
+    vec4 material = texelFetch(albedoMetallic, texel, 0);
+    vec4 normalData = texelFetch(normalRoughness, texel, 0);
+    vec3 color;
+    if (debugView == VIEW_ALBEDO) {
+        color = material.rgb;
+    } else if (debugView == VIEW_NORMAL) {
+        color = decodeOctahedral(normalData.xy) * 0.5 + 0.5;
+    } else if (debugView == VIEW_ROUGHNESS_METALLIC) {
+        color = vec3(normalData.z, material.a, 0.0);
+    } else if (debugView == VIEW_DEPTH) {
+        vec4 position = inverseProjection * vec4(vec3(gl_FragCoord.xy * screenSize.zw, depth) * 2.0 - 1.0, 1.0);
+        color = vec3(clamp(-position.z / position.w / 50.0, 0.0, 1.0));
+    } else {
+        color = accumulated.rgb + ambient * material.rgb;
+        // 色调映射和伽马校正，与 fragment.glsl 一致
+        color = color / (color + vec3(1.0));
+        color = pow(color, vec3(1.0 / 2.2));
+    }
+    FragColor = vec4(color, 1.0);
+}
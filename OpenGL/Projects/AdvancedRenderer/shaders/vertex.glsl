@@ -1,16 +1,28 @@
 #version 330 core
 
 layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec3 aColor;
+layout (location = 1) in vec3 aNormal;
 
-out vec3 ourColor;
+// 视图空间的位置与法线，前向着色与 G-buffer 共用
+out vec3 viewPosition;
+out vec3 viewNormal;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+
+// 每帧共享的相机矩阵与光源数（与 src/main.cpp 中的 FrameData 一致）
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 inverseProjection;
+    vec4 screenSize;
+    ivec4 lightParams;
+};
 
 void main()
 {
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
-    ourColor = aColor;
+    vec4 position = view * model * vec4(aPos, 1.0);
+    gl_Position = projection * position;
+    viewPosition = position.xyz;
+    // 物体只有旋转、平移与沿坐标轴的缩放，法线不需要逆转置
+    viewNormal = mat3(view * model) * aNormal;
 }
@@ -0,0 +1,278 @@
+// gbuffer.cpp
+// G-buffer 与光照帧缓冲、光源体积的球体网格、深度复制与光照累加、全屏解析
+
+#include "gbuffer.h"
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include <glm/gtc/constants.hpp>
+
+const char* const GBUFFER_VIEW_NAMES[GBUFFER_VIEW_COUNT] = {
+    "lit", "albedo", "normal", "roughness (R) / metallic (G)", "linear depth",
+    "G-buffer read traffic (blue 0 to red 16 lights x 12 bytes)",
+};
+
+namespace {
+
+// 光源体积球体的经线与纬线分段数
+const int SPHERE_SEGMENTS = 16;
+const int SPHERE_RINGS = 8;
+
+// 纹理单元：G-buffer 的三个纹理与光照纹理
+const GLuint ALBEDO_METALLIC_UNIT = 0;
+const GLuint NORMAL_ROUGHNESS_UNIT = 1;
+const GLuint DEPTH_UNIT = 2;
+const GLuint LIGHTING_UNIT = 3;
+
+bool checkFramebuffer(const char* name) {
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << name << " framebuffer is not complete!" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// 只用 texelFetch 读取，不需要过滤与 mip
+GLuint createTexture(GLenum internalFormat, GLenum format, GLenum type, int width, int height) {
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return texture;
+}
+
+void deleteAttachments(GBuffer& gbuffer) {
+    const GLuint textures[] = {gbuffer.albedoMetallicTexture, gbuffer.normalRoughnessTexture, gbuffer.depthTexture,
+                               gbuffer.lightingTexture};
+    glDeleteTextures(4, textures);
+    glDeleteRenderbuffers(1, &gbuffer.lightingDepthBuffer);
+    glDeleteFramebuffers(1, &gbuffer.geometryFramebuffer);
+    glDeleteFramebuffers(1, &gbuffer.lightingFramebuffer);
+    gbuffer.albedoMetallicTexture = 0;
+    gbuffer.normalRoughnessTexture = 0;
+    gbuffer.depthTexture = 0;
+    gbuffer.lightingTexture = 0;
+    gbuffer.lightingDepthBuffer = 0;
+    gbuffer.geometryFramebuffer = 0;
+    gbuffer.lightingFramebuffer = 0;
+}
+
+bool createAttachments(GBuffer& gbuffer, int width, int height) {
+    gbuffer.width = width;
+    gbuffer.height = height;
+
+    gbuffer.albedoMetallicTexture = createTexture(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, width, height);
+    gbuffer.normalRoughnessTexture = createTexture(GL_RGB10_A2, GL_RGBA, GL_UNSIGNED_INT_2_10_10_10_REV, width, height);
+    gbuffer.depthTexture = createTexture(GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, width, height);
+    gbuffer.lightingTexture = createTexture(GL_RGBA16F, GL_RGBA, GL_HALF_FLOAT, width, height);
+
+    bool complete = true;
+
+    glGenFramebuffers(1, &gbuffer.geometryFramebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, gbuffer.geometryFramebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, gbuffer.albedoMetallicTexture, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, gbuffer.normalRoughnessTexture, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, gbuffer.depthTexture, 0);
+    const GLenum drawBuffers[] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+    glDrawBuffers(2, drawBuffers);
+    complete = checkFramebuffer("G-buffer") && complete;
+
+    // 深度格式与几何通道相同，glBlitFramebuffer 复制深度要求两者格式一致
+    glGenRenderbuffers(1, &gbuffer.lightingDepthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, gbuffer.lightingDepthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &gbuffer.lightingFramebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, gbuffer.lightingFramebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, gbuffer.lightingTexture, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, gbuffer.lightingDepthBuffer);
+    complete = checkFramebuffer("Light accumulation") && complete;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    return complete;
+}
+
+// 单位 UV 球，从外面看为逆时针。多边形的面在真实球面之内，顶点按经线与纬线方向的弦心距放大，
+// 使网格包住整个单位球，按作用半径缩放后不会漏掉边缘的像素
+void createSphere(GBuffer& gbuffer) {
+    float scale = 1.0f / (std::cos(glm::pi<float>() / SPHERE_SEGMENTS) * std::cos(glm::pi<float>() / (2 * SPHERE_RINGS)));
+
+    std::vector<glm::vec3> positions;
+    for (int ring = 0; ring <= SPHERE_RINGS; ++ring) {
+        float phi = glm::pi<float>() * ring / SPHERE_RINGS;
+        for (int segment = 0; segment <= SPHERE_SEGMENTS; ++segment) {
+            float theta = 2.0f * glm::pi<float>() * segment / SPHERE_SEGMENTS;
+            positions.push_back(scale * glm::vec3(std::sin(phi) * std::cos(theta), std::cos(phi),
+                                                  std::sin(phi) * std::sin(theta)));
+        }
+    }
+
+    std::vector<GLushort> indices;
+    for (int ring = 0; ring < SPHERE_RINGS; ++ring) {
+        for (int segment = 0; segment < SPHERE_SEGMENTS; ++segment) {
+            GLushort current = (GLushort)(ring * (SPHERE_SEGMENTS + 1) + segment);
+            GLushort below = (GLushort)(current + SPHERE_SEGMENTS + 1);
+            indices.insert(indices.end(), {current, (GLushort)(current + 1), below});
+            indices.insert(indices.end(), {(GLushort)(current + 1), (GLushort)(below + 1), below});
+        }
+    }
+    gbuffer.sphereIndexCount = (GLsizei)indices.size();
+
+    glGenVertexArrays(1, &gbuffer.sphereVAO);
+    glGenBuffers(1, &gbuffer.sphereVBO);
+    glGenBuffers(1, &gbuffer.sphereEBO);
+    glBindVertexArray(gbuffer.sphereVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, gbuffer.sphereVBO);
+    glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(glm::vec3), positions.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gbuffer.sphereEBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLushort), indices.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (GLvoid*)0);
+    glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
+}
+
+void bindTexture(GLuint unit, GLuint texture) {
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_2D, texture);
+}
+
+} // namespace
+
+bool createGBuffer(GBuffer& gbuffer, int width, int height) {
+    if (!gbuffer.lightProgram.load("shaders/light_volume.vert", "shaders/light_volume.frag") ||
+        !gbuffer.resolveProgram.load("shaders/fullscreen.vert", "shaders/resolve.frag")) {
+        return false;
+    }
+    gbuffer.debugViewLocation = gbuffer.resolveProgram.uniformLocation("debugView");
+    gbuffer.backgroundLocation = gbuffer.resolveProgram.uniformLocation("background");
+    gbuffer.ambientLocation = gbuffer.resolveProgram.uniformLocation("ambient");
+
+    // 采样器对应的纹理单元只需设置一次
+    for (ShaderProgram* program : {&gbuffer.lightProgram, &gbuffer.resolveProgram}) {
+        program->use();
+        glUniform1i(program->uniformLocation("albedoMetallic"), ALBEDO_METALLIC_UNIT);
+        glUniform1i(program->uniformLocation("normalRoughness"), NORMAL_ROUGHNESS_UNIT);
+        glUniform1i(program->uniformLocation("depthTexture"), DEPTH_UNIT);
+        glUniform1i(program->uniformLocation("lighting"), LIGHTING_UNIT);
+    }
+    glUseProgram(0);
+
+    createSphere(gbuffer);
+    // 全屏三角形由 gl_VertexID 生成，核心模式下仍然需要绑定一个 VAO
+    glGenVertexArrays(1, &gbuffer.emptyVAO);
+    glGenQueries(4, &gbuffer.sampleQueries[0][0]);
+
+    return createAttachments(gbuffer, width, height);
+}
+
+bool resizeGBuffer(GBuffer& gbuffer, int width, int height) {
+    deleteAttachments(gbuffer);
+    return createAttachments(gbuffer, width, height);
+}
+
+void beginGeometryPass(GBuffer& gbuffer) {
+    // 读取两帧前同一组查询的结果，此时GPU通常早已完成
+    int slot = gbuffer.frame % 2;
+    if (gbuffer.samplesPending[slot]) {
+        glGetQueryObjectui64v(gbuffer.sampleQueries[slot][0], GL_QUERY_RESULT, &gbuffer.geometrySamples);
+        glGetQueryObjectui64v(gbuffer.sampleQueries[slot][1], GL_QUERY_RESULT, &gbuffer.lightSamples);
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, gbuffer.geometryFramebuffer);
+    glViewport(0, 0, gbuffer.width, gbuffer.height);
+    // 没有几何体的像素由深度为 1 识别，颜色附件的内容无关紧要，但清除可以让驱动跳过读取旧内容
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glBeginQuery(GL_SAMPLES_PASSED, gbuffer.sampleQueries[slot][0]);
+}
+
+void endGeometryPass(GBuffer&) {
+    glEndQuery(GL_SAMPLES_PASSED);
+}
+
+void accumulateLights(GBuffer& gbuffer, int lightCount) {
+    int slot = gbuffer.frame % 2;
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, gbuffer.geometryFramebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, gbuffer.lightingFramebuffer);
+    glBlitFramebuffer(0, 0, gbuffer.width, gbuffer.height, 0, 0, gbuffer.width, gbuffer.height, GL_DEPTH_BUFFER_BIT,
+                      GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, gbuffer.lightingFramebuffer);
+    const GLfloat black[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    glClearBufferfv(GL_COLOR, 0, black);
+
+    // 只画背面，背面在几何体之后（GL_GEQUAL）的像素才可能在球内；深度钳制使超出远平面的背面仍被光栅化
+    glDepthMask(GL_FALSE);
+    glDepthFunc(GL_GEQUAL);
+    glEnable(GL_DEPTH_CLAMP);
+    glEnable(GL_CULL_FACE);
+    glCullFace(GL_FRONT);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+
+    bindTexture(ALBEDO_METALLIC_UNIT, gbuffer.albedoMetallicTexture);
+    bindTexture(NORMAL_ROUGHNESS_UNIT, gbuffer.normalRoughnessTexture);
+    bindTexture(DEPTH_UNIT, gbuffer.depthTexture);
+
+    gbuffer.lightProgram.use();
+    glBindVertexArray(gbuffer.sphereVAO);
+    glBeginQuery(GL_SAMPLES_PASSED, gbuffer.sampleQueries[slot][1]);
+    if (lightCount > 0) {
+        glDrawElementsInstanced(GL_TRIANGLES, gbuffer.sphereIndexCount, GL_UNSIGNED_SHORT, (GLvoid*)0, lightCount);
+    }
+    glEndQuery(GL_SAMPLES_PASSED);
+    glBindVertexArray(0);
+
+    gbuffer.samplesPending[slot] = true;
+    gbuffer.frame++;
+
+    glDisable(GL_BLEND);
+    glCullFace(GL_BACK);
+    glDisable(GL_CULL_FACE);
+    glDisable(GL_DEPTH_CLAMP);
+    glDepthFunc(GL_LESS);
+    glDepthMask(GL_TRUE);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void resolveGBuffer(GBuffer& gbuffer, GBufferView view, const glm::vec3& background, const glm::vec3& ambient) {
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, gbuffer.width, gbuffer.height);
+    glDisable(GL_DEPTH_TEST);
+
+    bindTexture(ALBEDO_METALLIC_UNIT, gbuffer.albedoMetallicTexture);
+    bindTexture(NORMAL_ROUGHNESS_UNIT, gbuffer.normalRoughnessTexture);
+    bindTexture(DEPTH_UNIT, gbuffer.depthTexture);
+    bindTexture(LIGHTING_UNIT, gbuffer.lightingTexture);
+
+    gbuffer.resolveProgram.use();
+    glUniform1i(gbuffer.debugViewLocation, view);
+    glUniform3fv(gbuffer.backgroundLocation, 1, &background[0]);
+    glUniform3fv(gbuffer.ambientLocation, 1, &ambient[0]);
+    glBindVertexArray(gbuffer.emptyVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+
+    glActiveTexture(GL_TEXTURE0);
+    glEnable(GL_DEPTH_TEST);
+}
+
+void destroyGBuffer(GBuffer& gbuffer) {
+    deleteAttachments(gbuffer);
+    glDeleteVertexArrays(1, &gbuffer.sphereVAO);
+    glDeleteBuffers(1, &gbuffer.sphereVBO);
+    glDeleteBuffers(1, &gbuffer.sphereEBO);
+    glDeleteVertexArrays(1, &gbuffer.emptyVAO);
+    glDeleteQueries(4, &gbuffer.sampleQueries[0][0]);
+    gbuffer.lightProgram.destroy();
+    gbuffer.resolveProgram.destroy();
+    gbuffer = GBuffer();
+}
@@ -0,0 +1,94 @@
+// gbuffer.h
+// 延迟着色：几何通道把材质写入紧凑的 G-buffer，光照通道只为每个光源影响到的像素计算一次光照，
+// 光照的开销只与光源覆盖的屏幕面积有关，与场景的几何复杂度无关
+//
+// G-buffer 每像素 12 字节（GBUFFER_BYTES_PER_PIXEL）：
+//   albedoMetallic   GL_RGBA8      反照率、金属度
+//   normalRoughness  GL_RGB10_A2   视图空间法线的八面体编码（每分量 10 位）、粗糙度
+//   depth            GL_DEPTH_COMPONENT24  不另存位置，光照时由深度与逆投影矩阵重建视图空间位置
+//
+// GL 3.3 没有计算着色器，不能做分块（tiled）的光源累加，光照使用光源体积：每个点光源实例化绘制一个包住
+// 作用半径的球，只画背面并做 GL_GEQUAL 深度测试，只有球体范围内（球背面之前）的几何体像素被着色，
+// 相机在球内时也正确。结果按加法混合累加到 GL_RGBA16F 的光照纹理，alpha 累加覆盖每个像素的光源数，
+// 即每个像素读取 G-buffer 的次数，用于调试视图。
+// 深度纹理在光照通道中要被采样，不能同时作为深度附件，几何通道之后把深度 blit 到光照帧缓冲的深度缓冲。
+// 最后一个全屏三角形加上环境光，做色调映射与伽马校正并写入默认帧缓冲
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "shader_program.h"
+
+// G-buffer 每像素的字节数（两个颜色附件与深度）
+const int GBUFFER_BYTES_PER_PIXEL = 12;
+
+// 解析时显示的内容，与 resolve.frag 中的 view 一致
+enum GBufferView {
+    GBUFFER_VIEW_LIT = 0,
+    GBUFFER_VIEW_ALBEDO,
+    GBUFFER_VIEW_NORMAL,
+    GBUFFER_VIEW_ROUGHNESS_METALLIC,
+    GBUFFER_VIEW_DEPTH,
+    // 每个像素在光照通道中被读取的字节数（光源数 × GBUFFER_BYTES_PER_PIXEL）的热力图
+    GBUFFER_VIEW_READ_TRAFFIC,
+    GBUFFER_VIEW_COUNT
+};
+
+extern const char* const GBUFFER_VIEW_NAMES[GBUFFER_VIEW_COUNT];
+
+struct GBuffer {
+    // 几何通道：两个颜色附件与可采样的深度纹理
+    GLuint geometryFramebuffer = 0;
+    GLuint albedoMetallicTexture = 0;
+    GLuint normalRoughnessTexture = 0;
+    GLuint depthTexture = 0;
+
+    // 光照通道：HDR 光照纹理与从几何通道复制来的深度
+    GLuint lightingFramebuffer = 0;
+    GLuint lightingTexture = 0;
+    GLuint lightingDepthBuffer = 0;
+
+    // 光源体积的球体网格（按作用半径缩放后包住整个球）与全屏三角形用的空 VAO
+    GLuint sphereVAO = 0;
+    GLuint sphereVBO = 0;
+    GLuint sphereEBO = 0;
+    GLsizei sphereIndexCount = 0;
+    GLuint emptyVAO = 0;
+
+    // 光源体积与解析的程序，FrameData、LightData 块由调用者连接
+    ShaderProgram lightProgram;
+    ShaderProgram resolveProgram;
+    GLint debugViewLocation = -1;
+    GLint backgroundLocation = -1;
+    GLint ambientLocation = -1;
+
+    // 几何通道与光照通道通过深度测试的片段数，GL_SAMPLES_PASSED 查询交替使用，隔一帧读取
+    GLuint sampleQueries[2][2] = {};
+    bool samplesPending[2] = {};
+    int frame = 0;
+    GLuint64 geometrySamples = 0;
+    GLuint64 lightSamples = 0;
+
+    int width = 0;
+    int height = 0;
+};
+
+// 创建程序、球体网格与 width × height 的附件
+bool createGBuffer(GBuffer& gbuffer, int width, int height);
+
+// 帧缓冲尺寸变化时重新分配附件
+bool resizeGBuffer(GBuffer& gbuffer, int width, int height);
+
+// 绑定几何帧缓冲并清除；之后用 G-buffer 程序绘制场景，再调用 endGeometryPass
+void beginGeometryPass(GBuffer& gbuffer);
+void endGeometryPass(GBuffer& gbuffer);
+
+// 复制深度，为前 lightCount 个光源（LightData 中）绘制光源体积并累加光照
+void accumulateLights(GBuffer& gbuffer, int lightCount);
+
+// 把 view 指定的内容写入默认帧缓冲；background 为没有几何体的像素的颜色，ambient 为环境光
+void resolveGBuffer(GBuffer& gbuffer, GBufferView view, const glm::vec3& background, const glm::vec3& ambient);
+
+void destroyGBuffer(GBuffer& gbuffer);
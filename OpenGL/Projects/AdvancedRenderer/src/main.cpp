@@ -3,241 +3,446 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
-#include <fstream>
-#include <sstream>
+#include <random>
 #include <string>
+#include <vector>
+
+#include "gbuffer.h"
+#include "gpu_timer.h"
+#include "shader_program.h"
 
 // 窗口尺寸
 const int WIDTH = 800;
 const int HEIGHT = 600;
 
-// 着色器程序ID
-GLuint shaderProgram;
+// 光源数上限，与着色器中的 MAX_LIGHTS 一致（LightData 块为 8 KB，低于 GL 3.3 保证的 16 KB）
+const int MAX_LIGHTS = 256;
+const unsigned int SCENE_SEED = 7;
 
-// 顶点数组对象和顶点缓冲对象
-GLuint VAO, VBO, EBO;
+// 场景：地面上 GRID_SIZE × GRID_SIZE 个旋转的立方体
+const int GRID_SIZE = 12;
+const float GRID_SPACING = 2.0f;
+const float FLOOR_SIZE = GRID_SIZE * GRID_SPACING + 4.0f;
+
+// 相机
+const float CAMERA_FOVY = glm::radians(45.0f);
+const float CAMERA_NEAR = 0.1f;
+const float CAMERA_FAR = 100.0f;
+
+// 清屏颜色与环境光
+const glm::vec3 BACKGROUND_COLOR(0.2f, 0.3f, 0.3f);
+const glm::vec3 AMBIENT_COLOR(0.03f);
+
+// 每帧共享的相机矩阵与光源数，与着色器中的 layout(std140) uniform FrameData 一致
+struct FrameData {
+    glm::mat4 view;
+    glm::mat4 projection;
+    // 延迟着色由深度重建视图空间位置
+    glm::mat4 inverseProjection;
+    // 帧缓冲的宽高与其倒数
+    glm::vec4 screenSize;
+    // x 为光源数
+    glm::ivec4 lightParams;
+};
+const GLuint FRAME_DATA_BINDING = 0;
+
+// 每个光源两个 vec4：(世界空间位置, 作用半径)、(颜色, 0)，前向着色与光源体积共用
+struct LightData {
+    glm::vec4 lights[MAX_LIGHTS * 2];
+};
+const GLuint LIGHT_DATA_BINDING = 1;
+
+// 绘制场景的程序（前向着色与 G-buffer）与缓存的逐次绘制 uniform 位置
+struct SceneProgram {
+    ShaderProgram program;
+    GLint modelLoc = -1;
+    GLint albedoLoc = -1;
+    GLint metallicLoc = -1;
+    GLint roughnessLoc = -1;
+};
+SceneProgram forwardProgram;
+SceneProgram geometryProgram;
+GLint ambientLoc = -1;
+UniformBuffer frameUniforms;
+UniformBuffer lightUniforms;
+
+// 场景中的物体：立方体网格的变换与材质
+struct SceneObject {
+    glm::vec3 position;
+    glm::vec3 scale;
+    glm::vec3 albedo;
+    float metallic;
+    float roughness;
+    // 绕自身轴旋转的速度，0 为静止
+    float spin;
+};
+std::vector<SceneObject> objects;
+
+// 点光源在一个水平圆周上运动
+struct LightMotion {
+    glm::vec3 center;
+    float orbitRadius;
+    float speed;
+    float phase;
+    float radius;
+    glm::vec3 color;
+};
+std::vector<LightMotion> lightMotions;
+int lightCount = MAX_LIGHTS;
+
+// 延迟或前向着色（--forward 或 F 键切换），以及延迟着色时显示的内容（G 键切换）
+bool deferredShading = true;
+GBufferView gbufferView = GBUFFER_VIEW_LIT;
+GBuffer gbuffer;
+
+// 帧缓冲尺寸（高 DPI 屏幕上与窗口尺寸不同）
+int framebufferWidth = WIDTH;
+int framebufferHeight = HEIGHT;
 
-// 相机位置
-GLfloat cameraX = 0.0f;
-GLfloat cameraY = 0.0f;
-GLfloat cameraZ = 5.0f;
+// 各通道的 GPU 耗时
+GpuTimer forwardTimer;
+GpuTimer geometryTimer;
+GpuTimer lightingTimer;
+GpuTimer resolveTimer;
+
+// 顶点数组对象和顶点缓冲对象
+GLuint VAO, VBO;
 
 // 旋转角度
 GLfloat rotationAngle = 0.0f;
 
-// 读取着色器文件
-std::string readShaderFile(const char* filePath) {
-    std::string shaderCode;
-    std::ifstream shaderFile;
-    
-    // 确保ifstream对象可以抛出异常
-    shaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    
-    try {
-        // 打开文件
-        shaderFile.open(filePath);
-        
-        // 读取文件内容到stringstream
-        std::stringstream shaderStream;
-        shaderStream << shaderFile.rdbuf();
-        
-        // 关闭文件
-        shaderFile.close();
-        
-        // 转换到string
-        shaderCode = shaderStream.str();
-    } catch (std::ifstream::failure& e) {
-        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
+bool createSceneProgram(SceneProgram& scene, const char* fragmentPath) {
+    if (!scene.program.load("shaders/vertex.glsl", fragmentPath)) {
+        return false;
+    }
+    scene.program.bindUniformBlock("FrameData", FRAME_DATA_BINDING, sizeof(FrameData));
+    scene.program.bindUniformBlock("LightData", LIGHT_DATA_BINDING, sizeof(LightData));
+    scene.modelLoc = scene.program.uniformLocation("model");
+    scene.albedoLoc = scene.program.uniformLocation("albedo");
+    scene.metallicLoc = scene.program.uniformLocation("metallic");
+    scene.roughnessLoc = scene.program.uniformLocation("roughness");
+    return true;
+}
+
+// 创建着色器程序与 G-buffer，连接 uniform 块并取得逐次绘制的 uniform 位置
+bool createShaderPrograms() {
+    if (!createSceneProgram(forwardProgram, "shaders/fragment.glsl") ||
+        !createSceneProgram(geometryProgram, "shaders/gbuffer.frag") ||
+        !createGBuffer(gbuffer, framebufferWidth, framebufferHeight)) {
+        return false;
     }
-    
-    return shaderCode;
+    ambientLoc = forwardProgram.program.uniformLocation("ambient");
+    gbuffer.lightProgram.bindUniformBlock("FrameData", FRAME_DATA_BINDING, sizeof(FrameData));
+    gbuffer.lightProgram.bindUniformBlock("LightData", LIGHT_DATA_BINDING, sizeof(LightData));
+    gbuffer.resolveProgram.bindUniformBlock("FrameData", FRAME_DATA_BINDING, sizeof(FrameData));
+    return frameUniforms.create(sizeof(FrameData), FRAME_DATA_BINDING) &&
+           lightUniforms.create(sizeof(LightData), LIGHT_DATA_BINDING);
 }
 
-// 编译着色器
-GLuint compileShader(GLenum type, const char* source) {
-    GLuint shader = glCreateShader(type);
-    glShaderSource(shader, 1, &source, NULL);
-    glCompileShader(shader);
-    
-    // 检查编译错误
-    GLint success;
-    GLchar infoLog[512];
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(shader, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::COMPILATION_FAILED\n" << infoLog << std::endl;
+// 地面与立方体网格：金属度沿 x 增加，粗糙度沿 z 增加，颜色随机
+void setupScene() {
+    std::mt19937 random(SCENE_SEED);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    objects.push_back({glm::vec3(0.0f, -0.55f, 0.0f), glm::vec3(FLOOR_SIZE, 0.1f, FLOOR_SIZE), glm::vec3(0.6f), 0.0f,
+                       0.8f, 0.0f});
+    for (int z = 0; z < GRID_SIZE; ++z) {
+        for (int x = 0; x < GRID_SIZE; ++x) {
+            SceneObject object;
+            object.position = glm::vec3((x - (GRID_SIZE - 1) * 0.5f) * GRID_SPACING, 0.0f,
+                                        (z - (GRID_SIZE - 1) * 0.5f) * GRID_SPACING);
+            object.scale = glm::vec3(1.0f);
+            object.albedo = glm::vec3(0.3f) + 0.7f * glm::vec3(unit(random), unit(random), unit(random));
+            object.metallic = (float)x / (GRID_SIZE - 1);
+            object.roughness = 0.1f + 0.9f * z / (GRID_SIZE - 1);
+            object.spin = 0.5f + unit(random);
+            objects.push_back(object);
+        }
     }
-    
-    return shader;
 }
 
-// 创建着色器程序
-void createShaderProgram() {
-    // 读取着色器代码
-    std::string vertexShaderCode = readShaderFile("shaders/vertex.glsl");
-    std::string fragmentShaderCode = readShaderFile("shaders/fragment.glsl");
-    
-    // 编译着色器
-    GLuint vertexShader = compileShader(GL_VERTEX_SHADER, vertexShaderCode.c_str());
-    GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentShaderCode.c_str());
-    
-    // 创建着色器程序
-    shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-    
-    // 检查链接错误
-    GLint success;
-    GLchar infoLog[512];
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-    if (!success) {
-        glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+// 随机生成点光源：位置在立方体之间，各自绕一个小圆周运动，颜色为饱和的随机色
+void setupLights() {
+    std::mt19937 random(SCENE_SEED + 1);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    lightMotions.resize(lightCount);
+    for (LightMotion& motion : lightMotions) {
+        motion.center = glm::vec3((unit(random) - 0.5f) * FLOOR_SIZE, 0.2f + unit(random) * 1.5f,
+                                  (unit(random) - 0.5f) * FLOOR_SIZE);
+        motion.orbitRadius = 0.5f + unit(random) * 1.5f;
+        motion.speed = 0.5f + unit(random);
+        motion.phase = unit(random) * 6.2831853f;
+        motion.radius = 2.0f + unit(random) * 2.0f;
+        glm::vec3 color = glm::vec3(unit(random), unit(random), unit(random));
+        motion.color = color / std::max(color.r, std::max(color.g, color.b)) * 3.0f;
     }
-    
-    // 删除着色器，因为它们已经链接到程序中
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
 }
 
 // 设置顶点数据和缓冲区
 void setupBuffers() {
-    // 顶点数据（包含位置和颜色）
+    // 顶点数据（包含位置和法线）
     GLfloat vertices[] = {
-        // 位置                // 颜色
-        -0.5f, -0.5f, -0.5f,  0.0f, 0.0f, 0.0f,
-         0.5f, -0.5f, -0.5f,  1.0f, 0.0f, 0.0f,
-         0.5f,  0.5f, -0.5f,  1.0f, 1.0f, 0.0f,
-         0.5f,  0.5f, -0.5f,  1.0f, 1.0f, 0.0f,
-        -0.5f,  0.5f, -0.5f,  0.0f, 1.0f, 0.0f,
-        -0.5f, -0.5f, -0.5f,  0.0f, 0.0f, 0.0f,
-
-        -0.5f, -0.5f,  0.5f,  0.0f, 0.0f, 0.0f,
-         0.5f, -0.5f,  0.5f,  1.0f, 0.0f, 0.0f,
-         0.5f,  0.5f,  0.5f,  1.0f, 1.0f, 0.0f,
-         0.5f,  0.5f,  0.5f,  1.0f, 1.0f, 0.0f,
-        -0.5f,  0.5f,  0.5f,  0.0f, 1.0f, 0.0f,
-        -0.5f, -0.5f,  0.5f,  0.0f, 0.0f, 0.0f,
-
-        -0.5f,  0.5f,  0.5f,  1.0f, 0.0f, 0.0f,
-        -0.5f,  0.5f, -0.5f,  1.0f, 1.0f, 0.0f,
-        -0.5f, -0.5f, -0.5f,  0.0f, 1.0f, 0.0f,
-        -0.5f, -0.5f, -0.5f,  0.0f, 1.0f, 0.0f,
-        -0.5f, -0.5f,  0.5f,  0.0f, 0.0f, 0.0f,
-        -0.5f,  0.5f,  0.5f,  1.0f, 0.0f, 0.0f,
-
-         0.5f,  0.5f,  0.5f,  1.0f, 0.0f, 0.0f,
-         0.5f,  0.5f, -0.5f,  1.0f, 1.0f, 0.0f,
-         0.5f, -0.5f, -0.5f,  0.0f, 1.0f, 0.0f,
-         0.5f, -0.5f, -0.5f,  0.0f, 1.0f, 0.0f,
-         0.5f, -0.5f,  0.5f,  0.0f, 0.0f, 0.0f,
-         0.5f,  0.5f,  0.5f,  1.0f, 0.0f, 0.0f,
-
-        -0.5f, -0.5f, -0.5f,  0.0f, 1.0f, 0.0f,
-         0.5f, -0.5f, -0.5f,  1.0f, 1.0f, 0.0f,
-         0.5f, -0.5f,  0.5f,  1.0f, 0.0f, 0.0f,
-         0.5f, -0.5f,  0.5f,  1.0f, 0.0f, 0.0f,
-        -0.5f, -0.5f,  0.5f,  0.0f, 0.0f, 0.0f,
-        -0.5f, -0.5f, -0.5f,  0.0f, 1.0f, 0.0f,
-
-        -0.5f,  0.5f, -0.5f,  0.0f, 1.0f, 0.0f,
-         0.5f,  0.5f, -0.5f,  1.0f, 1.0f, 0.0f,
-         0.5f,  0.5f,  0.5f,  1.0f, 0.0f, 0.0f,
-         0.5f,  0.5f,  0.5f,  1.0f, 0.0f, 0.0f,
-        -0.5f,  0.5f,  0.5f,  0.0f, 0.0f, 0.0f,
-        -0.5f,  0.5f, -0.5f,  0.0f, 1.0f, 0.0f
+        // 位置                // 法线
+        -0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
+         0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
+         0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
+         0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
+        -0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
+        -0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
+
+        -0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,
+         0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,
+         0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,
+         0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,
+        -0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,
+        -0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,
+
+        -0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,
+        -0.5f,  0.5f, -0.5f, -1.0f,  0.0f,  0.0f,
+        -0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,
+        -0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,
+        -0.5f, -0.5f,  0.5f, -1.0f,  0.0f,  0.0f,
+        -0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,
+
+         0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,
+         0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,
+         0.5f,  0.5f, -0.5f,  1.0f,  0.0f,  0.0f,
+         0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,
+         0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,
+         0.5f, -0.5f,  0.5f,  1.0f,  0.0f,  0.0f,
+
+        -0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,
+         0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,
+         0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,
+         0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,
+        -0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,
+        -0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,
+
+        -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,
+         0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,
+         0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,
+         0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,
+        -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,
+        -0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f
     };
-    
+
     // 生成VAO和VBO
     glGenVertexArrays(1, &VAO);
     glGenBuffers(1, &VBO);
-    
+
     // 绑定VAO
     glBindVertexArray(VAO);
-    
+
     // 绑定VBO并填充数据
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-    
+
     // 设置顶点属性指针
     // 位置属性
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (GLvoid*)0);
     glEnableVertexAttribArray(0);
-    
-    // 颜色属性
+
+    // 法线属性
     glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (GLvoid*)(3 * sizeof(GLfloat)));
     glEnableVertexAttribArray(1);
-    
+
     // 解绑VAO
     glBindVertexArray(0);
 }
 
+// 用 scene 程序绘制所有物体，逐次绘制的变换与材质使用缓存的位置
+void drawScene(const SceneProgram& scene) {
+    scene.program.use();
+    glBindVertexArray(VAO);
+    for (const SceneObject& object : objects) {
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), object.position);
+        model = glm::rotate(model, rotationAngle * object.spin, glm::vec3(0.0f, 1.0f, 0.0f));
+        model = glm::scale(model, object.scale);
+        glUniformMatrix4fv(scene.modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+        glUniform3fv(scene.albedoLoc, 1, glm::value_ptr(object.albedo));
+        glUniform1f(scene.metallicLoc, object.metallic);
+        glUniform1f(scene.roughnessLoc, object.roughness);
+        glDrawArrays(GL_TRIANGLES, 0, 36);
+    }
+    glBindVertexArray(0);
+}
+
+// 每秒输出一次各通道的平均 GPU 耗时；延迟着色还输出 G-buffer 的读写量：
+// 几何通道每个通过深度测试的片段写入 GBUFFER_BYTES_PER_PIXEL 字节（含重复绘制），
+// 光源体积每个通过深度测试的片段读取同样多的字节
+void reportFrameTimes() {
+    static double lastReportTime = glfwGetTime();
+    static double forwardMilliseconds = 0.0;
+    static double geometryMilliseconds = 0.0;
+    static double lightingMilliseconds = 0.0;
+    static double resolveMilliseconds = 0.0;
+    static int frames = 0;
+
+    if (deferredShading) {
+        geometryMilliseconds += geometryTimer.milliseconds;
+        lightingMilliseconds += lightingTimer.milliseconds;
+        resolveMilliseconds += resolveTimer.milliseconds;
+    } else {
+        forwardMilliseconds += forwardTimer.milliseconds;
+    }
+    frames++;
+
+    double now = glfwGetTime();
+    if (now - lastReportTime >= 1.0) {
+        double pixels = (double)framebufferWidth * framebufferHeight;
+        std::cout << lightCount << " lights, " << objects.size() << " objects, " << framebufferWidth << "x"
+                  << framebufferHeight << ", " << frames / (now - lastReportTime) << " fps: ";
+        if (deferredShading) {
+            double writtenMB = gbuffer.geometrySamples * GBUFFER_BYTES_PER_PIXEL / 1e6;
+            double readMB = gbuffer.lightSamples * GBUFFER_BYTES_PER_PIXEL / 1e6;
+            std::cout << "deferred, geometry " << geometryMilliseconds / frames << " ms, lighting "
+                      << lightingMilliseconds / frames << " ms, resolve " << resolveMilliseconds / frames
+                      << " ms; G-buffer " << GBUFFER_BYTES_PER_PIXEL << " B/pixel, " << writtenMB << " MB written ("
+                      << gbuffer.geometrySamples / pixels << "x overdraw), " << readMB << " MB read by light volumes ("
+                      << gbuffer.lightSamples / pixels << " lights per pixel)";
+        } else {
+            std::cout << "forward, " << forwardMilliseconds / frames << " ms";
+        }
+        std::cout << std::endl;
+        forwardMilliseconds = 0.0;
+        geometryMilliseconds = 0.0;
+        lightingMilliseconds = 0.0;
+        resolveMilliseconds = 0.0;
+        frames = 0;
+        lastReportTime = now;
+    }
+}
+
 // 渲染循环
 void render() {
-    // 清空颜色和深度缓冲
-    glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    
-    // 使用着色器程序
-    glUseProgram(shaderProgram);
-    
-    // 创建变换矩阵
-    glm::mat4 model = glm::mat4(1.0f);
-    glm::mat4 view = glm::mat4(1.0f);
-    glm::mat4 projection = glm::mat4(1.0f);
-    
+    if (gbuffer.width != framebufferWidth || gbuffer.height != framebufferHeight) {
+        resizeGBuffer(gbuffer, framebufferWidth, framebufferHeight);
+    }
+
+    // 相机视图与透视投影、光源数据，每帧写入 uniform 缓冲区一次
+    FrameData frame;
+    frame.view = glm::lookAt(glm::vec3(0.0f, 12.0f, 20.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    frame.projection = glm::perspective(CAMERA_FOVY, (GLfloat)framebufferWidth / (GLfloat)framebufferHeight,
+                                        CAMERA_NEAR, CAMERA_FAR);
+    frame.inverseProjection = glm::inverse(frame.projection);
+    frame.screenSize = glm::vec4(framebufferWidth, framebufferHeight, 1.0f / framebufferWidth,
+                                 1.0f / framebufferHeight);
+    frame.lightParams = glm::ivec4(lightCount, 0, 0, 0);
+    frameUniforms.update(frame);
+
+    static LightData lightData;
+    float time = (float)glfwGetTime();
+    for (int i = 0; i < lightCount; ++i) {
+        const LightMotion& motion = lightMotions[i];
+        float angle = motion.phase + time * motion.speed;
+        glm::vec3 position = motion.center + motion.orbitRadius * glm::vec3(std::cos(angle), 0.0f, std::sin(angle));
+        lightData.lights[i * 2] = glm::vec4(position, motion.radius);
+        lightData.lights[i * 2 + 1] = glm::vec4(motion.color, 0.0f);
+    }
+    lightUniforms.update(lightData);
+
     // 旋转模型
     rotationAngle += 0.01f;
-    model = glm::rotate(model, rotationAngle, glm::vec3(1.0f, 1.0f, 0.0f));
-    
-    // 相机视图
-    view = glm::translate(view, glm::vec3(0.0f, 0.0f, -3.0f));
-    
-    // 透视投影
-    projection = glm::perspective(glm::radians(45.0f), (GLfloat)WIDTH / (GLfloat)HEIGHT, 0.1f, 100.0f);
-    
-    // 获取着色器中的uniform位置
-    GLint modelLoc = glGetUniformLocation(shaderProgram, "model");
-    GLint viewLoc = glGetUniformLocation(shaderProgram, "view");
-    GLint projectionLoc = glGetUniformLocation(shaderProgram, "projection");
-    
-    // 传递变换矩阵到着色器
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-    glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, glm::value_ptr(projection));
-    
-    // 绘制立方体
-    glBindVertexArray(VAO);
-    glDrawArrays(GL_TRIANGLES, 0, 36);
-    glBindVertexArray(0);
+
+    if (deferredShading) {
+        beginGpuTimer(geometryTimer);
+        beginGeometryPass(gbuffer);
+        drawScene(geometryProgram);
+        endGeometryPass(gbuffer);
+        endGpuTimer(geometryTimer);
+
+        beginGpuTimer(lightingTimer);
+        accumulateLights(gbuffer, lightCount);
+        endGpuTimer(lightingTimer);
+
+        beginGpuTimer(resolveTimer);
+        resolveGBuffer(gbuffer, gbufferView, BACKGROUND_COLOR, AMBIENT_COLOR);
+        endGpuTimer(resolveTimer);
+    } else {
+        // 清空颜色和深度缓冲
+        glViewport(0, 0, framebufferWidth, framebufferHeight);
+        glClearColor(BACKGROUND_COLOR.r, BACKGROUND_COLOR.g, BACKGROUND_COLOR.b, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        beginGpuTimer(forwardTimer);
+        forwardProgram.program.use();
+        glUniform3fv(ambientLoc, 1, glm::value_ptr(AMBIENT_COLOR));
+        drawScene(forwardProgram);
+        endGpuTimer(forwardTimer);
+    }
+
+    reportFrameTimes();
 }
 
 // 窗口大小变化回调
 void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
+    // 最小化时尺寸为 0，保留原来的尺寸
+    if (width == 0 || height == 0) {
+        return;
+    }
+    framebufferWidth = width;
+    framebufferHeight = height;
     glViewport(0, 0, width, height);
 }
 
-// 输入处理
+// 输入处理：F 键切换延迟与前向着色，G 键依次切换延迟着色的调试视图
 void processInput(GLFWwindow* window) {
+    static bool shadingKeyWasPressed = false;
+    static bool viewKeyWasPressed = false;
+
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
         glfwSetWindowShouldClose(window, true);
     }
+
+    bool shadingKeyPressed = glfwGetKey(window, GLFW_KEY_F) == GLFW_PRESS;
+    if (shadingKeyPressed && !shadingKeyWasPressed) {
+        deferredShading = !deferredShading;
+        std::cout << "Shading: " << (deferredShading ? "deferred" : "forward") << std::endl;
+    }
+    shadingKeyWasPressed = shadingKeyPressed;
+
+    bool viewKeyPressed = glfwGetKey(window, GLFW_KEY_G) == GLFW_PRESS;
+    if (viewKeyPressed && !viewKeyWasPressed && deferredShading) {
+        gbufferView = (GBufferView)((gbufferView + 1) % GBUFFER_VIEW_COUNT);
+        std::cout << "G-buffer view: " << GBUFFER_VIEW_NAMES[gbufferView] << std::endl;
+    }
+    viewKeyWasPressed = viewKeyPressed;
 }
 
-int main() {
+int main(int argc, char** argv) {
+    // 命令行参数：--lights N 指定点光源数（0 到 MAX_LIGHTS），--forward 从前向着色开始（运行时按 F 切换）
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--lights") == 0 && i + 1 < argc) {
+            lightCount = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--forward") == 0) {
+            deferredShading = false;
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--lights N] [--forward]" << std::endl;
+            return -1;
+        }
+    }
+    if (lightCount < 0 || lightCount > MAX_LIGHTS) {
+        std::cerr << "Light count must be between 0 and " << MAX_LIGHTS << std::endl;
+        return -1;
+    }
+
     // 初始化GLFW
     if (!glfwInit()) {
         std::cout << "Failed to initialize GLFW" << std::endl;
         return -1;
     }
-    
+
     // 设置GLFW窗口属性
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-    
+
     // 创建窗口
     GLFWwindow* window = glfwCreateWindow(WIDTH, HEIGHT, "Advanced Renderer", NULL, NULL);
     if (!window) {
@@ -245,54 +450,76 @@ int main() {
         glfwTerminate();
         return -1;
     }
-    
+
     // 设置当前上下文
     glfwMakeContextCurrent(window);
-    
+
     // 设置窗口大小变化回调
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-    
+
     // 初始化GLEW
     glewExperimental = GL_TRUE;
     if (glewInit() != GLEW_OK) {
         std::cout << "Failed to initialize GLEW" << std::endl;
         return -1;
     }
-    
+
     // 设置视口
-    glViewport(0, 0, WIDTH, HEIGHT);
-    
+    glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+    glViewport(0, 0, framebufferWidth, framebufferHeight);
+
     // 启用深度测试
     glEnable(GL_DEPTH_TEST);
-    
-    // 创建着色器程序
-    createShaderProgram();
-    
-    // 设置缓冲区
+
+    // 创建着色器程序与 G-buffer
+    if (!createShaderPrograms()) {
+        std::cout << "Failed to create shader program" << std::endl;
+        glfwTerminate();
+        return -1;
+    }
+    reportShaderCacheStats();
+
+    // 设置缓冲区与场景
     setupBuffers();
-    
+    setupScene();
+    setupLights();
+    createGpuTimer(forwardTimer);
+    createGpuTimer(geometryTimer);
+    createGpuTimer(lightingTimer);
+    createGpuTimer(resolveTimer);
+    std::cout << "Shading: " << (deferredShading ? "deferred" : "forward") << " (F toggles, G cycles G-buffer views), "
+              << lightCount << " point lights" << std::endl;
+
     // 渲染循环
     while (!glfwWindowShouldClose(window)) {
         // 处理输入
         processInput(window);
-        
+
         // 渲染
         render();
-        
+
         // 交换缓冲
         glfwSwapBuffers(window);
-        
+
         // 处理事件
         glfwPollEvents();
     }
-    
+
     // 清理资源
     glDeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
-    glDeleteProgram(shaderProgram);
-    
+    forwardProgram.program.destroy();
+    geometryProgram.program.destroy();
+    destroyGBuffer(gbuffer);
+    destroyGpuTimer(forwardTimer);
+    destroyGpuTimer(geometryTimer);
+    destroyGpuTimer(lightingTimer);
+    destroyGpuTimer(resolveTimer);
+    frameUniforms.destroy();
+    lightUniforms.destroy();
+
     // 终止GLFW
     glfwTerminate();
-    
+
     return 0;
 }
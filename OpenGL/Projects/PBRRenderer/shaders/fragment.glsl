@@ -8,11 +8,33 @@ in vec3 Normal;
 uniform vec3 albedo;
 uniform float metallic;
 uniform float roughness;
-uniform vec3 camPos;
 
-#define NR_LIGHTS 1
-uniform vec3 lightPositions[NR_LIGHTS];
-uniform vec3 lightColors[NR_LIGHTS];
+// 每帧共享的相机、簇参数与环境光照（与 src/main.cpp 中的 FrameData 一致）
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec4 camPos;
+    // xyz 为簇在屏幕 x、y 与深度方向上的数量，w 为光源总数
+    ivec4 clusterDims;
+    // 瓦片的像素宽高，深度切片 slice = log(depth) * z - w
+    vec4 clusterParams;
+    // 环境光照：辐照度 / π 的 9 个球谐系数，预滤波立方体贴图的最大 mip 层（见 src/environment_lighting.h）
+    vec4 irradianceSH[9];
+    vec4 environmentParams;
+};
+
+// 点光源与簇的光源列表（见 src/light_clusters.h）
+// lightData 每个光源两个 texel：(位置, 作用半径)、(颜色, 0)；clusterGrid 每个簇为 (起始位置, 光源数)
+uniform samplerBuffer lightData;
+uniform usamplerBuffer clusterGrid;
+uniform usamplerBuffer lightIndices;
+
+// 为 0 时不查簇，遍历所有光源（用于对比）
+uniform int clusteredShading;
+
+// 按 GGX 预滤波的环境立方体贴图（mip 层对应粗糙度）与 split-sum 的 BRDF 查找表
+uniform samplerCube prefilterMap;
+uniform sampler2D brdfLUT;
 
 const float PI = 3.14159265359;
 
@@ -60,10 +82,66 @@ vec3 fresnelSchlick(float cosTheta, vec3 F0)
     return F0 + (1.0 - F0) * pow(clamp(1.0 - cosTheta, 0.0, 1.0), 5.0);
 }
 
+// 考虑粗糙度的菲涅尔，用于环境光照：粗糙表面在掠射角的反射不会趋近 1
+vec3 fresnelSchlickRoughness(float cosTheta, vec3 F0, float roughness)
+{
+    return F0 + (max(vec3(1.0 - roughness), F0) - F0) * pow(clamp(1.0 - cosTheta, 0.0, 1.0), 5.0);
+}
+
+// 由球谐系数求法线方向的辐照度 / π
+vec3 irradiance(vec3 n)
+{
+    vec3 result = irradianceSH[0].rgb * 0.282095;
+    result += irradianceSH[1].rgb * 0.488603 * n.y;
+    result += irradianceSH[2].rgb * 0.488603 * n.z;
+    result += irradianceSH[3].rgb * 0.488603 * n.x;
+    result += irradianceSH[4].rgb * 1.092548 * n.x * n.y;
+    result += irradianceSH[5].rgb * 1.092548 * n.y * n.z;
+    result += irradianceSH[6].rgb * 0.315392 * (3.0 * n.z * n.z - 1.0);
+    result += irradianceSH[7].rgb * 1.092548 * n.x * n.z;
+    result += irradianceSH[8].rgb * 0.546274 * (n.x * n.x - n.y * n.y);
+    return max(result, vec3(0.0));
+}
+
+// 一个点光源的 Cook-Torrance 反射，距离衰减在作用半径处平滑地降到 0
+vec3 shadeLight(int light, vec3 N, vec3 V, vec3 F0)
+{
+    vec4 positionRadius = texelFetch(lightData, light * 2);
+    vec3 lightColor = texelFetch(lightData, light * 2 + 1).rgb;
+
+    // 计算光照方向和距离
+    vec3 toLight = positionRadius.xyz - FragPos;
+    float lightDistance = length(toLight);
+    if (lightDistance >= positionRadius.w)
+        return vec3(0.0);
+    vec3 L = toLight / lightDistance;
+    vec3 H = normalize(V + L);
+    float window = clamp(1.0 - pow(lightDistance / positionRadius.w, 4.0), 0.0, 1.0);
+    float attenuation = window * window / max(lightDistance * lightDistance, 0.01);
+    vec3 radiance = lightColor * attenuation;
+
+    // BRDF项
+    float NDF = DistributionGGX(N, H, roughness);
+    float G = GeometrySmith(N, V, L, roughness);
+    vec3 F = fresnelSchlick(clamp(dot(H, V), 0.0, 1.0), F0);
+
+    vec3 numerator = NDF * G * F;
+    float denominator = 4.0 * max(dot(N, V), 0.0) * max(dot(N, L), 0.0) + 0.0001;
+    vec3 specular = numerator / denominator;
+
+    // 计算漫反射和镜面反射比例
+    vec3 kS = F;
+    vec3 kD = vec3(1.0) - kS;
+    kD *= 1.0 - metallic;
+
+    float NdotL = max(dot(N, L), 0.0);
+    return (kD * albedo / PI + specular) * radiance * NdotL;
+}
+
 void main()
 {
     vec3 N = normalize(Normal);
-    vec3 V = normalize(camPos - FragPos);
+    vec3 V = normalize(camPos.xyz - FragPos);
     
     // 计算反射率
     vec3 F0 = vec3(0.04);
@@ -71,35 +149,38 @@ void main()
     
     // 反射率方程
     vec3 Lo = vec3(0.0);
-    for(int i = 0; i < NR_LIGHTS; ++i)
+    if (clusteredShading != 0)
     {
-        // 计算光照方向和距离
-        vec3 L = normalize(lightPositions[i] - FragPos);
-        vec3 H = normalize(V + L);
-        float distance = length(lightPositions[i] - FragPos);
-        float attenuation = 1.0 / (distance * distance);
-        vec3 radiance = lightColors[i] * attenuation;
-        
-        // BRDF项
-        float NDF = DistributionGGX(N, H, roughness);
-        float G = GeometrySmith(N, V, L, roughness);
-        vec3 F = fresnelSchlick(clamp(dot(H, V), 0.0, 1.0), F0);
-        
-        vec3 numerator = NDF * G * F;
-        float denominator = 4.0 * max(dot(N, V), 0.0) * max(dot(N, L), 0.0) + 0.0001;
-        vec3 specular = numerator / denominator;
-        
-        // 计算漫反射和镜面反射比例
-        vec3 kS = F;
-        vec3 kD = vec3(1.0) - kS;
-        kD *= 1.0 - metallic;
-        
-        float NdotL = max(dot(N, L), 0.0);
-        Lo += (kD * albedo / PI + specular) * radiance * NdotL;
+        // 由像素位置与视图空间深度定位簇，只计算簇列表中的光源
+        float viewDepth = -(view * vec4(FragPos, 1.0)).z;
+        int slice = clamp(int(floor(log(viewDepth) * clusterParams.z - clusterParams.w)), 0, clusterDims.z - 1);
+        ivec2 tile = min(ivec2(gl_FragCoord.xy / clusterParams.xy), clusterDims.xy - 1);
+        int cluster = tile.x + clusterDims.x * (tile.y + clusterDims.y * slice);
+        uvec2 range = texelFetch(clusterGrid, cluster).xy;
+        for(uint i = 0u; i < range.y; ++i)
+        {
+            int light = int(texelFetch(lightIndices, int(range.x + i)).r);
+            Lo += shadeLight(light, N, V, F0);
+        }
+    }
+    else
+    {
+        for(int i = 0; i < clusterDims.w; ++i)
+        {
+            Lo += shadeLight(i, N, V, F0);
+        }
     }
     
-    // 环境光照（简化处理）
-    vec3 ambient = vec3(0.03) * albedo;
+    // 环境光照：漫反射由球谐求值，镜面反射为预滤波贴图与 BRDF 查找表的 split-sum 近似
+    float NdotV = max(dot(N, V), 0.0);
+    vec3 F = fresnelSchlickRoughness(NdotV, F0, roughness);
+    vec3 kD = (1.0 - F) * (1.0 - metallic);
+    vec3 diffuse = irradiance(N) * albedo;
+    vec3 R = reflect(-V, N);
+    vec3 prefiltered = textureLod(prefilterMap, R, roughness * environmentParams.x).rgb;
+    vec2 brdf = texture(brdfLUT, vec2(NdotV, roughness)).rg;
+    vec3 specular = prefiltered * (F0 * brdf.x + brdf.y);
+    vec3 ambient = kD * diffuse + specular;
     vec3 color = ambient + Lo;
     
     // 色调映射和伽马校正
@@ -7,8 +7,18 @@ out vec3 FragPos;
 out vec3 Normal;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+
+// 每帧共享的相机、簇参数与环境光照（与 src/main.cpp 中的 FrameData 一致）
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec4 camPos;
+    ivec4 clusterDims;
+    vec4 clusterParams;
+    // 环境光照：辐照度 / π 的 9 个球谐系数，预滤波立方体贴图的最大 mip 层（见 src/environment_lighting.h）
+    vec4 irradianceSH[9];
+    vec4 environmentParams;
+};
 
 void main()
 {
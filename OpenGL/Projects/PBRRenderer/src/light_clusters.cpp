@@ -0,0 +1,201 @@
+// light_clusters.cpp
+// 簇的包围盒、逐切片并行的光源剔除与纹理缓冲区的上传
+
+#include "light_clusters.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// 创建纹理缓冲区：缓冲对象的内容每帧重新指定，纹理只需要在创建时连接一次
+void createTextureBuffer(GLuint& buffer, GLuint& texture, GLenum format) {
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+    glBufferData(GL_TEXTURE_BUFFER, 16, NULL, GL_STREAM_DRAW);
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_BUFFER, texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, format, buffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+// 重新指定整个数据存储，驱动可以为仍在被上一帧使用的旧存储另外分配，不需要等待 GPU
+void uploadTextureBuffer(GLuint buffer, const void* data, size_t size) {
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+    glBufferData(GL_TEXTURE_BUFFER, (GLsizeiptr)std::max<size_t>(size, 16), size > 0 ? data : NULL, GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+// 视图空间深度所在的切片，与 fragment.glsl 中的公式一致
+int depthSlice(const LightClusters& clusters, float depth) {
+    int slice = (int)std::floor(std::log(depth) * clusters.sliceScale - clusters.sliceBias);
+    return std::min(std::max(slice, 0), CLUSTER_Z - 1);
+}
+
+// 每个簇在视图空间中的包围盒：瓦片的四条边射线在切片前后两个深度处的 8 个点
+void computeClusterBounds(LightClusters& clusters) {
+    clusters.clusterMin.resize(CLUSTER_COUNT);
+    clusters.clusterMax.resize(CLUSTER_COUNT);
+
+    float tanHalfFovy = std::tan(clusters.fovy * 0.5f);
+    float aspect = (float)clusters.width / (float)clusters.height;
+    float depthRatio = clusters.farPlane / clusters.nearPlane;
+
+    for (int z = 0; z < CLUSTER_Z; ++z) {
+        float nearDepth = clusters.nearPlane * std::pow(depthRatio, (float)z / CLUSTER_Z);
+        float farDepth = clusters.nearPlane * std::pow(depthRatio, (float)(z + 1) / CLUSTER_Z);
+        for (int y = 0; y < CLUSTER_Y; ++y) {
+            // 最后一行、一列瓦片可以超出屏幕，与着色器中按像素整除的结果一致
+            float ndcY0 = 2.0f * y * clusters.tileHeight / clusters.height - 1.0f;
+            float ndcY1 = 2.0f * (y + 1) * clusters.tileHeight / clusters.height - 1.0f;
+            for (int x = 0; x < CLUSTER_X; ++x) {
+                float ndcX0 = 2.0f * x * clusters.tileWidth / clusters.width - 1.0f;
+                float ndcX1 = 2.0f * (x + 1) * clusters.tileWidth / clusters.width - 1.0f;
+
+                glm::vec3 boundsMin(INFINITY);
+                glm::vec3 boundsMax(-INFINITY);
+                for (float depth : {nearDepth, farDepth}) {
+                    for (float ndcY : {ndcY0, ndcY1}) {
+                        for (float ndcX : {ndcX0, ndcX1}) {
+                            glm::vec3 point(ndcX * depth * tanHalfFovy * aspect, ndcY * depth * tanHalfFovy, -depth);
+                            boundsMin = glm::min(boundsMin, point);
+                            boundsMax = glm::max(boundsMax, point);
+                        }
+                    }
+                }
+                int cluster = x + CLUSTER_X * (y + CLUSTER_Y * z);
+                clusters.clusterMin[cluster] = boundsMin;
+                clusters.clusterMax[cluster] = boundsMax;
+            }
+        }
+    }
+}
+
+// 球心到包围盒的最近距离不超过半径时相交
+bool sphereIntersectsBox(const glm::vec4& sphere, const glm::vec3& boxMin, const glm::vec3& boxMax) {
+    glm::vec3 center(sphere);
+    glm::vec3 offset = center - glm::clamp(center, boxMin, boxMax);
+    return glm::dot(offset, offset) <= sphere.w * sphere.w;
+}
+
+} // namespace
+
+bool createLightClusters(LightClusters& clusters) {
+    createTextureBuffer(clusters.lightDataBuffer, clusters.lightDataTexture, GL_RGBA32F);
+    createTextureBuffer(clusters.gridBuffer, clusters.gridTexture, GL_RG32UI);
+    createTextureBuffer(clusters.indexBuffer, clusters.indexTexture, GL_R16UI);
+
+    clusters.clusterLights.resize((size_t)CLUSTER_COUNT * MAX_LIGHTS_PER_CLUSTER);
+    clusters.clusterLightCounts.resize(CLUSTER_COUNT);
+    clusters.grid.resize(CLUSTER_COUNT * 2);
+    return clusters.lightDataTexture != 0 && clusters.gridTexture != 0 && clusters.indexTexture != 0;
+}
+
+void buildLightClusters(LightClusters& clusters, const std::vector<PointLight>& lights, const glm::mat4& view,
+                        float fovy, int width, int height, float nearPlane, float farPlane, JobSystem& jobs) {
+    if (fovy != clusters.fovy || width != clusters.width || height != clusters.height ||
+        nearPlane != clusters.nearPlane || farPlane != clusters.farPlane) {
+        clusters.fovy = fovy;
+        clusters.width = width;
+        clusters.height = height;
+        clusters.nearPlane = nearPlane;
+        clusters.farPlane = farPlane;
+        clusters.tileWidth = std::ceil((float)width / CLUSTER_X);
+        clusters.tileHeight = std::ceil((float)height / CLUSTER_Y);
+        float logDepthRatio = std::log(farPlane / nearPlane);
+        clusters.sliceScale = CLUSTER_Z / logDepthRatio;
+        clusters.sliceBias = CLUSTER_Z * std::log(nearPlane) / logDepthRatio;
+        computeClusterBounds(clusters);
+    }
+
+    int lightCount = std::min((int)lights.size(), MAX_CLUSTER_LIGHTS);
+    clusters.lightCount = lightCount;
+    clusters.viewSpheres.resize(lightCount);
+    clusters.lightSlices.resize(lightCount);
+    clusters.lightData.resize(lightCount * 2);
+
+    // 包围球变换到视图空间，并求出它覆盖的切片范围；完全在近平面之前或远平面之后的光源范围为空
+    for (int i = 0; i < lightCount; ++i) {
+        const PointLight& light = lights[i];
+        glm::vec3 center = glm::vec3(view * glm::vec4(light.position, 1.0f));
+        clusters.viewSpheres[i] = glm::vec4(center, light.radius);
+        clusters.lightData[i * 2] = glm::vec4(light.position, light.radius);
+        clusters.lightData[i * 2 + 1] = glm::vec4(light.color, 0.0f);
+
+        float nearestDepth = -center.z - light.radius;
+        float farthestDepth = -center.z + light.radius;
+        if (farthestDepth < nearPlane || nearestDepth > farPlane) {
+            clusters.lightSlices[i] = glm::ivec2(1, 0);
+        } else {
+            clusters.lightSlices[i] = glm::ivec2(depthSlice(clusters, std::max(nearestDepth, nearPlane)),
+                                                 depthSlice(clusters, std::min(farthestDepth, farPlane)));
+        }
+    }
+
+    // 每个切片的簇只由处理该切片的线程写入。计数可以超过容量，用来统计溢出
+    jobs.parallelFor(0, CLUSTER_Z, 1, [&](size_t sliceBegin, size_t sliceEnd) {
+        for (int z = (int)sliceBegin; z < (int)sliceEnd; ++z) {
+            int firstCluster = CLUSTER_X * CLUSTER_Y * z;
+            std::fill(clusters.clusterLightCounts.begin() + firstCluster,
+                      clusters.clusterLightCounts.begin() + firstCluster + CLUSTER_X * CLUSTER_Y, 0);
+
+            for (int i = 0; i < lightCount; ++i) {
+                if (z < clusters.lightSlices[i].x || z > clusters.lightSlices[i].y) {
+                    continue;
+                }
+                const glm::vec4& sphere = clusters.viewSpheres[i];
+                for (int cluster = firstCluster; cluster < firstCluster + CLUSTER_X * CLUSTER_Y; ++cluster) {
+                    if (!sphereIntersectsBox(sphere, clusters.clusterMin[cluster], clusters.clusterMax[cluster])) {
+                        continue;
+                    }
+                    int count = clusters.clusterLightCounts[cluster]++;
+                    if (count < MAX_LIGHTS_PER_CLUSTER) {
+                        clusters.clusterLights[(size_t)cluster * MAX_LIGHTS_PER_CLUSTER + count] = (GLushort)i;
+                    }
+                }
+            }
+        }
+    });
+
+    // 各簇的列表紧凑地排列成一个索引数组
+    clusters.indices.clear();
+    clusters.occupiedClusters = 0;
+    clusters.maxClusterLights = 0;
+    clusters.overflowedClusters = 0;
+    for (int cluster = 0; cluster < CLUSTER_COUNT; ++cluster) {
+        int count = clusters.clusterLightCounts[cluster];
+        int stored = std::min(count, MAX_LIGHTS_PER_CLUSTER);
+        clusters.grid[cluster * 2] = (GLuint)clusters.indices.size();
+        clusters.grid[cluster * 2 + 1] = (GLuint)stored;
+
+        const GLushort* list = &clusters.clusterLights[(size_t)cluster * MAX_LIGHTS_PER_CLUSTER];
+        clusters.indices.insert(clusters.indices.end(), list, list + stored);
+
+        clusters.occupiedClusters += count > 0 ? 1 : 0;
+        clusters.maxClusterLights = std::max(clusters.maxClusterLights, count);
+        clusters.overflowedClusters += count > MAX_LIGHTS_PER_CLUSTER ? 1 : 0;
+    }
+
+    uploadTextureBuffer(clusters.lightDataBuffer, clusters.lightData.data(),
+                        clusters.lightData.size() * sizeof(glm::vec4));
+    uploadTextureBuffer(clusters.gridBuffer, clusters.grid.data(), clusters.grid.size() * sizeof(GLuint));
+    uploadTextureBuffer(clusters.indexBuffer, clusters.indices.data(), clusters.indices.size() * sizeof(GLushort));
+}
+
+void bindLightClusters(const LightClusters& clusters, GLuint firstUnit) {
+    const GLuint textures[] = {clusters.lightDataTexture, clusters.gridTexture, clusters.indexTexture};
+    for (GLuint i = 0; i < 3; ++i) {
+        glActiveTexture(GL_TEXTURE0 + firstUnit + i);
+        glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+    }
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void destroyLightClusters(LightClusters& clusters) {
+    const GLuint textures[] = {clusters.lightDataTexture, clusters.gridTexture, clusters.indexTexture};
+    const GLuint buffers[] = {clusters.lightDataBuffer, clusters.gridBuffer, clusters.indexBuffer};
+    glDeleteTextures(3, textures);
+    glDeleteBuffers(3, buffers);
+    clusters = LightClusters();
+}
@@ -0,0 +1,90 @@
+// light_clusters.h
+// 分簇前向渲染的光源剔除：视锥体按屏幕瓦片与指数分布的深度切片划分为 CLUSTER_X * CLUSTER_Y * CLUSTER_Z 个簇（froxel），
+// 每帧为每个簇找出包围球与它相交的点光源，片段着色器由 gl_FragCoord 与视图空间深度算出所在的簇，只计算簇中的光源
+//
+// GL 3.3 没有计算着色器，剔除在 CPU 上按深度切片并行完成，每个切片只写自己的簇，线程之间不需要同步。
+// 结果用纹理缓冲区（GL 3.1 起为核心功能）传给片段着色器：
+//   lightData    GL_RGBA32F，每个光源两个 texel：(世界空间位置, 作用半径)、(颜色, 0)
+//   clusterGrid  GL_RG32UI，每个簇一个 texel：(在 lightIndices 中的起始位置, 光源数)
+//   lightIndices GL_R16UI，所有簇的光源索引依次排列
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "job_system.h"
+
+// 簇的划分，与 fragment.glsl 中通过 FrameData.clusterDims 读取的值一致
+const int CLUSTER_X = 16;
+const int CLUSTER_Y = 9;
+const int CLUSTER_Z = 24;
+const int CLUSTER_COUNT = CLUSTER_X * CLUSTER_Y * CLUSTER_Z;
+
+// 光源数上限，索引用 16 位无符号整数存储
+const int MAX_CLUSTER_LIGHTS = 4096;
+
+// 每个簇最多记录的光源数，超出的光源被丢弃并计入 overflowedClusters
+const int MAX_LIGHTS_PER_CLUSTER = 128;
+
+// 点光源在作用半径处衰减到 0
+struct PointLight {
+    glm::vec3 position;
+    float radius;
+    glm::vec3 color;
+};
+
+struct LightClusters {
+    // 三个纹理缓冲区：缓冲对象与引用它的纹理
+    GLuint lightDataBuffer = 0;
+    GLuint lightDataTexture = 0;
+    GLuint gridBuffer = 0;
+    GLuint gridTexture = 0;
+    GLuint indexBuffer = 0;
+    GLuint indexTexture = 0;
+
+    // 视图空间中每个簇的包围盒，只在投影参数或帧缓冲尺寸变化时重新计算
+    std::vector<glm::vec3> clusterMin;
+    std::vector<glm::vec3> clusterMax;
+    float fovy = 0.0f;
+    int width = 0;
+    int height = 0;
+    float nearPlane = 0.0f;
+    float farPlane = 0.0f;
+
+    // 瓦片的像素尺寸与深度切片公式 slice = log(depth) * sliceScale - sliceBias 的系数，着色器用同样的值定位簇
+    float tileWidth = 0.0f;
+    float tileHeight = 0.0f;
+    float sliceScale = 0.0f;
+    float sliceBias = 0.0f;
+
+    // 构建时的临时数据，每帧复用：视图空间包围球、每个光源覆盖的切片范围、每个簇固定容量的光源列表
+    std::vector<glm::vec4> viewSpheres;
+    std::vector<glm::ivec2> lightSlices;
+    std::vector<GLushort> clusterLights;
+    std::vector<int> clusterLightCounts;
+
+    // 上传的内容
+    std::vector<glm::vec4> lightData;
+    std::vector<GLuint> grid;
+    std::vector<GLushort> indices;
+
+    // 最近一次构建的统计
+    int lightCount = 0;
+    int occupiedClusters = 0;
+    int maxClusterLights = 0;
+    int overflowedClusters = 0;
+};
+
+bool createLightClusters(LightClusters& clusters);
+
+// 按当前相机为 lights 构建每个簇的光源列表并上传到纹理缓冲区；width、height 为帧缓冲尺寸
+void buildLightClusters(LightClusters& clusters, const std::vector<PointLight>& lights, const glm::mat4& view,
+                        float fovy, int width, int height, float nearPlane, float farPlane, JobSystem& jobs);
+
+// 把 lightData、clusterGrid、lightIndices 依次绑定到纹理单元 firstUnit、firstUnit + 1、firstUnit + 2
+void bindLightClusters(const LightClusters& clusters, GLuint firstUnit);
+
+void destroyLightClusters(LightClusters& clusters);
@@ -3,17 +3,71 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
-#include <fstream>
-#include <sstream>
+#include <random>
 #include <string>
+#include <vector>
+
+#include "environment_lighting.h"
+#include "gpu_timer.h"
+#include "job_system.h"
+#include "light_clusters.h"
+#include "shader_program.h"
 
 // 窗口尺寸
 const int WIDTH = 800;
 const int HEIGHT = 600;
 
-// 着色器程序ID
-GLuint shaderProgram;
+// 相机的透视参数，簇按相机视锥体划分
+const float CAMERA_FOVY = glm::radians(45.0f);
+const float CAMERA_NEAR = 0.1f;
+const float CAMERA_FAR = 100.0f;
+
+// 场景：地面上 CUBE_GRID x CUBE_GRID 个旋转的立方体，点光源随机分布在地面上方
+const int CUBE_GRID = 10;
+const float CUBE_SPACING = 3.5f;
+const float FLOOR_SIZE = 40.0f;
+const unsigned int LIGHT_SEED = 1234;
+
+// 默认的点光源数，可用 --lights 指定（1 到 MAX_CLUSTER_LIGHTS）
+const int DEFAULT_LIGHT_COUNT = 1024;
+
+// 每帧共享的相机、簇参数与环境光照，与着色器中的 layout(std140) uniform FrameData 一致（std140 中 vec3 按 vec4 对齐）
+struct FrameData {
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::vec4 camPos;
+    // xyz 为簇在各方向上的数量，w 为光源总数
+    glm::ivec4 clusterDims;
+    // 瓦片的像素宽高，深度切片公式的 scale 与 bias
+    glm::vec4 clusterParams;
+    // 辐照度 / π 的球谐系数与预滤波立方体贴图的最大 mip 层（x）
+    glm::vec4 irradianceSH[9];
+    glm::vec4 environmentParams;
+};
+const GLuint FRAME_DATA_BINDING = 0;
+
+// 光源数据、簇网格与光源索引所在的纹理单元
+const GLuint LIGHT_CLUSTER_TEXTURE_UNIT = 0;
+
+// 预滤波环境贴图与 BRDF 查找表所在的纹理单元
+const GLuint PREFILTER_TEXTURE_UNIT = 3;
+const GLuint BRDF_LUT_TEXTURE_UNIT = 4;
+
+// 着色器程序与每帧的 uniform 缓冲区
+ShaderProgram shaderProgram;
+UniformBuffer frameUniforms;
+
+// 逐次绘制的 uniform 位置，创建程序时取得
+GLint modelLoc = -1;
+GLint albedoLoc = -1;
+GLint metallicLoc = -1;
+GLint roughnessLoc = -1;
+GLint clusteredShadingLoc = -1;
 
 // 顶点数组对象和顶点缓冲对象
 GLuint VAO, VBO, EBO;
@@ -21,80 +75,129 @@ GLuint VAO, VBO, EBO;
 // 旋转角度
 GLfloat rotationAngle = 0.0f;
 
-// 读取着色器文件
-std::string readShaderFile(const char* filePath) {
-    std::string shaderCode;
-    std::ifstream shaderFile;
-    
-    // 确保ifstream对象可以抛出异常
-    shaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    
-    try {
-        // 打开文件
-        shaderFile.open(filePath);
-        
-        // 读取文件内容到stringstream
-        std::stringstream shaderStream;
-        shaderStream << shaderFile.rdbuf();
-        
-        // 关闭文件
-        shaderFile.close();
-        
-        // 转换到string
-        shaderCode = shaderStream.str();
-    } catch (std::ifstream::failure& e) {
-        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
+// 当前的帧缓冲尺寸，瓦片按像素划分
+int framebufferWidth = WIDTH;
+int framebufferHeight = HEIGHT;
+
+// 点光源：初始位置与运动参数，每帧由它们算出 lights
+struct LightMotion {
+    glm::vec3 center;
+    float orbitRadius;
+    float speed;
+    float phase;
+};
+std::vector<LightMotion> lightMotions;
+std::vector<PointLight> lights;
+int lightCount = DEFAULT_LIGHT_COUNT;
+
+// 分簇剔除；--no-clusters 或 C 键切换为遍历所有光源
+LightClusters lightClusters;
+bool clusteredShading = true;
+
+// 环境光照：--environment 指定 HDR 环境图（默认为程序生成的天空），--no-ibl-cache 每次都重新预计算
+std::string environmentPath;
+bool useIblCache = true;
+EnvironmentLighting environmentLighting;
+GLuint prefilterMap = 0;
+GLuint brdfLutTexture = 0;
+
+// 光照通道的GPU耗时与剔除的CPU耗时
+GpuTimer lightingTimer;
+double clusterMilliseconds = 0.0;
+
+// 创建着色器程序，连接 uniform 块并取得逐次绘制的 uniform 位置
+bool createShaderProgram() {
+    if (!shaderProgram.load("shaders/vertex.glsl", "shaders/fragment.glsl")) {
+        return false;
     }
-    
-    return shaderCode;
+    shaderProgram.bindUniformBlock("FrameData", FRAME_DATA_BINDING, sizeof(FrameData));
+    modelLoc = shaderProgram.uniformLocation("model");
+    albedoLoc = shaderProgram.uniformLocation("albedo");
+    metallicLoc = shaderProgram.uniformLocation("metallic");
+    roughnessLoc = shaderProgram.uniformLocation("roughness");
+    clusteredShadingLoc = shaderProgram.uniformLocation("clusteredShading");
+
+    // 纹理缓冲区的采样器固定在各自的纹理单元上
+    shaderProgram.use();
+    glUniform1i(shaderProgram.uniformLocation("lightData"), LIGHT_CLUSTER_TEXTURE_UNIT);
+    glUniform1i(shaderProgram.uniformLocation("clusterGrid"), LIGHT_CLUSTER_TEXTURE_UNIT + 1);
+    glUniform1i(shaderProgram.uniformLocation("lightIndices"), LIGHT_CLUSTER_TEXTURE_UNIT + 2);
+    glUniform1i(shaderProgram.uniformLocation("prefilterMap"), PREFILTER_TEXTURE_UNIT);
+    glUniform1i(shaderProgram.uniformLocation("brdfLUT"), BRDF_LUT_TEXTURE_UNIT);
+    glUseProgram(0);
+    return frameUniforms.create(sizeof(FrameData), FRAME_DATA_BINDING);
 }
 
-// 编译着色器
-GLuint compileShader(GLenum type, const char* source) {
-    GLuint shader = glCreateShader(type);
-    glShaderSource(shader, 1, &source, NULL);
-    glCompileShader(shader);
-    
-    // 检查编译错误
-    GLint success;
-    GLchar infoLog[512];
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(shader, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::COMPILATION_FAILED\n" << infoLog << std::endl;
+// 读取（或预计算）环境光照并上传预滤波立方体贴图与 BRDF 查找表，球谐系数每帧随 FrameData 上传
+bool createEnvironmentTextures() {
+    if (!loadEnvironmentLighting(environmentPath, useIblCache, environmentLighting)) {
+        return false;
     }
-    
-    return shader;
+    reportEnvironmentLighting(environmentLighting);
+    
+    // 各 mip 层由预计算给出，不能用 glGenerateMipmap；无缝过滤避免粗糙度高时出现面的接缝
+    glGenTextures(1, &prefilterMap);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, prefilterMap);
+    for (int level = 0; level < IBL_SPECULAR_MIP_LEVELS; ++level) {
+        int size = specularMipSize(level);
+        for (int face = 0; face < 6; ++face) {
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, level, GL_RGBA16F, size, size, 0, GL_RGBA,
+                         GL_HALF_FLOAT, &environmentLighting.specular[specularOffset(level, face)]);
+        }
+    }
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, IBL_SPECULAR_MIP_LEVELS - 1);
+    glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+    
+    glGenTextures(1, &brdfLutTexture);
+    glBindTexture(GL_TEXTURE_2D, brdfLutTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, IBL_BRDF_LUT_SIZE, IBL_BRDF_LUT_SIZE, 0, GL_RG, GL_HALF_FLOAT,
+                 environmentLighting.brdfLut.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    
+    // 上传后只保留球谐系数
+    environmentLighting.specular = std::vector<uint16_t>();
+    environmentLighting.brdfLut = std::vector<uint16_t>();
+    return true;
 }
 
-// 创建着色器程序
-void createShaderProgram() {
-    // 读取着色器代码
-    std::string vertexShaderCode = readShaderFile("shaders/vertex.glsl");
-    std::string fragmentShaderCode = readShaderFile("shaders/fragment.glsl");
-    
-    // 编译着色器
-    GLuint vertexShader = compileShader(GL_VERTEX_SHADER, vertexShaderCode.c_str());
-    GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentShaderCode.c_str());
-    
-    // 创建着色器程序
-    shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-    
-    // 检查链接错误
-    GLint success;
-    GLchar infoLog[512];
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-    if (!success) {
-        glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+// 随机生成点光源：位置在地面上方，各自绕一个小圆周运动，颜色为饱和的随机色
+void setupLights() {
+    std::mt19937 random(LIGHT_SEED);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    lightMotions.resize(lightCount);
+    lights.resize(lightCount);
+    for (int i = 0; i < lightCount; ++i) {
+        LightMotion& motion = lightMotions[i];
+        motion.center = glm::vec3((unit(random) - 0.5f) * FLOOR_SIZE, 0.3f + unit(random) * 2.0f,
+                                  (unit(random) - 0.5f) * FLOOR_SIZE);
+        motion.orbitRadius = 0.5f + unit(random) * 1.5f;
+        motion.speed = 0.5f + unit(random);
+        motion.phase = unit(random) * 6.2831853f;
+
+        glm::vec3 color = glm::vec3(unit(random), unit(random), unit(random));
+        color /= std::max(color.r, std::max(color.g, color.b));
+        lights[i].radius = 2.0f + unit(random) * 2.0f;
+        lights[i].color = color * 3.0f;
+    }
+}
+
+void updateLights(float time) {
+    for (int i = 0; i < lightCount; ++i) {
+        const LightMotion& motion = lightMotions[i];
+        float angle = motion.phase + time * motion.speed;
+        lights[i].position = motion.center + motion.orbitRadius * glm::vec3(std::cos(angle), 0.0f, std::sin(angle));
     }
-    
-    // 删除着色器，因为它们已经链接到程序中
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
 }
 
 // 设置顶点数据和缓冲区
@@ -169,69 +272,173 @@ void setupBuffers() {
     glBindVertexArray(0);
 }
 
+// 每秒输出一次剔除与光照通道的平均耗时，以及簇中光源数的统计
+void reportFrameTimes() {
+    static double lastReportTime = glfwGetTime();
+    static double cullMilliseconds = 0.0;
+    static double lightingMilliseconds = 0.0;
+    static int frames = 0;
+    
+    cullMilliseconds += clusterMilliseconds;
+    lightingMilliseconds += lightingTimer.milliseconds;
+    frames++;
+    
+    double now = glfwGetTime();
+    if (now - lastReportTime >= 1.0) {
+        std::cout << lightCount << " lights, " << (clusteredShading ? "clustered" : "all lights per fragment")
+                  << ": lighting pass (" << framebufferWidth << "x" << framebufferHeight << ") "
+                  << lightingMilliseconds / frames << " ms";
+        if (clusteredShading) {
+            int occupied = std::max(lightClusters.occupiedClusters, 1);
+            std::cout << ", light culling " << cullMilliseconds / frames << " ms; " << lightClusters.occupiedClusters
+                      << "/" << CLUSTER_COUNT << " clusters lit, " << (float)lightClusters.indices.size() / occupied
+                      << " lights on average, " << lightClusters.maxClusterLights << " at most";
+            if (lightClusters.overflowedClusters > 0) {
+                std::cout << " (" << lightClusters.overflowedClusters << " clusters over " << MAX_LIGHTS_PER_CLUSTER
+                          << ")";
+            }
+        }
+        std::cout << std::endl;
+        cullMilliseconds = 0.0;
+        lightingMilliseconds = 0.0;
+        frames = 0;
+        lastReportTime = now;
+    }
+}
+
+// 绘制一个立方体，model 决定位置与尺寸
+void drawCube(const glm::mat4& model, const glm::vec3& albedo, float metallic, float roughness) {
+    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
+    glUniform3f(albedoLoc, albedo.r, albedo.g, albedo.b);
+    glUniform1f(metallicLoc, metallic);
+    glUniform1f(roughnessLoc, roughness);
+    glDrawArrays(GL_TRIANGLES, 0, 36);
+}
+
 // 渲染循环
-void render() {
+void render(JobSystem& jobs) {
     // 清空颜色和深度缓冲
     glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     
+    // 相机从斜上方看向地面中心
+    glm::vec3 cameraPos(0.0f, 12.0f, 24.0f);
+    float aspect = (GLfloat)framebufferWidth / (GLfloat)framebufferHeight;
+    glm::mat4 view = glm::lookAt(cameraPos, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    
+    // 更新光源并重建簇的光源列表；遍历所有光源时仍然上传光源数据，只是不需要剔除
+    updateLights((float)glfwGetTime());
+    auto cullStart = std::chrono::steady_clock::now();
+    buildLightClusters(lightClusters, lights, view, CAMERA_FOVY, framebufferWidth, framebufferHeight, CAMERA_NEAR,
+                       CAMERA_FAR, jobs);
+    clusterMilliseconds =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - cullStart).count();
+    
+    // 相机与簇参数，每帧写入 uniform 缓冲区一次
+    FrameData frame;
+    frame.view = view;
+    frame.projection = glm::perspective(CAMERA_FOVY, aspect, CAMERA_NEAR, CAMERA_FAR);
+    frame.camPos = glm::vec4(cameraPos, 1.0f);
+    frame.clusterDims = glm::ivec4(CLUSTER_X, CLUSTER_Y, CLUSTER_Z, lightClusters.lightCount);
+    frame.clusterParams = glm::vec4(lightClusters.tileWidth, lightClusters.tileHeight, lightClusters.sliceScale,
+                                    lightClusters.sliceBias);
+    for (int i = 0; i < 9; ++i) {
+        frame.irradianceSH[i] = environmentLighting.irradianceSH[i];
+    }
+    frame.environmentParams = glm::vec4((float)(IBL_SPECULAR_MIP_LEVELS - 1), 0.0f, 0.0f, 0.0f);
+    frameUniforms.update(frame);
+    
     // 使用着色器程序
-    glUseProgram(shaderProgram);
+    beginGpuTimer(lightingTimer);
+    shaderProgram.use();
+    glUniform1i(clusteredShadingLoc, clusteredShading ? 1 : 0);
+    bindLightClusters(lightClusters, LIGHT_CLUSTER_TEXTURE_UNIT);
+    glActiveTexture(GL_TEXTURE0 + PREFILTER_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, prefilterMap);
+    glActiveTexture(GL_TEXTURE0 + BRDF_LUT_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, brdfLutTexture);
+    glActiveTexture(GL_TEXTURE0);
+    glBindVertexArray(VAO);
     
-    // 创建变换矩阵
-    glm::mat4 model = glm::mat4(1.0f);
-    glm::mat4 view = glm::mat4(1.0f);
-    glm::mat4 projection = glm::mat4(1.0f);
+    // 地面
+    glm::mat4 floorModel = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -0.05f, 0.0f));
+    floorModel = glm::scale(floorModel, glm::vec3(FLOOR_SIZE, 0.1f, FLOOR_SIZE));
+    drawCube(floorModel, glm::vec3(0.6f), 0.0f, 0.6f);
     
-    // 旋转模型
+    // 旋转的立方体，金属度与粗糙度沿两个方向变化
     rotationAngle += 0.01f;
-    model = glm::rotate(model, rotationAngle, glm::vec3(1.0f, 1.0f, 0.0f));
-    
-    // 相机视图
-    view = glm::translate(view, glm::vec3(0.0f, 0.0f, -3.0f));
-    
-    // 透视投影
-    projection = glm::perspective(glm::radians(45.0f), (GLfloat)WIDTH / (GLfloat)HEIGHT, 0.1f, 100.0f);
-    
-    // 获取着色器中的uniform位置
-    GLint modelLoc = glGetUniformLocation(shaderProgram, "model");
-    GLint viewLoc = glGetUniformLocation(shaderProgram, "view");
-    GLint projectionLoc = glGetUniformLocation(shaderProgram, "projection");
-    
-    // 传递变换矩阵到着色器
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-    glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, glm::value_ptr(projection));
-    
-    // 设置PBR材质参数
-    glUniform3f(glGetUniformLocation(shaderProgram, "albedo"), 0.95f, 0.75f, 0.55f);
-    glUniform1f(glGetUniformLocation(shaderProgram, "metallic"), 0.7f);
-    glUniform1f(glGetUniformLocation(shaderProgram, "roughness"), 0.3f);
-    glUniform3f(glGetUniformLocation(shaderProgram, "camPos"), 0.0f, 0.0f, 3.0f);
-    
-    // 设置光源参数
-    glUniform3f(glGetUniformLocation(shaderProgram, "lightPositions[0]"), 0.0f, 1.0f, 2.0f);
-    glUniform3f(glGetUniformLocation(shaderProgram, "lightColors[0]"), 1.0f, 1.0f, 1.0f);
+    for (int row = 0; row < CUBE_GRID; ++row) {
+        for (int column = 0; column < CUBE_GRID; ++column) {
+            glm::vec3 position((column - (CUBE_GRID - 1) * 0.5f) * CUBE_SPACING, 1.0f,
+                               (row - (CUBE_GRID - 1) * 0.5f) * CUBE_SPACING);
+            glm::mat4 model = glm::translate(glm::mat4(1.0f), position);
+            model = glm::rotate(model, rotationAngle, glm::vec3(1.0f, 1.0f, 0.0f));
+            float metallic = (float)row / (CUBE_GRID - 1);
+            float roughness = glm::clamp((float)column / (CUBE_GRID - 1), 0.05f, 1.0f);
+            drawCube(model, glm::vec3(0.95f, 0.75f, 0.55f), metallic, roughness);
+        }
+    }
     
-    // 绘制立方体
-    glBindVertexArray(VAO);
-    glDrawArrays(GL_TRIANGLES, 0, 36);
     glBindVertexArray(0);
+    endGpuTimer(lightingTimer);
+    reportFrameTimes();
 }
 
 // 窗口大小变化回调
 void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
+    // 最小化时尺寸为 0，保留原来的尺寸
+    if (width == 0 || height == 0) {
+        return;
+    }
+    framebufferWidth = width;
+    framebufferHeight = height;
     glViewport(0, 0, width, height);
 }
 
-// 输入处理
+// 输入处理：C 切换分簇着色与遍历所有光源
 void processInput(GLFWwindow* window) {
+    static bool clusterKeyDown = false;
+    
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
         glfwSetWindowShouldClose(window, true);
     }
+    
+    bool down = glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS;
+    if (down && !clusterKeyDown) {
+        clusteredShading = !clusteredShading;
+        std::cout << "Clustered shading: " << (clusteredShading ? "on" : "off") << std::endl;
+    }
+    clusterKeyDown = down;
 }
 
-int main() {
+int main(int argc, char** argv) {
+    // 命令行参数：--lights N 指定点光源数（1 到 MAX_CLUSTER_LIGHTS），--threads T 指定剔除的线程数（默认全部硬件线程），
+    // --no-clusters 从遍历所有光源开始（运行时按 C 切换）；
+    // --environment file.hdr 指定环境光照的 HDR 等距柱状投影图，--no-ibl-cache 忽略 ibl_cache/ 重新预计算（测量冷启动）
+    unsigned int threadCount = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--lights") == 0 && i + 1 < argc) {
+            lightCount = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threadCount = (unsigned int)std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--no-clusters") == 0) {
+            clusteredShading = false;
+        } else if (std::strcmp(argv[i], "--environment") == 0 && i + 1 < argc) {
+            environmentPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--no-ibl-cache") == 0) {
+            useIblCache = false;
+        } else {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--lights N] [--threads T] [--no-clusters] [--environment file.hdr] [--no-ibl-cache]"
+                      << std::endl;
+            return -1;
+        }
+    }
+    if (lightCount < 1 || lightCount > MAX_CLUSTER_LIGHTS) {
+        std::cerr << "Light count must be between 1 and " << MAX_CLUSTER_LIGHTS << std::endl;
+        return -1;
+    }
+    
     // 初始化GLFW
     if (!glfwInit()) {
         std::cout << "Failed to initialize GLFW" << std::endl;
@@ -264,25 +471,48 @@ int main() {
         return -1;
     }
     
-    // 设置视口
-    glViewport(0, 0, WIDTH, HEIGHT);
+    // 设置视口；高 DPI 显示器上帧缓冲可以大于窗口尺寸
+    glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+    glViewport(0, 0, framebufferWidth, framebufferHeight);
     
     // 启用深度测试
     glEnable(GL_DEPTH_TEST);
     
     // 创建着色器程序
-    createShaderProgram();
+    if (!createShaderProgram()) {
+        std::cout << "Failed to create shader program" << std::endl;
+        glfwTerminate();
+        return -1;
+    }
+    reportShaderCacheStats();
     
     // 设置缓冲区
     setupBuffers();
     
+    // 光源与簇的纹理缓冲区
+    setupLights();
+    if (!createLightClusters(lightClusters)) {
+        std::cout << "Failed to create light cluster buffers" << std::endl;
+        glfwTerminate();
+        return -1;
+    }
+    if (!createEnvironmentTextures()) {
+        std::cout << "Failed to load environment lighting" << std::endl;
+        glfwTerminate();
+        return -1;
+    }
+    createGpuTimer(lightingTimer);
+    JobSystem jobs(threadCount);
+    std::cout << lightCount << " point lights, " << CLUSTER_X << "x" << CLUSTER_Y << "x" << CLUSTER_Z
+              << " clusters culled on " << jobs.threadCount() << " threads" << std::endl;
+    
     // 渲染循环
     while (!glfwWindowShouldClose(window)) {
         // 处理输入
         processInput(window);
         
         // 渲染
-        render();
+        render(jobs);
         
         // 交换缓冲
         glfwSwapBuffers(window);
@@ -294,7 +524,12 @@ int main() {
     // 清理资源
     glDeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
-    glDeleteProgram(shaderProgram);
+    shaderProgram.destroy();
+    frameUniforms.destroy();
+    destroyLightClusters(lightClusters);
+    glDeleteTextures(1, &prefilterMap);
+    glDeleteTextures(1, &brdfLutTexture);
+    destroyGpuTimer(lightingTimer);
     
     // 终止GLFW
     glfwTerminate();
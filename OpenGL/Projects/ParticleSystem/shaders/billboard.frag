@@ -0,0 +1,38 @@
+#version 330 core
+
+// 软粒子：与不透明场景的深度差小于 SOFTNESS 时逐渐变透明，被场景遮挡的部分完全透明，
+// 因此绘制粒子时不需要硬件深度测试
+in vec3 Color;
+in vec2 Corner;
+in float ViewDepth;
+
+out vec4 FragColor;
+
+uniform sampler2D sceneDepth;
+
+// 投影矩阵的 [2][2] 与 [3][2] 用于把深度缓冲的值还原为视图空间距离
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+};
+
+const float SOFTNESS = 0.1;
+const float OPACITY = 0.6;
+
+void main()
+{
+    float radius = length(Corner);
+    if (radius > 1.0) {
+        discard;
+    }
+
+    float depth = texelFetch(sceneDepth, ivec2(gl_FragCoord.xy), 0).r;
+    float sceneViewDepth = projection[3][2] / (depth * 2.0 - 1.0 + projection[2][2]);
+    float fade = clamp((sceneViewDepth - ViewDepth) / SOFTNESS, 0.0, 1.0);
+
+    float alpha = (1.0 - radius) * fade * OPACITY;
+    if (alpha <= 0.0) {
+        discard;
+    }
+    FragColor = vec4(Color, alpha);
+}
@@ -0,0 +1,31 @@
+#version 330 core
+
+// 实例化的面向相机四边形：每个粒子一个实例，4个顶点按 gl_VertexID 生成角点（三角形带）
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aColor;
+layout (location = 2) in float aSize;
+
+out vec3 Color;
+out vec2 Corner;
+out float ViewDepth;
+
+// 每帧共享的相机矩阵（frame_uniforms.h）
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+};
+
+// 粒子大小到世界空间半宽的比例，与点精灵（gl_PointSize = aSize * 200）在默认相机距离下的大小接近
+const float BILLBOARD_SCALE = 0.4;
+
+void main()
+{
+    Corner = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0 - 1.0;
+    Color = aColor;
+
+    // 在视图空间中展开，四边形始终正对相机
+    vec4 viewPos = view * vec4(aPos, 1.0);
+    viewPos.xy += Corner * aSize * BILLBOARD_SCALE;
+    ViewDepth = -viewPos.z;
+    gl_Position = projection * viewPos;
+}
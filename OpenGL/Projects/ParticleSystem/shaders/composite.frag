@@ -0,0 +1,12 @@
+#version 330 core
+
+// 把离屏渲染的不透明场景复制到默认帧缓冲，粒子随后混合在它上面
+in vec2 TexCoord;
+out vec4 FragColor;
+
+uniform sampler2D sceneColor;
+
+void main()
+{
+    FragColor = texture(sceneColor, TexCoord);
+}
@@ -0,0 +1,10 @@
+#version 330 core
+
+// 覆盖全屏的三角形，不需要顶点缓冲区
+out vec2 TexCoord;
+
+void main()
+{
+    TexCoord = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0;
+    gl_Position = vec4(TexCoord * 2.0 - 1.0, 0.0, 1.0);
+}
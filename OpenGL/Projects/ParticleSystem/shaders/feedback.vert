@@ -0,0 +1,63 @@
+#version 330 core
+
+// GL 3.3 的变换反馈模拟：每个粒子一个顶点，从一个缓冲区读入、写到另一个缓冲区
+// 变换反馈不能压缩，死亡的粒子在原槽位重生；随机数与 gpu_emit.comp 相同，以槽位序号为计数器
+layout (location = 0) in vec3 aPosition;
+layout (location = 1) in float aLife;
+layout (location = 2) in vec3 aVelocity;
+layout (location = 3) in float aSize;
+layout (location = 4) in vec3 aColor;
+
+out vec3 outPosition;
+out float outLife;
+out vec3 outVelocity;
+out float outSize;
+out vec3 outColor;
+
+uniform vec3 emitterPosition;
+uniform uint seed;
+uniform uint frame;
+uniform float deltaTime;
+
+const float GRAVITY = 9.8;
+// 1 / PARTICLE_LIFETIME（particles.h）
+const float LIFE_DECAY = 0.5;
+const uint COUNTER_INCREMENT = 0x9E3779B9u;
+
+uint hash32(uint x) {
+    x ^= x >> 16;
+    x *= 0x7FEB352Du;
+    x ^= x >> 15;
+    x *= 0x846CA68Bu;
+    x ^= x >> 16;
+    return x;
+}
+
+uint counter;
+
+float unitFloat() {
+    counter += COUNTER_INCREMENT;
+    return float(hash32(counter) >> 8) * (1.0 / 16777216.0);
+}
+
+float signedFloat() {
+    return unitFloat() * 2.0 - 1.0;
+}
+
+void main()
+{
+    outLife = aLife - deltaTime * LIFE_DECAY;
+    if (outLife <= 0.0) {
+        counter = hash32(uint(gl_VertexID) ^ hash32(seed ^ hash32(frame)));
+        outPosition = emitterPosition;
+        outLife = 1.0;
+        outVelocity = vec3(signedFloat() * 0.5, signedFloat() * 0.5 + 1.0, signedFloat() * 0.5);
+        outColor = vec3(unitFloat(), unitFloat(), unitFloat());
+        outSize = 0.02 + signedFloat() * 0.03;
+    } else {
+        outPosition = aPosition + aVelocity * deltaTime;
+        outVelocity = aVelocity - vec3(0.0, GRAVITY * deltaTime, 0.0);
+        outSize = aSize;
+        outColor = aColor;
+    }
+}
@@ -0,0 +1,32 @@
+#version 430 core
+
+// 计算着色器路径的顶点着色器：按存活列表从粒子池中取数据（顶点拉取），
+// 绘制数量由 gpu_prepare.comp 写入的间接绘制参数决定
+struct Particle {
+    vec4 positionLife;
+    vec4 velocitySize;
+    vec4 color;
+};
+
+layout(std430, binding = 1) readonly buffer Particles {
+    Particle particles[];
+};
+layout(std430, binding = 3) readonly buffer AliveList {
+    uint aliveList[];
+};
+
+out vec3 Color;
+
+// 每帧共享的相机矩阵（frame_uniforms.h）
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+};
+
+void main()
+{
+    Particle p = particles[aliveList[gl_VertexID]];
+    Color = p.color.rgb;
+    gl_Position = projection * view * vec4(p.positionLife.xyz, 1.0);
+    gl_PointSize = p.velocitySize.w * 200.0;
+}
@@ -0,0 +1,18 @@
+#version 330 core
+
+// 地面与碰撞盒：棋盘格，按屏幕空间导数得到的面法线做简单的漫反射，远处渐暗
+in vec3 WorldPos;
+out vec4 FragColor;
+
+const vec3 LIGHT_DIRECTION = vec3(0.4, 0.8, 0.45);
+
+void main()
+{
+    vec3 normal = normalize(cross(dFdx(WorldPos), dFdy(WorldPos)));
+    float diffuse = 0.5 + 0.5 * abs(dot(normal, normalize(LIGHT_DIRECTION)));
+
+    float checker = mod(floor(WorldPos.x * 2.0) + floor(WorldPos.y * 2.0) + floor(WorldPos.z * 2.0), 2.0);
+    vec3 color = mix(vec3(0.18), vec3(0.28), checker);
+    float falloff = clamp(1.0 - length(WorldPos.xz) / 8.0, 0.2, 1.0);
+    FragColor = vec4(color * diffuse * falloff, 1.0);
+}
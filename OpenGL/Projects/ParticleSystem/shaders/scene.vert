@@ -0,0 +1,17 @@
+#version 330 core
+
+layout (location = 0) in vec3 aPos;
+
+out vec3 WorldPos;
+
+// 每帧共享的相机矩阵（frame_uniforms.h）
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+};
+
+void main()
+{
+    WorldPos = aPos;
+    gl_Position = projection * view * vec4(aPos, 1.0);
+}
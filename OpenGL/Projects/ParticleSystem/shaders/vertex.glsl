@@ -6,8 +6,11 @@ layout (location = 2) in float aSize;
 
 out vec3 Color;
 
-uniform mat4 view;
-uniform mat4 projection;
+// 每帧共享的相机矩阵（frame_uniforms.h）
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+};
 
 void main()
 {
@@ -0,0 +1,194 @@
+// billboard_renderer.cpp
+// 离屏场景、全屏复制与实例化软粒子
+
+#include "billboard_renderer.h"
+
+#include <cstddef>
+#include <iostream>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "frame_uniforms.h"
+#include "particles.h"
+
+namespace {
+
+// 地面的半边长（高度与碰撞使用的 FLOOR_HEIGHT 相同）
+const float FLOOR_EXTENT = 8.0f;
+
+// 追加一个四边形（两个三角形），角点按逆时针顺序给出
+void appendQuad(std::vector<float>& vertices, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c,
+                const glm::vec3& d) {
+    for (const glm::vec3* corner : {&a, &b, &c, &a, &c, &d}) {
+        vertices.insert(vertices.end(), {corner->x, corner->y, corner->z});
+    }
+}
+
+// 地面与碰撞盒（底面贴着地面，不绘制）
+std::vector<float> sceneGeometry() {
+    std::vector<float> vertices;
+    appendQuad(vertices, glm::vec3(-FLOOR_EXTENT, FLOOR_HEIGHT, -FLOOR_EXTENT),
+               glm::vec3(-FLOOR_EXTENT, FLOOR_HEIGHT, FLOOR_EXTENT), glm::vec3(FLOOR_EXTENT, FLOOR_HEIGHT, FLOOR_EXTENT),
+               glm::vec3(FLOOR_EXTENT, FLOOR_HEIGHT, -FLOOR_EXTENT));
+
+    glm::vec3 lo = SCENE_BOX_MIN;
+    glm::vec3 hi = SCENE_BOX_MAX;
+    appendQuad(vertices, glm::vec3(lo.x, hi.y, lo.z), glm::vec3(lo.x, hi.y, hi.z), glm::vec3(hi.x, hi.y, hi.z),
+               glm::vec3(hi.x, hi.y, lo.z));
+    appendQuad(vertices, glm::vec3(lo.x, lo.y, hi.z), glm::vec3(hi.x, lo.y, hi.z), glm::vec3(hi.x, hi.y, hi.z),
+               glm::vec3(lo.x, hi.y, hi.z));
+    appendQuad(vertices, glm::vec3(hi.x, lo.y, lo.z), glm::vec3(lo.x, lo.y, lo.z), glm::vec3(lo.x, hi.y, lo.z),
+               glm::vec3(hi.x, hi.y, lo.z));
+    appendQuad(vertices, glm::vec3(lo.x, lo.y, lo.z), glm::vec3(lo.x, lo.y, hi.z), glm::vec3(lo.x, hi.y, hi.z),
+               glm::vec3(lo.x, hi.y, lo.z));
+    appendQuad(vertices, glm::vec3(hi.x, lo.y, hi.z), glm::vec3(hi.x, lo.y, lo.z), glm::vec3(hi.x, hi.y, lo.z),
+               glm::vec3(hi.x, hi.y, hi.z));
+    return vertices;
+}
+
+void createTargets(BillboardRenderer& renderer) {
+    glGenTextures(1, &renderer.colorTexture);
+    glBindTexture(GL_TEXTURE_2D, renderer.colorTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, renderer.width, renderer.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    glGenTextures(1, &renderer.depthTexture);
+    glBindTexture(GL_TEXTURE_2D, renderer.depthTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, renderer.width, renderer.height, 0, GL_DEPTH_COMPONENT,
+                 GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &renderer.framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, renderer.framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, renderer.colorTexture, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, renderer.depthTexture, 0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Scene framebuffer is not complete!" << std::endl;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void destroyTargets(BillboardRenderer& renderer) {
+    glDeleteFramebuffers(1, &renderer.framebuffer);
+    glDeleteTextures(1, &renderer.colorTexture);
+    glDeleteTextures(1, &renderer.depthTexture);
+    renderer.framebuffer = 0;
+    renderer.colorTexture = 0;
+    renderer.depthTexture = 0;
+}
+
+} // namespace
+
+bool createBillboardRenderer(BillboardRenderer& renderer, int width, int height) {
+    if (!renderer.billboardProgram.load("shaders/billboard.vert", "shaders/billboard.frag") ||
+        !renderer.compositeProgram.load("shaders/composite.vert", "shaders/composite.frag") ||
+        !renderer.sceneProgram.load("shaders/scene.vert", "shaders/scene.frag")) {
+        return false;
+    }
+    renderer.billboardProgram.bindUniformBlock("FrameData", FRAME_DATA_BINDING, sizeof(FrameData));
+    renderer.sceneProgram.bindUniformBlock("FrameData", FRAME_DATA_BINDING, sizeof(FrameData));
+
+    // 地面与盒子
+    std::vector<float> sceneVertices = sceneGeometry();
+    renderer.sceneVertexCount = (GLsizei)(sceneVertices.size() / 3);
+    glGenVertexArrays(1, &renderer.sceneVAO);
+    glGenBuffers(1, &renderer.sceneVBO);
+    glBindVertexArray(renderer.sceneVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, renderer.sceneVBO);
+    glBufferData(GL_ARRAY_BUFFER, sceneVertices.size() * sizeof(float), sceneVertices.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+
+    // 实例属性：位置、颜色、大小，每个实例前进一次
+    glGenVertexArrays(1, &renderer.instanceVAO);
+    glBindVertexArray(renderer.instanceVAO);
+    for (GLuint i = 0; i < 3; ++i) {
+        glEnableVertexAttribArray(i);
+        glVertexAttribDivisor(i, 1);
+    }
+
+    glGenVertexArrays(1, &renderer.emptyVAO);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // 采样器只在这里设置一次
+    renderer.billboardProgram.use();
+    glUniform1i(renderer.billboardProgram.uniformLocation("sceneDepth"), 0);
+    renderer.compositeProgram.use();
+    glUniform1i(renderer.compositeProgram.uniformLocation("sceneColor"), 0);
+    glUseProgram(0);
+
+    renderer.width = width;
+    renderer.height = height;
+    createTargets(renderer);
+    return true;
+}
+
+void resizeBillboardRenderer(BillboardRenderer& renderer, int width, int height) {
+    if (width == renderer.width && height == renderer.height) {
+        return;
+    }
+    // 最小化时大小为 0，保留原来的纹理
+    if (width <= 0 || height <= 0) {
+        return;
+    }
+    destroyTargets(renderer);
+    renderer.width = width;
+    renderer.height = height;
+    createTargets(renderer);
+}
+
+void renderBillboards(BillboardRenderer& renderer, GLuint instanceBuffer, GLint firstInstance, GLsizei count) {
+    // 不透明场景渲染到离屏帧缓冲
+    glBindFramebuffer(GL_FRAMEBUFFER, renderer.framebuffer);
+    glViewport(0, 0, renderer.width, renderer.height);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glEnable(GL_DEPTH_TEST);
+
+    renderer.sceneProgram.use();
+    glBindVertexArray(renderer.sceneVAO);
+    glDrawArrays(GL_TRIANGLES, 0, renderer.sceneVertexCount);
+
+    // 复制到屏幕；粒子由软粒子淡出处理遮挡，不需要深度测试
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDisable(GL_DEPTH_TEST);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, renderer.colorTexture);
+    renderer.compositeProgram.use();
+    glBindVertexArray(renderer.emptyVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+
+    // 流缓冲区每帧使用不同的段，实例属性需要重新指向本帧的数据
+    glBindVertexArray(renderer.instanceVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    size_t base = sizeof(ParticleVertex) * firstInstance;
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(ParticleVertex), (void*)(base + offsetof(ParticleVertex, position)));
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(ParticleVertex), (void*)(base + offsetof(ParticleVertex, color)));
+    glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, sizeof(ParticleVertex), (void*)(base + offsetof(ParticleVertex, size)));
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    renderer.billboardProgram.use();
+    glBindTexture(GL_TEXTURE_2D, renderer.depthTexture);
+
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
+    glDisable(GL_BLEND);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindVertexArray(0);
+    glEnable(GL_DEPTH_TEST);
+}
+
+void destroyBillboardRenderer(BillboardRenderer& renderer) {
+    destroyTargets(renderer);
+    glDeleteVertexArrays(1, &renderer.instanceVAO);
+    glDeleteVertexArrays(1, &renderer.sceneVAO);
+    glDeleteVertexArrays(1, &renderer.emptyVAO);
+    glDeleteBuffers(1, &renderer.sceneVBO);
+    renderer = BillboardRenderer();
+}
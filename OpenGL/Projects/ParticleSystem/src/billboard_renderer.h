@@ -0,0 +1,41 @@
+// billboard_renderer.h
+// 实例化公告板粒子渲染：按深度排好序的粒子以面向相机的四边形从后往前做 alpha 混合
+//
+// 不透明场景（地面与碰撞盒）先渲染到离屏帧缓冲，再复制到屏幕；粒子的片段着色器读取场景深度纹理，
+// 在靠近场景表面时淡出（软粒子），被遮挡的部分直接丢弃
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include "shader_program.h"
+
+// 相机矩阵从 FrameData uniform 块中读取（frame_uniforms.h），调用方每帧更新一次
+struct BillboardRenderer {
+    ShaderProgram billboardProgram;
+    ShaderProgram compositeProgram;
+    ShaderProgram sceneProgram;
+
+    // 实例属性每帧指向流缓冲区中的不同位置
+    GLuint instanceVAO = 0;
+    GLuint sceneVAO = 0;
+    GLuint sceneVBO = 0;
+    GLsizei sceneVertexCount = 0;
+    GLuint emptyVAO = 0;
+
+    GLuint framebuffer = 0;
+    GLuint colorTexture = 0;
+    GLuint depthTexture = 0;
+    int width = 0;
+    int height = 0;
+};
+
+bool createBillboardRenderer(BillboardRenderer& renderer, int width, int height);
+
+// 帧缓冲大小变化时重新分配离屏纹理
+void resizeBillboardRenderer(BillboardRenderer& renderer, int width, int height);
+
+// 渲染场景与 instanceBuffer 中从 firstInstance 开始的 count 个粒子（ParticleVertex，已按从后往前排序）
+void renderBillboards(BillboardRenderer& renderer, GLuint instanceBuffer, GLint firstInstance, GLsizei count);
+
+void destroyBillboardRenderer(BillboardRenderer& renderer);
@@ -0,0 +1,16 @@
+// frame_uniforms.h
+// 每帧共享的 uniform 块，与着色器中的 layout(std140) uniform FrameData 一致
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+// 每帧更新一次，所有绘制程序从同一个绑定点读取
+const GLuint FRAME_DATA_BINDING = 0;
+
+struct FrameData {
+    glm::mat4 view;
+    glm::mat4 projection;
+};
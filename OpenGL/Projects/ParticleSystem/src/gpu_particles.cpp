@@ -0,0 +1,317 @@
+// gpu_particles.cpp
+// GPU粒子模拟：GL 4.3 计算着色器（append/consume + 间接绘制）与 GL 3.3 变换反馈两种实现
+
+#include "gpu_particles.h"
+
+#include <iostream>
+#include <vector>
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include "frame_uniforms.h"
+
+namespace {
+
+// 与 shaders/gpu_*.comp 中的 Particle 一致（std430）
+struct GpuParticle {
+    glm::vec4 positionLife;
+    glm::vec4 velocitySize;
+    glm::vec4 color;
+};
+
+// 与 shaders/gpu_prepare.comp 中的 Counters、IndirectCommands 一致
+struct Counters {
+    GLuint aliveCount[2];
+    GLuint deadCount;
+    GLuint emitCount;
+};
+
+struct IndirectCommands {
+    GLuint emitDispatch[3];
+    GLuint simulateDispatch[3];
+    GLuint drawCommand[4];
+};
+
+// 与 shaders/feedback.vert 的输入属性与输出变量顺序一致
+struct FeedbackVertex {
+    glm::vec3 position;
+    float life;
+    glm::vec3 velocity;
+    float size;
+    glm::vec3 color;
+};
+
+const char* FEEDBACK_VARYINGS[] = {"outPosition", "outLife", "outVelocity", "outSize", "outColor"};
+
+// 着色器中的存储缓冲区绑定点
+const GLuint COUNTER_BINDING = 0;
+const GLuint PARTICLE_BINDING = 1;
+const GLuint DEAD_LIST_BINDING = 2;
+const GLuint ALIVE_LIST_BINDING = 3;
+const GLuint COMMAND_BINDING = 4;
+const GLuint NEXT_ALIVE_LIST_BINDING = 5;
+
+// gpu_prepare.comp 的阶段
+const GLuint STAGE_EMIT = 0;
+const GLuint STAGE_SIMULATE = 1;
+const GLuint STAGE_DRAW = 2;
+
+bool supportsCompute() {
+    if (!GLEW_VERSION_4_3) {
+        return false;
+    }
+    // 顶点着色器需要读取粒子池与存活列表两个存储缓冲区，GL 4.3 允许实现不支持
+    GLint vertexStorageBlocks = 0;
+    glGetIntegerv(GL_MAX_VERTEX_SHADER_STORAGE_BLOCKS, &vertexStorageBlocks);
+    return vertexStorageBlocks >= 2;
+}
+
+void runPrepare(GpuParticleSystem& system, GLuint stage, GLuint emitRequest) {
+    system.prepareProgram.use();
+    glUniform1ui(system.prepareStageLocation, stage);
+    glUniform1ui(system.prepareEmitRequestLocation, emitRequest);
+    glUniform1ui(system.prepareCurrentLocation, system.current);
+    glDispatchCompute(1, 1, 1);
+    // 后续的间接派发/绘制读取命令缓冲区，着色器读取计数器
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+}
+
+bool createComputePath(GpuParticleSystem& system) {
+    if (!system.prepareProgram.loadCompute("shaders/gpu_prepare.comp") ||
+        !system.emitProgram.loadCompute("shaders/gpu_emit.comp") ||
+        !system.simulateProgram.loadCompute("shaders/gpu_simulate.comp") ||
+        !system.pullProgram.load("shaders/gpu_vertex.glsl", "shaders/fragment.glsl")) {
+        return false;
+    }
+    system.prepareStageLocation = system.prepareProgram.uniformLocation("stage");
+    system.prepareEmitRequestLocation = system.prepareProgram.uniformLocation("emitRequest");
+    system.prepareCurrentLocation = system.prepareProgram.uniformLocation("current");
+    system.emitPositionLocation = system.emitProgram.uniformLocation("emitterPosition");
+    system.emitSeedLocation = system.emitProgram.uniformLocation("seed");
+    system.emitFrameLocation = system.emitProgram.uniformLocation("frame");
+    system.emitCurrentLocation = system.emitProgram.uniformLocation("current");
+    system.simulateDeltaTimeLocation = system.simulateProgram.uniformLocation("deltaTime");
+    system.simulateCurrentLocation = system.simulateProgram.uniformLocation("current");
+    system.pullProgram.bindUniformBlock("FrameData", FRAME_DATA_BINDING, sizeof(FrameData));
+
+    glGenBuffers(1, &system.particleBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, system.particleBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GpuParticle) * system.capacity, NULL, GL_DYNAMIC_COPY);
+
+    // 初始时所有槽位都在死亡列表中
+    std::vector<GLuint> slots(system.capacity);
+    for (size_t i = 0; i < system.capacity; ++i) {
+        slots[i] = (GLuint)i;
+    }
+    glGenBuffers(1, &system.deadListBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, system.deadListBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint) * system.capacity, slots.data(), GL_DYNAMIC_COPY);
+
+    glGenBuffers(2, system.aliveListBuffers);
+    for (GLuint buffer : system.aliveListBuffers) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint) * system.capacity, NULL, GL_DYNAMIC_COPY);
+    }
+
+    Counters counters = {{0, 0}, (GLuint)system.capacity, 0};
+    glGenBuffers(1, &system.counterBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, system.counterBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(Counters), &counters, GL_DYNAMIC_COPY);
+
+    IndirectCommands commands = {};
+    glGenBuffers(1, &system.commandBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, system.commandBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(IndirectCommands), &commands, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    // 顶点拉取不需要顶点属性，但核心模式下绘制时必须绑定VAO
+    glGenVertexArrays(1, &system.emptyVAO);
+    return true;
+}
+
+void setupFeedbackAttributes(GLuint vao, GLuint buffer, bool forDrawing) {
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+
+    GLsizei stride = sizeof(FeedbackVertex);
+    if (forDrawing) {
+        // shaders/vertex.glsl：位置、颜色、大小
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(FeedbackVertex, position));
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(FeedbackVertex, color));
+        glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(FeedbackVertex, size));
+        for (GLuint i = 0; i < 3; ++i) {
+            glEnableVertexAttribArray(i);
+        }
+    } else {
+        // shaders/feedback.vert：全部粒子状态
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(FeedbackVertex, position));
+        glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(FeedbackVertex, life));
+        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(FeedbackVertex, velocity));
+        glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(FeedbackVertex, size));
+        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(FeedbackVertex, color));
+        for (GLuint i = 0; i < 5; ++i) {
+            glEnableVertexAttribArray(i);
+        }
+    }
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+bool createFeedbackPath(GpuParticleSystem& system) {
+    if (!system.feedbackProgram.loadFeedback("shaders/feedback.vert", FEEDBACK_VARYINGS, 5) ||
+        !system.drawProgram.load("shaders/vertex.glsl", "shaders/fragment.glsl")) {
+        return false;
+    }
+    system.feedbackPositionLocation = system.feedbackProgram.uniformLocation("emitterPosition");
+    system.feedbackSeedLocation = system.feedbackProgram.uniformLocation("seed");
+    system.feedbackFrameLocation = system.feedbackProgram.uniformLocation("frame");
+    system.feedbackDeltaTimeLocation = system.feedbackProgram.uniformLocation("deltaTime");
+    system.drawProgram.bindUniformBlock("FrameData", FRAME_DATA_BINDING, sizeof(FrameData));
+
+    // 初始生命值按槽位在 (0, 1] 内错开，粒子依次死亡并重生；重生前大小为 0、颜色为黑色，加法混合下不可见
+    std::vector<FeedbackVertex> vertices(system.capacity);
+    for (size_t i = 0; i < system.capacity; ++i) {
+        vertices[i] = {glm::vec3(0.0f), float(i + 1) / float(system.capacity), glm::vec3(0.0f), 0.0f, glm::vec3(0.0f)};
+    }
+
+    glGenBuffers(2, system.feedbackBuffers);
+    for (int i = 0; i < 2; ++i) {
+        glBindBuffer(GL_ARRAY_BUFFER, system.feedbackBuffers[i]);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(FeedbackVertex) * system.capacity, i == 0 ? vertices.data() : NULL,
+                     GL_DYNAMIC_COPY);
+    }
+
+    glGenVertexArrays(2, system.simulateVAOs);
+    glGenVertexArrays(2, system.drawVAOs);
+    for (int i = 0; i < 2; ++i) {
+        setupFeedbackAttributes(system.simulateVAOs[i], system.feedbackBuffers[i], false);
+        setupFeedbackAttributes(system.drawVAOs[i], system.feedbackBuffers[i], true);
+    }
+    return true;
+}
+
+void updateCompute(GpuParticleSystem& system, const GpuEmitter& emitter, float deltaTime) {
+    system.emitAccumulator += emitter.rate * deltaTime;
+    GLuint emitRequest = (GLuint)system.emitAccumulator;
+    system.emitAccumulator -= emitRequest;
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COUNTER_BINDING, system.counterBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PARTICLE_BINDING, system.particleBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DEAD_LIST_BINDING, system.deadListBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, ALIVE_LIST_BINDING, system.aliveListBuffers[system.current]);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COMMAND_BINDING, system.commandBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, NEXT_ALIVE_LIST_BINDING, system.aliveListBuffers[1 - system.current]);
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, system.commandBuffer);
+
+    // 发射
+    runPrepare(system, STAGE_EMIT, emitRequest);
+    system.emitProgram.use();
+    glUniform3fv(system.emitPositionLocation, 1, glm::value_ptr(emitter.position));
+    glUniform1ui(system.emitSeedLocation, system.seed);
+    glUniform1ui(system.emitFrameLocation, system.frame);
+    glUniform1ui(system.emitCurrentLocation, system.current);
+    glDispatchComputeIndirect((GLintptr)offsetof(IndirectCommands, emitDispatch));
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    // 模拟并压缩到另一个存活列表
+    runPrepare(system, STAGE_SIMULATE, 0);
+    system.simulateProgram.use();
+    glUniform1f(system.simulateDeltaTimeLocation, deltaTime);
+    glUniform1ui(system.simulateCurrentLocation, system.current);
+    glDispatchComputeIndirect((GLintptr)offsetof(IndirectCommands, simulateDispatch));
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    // 写出间接绘制参数，之后新的存活列表成为当前列表
+    runPrepare(system, STAGE_DRAW, 0);
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+    system.current = 1 - system.current;
+}
+
+void updateFeedback(GpuParticleSystem& system, const GpuEmitter& emitter, float deltaTime) {
+    system.feedbackProgram.use();
+    glUniform3fv(system.feedbackPositionLocation, 1, glm::value_ptr(emitter.position));
+    glUniform1ui(system.feedbackSeedLocation, system.seed);
+    glUniform1ui(system.feedbackFrameLocation, system.frame);
+    glUniform1f(system.feedbackDeltaTimeLocation, deltaTime);
+
+    // 只需要顶点着色器的输出，跳过光栅化
+    glEnable(GL_RASTERIZER_DISCARD);
+    glBindVertexArray(system.simulateVAOs[system.current]);
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, system.feedbackBuffers[1 - system.current]);
+    glBeginTransformFeedback(GL_POINTS);
+    glDrawArrays(GL_POINTS, 0, (GLsizei)system.capacity);
+    glEndTransformFeedback();
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+    glBindVertexArray(0);
+    glDisable(GL_RASTERIZER_DISCARD);
+
+    system.current = 1 - system.current;
+}
+
+} // namespace
+
+bool createGpuParticles(GpuParticleSystem& system, size_t capacity, uint32_t seed, bool allowCompute) {
+    system.capacity = capacity;
+    system.seed = seed;
+    system.frame = 0;
+    system.current = 0;
+    system.emitAccumulator = 0.0;
+    system.compute = allowCompute && supportsCompute();
+
+    createGpuTimer(system.simulationTimer);
+
+    if (system.compute) {
+        return createComputePath(system);
+    }
+    return createFeedbackPath(system);
+}
+
+void updateGpuParticles(GpuParticleSystem& system, const GpuEmitter& emitter, float deltaTime) {
+    beginGpuTimer(system.simulationTimer);
+    if (system.compute) {
+        updateCompute(system, emitter, deltaTime);
+    } else {
+        updateFeedback(system, emitter, deltaTime);
+    }
+    endGpuTimer(system.simulationTimer);
+
+    system.frame++;
+}
+
+void drawGpuParticles(GpuParticleSystem& system) {
+    if (system.compute) {
+        system.pullProgram.use();
+    } else {
+        system.drawProgram.use();
+    }
+
+    if (system.compute) {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PARTICLE_BINDING, system.particleBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, ALIVE_LIST_BINDING, system.aliveListBuffers[system.current]);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, system.commandBuffer);
+        glBindVertexArray(system.emptyVAO);
+        glDrawArraysIndirect(GL_POINTS, (void*)offsetof(IndirectCommands, drawCommand));
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    } else {
+        glBindVertexArray(system.drawVAOs[system.current]);
+        glDrawArrays(GL_POINTS, 0, (GLsizei)system.capacity);
+    }
+    glBindVertexArray(0);
+}
+
+void destroyGpuParticles(GpuParticleSystem& system) {
+    destroyGpuTimer(system.simulationTimer);
+
+    GLuint buffers[] = {system.particleBuffer, system.deadListBuffer, system.aliveListBuffers[0],
+                        system.aliveListBuffers[1], system.counterBuffer, system.commandBuffer,
+                        system.feedbackBuffers[0], system.feedbackBuffers[1]};
+    glDeleteBuffers(8, buffers);
+
+    GLuint vertexArrays[] = {system.emptyVAO, system.simulateVAOs[0], system.simulateVAOs[1],
+                             system.drawVAOs[0], system.drawVAOs[1]};
+    glDeleteVertexArrays(5, vertexArrays);
+
+    // 着色器程序随旧的状态一起析构
+    system = GpuParticleSystem();
+}
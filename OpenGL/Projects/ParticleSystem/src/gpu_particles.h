@@ -0,0 +1,85 @@
+// gpu_particles.h
+// 完全在GPU上运行的粒子模拟，CPU每帧只设置发射器参数
+//
+// GL 4.3 计算着色器路径：粒子池 + 死亡列表（consume）+ 两个交替的存活列表（append），计数器留在GPU上
+//   每帧依次执行：准备发射 → 发射 → 准备模拟 → 模拟（死亡粒子归还槽位，存活粒子压缩到另一个列表）→ 准备绘制，
+//   发射与模拟用 glDispatchComputeIndirect，绘制用 glDrawArraysIndirect 直接读取存活数
+// GL 3.3 变换反馈路径：两个顶点缓冲区交替作为输入与输出，死亡的粒子在原槽位重生；
+//   初始生命值按槽位错开，使粒子以恒定速率出现
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "gpu_timer.h"
+#include "shader_program.h"
+
+struct GpuEmitter {
+    glm::vec3 position = glm::vec3(0.0f);
+    // 每秒发射的粒子数；变换反馈路径的发射率由容量与粒子寿命决定，忽略此参数
+    float rate = 0.0f;
+};
+
+struct GpuParticleSystem {
+    bool compute = false;
+    size_t capacity = 0;
+    uint32_t seed = 0;
+    uint32_t frame = 0;
+    // 本帧作为输入的存活列表（计算路径）或顶点缓冲区（变换反馈路径）
+    int current = 0;
+    // 发射数的小数部分累积到下一帧
+    double emitAccumulator = 0.0;
+
+    // 计算着色器路径
+    GLuint particleBuffer = 0;
+    GLuint deadListBuffer = 0;
+    GLuint aliveListBuffers[2] = {};
+    GLuint counterBuffer = 0;
+    GLuint commandBuffer = 0;
+    ShaderProgram prepareProgram;
+    ShaderProgram emitProgram;
+    ShaderProgram simulateProgram;
+    ShaderProgram pullProgram;
+    GLuint emptyVAO = 0;
+
+    // 变换反馈路径
+    GLuint feedbackBuffers[2] = {};
+    GLuint simulateVAOs[2] = {};
+    GLuint drawVAOs[2] = {};
+    ShaderProgram feedbackProgram;
+    ShaderProgram drawProgram;
+
+    // 每步都要设置的 uniform 位置，创建程序时取得
+    GLint prepareStageLocation = -1;
+    GLint prepareEmitRequestLocation = -1;
+    GLint prepareCurrentLocation = -1;
+    GLint emitPositionLocation = -1;
+    GLint emitSeedLocation = -1;
+    GLint emitFrameLocation = -1;
+    GLint emitCurrentLocation = -1;
+    GLint simulateDeltaTimeLocation = -1;
+    GLint simulateCurrentLocation = -1;
+    GLint feedbackPositionLocation = -1;
+    GLint feedbackSeedLocation = -1;
+    GLint feedbackFrameLocation = -1;
+    GLint feedbackDeltaTimeLocation = -1;
+
+    // 模拟耗时，读取 simulationTimer.milliseconds
+    GpuTimer simulationTimer;
+};
+
+// 创建容量为 capacity 的GPU粒子系统；allowCompute 为 false 或上下文不支持时使用变换反馈
+bool createGpuParticles(GpuParticleSystem& system, size_t capacity, uint32_t seed, bool allowCompute);
+
+// 在GPU上推进一个模拟步
+void updateGpuParticles(GpuParticleSystem& system, const GpuEmitter& emitter, float deltaTime);
+
+// 用当前的粒子状态绘制（调用方负责混合状态，相机矩阵来自 FrameData uniform 块）
+void drawGpuParticles(GpuParticleSystem& system);
+
+void destroyGpuParticles(GpuParticleSystem& system);
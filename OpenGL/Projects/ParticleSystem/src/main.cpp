@@ -4,223 +4,350 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <iostream>
-#include <fstream>
-#include <sstream>
+#include <string>
 #include <vector>
-#include <random>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#include "job_system.h"
+#include "particles.h"
+#include "particle_stream.h"
+#include "shader_program.h"
+#include "frame_uniforms.h"
+#include "gpu_particles.h"
+#include "radix_sort.h"
+#include "billboard_renderer.h"
+#include "spatial_grid.h"
 
 // 窗口尺寸
 const int WIDTH = 800;
 const int HEIGHT = 600;
 
-// 粒子数量
-const int MAX_PARTICLES = 1000;
+// 重生随机数的种子
+const uint32_t PARTICLE_SEED = 1;
 
-// 粒子结构体
-struct Particle {
-    glm::vec3 position;
-    glm::vec3 velocity;
-    glm::vec3 color;
-    float life;
-    float size;
-};
+// GPU模拟的默认粒子数
+const size_t GPU_PARTICLES = 5000000;
 
-// 着色器程序ID
-GLuint shaderProgram;
+// 固定模拟步长：每帧按实际经过的时间执行若干个固定步，模拟结果与帧率、glfwGetTime 的抖动无关
+const float FIXED_TIMESTEP = 1.0f / 60.0f;
+// 单帧最多执行的模拟步数，卡顿后丢弃多出的时间，避免越追越慢
+const int MAX_STEPS_PER_FRAME = 8;
 
-// VAO和VBO
-GLuint VAO, VBO;
+// 相机位置与朝向，深度排序与视图矩阵共用
+const glm::vec3 CAMERA_POSITION(0.0f, 0.0f, 3.0f);
+const glm::vec3 CAMERA_TARGET(0.0f, 0.0f, 0.0f);
 
-// 粒子数组
-std::vector<Particle> particles;
+// 扩展性测试的线程数
+const unsigned int SCALING_THREAD_COUNTS[] = {1, 2, 4, 8, 16, 32};
 
-// 随机数生成器
-std::mt19937 gen; // 随机数生成器
-std::uniform_real_distribution<float> rand_float(-1.0f, 1.0f);
-std::uniform_real_distribution<float> rand_color(0.0f, 1.0f);
+// 点精灵着色器程序与每帧的相机矩阵（所有程序共用 FrameData 绑定点）
+ShaderProgram shaderProgram;
+UniformBuffer frameUniforms;
 
-// 函数声明
-std::string readShaderFile(const char* filePath);
-GLuint compileShader(GLenum type, const char* source);
-GLuint createShaderProgram(const char* vertexPath, const char* fragmentPath);
-void setupBuffers();
-void updateParticles(float deltaTime);
-void render();
-void framebuffer_size_callback(GLFWwindow* window, int width, int height);
-void processInput(GLFWwindow* window);
+// VAO与粒子顶点流（流内部管理VBO）
+GLuint VAO;
+ParticleStream particleStream;
 
-// 读取着色器文件
-std::string readShaderFile(const char* filePath) {
-    std::ifstream file(filePath);
-    if (!file.is_open()) {
-        std::cerr << "Failed to open shader file: " << filePath << std::endl;
-        return "";
-    }
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    return buffer.str();
-}
+// 为 false 时（--orphan）即使支持持久映射也使用孤立缓冲方式，便于对比
+bool allowPersistentStream = true;
 
-// 编译着色器
-GLuint compileShader(GLenum type, const char* source) {
-    GLuint shader = glCreateShader(type);
-    glShaderSource(shader, 1, &source, NULL);
-    glCompileShader(shader);
-    
-    GLint success;
-    GLchar infoLog[512];
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(shader, 512, NULL, infoLog);
-        std::cerr << "Shader compilation failed: " << infoLog << std::endl;
-        return 0;
-    }
-    return shader;
-}
+// 粒子数据（SoA）与实际粒子数，可用 --particles 指定
+ParticleStore particles;
+size_t particleCount = MAX_PARTICLES;
 
-// 创建着色器程序
-GLuint createShaderProgram(const char* vertexPath, const char* fragmentPath) {
-    std::string vertexCode = readShaderFile(vertexPath);
-    std::string fragmentCode = readShaderFile(fragmentPath);
-    
-    GLuint vertexShader = compileShader(GL_VERTEX_SHADER, vertexCode.c_str());
-    GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentCode.c_str());
-    
-    GLuint program = glCreateProgram();
-    glAttachShader(program, vertexShader);
-    glAttachShader(program, fragmentShader);
-    glLinkProgram(program);
-    
-    GLint success;
-    GLchar infoLog[512];
-    glGetProgramiv(program, GL_LINK_STATUS, &success);
-    if (!success) {
-        glGetProgramInfoLog(program, 512, NULL, infoLog);
-        std::cerr << "Program linking failed: " << infoLog << std::endl;
-        return 0;
-    }
-    
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
-    
-    return program;
-}
+// GPU模拟（--gpu）：计算着色器不可用或指定 --feedback 时使用变换反馈
+bool gpuSimulation = false;
+bool allowComputeSimulation = true;
+GpuParticleSystem gpuParticles;
 
-// 初始化粒子
-void initParticle(Particle& particle) {
-    particle.position = glm::vec3(0.0f, 0.0f, 0.0f);
-    particle.velocity = glm::vec3(rand_float(gen) * 0.5f, rand_float(gen) * 0.5f + 1.0f, rand_float(gen) * 0.5f);
-    particle.color = glm::vec3(rand_color(gen), rand_color(gen), rand_color(gen));
-    particle.life = 1.0f;
-    particle.size = 0.02f + rand_float(gen) * 0.03f;
-}
+// CPU模拟的粒子间碰撞（--collisions 开启；与地面、盒子的碰撞始终开启）
+bool particleCollisions = false;
+SpatialGrid spatialGrid;
 
-// 初始化所有粒子
-void initParticles() {
-    particles.resize(MAX_PARTICLES);
-    for (auto& particle : particles) {
-        initParticle(particle);
-    }
-}
+// CPU模拟默认按深度排序后绘制为软粒子公告板，--points 使用原来的加法混合点精灵（不排序）
+bool billboardRendering = true;
+BillboardRenderer billboardRenderer;
+
+// 公告板模式下模拟先把顶点写到这里，排序后再按顺序收集到映射的流缓冲区
+std::vector<ParticleVertex> unsortedVertices;
+RadixSortBuffers depthSort;
+
+// 粒子更新耗时统计（按模拟步平均），每秒输出一次；GPU模拟时为GPU计时查询的结果
+double updateMilliseconds = 0.0;
+int updateSteps = 0;
+std::string updateMode;
+
+// 每帧深度排序（计算键、基数排序、收集顶点）的耗时统计
+double sortMilliseconds = 0.0;
+int sortFrames = 0;
+
+// 函数声明
+bool setupBuffers();
+glm::mat4 getViewMatrix();
+glm::mat4 getProjectionMatrix();
+void render(GLint firstVertex);
+void renderGpu();
+void reportUpdateTime(double milliseconds, int steps);
+void reportSortTime(double milliseconds);
+void sortParticleVertices(JobSystem& jobs, ParticleVertex* vertices);
+void stepParticles(JobSystem& jobs, ParticleVertex* vertices);
+uint64_t particleChecksum(const ParticleStore& store);
+int runBenchmark(int frames, unsigned int threadCount);
+void framebuffer_size_callback(GLFWwindow* window, int width, int height);
+void processInput(GLFWwindow* window);
 
 // 设置缓冲区
-void setupBuffers() {
-    // 创建VAO和VBO
+bool setupBuffers() {
+    // 创建VAO
     glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    
     glBindVertexArray(VAO);
     
-    // 粒子位置、颜色和大小数据
-    struct ParticleData {
-        glm::vec3 position;
-        glm::vec3 color;
-        float size;
-    };
-    
-    // 分配VBO内存（但不填充数据，因为粒子数据会动态更新）
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(ParticleData) * MAX_PARTICLES, NULL, GL_DYNAMIC_DRAW);
+    // 创建顶点流，它会把自己的VBO绑定到 GL_ARRAY_BUFFER
+    if (!createParticleStream(particleStream, particleCount, allowPersistentStream)) {
+        glBindVertexArray(0);
+        return false;
+    }
     
     // 位置属性
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(ParticleData), (void*)0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(ParticleVertex), (void*)0);
     glEnableVertexAttribArray(0);
     
     // 颜色属性
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(ParticleData), (void*)offsetof(ParticleData, color));
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(ParticleVertex), (void*)offsetof(ParticleVertex, color));
     glEnableVertexAttribArray(1);
     
     // 大小属性
-    glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, sizeof(ParticleData), (void*)offsetof(ParticleData, size));
+    glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, sizeof(ParticleVertex), (void*)offsetof(ParticleVertex, size));
     glEnableVertexAttribArray(2);
     
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
+    return true;
+}
+
+// 累计 steps 个模拟步的更新耗时，每秒输出一次平均值（按每百万粒子折算）
+void reportUpdateTime(double milliseconds, int steps) {
+    static double lastReportTime = glfwGetTime();
+    
+    updateMilliseconds += milliseconds;
+    updateSteps += steps;
+    
+    double now = glfwGetTime();
+    if (now - lastReportTime >= 1.0 && updateSteps > 0) {
+        double average = updateMilliseconds / updateSteps;
+        std::cout << particleCount << " particles (" << updateMode << "): update " << average << " ms, "
+                  << average * 1e6 / particleCount << " ms per million particles" << std::endl;
+        updateMilliseconds = 0.0;
+        updateSteps = 0;
+        lastReportTime = now;
+    }
 }
 
-// 更新粒子
-void updateParticles(float deltaTime) {
-    for (auto& particle : particles) {
-        // 更新生命值
-        particle.life -= deltaTime * 0.5f;
+// 累计深度排序耗时，每秒输出一次每帧平均值
+void reportSortTime(double milliseconds) {
+    static double lastReportTime = glfwGetTime();
+    
+    sortMilliseconds += milliseconds;
+    sortFrames++;
+    
+    double now = glfwGetTime();
+    if (now - lastReportTime >= 1.0) {
+        double average = sortMilliseconds / sortFrames;
+        std::cout << particleCount << " particles: depth sort " << average << " ms, "
+                  << average * 1e6 / particleCount << " ms per million particles" << std::endl;
+        sortMilliseconds = 0.0;
+        sortFrames = 0;
+        lastReportTime = now;
+    }
+}
+
+// 按到相机的深度从远到近排序 unsortedVertices，结果顺序写入 vertices
+void sortParticleVertices(JobSystem& jobs, ParticleVertex* vertices) {
+    glm::vec3 forward = glm::normalize(CAMERA_TARGET - CAMERA_POSITION);
+    computeDepthKeys(particles, CAMERA_POSITION, forward, jobs, depthSort.keys.data(), depthSort.values.data());
+    radixSort(depthSort, particleCount, jobs);
+    gatherParticleVertices(unsortedVertices.data(), depthSort.values.data(), particleCount, jobs, vertices);
+}
+
+// 推进一个固定模拟步：开启碰撞时先按格子重排粒子并求解粒子间碰撞，再积分（vertices 不为空时同时写出顶点）
+void stepParticles(JobSystem& jobs, ParticleVertex* vertices) {
+    if (particleCollisions) {
+        buildSpatialGrid(spatialGrid, particles, jobs);
+        collideParticles(spatialGrid, particles, FIXED_TIMESTEP, jobs);
+    }
+    updateParticles(particles, FIXED_TIMESTEP, jobs, vertices);
+}
+
+// 粒子状态（不含补齐部分）的 FNV-1a 校验和，用于确认不同线程数下的结果逐位相同
+uint64_t particleChecksum(const ParticleStore& store) {
+    uint64_t hash = 14695981039346656037ull;
+    for (const std::vector<float>* array : {&store.positionX, &store.positionY, &store.positionZ,
+                                            &store.velocityX, &store.velocityY, &store.velocityZ,
+                                            &store.colorR, &store.colorG, &store.colorB,
+                                            &store.life, &store.size}) {
+        for (size_t i = 0; i < store.count; ++i) {
+            uint32_t bits;
+            std::memcpy(&bits, &(*array)[i], sizeof(bits));
+            hash = (hash ^ bits) * 1099511628211ull;
+        }
+    }
+    return hash;
+}
+
+// 不创建窗口，以固定步长更新 frames 帧并输出每百万粒子的更新耗时；开启碰撞时另外输出网格构建、
+// 粒子间碰撞的耗时与最后一帧上 SPH 密度邻居查询的吞吐量。threadCount 为 0 时依次测试 SCALING_THREAD_COUNTS 中的线程数，并比较各自的结果是否逐位相同
+int runBenchmark(int frames, unsigned int threadCount) {
+    std::vector<unsigned int> threadCounts;
+    if (threadCount > 0) {
+        threadCounts.push_back(threadCount);
+    } else {
+        threadCounts.assign(std::begin(SCALING_THREAD_COUNTS), std::end(SCALING_THREAD_COUNTS));
+    }
+    
+    std::cout << particleCount << " particles, " << frames << " frames (" << particleSimdName() << ", "
+              << std::thread::hardware_concurrency() << " hardware threads)" << std::endl;
+    
+    // 公告板模式同时测量每帧的深度排序，排序结果写入一个普通数组代替映射的缓冲区
+    std::vector<ParticleVertex> sortedVertices;
+    if (billboardRendering) {
+        unsortedVertices.resize(particleCount);
+        sortedVertices.resize(particleCount);
+        depthSort.resize(particleCount);
+    }
+    
+    double baseline = 0.0;
+    uint64_t referenceChecksum = 0;
+    bool identical = true;
+    for (unsigned int threads : threadCounts) {
+        JobSystem jobs(threads);
+        initParticles(particles, particleCount, PARTICLE_SEED, jobs);
         
-        // 如果粒子死亡，重新初始化
-        if (particle.life <= 0.0f) {
-            initParticle(particle);
-        } else {
-            // 更新位置
-            particle.position += particle.velocity * deltaTime;
+        double updateTotal = 0.0;
+        double sortTotal = 0.0;
+        double gridTotal = 0.0;
+        double collisionTotal = 0.0;
+        for (int i = 0; i < frames; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            auto built = start;
+            auto collided = start;
+            if (particleCollisions) {
+                buildSpatialGrid(spatialGrid, particles, jobs);
+                built = std::chrono::steady_clock::now();
+                collideParticles(spatialGrid, particles, FIXED_TIMESTEP, jobs);
+                collided = std::chrono::steady_clock::now();
+            }
+            updateParticles(particles, FIXED_TIMESTEP, jobs, billboardRendering ? unsortedVertices.data() : nullptr);
+            auto updated = std::chrono::steady_clock::now();
+            if (billboardRendering) {
+                sortParticleVertices(jobs, sortedVertices.data());
+            }
+            auto end = std::chrono::steady_clock::now();
+            updateTotal += std::chrono::duration<double, std::milli>(updated - start).count();
+            gridTotal += std::chrono::duration<double, std::milli>(built - start).count();
+            collisionTotal += std::chrono::duration<double, std::milli>(collided - built).count();
+            sortTotal += std::chrono::duration<double, std::milli>(end - updated).count();
+        }
+        
+        double average = updateTotal / frames;
+        uint64_t checksum = particleChecksum(particles);
+        if (baseline == 0.0) {
+            baseline = average;
+            referenceChecksum = checksum;
+        }
+        identical = identical && checksum == referenceChecksum;
+        
+        std::cout << threads << " threads: " << average << " ms per frame, " << average * 1e6 / particleCount
+                  << " ms per million particles, speedup " << baseline / average << "x, checksum " << std::hex
+                  << checksum << std::dec << std::endl;
+        if (particleCollisions) {
+            std::cout << "    grid build " << gridTotal / frames << " ms, particle collisions " << collisionTotal / frames
+                      << " ms per frame" << std::endl;
             
-            // 应用重力
-            particle.velocity.y -= 9.8f * deltaTime;
+            // 网格是本帧开始时建立的，积分后粒子略有移动，但仍按格子排列，足以测量查询吞吐量
+            std::vector<float> densities(particleCount);
+            auto queryStart = std::chrono::steady_clock::now();
+            size_t neighbors = computeParticleDensities(spatialGrid, particles, jobs, densities.data());
+            auto queryEnd = std::chrono::steady_clock::now();
+            double queryMilliseconds = std::chrono::duration<double, std::milli>(queryEnd - queryStart).count();
+            std::cout << "    SPH density: " << queryMilliseconds << " ms, " << particleCount / queryMilliseconds / 1e3
+                      << " M queries/s, " << neighbors / queryMilliseconds / 1e3 << " M neighbors/s ("
+                      << (double)neighbors / particleCount << " per particle)" << std::endl;
+        }
+        if (billboardRendering) {
+            double sortAverage = sortTotal / frames;
+            std::cout << "    depth sort: " << sortAverage << " ms per frame, " << sortAverage * 1e6 / particleCount
+                      << " ms per million particles" << std::endl;
         }
     }
+    
+    if (threadCounts.size() > 1) {
+        std::cout << "results " << (identical ? "are" : "are NOT") << " bit-identical across thread counts" << std::endl;
+    }
+    return identical ? 0 : 1;
 }
 
-// 渲染
-void render() {
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+// 视图矩阵
+glm::mat4 getViewMatrix() {
+    return glm::lookAt(CAMERA_POSITION, CAMERA_TARGET, glm::vec3(0.0f, 1.0f, 0.0f));
+}
+
+// 投影矩阵
+glm::mat4 getProjectionMatrix() {
+    return glm::perspective(glm::radians(45.0f), (float)WIDTH / (float)HEIGHT, 0.1f, 100.0f);
+}
+
+// 更新每帧的 uniform 块，之后的绘制不再逐个设置相机矩阵
+void updateFrameUniforms() {
+    FrameData frame;
+    frame.view = getViewMatrix();
+    frame.projection = getProjectionMatrix();
+    frameUniforms.update(frame);
+}
+
+// 渲染，firstVertex 为本帧顶点数据在流缓冲区中的起始位置
+void render(GLint firstVertex) {
+    updateFrameUniforms();
     
-    // 使用着色器程序
-    glUseProgram(shaderProgram);
-    
-    // 设置视图矩阵
-    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 3.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "view"), 1, GL_FALSE, glm::value_ptr(view));
-    
-    // 设置投影矩阵
-    glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)WIDTH / (float)HEIGHT, 0.1f, 100.0f);
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
-    
-    // 更新VBO数据
-    struct ParticleData {
-        glm::vec3 position;
-        glm::vec3 color;
-        float size;
-    };
-    
-    std::vector<ParticleData> particleData(MAX_PARTICLES);
-    for (int i = 0; i < MAX_PARTICLES; ++i) {
-        particleData[i].position = particles[i].position;
-        particleData[i].color = particles[i].color;
-        particleData[i].size = particles[i].size;
+    if (billboardRendering) {
+        renderBillboards(billboardRenderer, particleStream.buffer, firstVertex, (GLsizei)particleCount);
+        return;
     }
     
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(ParticleData) * MAX_PARTICLES, particleData.data());
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    
+    // 使用着色器程序
+    shaderProgram.use();
     
     // 渲染粒子
     glBindVertexArray(VAO);
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE); // 加法混合，用于粒子效果
-    glDrawArrays(GL_POINTS, 0, MAX_PARTICLES);
+    glDrawArrays(GL_POINTS, firstVertex, (GLsizei)particleCount);
     glDisable(GL_BLEND);
     glBindVertexArray(0);
 }
 
+// 渲染GPU模拟的粒子
+void renderGpu() {
+    updateFrameUniforms();
+    
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE); // 加法混合，用于粒子效果
+    drawGpuParticles(gpuParticles);
+    glDisable(GL_BLEND);
+}
+
 // 窗口大小变化回调
 void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
     glViewport(0, 0, width, height);
+    if (billboardRenderer.framebuffer) {
+        resizeBillboardRenderer(billboardRenderer, width, height);
+    }
 }
 
 // 处理输入
@@ -229,20 +356,85 @@ void processInput(GLFWwindow* window) {
         glfwSetWindowShouldClose(window, true);
 }
 
-int main() {
+int main(int argc, char** argv) {
+    // 命令行参数：--particles N 指定粒子数，--benchmark F 不创建窗口只测量 F 帧的更新耗时，
+    // --orphan 强制使用 GL 3.3 的孤立缓冲方式上传顶点，--gpu 在GPU上模拟（--feedback 强制使用变换反馈），
+    // --threads T 指定CPU更新的线程数（默认全部硬件线程；基准测试时默认测试 1 到 32 线程的扩展性），
+    // --points 绘制不排序的点精灵而不是软粒子公告板，--collisions 开启CPU模拟的粒子间碰撞，
+    // --no-shader-cache 不使用程序二进制缓存（测量冷启动）
+    int benchmarkFrames = 0;
+    unsigned int threadCount = 0;
+    bool particleCountGiven = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--particles") == 0 && i + 1 < argc) {
+            particleCount = std::strtoull(argv[++i], nullptr, 10);
+            particleCountGiven = true;
+        } else if (std::strcmp(argv[i], "--benchmark") == 0 && i + 1 < argc) {
+            benchmarkFrames = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threadCount = (unsigned int)std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--orphan") == 0) {
+            allowPersistentStream = false;
+        } else if (std::strcmp(argv[i], "--gpu") == 0) {
+            gpuSimulation = true;
+        } else if (std::strcmp(argv[i], "--collisions") == 0) {
+            particleCollisions = true;
+        } else if (std::strcmp(argv[i], "--points") == 0) {
+            billboardRendering = false;
+        } else if (std::strcmp(argv[i], "--feedback") == 0) {
+            gpuSimulation = true;
+            allowComputeSimulation = false;
+        } else if (std::strcmp(argv[i], "--no-shader-cache") == 0) {
+            setShaderCacheEnabled(false);
+        } else {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--particles N] [--benchmark FRAMES] [--threads T] [--orphan] [--points] [--collisions] [--gpu] [--feedback] [--no-shader-cache]"
+                      << std::endl;
+            return -1;
+        }
+    }
+    if (gpuSimulation && !particleCountGiven) {
+        particleCount = GPU_PARTICLES;
+    }
+    // GPU模拟的粒子数据不回读到CPU，只能绘制为点精灵，也没有粒子间碰撞
+    if (gpuSimulation) {
+        billboardRendering = false;
+        particleCollisions = false;
+    }
+    if (gpuSimulation && benchmarkFrames > 0) {
+        std::cerr << "--benchmark measures the CPU update and cannot be combined with --gpu" << std::endl;
+        return -1;
+    }
+    if (particleCount == 0 || particleCount > MAX_PARTICLES) {
+        std::cerr << "Particle count must be between 1 and " << MAX_PARTICLES << std::endl;
+        return -1;
+    }
+    
+    if (benchmarkFrames > 0) {
+        return runBenchmark(benchmarkFrames, threadCount);
+    }
+    
     // 初始化GLFW
     if (!glfwInit()) {
         std::cerr << "Failed to initialize GLFW" << std::endl;
         return -1;
     }
     
-    // 设置GLFW窗口属性
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    // 设置GLFW窗口属性；GPU模拟先尝试计算着色器需要的 4.3 上下文，失败时回退到 3.3
+    GLFWwindow* window = NULL;
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    if (gpuSimulation && allowComputeSimulation) {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        window = glfwCreateWindow(WIDTH, HEIGHT, "Particle System", NULL, NULL);
+    }
     
     // 创建窗口
-    GLFWwindow* window = glfwCreateWindow(WIDTH, HEIGHT, "Particle System", NULL, NULL);
+    if (!window) {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        window = glfwCreateWindow(WIDTH, HEIGHT, "Particle System", NULL, NULL);
+    }
     if (!window) {
         std::cerr << "Failed to create GLFW window" << std::endl;
         glfwTerminate();
@@ -262,43 +454,121 @@ int main() {
     }
     
     // 创建着色器程序
-    shaderProgram = createShaderProgram(
-        "shaders/vertex.glsl",
-        "shaders/fragment.glsl"
-    );
-    
-    if (!shaderProgram) {
+    if (!shaderProgram.load("shaders/vertex.glsl", "shaders/fragment.glsl")) {
         std::cerr << "Failed to create shader program" << std::endl;
         return -1;
     }
+    shaderProgram.bindUniformBlock("FrameData", FRAME_DATA_BINDING, sizeof(FrameData));
+    frameUniforms.create(sizeof(FrameData), FRAME_DATA_BINDING);
+    
+    // CPU更新使用的任务线程池
+    JobSystem jobs(threadCount);
     
     // 初始化粒子
-    initParticles();
+    if (gpuSimulation) {
+        if (!createGpuParticles(gpuParticles, particleCount, PARTICLE_SEED, allowComputeSimulation)) {
+            std::cerr << "Failed to create GPU particle simulation" << std::endl;
+            return -1;
+        }
+        updateMode = gpuParticles.compute ? "GPU compute" : "GPU transform feedback";
+    } else {
+        initParticles(particles, particleCount, PARTICLE_SEED, jobs);
+        
+        // 设置缓冲区
+        if (!setupBuffers()) {
+            std::cerr << "Failed to create particle vertex stream" << std::endl;
+            return -1;
+        }
+        if (billboardRendering) {
+            int framebufferWidth, framebufferHeight;
+            glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+            if (!createBillboardRenderer(billboardRenderer, framebufferWidth, framebufferHeight)) {
+                std::cerr << "Failed to create billboard renderer" << std::endl;
+                return -1;
+            }
+            unsortedVertices.resize(particleCount);
+            depthSort.resize(particleCount);
+        }
+        
+        updateMode = std::string(particleSimdName()) + ", " + std::to_string(jobs.threadCount()) + " threads, " +
+                     (particleStream.persistent ? "persistent" : "orphan") +
+                     (particleCollisions ? ", collisions" : "") +
+                     (billboardRendering ? ", sorted billboards" : ", points");
+    }
+    
+    // 所有着色器程序已创建，输出冷/热启动的耗时
+    reportShaderCacheStats();
     
-    // 设置缓冲区
-    setupBuffers();
+    // GPU模拟只需要设置发射器
+    GpuEmitter emitter;
+    emitter.rate = particleCount / PARTICLE_LIFETIME;
     
     // 启用深度测试
     glEnable(GL_DEPTH_TEST);
     
-    // 记录上一帧时间
-    float lastTime = glfwGetTime();
+    // 记录上一帧时间与尚未模拟的时间
+    double lastTime = glfwGetTime();
+    double accumulator = 0.0;
     
     // 主循环
     while (!glfwWindowShouldClose(window)) {
-        // 计算 deltaTime
-        float currentTime = glfwGetTime();
-        float deltaTime = currentTime - lastTime;
+        // 计算 deltaTime，并换算为本帧要执行的固定模拟步数
+        double currentTime = glfwGetTime();
+        accumulator += currentTime - lastTime;
         lastTime = currentTime;
         
+        int steps = (int)(accumulator / FIXED_TIMESTEP);
+        if (steps > MAX_STEPS_PER_FRAME) {
+            steps = MAX_STEPS_PER_FRAME;
+            accumulator = 0.0;
+        } else {
+            accumulator -= steps * FIXED_TIMESTEP;
+        }
+        
         // 处理输入
         processInput(window);
         
-        // 更新粒子
-        updateParticles(deltaTime);
+        if (gpuSimulation) {
+            for (int step = 0; step < steps; ++step) {
+                updateGpuParticles(gpuParticles, emitter, FIXED_TIMESTEP);
+                reportUpdateTime(gpuParticles.simulationTimer.milliseconds, 1);
+            }
+            renderGpu();
+            
+            glfwSwapBuffers(window);
+            glfwPollEvents();
+            continue;
+        }
+        
+        // 取得本帧的顶点内存，最后一个模拟步同时直接写入顶点；本帧没有模拟步时只写出当前状态
+        // 公告板模式下顶点先写到 unsortedVertices，排序后再顺序写入映射的内存
+        ParticleVertex* vertices = beginParticleStreamFrame(particleStream);
+        if (!vertices) {
+            break;
+        }
+        ParticleVertex* target = billboardRendering ? unsortedVertices.data() : vertices;
+        
+        auto updateStart = std::chrono::steady_clock::now();
+        for (int step = 0; step < steps; ++step) {
+            stepParticles(jobs, step == steps - 1 ? target : nullptr);
+        }
+        auto updateEnd = std::chrono::steady_clock::now();
+        if (steps == 0) {
+            writeParticleVertices(particles, jobs, target);
+        } else {
+            reportUpdateTime(std::chrono::duration<double, std::milli>(updateEnd - updateStart).count(), steps);
+        }
         
-        // 渲染
-        render();
+        if (billboardRendering) {
+            auto sortStart = std::chrono::steady_clock::now();
+            sortParticleVertices(jobs, vertices);
+            auto sortEnd = std::chrono::steady_clock::now();
+            reportSortTime(std::chrono::duration<double, std::milli>(sortEnd - sortStart).count());
+        }
+        
+        // 渲染，之后为这一段插入栅栏
+        render(endParticleStreamFrame(particleStream));
+        fenceParticleStreamFrame(particleStream);
         
         // 交换缓冲区
         glfwSwapBuffers(window);
@@ -308,9 +578,17 @@ int main() {
     }
     
     // 清理资源
-    glDeleteVertexArrays(1, &VAO);
-    glDeleteBuffers(1, &VBO);
-    glDeleteProgram(shaderProgram);
+    if (gpuSimulation) {
+        destroyGpuParticles(gpuParticles);
+    } else {
+        glDeleteVertexArrays(1, &VAO);
+        destroyParticleStream(particleStream);
+        if (billboardRendering) {
+            destroyBillboardRenderer(billboardRenderer);
+        }
+    }
+    shaderProgram.destroy();
+    frameUniforms.destroy();
     
     // 终止GLFW
     glfwTerminate();
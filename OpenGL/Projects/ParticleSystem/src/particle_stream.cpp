@@ -0,0 +1,108 @@
+// particle_stream.cpp
+// 持久映射的三重缓冲顶点流，以及 GL 3.3 下的孤立缓冲回退
+
+#include "particle_stream.h"
+
+#include <iostream>
+
+namespace {
+
+// 单次等待栅栏的超时（纳秒）
+const GLuint64 FENCE_TIMEOUT = 1000000000;
+
+void waitFence(GLsync& fence) {
+    if (!fence) {
+        return;
+    }
+    for (;;) {
+        GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT);
+        if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED) {
+            break;
+        }
+        if (result == GL_WAIT_FAILED) {
+            std::cerr << "Failed to wait for particle stream fence" << std::endl;
+            break;
+        }
+    }
+    glDeleteSync(fence);
+    fence = nullptr;
+}
+
+} // namespace
+
+bool createParticleStream(ParticleStream& stream, size_t vertexCount, bool allowPersistent) {
+    stream.vertexCount = vertexCount;
+    stream.persistent = allowPersistent && (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage);
+    stream.segment = 0;
+
+    glGenBuffers(1, &stream.buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, stream.buffer);
+
+    size_t segmentBytes = sizeof(ParticleVertex) * vertexCount;
+    if (stream.persistent) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_ARRAY_BUFFER, segmentBytes * STREAM_SEGMENTS, NULL, flags);
+        stream.mapped = (ParticleVertex*)glMapBufferRange(GL_ARRAY_BUFFER, 0, segmentBytes * STREAM_SEGMENTS, flags);
+        if (!stream.mapped) {
+            std::cerr << "Failed to persistently map particle buffer" << std::endl;
+            return false;
+        }
+    } else {
+        glBufferData(GL_ARRAY_BUFFER, segmentBytes, NULL, GL_STREAM_DRAW);
+    }
+    return true;
+}
+
+ParticleVertex* beginParticleStreamFrame(ParticleStream& stream) {
+    if (stream.persistent) {
+        waitFence(stream.fences[stream.segment]);
+        return stream.mapped + stream.vertexCount * stream.segment;
+    }
+
+    // 孤立旧存储：正在被GPU读取的数据由驱动保留，映射得到的是一块新的存储
+    size_t segmentBytes = sizeof(ParticleVertex) * stream.vertexCount;
+    glBindBuffer(GL_ARRAY_BUFFER, stream.buffer);
+    glBufferData(GL_ARRAY_BUFFER, segmentBytes, NULL, GL_STREAM_DRAW);
+    void* data = glMapBufferRange(GL_ARRAY_BUFFER, 0, segmentBytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (!data) {
+        std::cerr << "Failed to map particle buffer" << std::endl;
+    }
+    return (ParticleVertex*)data;
+}
+
+GLint endParticleStreamFrame(ParticleStream& stream) {
+    if (stream.persistent) {
+        // COHERENT 映射的写入对之后提交的命令可见，不需要 flush 或解除映射
+        return (GLint)(stream.vertexCount * stream.segment);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, stream.buffer);
+    if (glUnmapBuffer(GL_ARRAY_BUFFER) == GL_FALSE) {
+        std::cerr << "Particle buffer contents were lost while mapped" << std::endl;
+    }
+    return 0;
+}
+
+void fenceParticleStreamFrame(ParticleStream& stream) {
+    if (!stream.persistent) {
+        return;
+    }
+    stream.fences[stream.segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    stream.segment = (stream.segment + 1) % STREAM_SEGMENTS;
+}
+
+void destroyParticleStream(ParticleStream& stream) {
+    for (GLsync& fence : stream.fences) {
+        if (fence) {
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+    if (stream.mapped) {
+        glBindBuffer(GL_ARRAY_BUFFER, stream.buffer);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        stream.mapped = nullptr;
+    }
+    glDeleteBuffers(1, &stream.buffer);
+    stream.buffer = 0;
+}
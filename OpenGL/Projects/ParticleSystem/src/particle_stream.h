@@ -0,0 +1,43 @@
+// particle_stream.h
+// 每帧粒子顶点数据的流式上传
+//
+// 支持 GL 4.4 / ARB_buffer_storage 时，用 glBufferStorage 分配三段大小相同的缓冲区并持久映射（PERSISTENT | COHERENT），
+// 每帧轮流写入其中一段，绘制后插入 glFenceSync；再次轮到这一段时先等待它的栅栏，保证GPU已读完
+// 否则（GL 3.3）每帧用 glBufferData(NULL) 孤立（orphan）旧存储再映射，由驱动负责避免同步
+// 两种方式下模拟都直接写入映射的内存，不需要额外的CPU端缓冲与 glBufferSubData 拷贝
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstddef>
+
+#include "particles.h"
+
+const int STREAM_SEGMENTS = 3;
+
+struct ParticleStream {
+    GLuint buffer = 0;
+    size_t vertexCount = 0;
+    bool persistent = false;
+
+    // 持久映射时为整个缓冲区的地址
+    ParticleVertex* mapped = nullptr;
+    GLsync fences[STREAM_SEGMENTS] = {};
+    int segment = 0;
+};
+
+// 创建可容纳 vertexCount 个顶点的流，allowPersistent 为 false 时强制使用孤立方式；
+// 调用前需绑定好VAO，函数会把流的缓冲区绑定到 GL_ARRAY_BUFFER 以便设置顶点属性
+bool createParticleStream(ParticleStream& stream, size_t vertexCount, bool allowPersistent);
+
+// 返回本帧可写入的顶点内存（必要时等待GPU读完这一段），失败时返回空指针
+ParticleVertex* beginParticleStreamFrame(ParticleStream& stream);
+
+// 结束写入，返回本帧数据在缓冲区中的第一个顶点下标，作为 glDrawArrays 的 first 参数
+GLint endParticleStreamFrame(ParticleStream& stream);
+
+// 在使用本帧数据的绘制命令之后调用：插入栅栏并切换到下一段
+void fenceParticleStreamFrame(ParticleStream& stream);
+
+void destroyParticleStream(ParticleStream& stream);
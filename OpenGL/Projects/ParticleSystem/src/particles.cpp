@@ -0,0 +1,338 @@
+// particles.cpp
+// 粒子的 SIMD 更新与重生
+
+#include "particles.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "job_system.h"
+#include "simd.h"
+
+using simd::vfloat;
+using simd::vuint;
+
+namespace {
+
+const float GRAVITY = 9.8f;
+// 每秒损失的生命值，粒子存活 PARTICLE_LIFETIME 秒
+const float LIFE_DECAY = 1.0f / PARTICLE_LIFETIME;
+
+// 与场景碰撞时法向速度保留的比例，以及切向速度每次接触损失的比例
+const float SCENE_RESTITUTION = 0.3f;
+const float SCENE_FRICTION = 0.1f;
+
+// 相邻随机数之间的计数器增量（黄金分割比的 32 位定点表示）
+const uint32_t COUNTER_INCREMENT = 0x9E3779B9u;
+
+// 32位整数哈希（lowbias32），作为计数器型随机数发生器：输入相同时输出相同，各输入之间互不相关
+uint32_t hash32(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7FEB352Du;
+    x ^= x >> 15;
+    x *= 0x846CA68Bu;
+    x ^= x >> 16;
+    return x;
+}
+
+vuint hash32(vuint x) {
+    x = x ^ simd::shiftRight<16>(x);
+    x = x * vuint(0x7FEB352Du);
+    x = x ^ simd::shiftRight<15>(x);
+    x = x * vuint(0x846CA68Bu);
+    x = x ^ simd::shiftRight<16>(x);
+    return x;
+}
+
+uint32_t stepKey(uint32_t seed, uint32_t step) {
+    return hash32(seed ^ hash32(step));
+}
+
+// 取哈希值的高 24 位，映射到 [0, 1)
+vfloat unitFloat(vuint h) {
+    return simd::toFloat(simd::shiftRight<8>(h)) * vfloat(1.0f / 16777216.0f);
+}
+
+// 映射到 [-1, 1)
+vfloat signedFloat(vuint h) {
+    return unitFloat(h) * vfloat(2.0f) - vfloat(1.0f);
+}
+
+struct RespawnValues {
+    vfloat velocityX, velocityY, velocityZ;
+    vfloat colorR, colorG, colorB;
+    vfloat size;
+};
+
+// 从 firstIndex 开始的 simd::WIDTH 个粒子在 key 对应的模拟步重生时的随机属性
+RespawnValues respawnValues(uint32_t firstIndex, uint32_t key) {
+    vuint counter = hash32(simd::laneIndex(firstIndex) ^ vuint(key));
+    auto next = [&counter]() {
+        counter = counter + vuint(COUNTER_INCREMENT);
+        return hash32(counter);
+    };
+
+    RespawnValues values;
+    values.velocityX = signedFloat(next()) * vfloat(0.5f);
+    values.velocityY = signedFloat(next()) * vfloat(0.5f) + vfloat(1.0f);
+    values.velocityZ = signedFloat(next()) * vfloat(0.5f);
+    values.colorR = unitFloat(next());
+    values.colorG = unitFloat(next());
+    values.colorB = unitFloat(next());
+    values.size = vfloat(0.02f) + signedFloat(next()) * vfloat(0.03f);
+    return values;
+}
+
+// 把 hit 通道推到碰撞面上（normal 方向上的坐标设为 surface），朝内的法向速度反弹，切向速度施加摩擦
+void resolveContact(vfloat hit, vfloat surface, float normalSign, vfloat& position, vfloat& normalVelocity,
+                    vfloat& tangentVelocity1, vfloat& tangentVelocity2) {
+    const vfloat friction(1.0f - SCENE_FRICTION);
+    position = select(hit, surface, position);
+    vfloat inward = hit & (normalVelocity * vfloat(normalSign) < vfloat(0.0f));
+    normalVelocity = select(inward, normalVelocity * vfloat(-SCENE_RESTITUTION), normalVelocity);
+    tangentVelocity1 = select(hit, tangentVelocity1 * friction, tangentVelocity1);
+    tangentVelocity2 = select(hit, tangentVelocity2 * friction, tangentVelocity2);
+}
+
+// 地面平面与盒子的碰撞；进入盒子的粒子沿穿透最浅的面推出。盒子放在地面上，粒子不会从底面进入，
+// 所以底面不参与比较，贴着地面滑进盒子的粒子（y 等于底面高度）也算在盒子内
+void collideScene(vfloat& x, vfloat& y, vfloat& z, vfloat& vx, vfloat& vy, vfloat& vz) {
+    const vfloat floorHeight(FLOOR_HEIGHT);
+    vfloat belowFloor = y < floorHeight;
+    if (simd::any(belowFloor)) {
+        resolveContact(belowFloor, floorHeight, 1.0f, y, vy, vx, vz);
+    }
+
+    const vfloat minX(SCENE_BOX_MIN.x), minY(SCENE_BOX_MIN.y), minZ(SCENE_BOX_MIN.z);
+    const vfloat maxX(SCENE_BOX_MAX.x), maxY(SCENE_BOX_MAX.y), maxZ(SCENE_BOX_MAX.z);
+    vfloat inside = (x > minX) & (x < maxX) & (y >= minY) & (y < maxY) & (z > minZ) & (z < maxZ);
+    if (simd::none(inside)) {
+        return;
+    }
+
+    vfloat depthMinX = x - minX, depthMaxX = maxX - x;
+    vfloat depthMaxY = maxY - y;
+    vfloat depthMinZ = z - minZ, depthMaxZ = maxZ - z;
+    vfloat shallowest = simd::min(simd::min(simd::min(depthMinX, depthMaxX), depthMaxY), simd::min(depthMinZ, depthMaxZ));
+
+    // 深度相同时只处理第一个面
+    vfloat pending = inside;
+    auto face = [&](vfloat depth, vfloat surface, float normalSign, vfloat& position, vfloat& normalVelocity,
+                    vfloat& tangentVelocity1, vfloat& tangentVelocity2) {
+        vfloat hit = pending & (depth <= shallowest);
+        resolveContact(hit, surface, normalSign, position, normalVelocity, tangentVelocity1, tangentVelocity2);
+        pending = andNot(hit, pending);
+    };
+    face(depthMaxY, maxY, 1.0f, y, vy, vx, vz);
+    face(depthMinX, minX, -1.0f, x, vx, vy, vz);
+    face(depthMaxX, maxX, 1.0f, x, vx, vy, vz);
+    face(depthMinZ, minZ, -1.0f, z, vz, vx, vy);
+    face(depthMaxZ, maxZ, 1.0f, z, vz, vx, vy);
+}
+
+#if defined(SIMD_AVX2) || defined(SIMD_SSE)
+// 4个粒子转置为交错的顶点数据：每个顶点用两次16字节写入，第二次多写的一个float随后被下一个顶点覆盖，
+// 所以第4个顶点之后必须还有至少一个float可写
+void writeVertices4(__m128 x, __m128 y, __m128 z, __m128 r, __m128 g, __m128 b, __m128 size, float* out) {
+    __m128 pad = _mm_setzero_ps();
+    _MM_TRANSPOSE4_PS(x, y, z, r);
+    _MM_TRANSPOSE4_PS(g, b, size, pad);
+    _mm_storeu_ps(out, x);
+    _mm_storeu_ps(out + 4, g);
+    _mm_storeu_ps(out + 7, y);
+    _mm_storeu_ps(out + 11, b);
+    _mm_storeu_ps(out + 14, z);
+    _mm_storeu_ps(out + 18, size);
+    _mm_storeu_ps(out + 21, r);
+    _mm_storeu_ps(out + 25, pad);
+}
+#endif
+
+static_assert(sizeof(ParticleVertex) == 7 * sizeof(float), "ParticleVertex must be 7 tightly packed floats");
+
+// 把一组粒子转置为交错的顶点数据；count 为这一组中需要写出的粒子数，
+// hasNext 表示这一组之后的顶点也由当前线程写出（允许重叠写入）
+void writeVertexGroup(vfloat x, vfloat y, vfloat z, vfloat r, vfloat g, vfloat b, vfloat size, size_t count,
+                      bool hasNext, ParticleVertex* vertices) {
+    float* out = reinterpret_cast<float*>(vertices);
+#if defined(SIMD_AVX2)
+    if (count == simd::WIDTH && hasNext) {
+        writeVertices4(_mm256_castps256_ps128(x.v), _mm256_castps256_ps128(y.v), _mm256_castps256_ps128(z.v),
+                       _mm256_castps256_ps128(r.v), _mm256_castps256_ps128(g.v), _mm256_castps256_ps128(b.v),
+                       _mm256_castps256_ps128(size.v), out);
+        writeVertices4(_mm256_extractf128_ps(x.v, 1), _mm256_extractf128_ps(y.v, 1), _mm256_extractf128_ps(z.v, 1),
+                       _mm256_extractf128_ps(r.v, 1), _mm256_extractf128_ps(g.v, 1), _mm256_extractf128_ps(b.v, 1),
+                       _mm256_extractf128_ps(size.v, 1), out + 28);
+        return;
+    }
+#elif defined(SIMD_SSE)
+    if (count == simd::WIDTH && hasNext) {
+        writeVertices4(x.v, y.v, z.v, r.v, g.v, b.v, size.v, out);
+        return;
+    }
+#endif
+
+    // 最后一组（或标量实现）逐个写出
+    alignas(32) float lanes[7][simd::WIDTH];
+    x.store(lanes[0]);
+    y.store(lanes[1]);
+    z.store(lanes[2]);
+    r.store(lanes[3]);
+    g.store(lanes[4]);
+    b.store(lanes[5]);
+    size.store(lanes[6]);
+    for (size_t k = 0; k < count; ++k) {
+        for (int c = 0; c < 7; ++c) {
+            out[k * 7 + c] = lanes[c][k];
+        }
+    }
+}
+
+// 更新 [first, last) 范围内的粒子；first、last 为 SIMD 宽度的整数倍
+void updateRange(ParticleStore& store, size_t first, size_t last, float deltaTime, uint32_t key,
+                 ParticleVertex* vertices) {
+    const vfloat zero(0.0f);
+    const vfloat one(1.0f);
+    const vfloat dt(deltaTime);
+    const vfloat lifeLoss(deltaTime * LIFE_DECAY);
+    const vfloat gravity(deltaTime * GRAVITY);
+
+    float* positionX = store.positionX.data();
+    float* positionY = store.positionY.data();
+    float* positionZ = store.positionZ.data();
+    float* velocityX = store.velocityX.data();
+    float* velocityY = store.velocityY.data();
+    float* velocityZ = store.velocityZ.data();
+    float* life = store.life.data();
+
+    // 顶点的重叠写入不能越过本块的末尾，否则会与处理下一块的线程冲突
+    size_t vertexEnd = std::min(last, store.count);
+    for (size_t i = first; i < last; i += simd::WIDTH) {
+        vfloat l = vfloat::load(life + i) - lifeLoss;
+        vfloat vx = vfloat::load(velocityX + i);
+        vfloat vy = vfloat::load(velocityY + i);
+        vfloat vz = vfloat::load(velocityZ + i);
+
+        // 先按存活粒子积分，死亡的通道随后整体替换为重生值
+        vfloat x = vfloat::load(positionX + i) + vx * dt;
+        vfloat y = vfloat::load(positionY + i) + vy * dt;
+        vfloat z = vfloat::load(positionZ + i) + vz * dt;
+        vy = vy - gravity;
+        collideScene(x, y, z, vx, vy, vz);
+
+        vfloat dead = l <= zero;
+        if (simd::any(dead)) {
+            RespawnValues values = respawnValues(static_cast<uint32_t>(i), key);
+            x = andNot(dead, x);
+            y = andNot(dead, y);
+            z = andNot(dead, z);
+            vx = select(dead, values.velocityX, vx);
+            vy = select(dead, values.velocityY, vy);
+            vz = select(dead, values.velocityZ, vz);
+            l = select(dead, one, l);
+
+            // 颜色与大小只在重生时改变
+            select(dead, values.colorR, vfloat::load(&store.colorR[i])).store(&store.colorR[i]);
+            select(dead, values.colorG, vfloat::load(&store.colorG[i])).store(&store.colorG[i]);
+            select(dead, values.colorB, vfloat::load(&store.colorB[i])).store(&store.colorB[i]);
+            select(dead, values.size, vfloat::load(&store.size[i])).store(&store.size[i]);
+        }
+
+        x.store(positionX + i);
+        y.store(positionY + i);
+        z.store(positionZ + i);
+        vx.store(velocityX + i);
+        vy.store(velocityY + i);
+        vz.store(velocityZ + i);
+        l.store(life + i);
+
+        if (vertices && i < vertexEnd) {
+            writeVertexGroup(x, y, z, vfloat::load(&store.colorR[i]), vfloat::load(&store.colorG[i]),
+                             vfloat::load(&store.colorB[i]), vfloat::load(&store.size[i]),
+                             std::min<size_t>(simd::WIDTH, vertexEnd - i), i + simd::WIDTH < vertexEnd, vertices + i);
+        }
+    }
+}
+
+} // namespace
+
+void initParticles(ParticleStore& store, size_t count, uint32_t seed, JobSystem& jobs) {
+    size_t padded = (count + simd::WIDTH - 1) / simd::WIDTH * simd::WIDTH;
+
+    store.count = count;
+    store.seed = seed;
+    store.step = 0;
+
+    for (std::vector<float>* array : {&store.positionX, &store.positionY, &store.positionZ,
+                                      &store.velocityX, &store.velocityY, &store.velocityZ,
+                                      &store.colorR, &store.colorG, &store.colorB,
+                                      &store.life, &store.size}) {
+        array->assign(padded, 0.0f);
+    }
+
+    uint32_t key = stepKey(seed, 0);
+    jobs.parallelFor(0, padded, PARTICLE_CHUNK_SIZE, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; i += simd::WIDTH) {
+            RespawnValues values = respawnValues(static_cast<uint32_t>(i), key);
+            values.velocityX.store(&store.velocityX[i]);
+            values.velocityY.store(&store.velocityY[i]);
+            values.velocityZ.store(&store.velocityZ[i]);
+            values.colorR.store(&store.colorR[i]);
+            values.colorG.store(&store.colorG[i]);
+            values.colorB.store(&store.colorB[i]);
+            values.size.store(&store.size[i]);
+            vfloat(1.0f).store(&store.life[i]);
+        }
+    });
+}
+
+void updateParticles(ParticleStore& store, float deltaTime, JobSystem& jobs, ParticleVertex* vertices) {
+    store.step++;
+    uint32_t key = stepKey(store.seed, store.step);
+
+    jobs.parallelFor(0, store.life.size(), PARTICLE_CHUNK_SIZE, [&](size_t first, size_t last) {
+        updateRange(store, first, last, deltaTime, key, vertices);
+    });
+}
+
+void writeParticleVertices(const ParticleStore& store, JobSystem& jobs, ParticleVertex* vertices) {
+    jobs.parallelFor(0, store.count, PARTICLE_CHUNK_SIZE, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; i += simd::WIDTH) {
+            writeVertexGroup(vfloat::load(&store.positionX[i]), vfloat::load(&store.positionY[i]),
+                             vfloat::load(&store.positionZ[i]), vfloat::load(&store.colorR[i]),
+                             vfloat::load(&store.colorG[i]), vfloat::load(&store.colorB[i]),
+                             vfloat::load(&store.size[i]), std::min<size_t>(simd::WIDTH, last - i),
+                             i + simd::WIDTH < last, vertices + i);
+        }
+    });
+}
+
+void computeDepthKeys(const ParticleStore& store, const glm::vec3& eye, const glm::vec3& forward, JobSystem& jobs,
+                      uint32_t* keys, uint32_t* indices) {
+    jobs.parallelFor(0, store.count, PARTICLE_CHUNK_SIZE, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) {
+            float depth = (store.positionX[i] - eye.x) * forward.x + (store.positionY[i] - eye.y) * forward.y +
+                          (store.positionZ[i] - eye.z) * forward.z;
+
+            // 浮点数转换为保序的无符号整数（负数翻转全部位，正数翻转符号位），再取反得到降序
+            uint32_t bits;
+            std::memcpy(&bits, &depth, sizeof(bits));
+            uint32_t ordered = bits ^ ((bits >> 31) != 0 ? 0xFFFFFFFFu : 0x80000000u);
+            keys[i] = ~ordered;
+            indices[i] = static_cast<uint32_t>(i);
+        }
+    });
+}
+
+void gatherParticleVertices(const ParticleVertex* source, const uint32_t* order, size_t count, JobSystem& jobs,
+                            ParticleVertex* destination) {
+    jobs.parallelFor(0, count, PARTICLE_CHUNK_SIZE, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) {
+            destination[i] = source[order[i]];
+        }
+    });
+}
+
+const char* particleSimdName() {
+    return simd::NAME;
+}
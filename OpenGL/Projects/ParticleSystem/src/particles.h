@@ -0,0 +1,73 @@
+// particles.h
+// 粒子数据按结构数组（SoA）存放，更新时用 SIMD 一次处理 simd::WIDTH 个粒子
+//
+// 更新按固定大小的块（PARTICLE_CHUNK_SIZE）在任务线程池上并行执行。重生粒子的随机数由
+// （种子、模拟步序号、粒子下标）经哈希得到，与块由哪个线程、以什么顺序执行无关，
+// 因此线程数或 SIMD 宽度改变时，同一步的模拟结果逐位相同
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+class JobSystem;
+
+// 粒子数量上限
+const size_t MAX_PARTICLES = 10000000;
+
+// 粒子寿命（秒）：CPU更新、GPU模拟（gpu_simulate.comp、feedback.vert 中的 LIFE_DECAY = 1 / 寿命）
+// 与GPU发射率（容量 / 寿命，使存活粒子数稳定在容量附近）共用这一个值
+const float PARTICLE_LIFETIME = 2.0f;
+
+// 并行更新时每个任务处理的粒子数（SIMD 宽度的整数倍）
+const size_t PARTICLE_CHUNK_SIZE = 16384;
+
+struct ParticleStore {
+    // 实际粒子数；各数组长度向上补齐到 SIMD 宽度的整数倍，补齐的粒子同样参与更新但不绘制
+    size_t count = 0;
+    uint32_t seed = 0;
+    // 已执行的模拟步数，作为重生随机数的计数器之一
+    uint32_t step = 0;
+
+    std::vector<float> positionX, positionY, positionZ;
+    std::vector<float> velocityX, velocityY, velocityZ;
+    std::vector<float> colorR, colorG, colorB;
+    std::vector<float> life;
+    std::vector<float> size;
+};
+
+// 场景碰撞体：地面平面 y = FLOOR_HEIGHT 与放在地面上的轴对齐盒子，渲染时绘制相同的几何体
+const float FLOOR_HEIGHT = -1.0f;
+const glm::vec3 SCENE_BOX_MIN(-0.25f, -1.0f, -0.25f);
+const glm::vec3 SCENE_BOX_MAX(0.25f, -0.7f, 0.25f);
+
+// 上传到VBO的每粒子顶点数据，对应顶点着色器的属性 0/1/2
+struct ParticleVertex {
+    glm::vec3 position;
+    glm::vec3 color;
+    float size;
+};
+
+// 分配并初始化 count 个粒子
+void initParticles(ParticleStore& store, size_t count, uint32_t seed, JobSystem& jobs);
+
+// 推进一个模拟步：生命值衰减，死亡的粒子在原点重生，其余粒子积分位置、施加重力并与地面和盒子碰撞
+// vertices 不为空时在同一遍循环中顺序写出前 count 个粒子的顶点数据（只写不读，可以直接指向映射的GPU缓冲区）
+void updateParticles(ParticleStore& store, float deltaTime, JobSystem& jobs, ParticleVertex* vertices = nullptr);
+
+// 不推进模拟，只写出当前状态的顶点数据（本帧没有执行模拟步时使用）
+void writeParticleVertices(const ParticleStore& store, JobSystem& jobs, ParticleVertex* vertices);
+
+// 计算按视图深度排序的键：离相机越远键越小，按键升序即为从后往前的混合顺序；indices 写入粒子下标
+void computeDepthKeys(const ParticleStore& store, const glm::vec3& eye, const glm::vec3& forward, JobSystem& jobs,
+                      uint32_t* keys, uint32_t* indices);
+
+// 按 order 给出的下标顺序从 source 复制 count 个顶点到 destination（顺序写入）；
+// source 应为 updateParticles 写出的交错顶点，随机读取时每个粒子只涉及一条缓存行，而不是 SoA 的7个数组
+void gatherParticleVertices(const ParticleVertex* source, const uint32_t* order, size_t count, JobSystem& jobs,
+                            ParticleVertex* destination);
+
+const char* particleSimdName();
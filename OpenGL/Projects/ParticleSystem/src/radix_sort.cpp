@@ -0,0 +1,95 @@
+// radix_sort.cpp
+// 并行 LSD 基数排序
+
+#include "radix_sort.h"
+
+#include <algorithm>
+
+#include "job_system.h"
+
+namespace {
+
+const int RADIX_BITS = 8;
+const uint32_t RADIX_SIZE = 1u << RADIX_BITS;
+const uint32_t RADIX_MASK = RADIX_SIZE - 1;
+
+// 每个数据块的元素数；块数决定了直方图的大小与串行前缀和的开销
+const size_t SORT_BLOCK_SIZE = 65536;
+
+} // namespace
+
+void RadixSortBuffers::resize(size_t count) {
+    keys.resize(count);
+    values.resize(count);
+    tempKeys.resize(count);
+    tempValues.resize(count);
+    histograms.resize(((count + SORT_BLOCK_SIZE - 1) / SORT_BLOCK_SIZE) * RADIX_SIZE);
+}
+
+void radixSort(RadixSortBuffers& buffers, size_t count, JobSystem& jobs) {
+    size_t blockCount = (count + SORT_BLOCK_SIZE - 1) / SORT_BLOCK_SIZE;
+    if (blockCount == 0) {
+        return;
+    }
+
+    uint32_t* keys = buffers.keys.data();
+    uint32_t* values = buffers.values.data();
+    uint32_t* tempKeys = buffers.tempKeys.data();
+    uint32_t* tempValues = buffers.tempValues.data();
+    uint32_t* histograms = buffers.histograms.data();
+
+    for (int shift = 0; shift < 32; shift += RADIX_BITS) {
+        // 统计每个数据块中各个桶的元素数
+        jobs.parallelFor(0, count, SORT_BLOCK_SIZE, [&](size_t first, size_t last) {
+            uint32_t* histogram = histograms + (first / SORT_BLOCK_SIZE) * RADIX_SIZE;
+            std::fill(histogram, histogram + RADIX_SIZE, 0u);
+            for (size_t i = first; i < last; ++i) {
+                histogram[(keys[i] >> shift) & RADIX_MASK]++;
+            }
+        });
+
+        // 所有键在这一位上都相同时跳过这一趟（例如深度接近时高位全部一致）
+        bool trivial = false;
+        for (uint32_t digit = 0; digit < RADIX_SIZE && !trivial; ++digit) {
+            size_t total = 0;
+            for (size_t block = 0; block < blockCount; ++block) {
+                total += histograms[block * RADIX_SIZE + digit];
+            }
+            trivial = total == count;
+        }
+        if (trivial) {
+            continue;
+        }
+
+        // 按（桶，块）的顺序求前缀和，得到每个块每个桶的起始写入位置，保证排序稳定
+        uint32_t offset = 0;
+        for (uint32_t digit = 0; digit < RADIX_SIZE; ++digit) {
+            for (size_t block = 0; block < blockCount; ++block) {
+                uint32_t& entry = histograms[block * RADIX_SIZE + digit];
+                uint32_t blockCountForDigit = entry;
+                entry = offset;
+                offset += blockCountForDigit;
+            }
+        }
+
+        jobs.parallelFor(0, count, SORT_BLOCK_SIZE, [&](size_t first, size_t last) {
+            uint32_t* offsets = histograms + (first / SORT_BLOCK_SIZE) * RADIX_SIZE;
+            for (size_t i = first; i < last; ++i) {
+                uint32_t destination = offsets[(keys[i] >> shift) & RADIX_MASK]++;
+                tempKeys[destination] = keys[i];
+                tempValues[destination] = values[i];
+            }
+        });
+
+        std::swap(keys, tempKeys);
+        std::swap(values, tempValues);
+    }
+
+    // 执行了奇数趟时结果在临时数组中
+    if (keys != buffers.keys.data()) {
+        jobs.parallelFor(0, count, SORT_BLOCK_SIZE, [&](size_t first, size_t last) {
+            std::copy(keys + first, keys + last, buffers.keys.data() + first);
+            std::copy(values + first, values + last, buffers.values.data() + first);
+        });
+    }
+}
@@ -0,0 +1,28 @@
+// radix_sort.h
+// 并行 LSD 基数排序（32位键 + 32位值），用于按视图深度对粒子排序
+//
+// 每一趟处理8位：各数据块并行统计直方图，串行求前缀和得到每个块每个桶的写入位置，再并行分散写入；
+// 数据块的划分只取决于元素个数，所以结果与线程数无关，且排序是稳定的
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class JobSystem;
+
+struct RadixSortBuffers {
+    std::vector<uint32_t> keys;
+    std::vector<uint32_t> values;
+
+    // 排序过程中交替使用的临时数组与各数据块的直方图
+    std::vector<uint32_t> tempKeys;
+    std::vector<uint32_t> tempValues;
+    std::vector<uint32_t> histograms;
+
+    void resize(size_t count);
+};
+
+// 按 keys 升序排序 buffers 中的前 count 个元素，values 随键一起移动
+void radixSort(RadixSortBuffers& buffers, size_t count, JobSystem& jobs);
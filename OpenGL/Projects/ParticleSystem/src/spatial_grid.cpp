@@ -0,0 +1,182 @@
+// spatial_grid.cpp
+// 空间哈希网格的构建、粒子重排、粒子间碰撞与 SPH 密度
+
+#include "spatial_grid.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "job_system.h"
+
+namespace {
+
+// 粒子相互接近时法向相对速度保留的比例
+const float PARTICLE_RESTITUTION = 0.5f;
+// 每个模拟步消除的重叠比例，转换为分离速度
+const float OVERLAP_CORRECTION = 0.2f;
+// 距离小于该值的两个粒子（例如同一步在原点重生的粒子）没有确定的法线，不产生碰撞
+const float MIN_CONTACT_DISTANCE = 1e-6f;
+
+// poly6 核的归一化系数 315 / (64 π h^9)
+const float POLY6_SCALE = 315.0f / (64.0f * 3.14159265f * std::pow(GRID_CELL_SIZE, 9.0f));
+
+} // namespace
+
+void buildSpatialGrid(SpatialGrid& grid, ParticleStore& store, JobSystem& jobs) {
+    size_t count = store.count;
+    size_t padded = store.life.size();
+    grid.scratch.resize(padded);
+
+    uint32_t* keys = grid.sort.keys.data();
+    uint32_t* order = grid.sort.values.data();
+    GridCell* cells = grid.cells.data();
+    if (grid.sort.keys.size() != count) {
+        grid.sort.resize(count);
+        grid.cells.assign(GRID_CELL_COUNT, GridCell{0, 0});
+        keys = grid.sort.keys.data();
+        order = grid.sort.values.data();
+        cells = grid.cells.data();
+    } else {
+        // keys 中还是上一步排好序的键，每个格子只由它的第一个粒子清除一次
+        jobs.parallelFor(0, count, PARTICLE_CHUNK_SIZE, [&](size_t first, size_t last) {
+            for (size_t i = first; i < last; ++i) {
+                if (i == 0 || keys[i - 1] != keys[i]) {
+                    cells[keys[i]] = GridCell{0, 0};
+                }
+            }
+        });
+    }
+
+    jobs.parallelFor(0, count, PARTICLE_CHUNK_SIZE, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) {
+            keys[i] = gridKey(gridCoordinate(store.positionX[i]), gridCoordinate(store.positionY[i]),
+                              gridCoordinate(store.positionZ[i]));
+            order[i] = static_cast<uint32_t>(i);
+        }
+    });
+    radixSort(grid.sort, count, jobs);
+
+    // 粒子每步只移动很短的距离，上一步已按格子排好序，这里的读取也接近顺序访问
+    for (std::vector<float>* array : {&store.positionX, &store.positionY, &store.positionZ,
+                                      &store.velocityX, &store.velocityY, &store.velocityZ,
+                                      &store.colorR, &store.colorG, &store.colorB,
+                                      &store.life, &store.size}) {
+        const float* source = array->data();
+        float* destination = grid.scratch.data();
+        jobs.parallelFor(0, padded, PARTICLE_CHUNK_SIZE, [&](size_t first, size_t last) {
+            for (size_t i = first; i < last; ++i) {
+                destination[i] = i < count ? source[order[i]] : source[i];
+            }
+        });
+        std::swap(*array, grid.scratch);
+    }
+
+    // 排序后的键中每一段相同的值就是一个格子的粒子范围
+    jobs.parallelFor(0, count, PARTICLE_CHUNK_SIZE, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) {
+            uint32_t key = keys[i];
+            if (i == 0 || keys[i - 1] != key) {
+                cells[key].first = static_cast<uint32_t>(i);
+            }
+            if (i + 1 == count || keys[i + 1] != key) {
+                cells[key].last = static_cast<uint32_t>(i + 1);
+            }
+        }
+    });
+}
+
+void collideParticles(SpatialGrid& grid, ParticleStore& store, float deltaTime, JobSystem& jobs) {
+    size_t count = store.count;
+    size_t padded = store.life.size();
+    grid.velocityX.resize(padded);
+    grid.velocityY.resize(padded);
+    grid.velocityZ.resize(padded);
+
+    const float* velocityX = store.velocityX.data();
+    const float* velocityY = store.velocityY.data();
+    const float* velocityZ = store.velocityZ.data();
+    float* resultX = grid.velocityX.data();
+    float* resultY = grid.velocityY.data();
+    float* resultZ = grid.velocityZ.data();
+    const float separationRate = OVERLAP_CORRECTION / deltaTime;
+
+    jobs.parallelFor(0, padded, PARTICLE_CHUNK_SIZE, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) {
+            float vx = velocityX[i];
+            float vy = velocityY[i];
+            float vz = velocityZ[i];
+            if (i >= count) {
+                resultX[i] = vx;
+                resultY[i] = vy;
+                resultZ[i] = vz;
+                continue;
+            }
+
+            float changeX = 0.0f, changeY = 0.0f, changeZ = 0.0f;
+            int contacts = 0;
+            forEachNeighbor(grid, store, store.positionX[i], store.positionY[i], store.positionZ[i], i,
+                            [&](uint32_t j, float dx, float dy, float dz, float distanceSquared) {
+                float distance = std::sqrt(distanceSquared);
+                if (distance < MIN_CONTACT_DISTANCE) {
+                    return;
+                }
+                // 法线从 j 指向 i，两个粒子质量相同，各承担一半的冲量
+                float inverseDistance = 1.0f / distance;
+                float nx = dx * inverseDistance, ny = dy * inverseDistance, nz = dz * inverseDistance;
+                float approach = (vx - velocityX[j]) * nx + (vy - velocityY[j]) * ny + (vz - velocityZ[j]) * nz;
+
+                float impulse = 0.5f * (GRID_CELL_SIZE - distance) * separationRate;
+                if (approach < 0.0f) {
+                    impulse -= 0.5f * (1.0f + PARTICLE_RESTITUTION) * approach;
+                }
+                changeX += nx * impulse;
+                changeY += ny * impulse;
+                changeZ += nz * impulse;
+                contacts++;
+            });
+
+            if (contacts > 0) {
+                float scale = 1.0f / contacts;
+                vx += changeX * scale;
+                vy += changeY * scale;
+                vz += changeZ * scale;
+            }
+            resultX[i] = vx;
+            resultY[i] = vy;
+            resultZ[i] = vz;
+        }
+    });
+
+    std::swap(store.velocityX, grid.velocityX);
+    std::swap(store.velocityY, grid.velocityY);
+    std::swap(store.velocityZ, grid.velocityZ);
+}
+
+size_t computeParticleDensities(const SpatialGrid& grid, const ParticleStore& store, JobSystem& jobs,
+                                float* densities) {
+    const float radiusSquared = GRID_CELL_SIZE * GRID_CELL_SIZE;
+
+    // 每块单独计数，最后按块顺序求和
+    size_t chunkCount = (store.count + PARTICLE_CHUNK_SIZE - 1) / PARTICLE_CHUNK_SIZE;
+    std::vector<size_t> neighborCounts(chunkCount, 0);
+    jobs.parallelFor(0, store.count, PARTICLE_CHUNK_SIZE, [&](size_t first, size_t last) {
+        size_t neighbors = 0;
+        for (size_t i = first; i < last; ++i) {
+            // 自身的贡献
+            float sum = radiusSquared * radiusSquared * radiusSquared;
+            neighbors += forEachNeighbor(grid, store, store.positionX[i], store.positionY[i], store.positionZ[i], i,
+                                         [&](uint32_t, float, float, float, float distanceSquared) {
+                float weight = radiusSquared - distanceSquared;
+                sum += weight * weight * weight;
+            });
+            densities[i] = sum * POLY6_SCALE;
+        }
+        neighborCounts[first / PARTICLE_CHUNK_SIZE] = neighbors;
+    });
+
+    size_t total = 0;
+    for (size_t neighbors : neighborCounts) {
+        total += neighbors;
+    }
+    return total;
+}
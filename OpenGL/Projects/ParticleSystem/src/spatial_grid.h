@@ -0,0 +1,155 @@
+// spatial_grid.h
+// 均匀空间哈希网格：粒子间碰撞与 SPH 风格的邻居查询
+//
+// 网格坐标按每轴 GRID_AXIS_CELLS 取模后拼成哈希键（相距一个周期的格子共用一个桶，查询时按距离过滤），
+// 因此哈希表大小固定，不依赖粒子的分布范围。每个模拟步按键对粒子做并行的基数排序（8位一趟的计数排序），
+// 并把 ParticleStore 的所有数组按格子顺序重排：同一格子的粒子在内存中连续，x 方向相邻的格子也相邻，
+// 邻居查询几乎是顺序访问。排序稳定且分块只取决于粒子数，重排与查询结果与线程数无关
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "particles.h"
+#include "radix_sort.h"
+#include "simd.h"
+
+class JobSystem;
+
+// 粒子的碰撞半径（与公告板的平均大小接近）；格子边长为碰撞距离（两倍半径），也作为 SPH 的光滑半径
+const float PARTICLE_RADIUS = 0.005f;
+const float GRID_CELL_SIZE = 2.0f * PARTICLE_RADIUS;
+
+// 每轴的格子数（2 的幂，周期 1.28 米）与哈希表大小
+const uint32_t GRID_AXIS_BITS = 7;
+const uint32_t GRID_AXIS_CELLS = 1u << GRID_AXIS_BITS;
+const uint32_t GRID_CELL_COUNT = GRID_AXIS_CELLS * GRID_AXIS_CELLS * GRID_AXIS_CELLS;
+
+// 一次查询最多访问的邻居数：新粒子都在原点重生，不设上限时原点附近的查询是 O(n²) 的
+const int MAX_NEIGHBORS = 32;
+
+// 格子中的粒子范围 [first, last)，空格子两者都为 0
+struct GridCell {
+    uint32_t first;
+    uint32_t last;
+};
+
+struct SpatialGrid {
+    // keys 为排序后各粒子所在格子的哈希键，values 为重排前的粒子下标
+    RadixSortBuffers sort;
+
+    // 按哈希键索引的格子范围，查询时一个格子只访问一次缓存行；重建时只清除上一步用到的格子
+    std::vector<GridCell> cells;
+
+    // 重排与碰撞求解使用的临时数组（长度与 ParticleStore 的数组相同）
+    std::vector<float> scratch;
+    std::vector<float> velocityX, velocityY, velocityZ;
+};
+
+inline int32_t gridCoordinate(float position) {
+    return static_cast<int32_t>(std::floor(position * (1.0f / GRID_CELL_SIZE)));
+}
+
+inline uint32_t gridKey(int32_t cellX, int32_t cellY, int32_t cellZ) {
+    const uint32_t mask = GRID_AXIS_CELLS - 1;
+    return (static_cast<uint32_t>(cellX) & mask) | ((static_cast<uint32_t>(cellY) & mask) << GRID_AXIS_BITS) |
+           ((static_cast<uint32_t>(cellZ) & mask) << (2 * GRID_AXIS_BITS));
+}
+
+// 按格子重排粒子并建立格子范围；调用之后粒子下标发生变化，需要在写出本步的顶点之前调用
+void buildSpatialGrid(SpatialGrid& grid, ParticleStore& store, JobSystem& jobs);
+
+namespace detail {
+
+// 访问 [first, last) 范围内距离小于 GRID_CELL_SIZE 的粒子，每次用 SIMD 检查 simd::WIDTH 个候选；
+// 返回 false 表示已经达到 MAX_NEIGHBORS
+template <typename Fn>
+bool visitNeighborRange(const ParticleStore& store, float x, float y, float z, size_t exclude, uint32_t first,
+                        uint32_t last, int& found, Fn& fn) {
+    const float radiusSquared = GRID_CELL_SIZE * GRID_CELL_SIZE;
+    const float* positionX = store.positionX.data();
+    const float* positionY = store.positionY.data();
+    const float* positionZ = store.positionZ.data();
+
+    auto visit = [&](uint32_t j) {
+        float dx = x - positionX[j];
+        float dy = y - positionY[j];
+        float dz = z - positionZ[j];
+        float distanceSquared = dx * dx + dy * dy + dz * dz;
+        if (j == exclude || distanceSquared >= radiusSquared) {
+            return true;
+        }
+        fn(j, dx, dy, dz, distanceSquared);
+        return ++found < MAX_NEIGHBORS;
+    };
+
+    uint32_t j = first;
+    for (; j + simd::WIDTH <= last; j += simd::WIDTH) {
+        simd::vfloat dx = simd::vfloat(x) - simd::vfloat::load(positionX + j);
+        simd::vfloat dy = simd::vfloat(y) - simd::vfloat::load(positionY + j);
+        simd::vfloat dz = simd::vfloat(z) - simd::vfloat::load(positionZ + j);
+        int hits = simd::movemask(dx * dx + dy * dy + dz * dz < simd::vfloat(radiusSquared));
+        for (int lane = 0; hits != 0; ++lane, hits >>= 1) {
+            if ((hits & 1) && !visit(j + lane)) {
+                return false;
+            }
+        }
+    }
+    for (; j < last; ++j) {
+        if (!visit(j)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace detail
+
+// 对 (x, y, z) 所在格子及周围 26 个格子中距离小于 GRID_CELL_SIZE 的粒子调用 fn(j, dx, dy, dz, distanceSquared)，
+// 其中 (dx, dy, dz) = (x, y, z) - 粒子 j 的位置；exclude 为查询粒子自身的下标。返回访问的邻居数（不超过 MAX_NEIGHBORS）
+// x 方向相邻的三个格子的键相邻，粒子在内存中连成一段，按 9 段连续范围检查
+template <typename Fn>
+int forEachNeighbor(const SpatialGrid& grid, const ParticleStore& store, float x, float y, float z, size_t exclude,
+                    Fn&& fn) {
+    int32_t cellX = gridCoordinate(x);
+    int32_t cellY = gridCoordinate(y);
+    int32_t cellZ = gridCoordinate(z);
+
+    int found = 0;
+    for (int32_t offsetZ = -1; offsetZ <= 1; ++offsetZ) {
+        for (int32_t offsetY = -1; offsetY <= 1; ++offsetY) {
+            // 合并首尾相接的格子范围；x 坐标取模回绕时三个格子不相邻，分开检查
+            uint32_t rowFirst = 0, rowLast = 0;
+            for (int32_t offsetX = -1; offsetX <= 1; ++offsetX) {
+                uint32_t key = gridKey(cellX + offsetX, cellY + offsetY, cellZ + offsetZ);
+                GridCell cell = grid.cells[key];
+                uint32_t first = cell.first, last = cell.last;
+                if (first == last) {
+                    continue;
+                }
+                if (first != rowLast) {
+                    if (!detail::visitNeighborRange(store, x, y, z, exclude, rowFirst, rowLast, found, fn)) {
+                        return found;
+                    }
+                    rowFirst = first;
+                }
+                rowLast = last;
+            }
+            if (!detail::visitNeighborRange(store, x, y, z, exclude, rowFirst, rowLast, found, fn)) {
+                return found;
+            }
+        }
+    }
+    return found;
+}
+
+// 粒子间碰撞：相互接近的粒子沿连线交换法向速度，重叠的粒子获得分离速度；
+// 每个粒子的结果只读取上一状态（Jacobi 迭代），各接触的修正取平均，避免拥挤处的速度爆炸
+void collideParticles(SpatialGrid& grid, ParticleStore& store, float deltaTime, JobSystem& jobs);
+
+// SPH 密度（poly6 核，粒子质量为 1）：对每个粒子做一次邻居查询，返回访问的邻居总数
+size_t computeParticleDensities(const SpatialGrid& grid, const ParticleStore& store, JobSystem& jobs,
+                                float* densities);
@@ -2,51 +2,190 @@
 
 in vec3 FragPos;
 in vec3 Normal;
-in vec4 FragPosLightSpace;
+in float ViewDepth;
 
 out vec4 FragColor;
 
-uniform vec3 lightPos;
-uniform vec3 viewPos;
-uniform vec3 lightColor;
-uniform sampler2D shadowMap;
+// 每个级联一层；shadowMap 由硬件比较深度并对相邻 4 个比较结果双线性插值，返回光照比例，
+// shadowDepth 是同一张纹理关闭比较后的深度值，只用于手动比较的 3x3 PCF
+uniform sampler2DArrayShadow shadowMap;
+uniform sampler2DArray shadowDepth;
 
-// 计算阴影
-float ShadowCalculation(vec4 fragPosLightSpace) {
-    // 执行透视除法
+// VSM / EVSM 的矩纹理数组，模糊后带 mip，只在 shadowFilter 不是 SHADOW_FILTER_PCF 时使用
+uniform sampler2DArray momentMap;
+
+// 每帧共享的相机、光源与级联参数（与 src/main.cpp 中的 FrameData 一致）
+#define MAX_CASCADES 4
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 lightSpaceMatrices[MAX_CASCADES];
+    vec4 cascadeSplits;
+    int cascadeCount;
+    int pcfMode;
+    int pcfTapCount;
+    float pcfRadius;
+    int shadowFilter;
+    float lightBleedReduction;
+    float evsmPositiveExponent;
+    float evsmNegativeExponent;
+    vec4 viewPos;
+    vec4 lightPos;
+    vec4 lightColor;
+};
+
+// 选择覆盖当前深度的级联，超出阴影距离时返回 cascadeCount
+int selectCascade() {
+    for (int i = 0; i < cascadeCount; ++i) {
+        if (ViewDepth < cascadeSplits[i]) {
+            return i;
+        }
+    }
+    return cascadeCount;
+}
+
+// 阴影过滤方式（与 src/main.cpp 中的 SHADOW_FILTER_*、PCF_* 一致）
+#define SHADOW_FILTER_PCF 0
+#define SHADOW_FILTER_VSM 1
+#define SHADOW_FILTER_EVSM 2
+#define PCF_MANUAL 0
+#define PCF_POISSON 1
+
+// 矩阴影的方差下限对应的深度标准差（[0,1] 深度），避免平坦表面方差接近 0 时的数值问题与自阴影
+#define MIN_DEPTH_DEVIATION 0.0005
+
+// 单位圆内的泊松圆盘；前 4 个点分别位于 4 个象限的外圈，先用它们探测整个采样区域
+const vec2 poissonDisk[16] = vec2[](
+    vec2(-0.94201624, -0.39906216),
+    vec2( 0.94558609, -0.76890725),
+    vec2( 0.97484398,  0.75648379),
+    vec2(-0.81409955,  0.91437590),
+    vec2(-0.09418410, -0.92938870),
+    vec2( 0.34495938,  0.29387760),
+    vec2(-0.91588581,  0.45771432),
+    vec2(-0.81544232, -0.87912464),
+    vec2(-0.38277543,  0.27676845),
+    vec2( 0.44323325, -0.97511554),
+    vec2( 0.53742981, -0.47373420),
+    vec2(-0.26496911, -0.41893023),
+    vec2( 0.79197514,  0.19090188),
+    vec2(-0.24188840,  0.99706507),
+    vec2( 0.19984126,  0.78641367),
+    vec2( 0.14383161, -0.14100790)
+);
+
+// 交错梯度噪声：每个像素一个稳定的旋转角，相邻像素的角度差异大，少量采样的带状瑕疵变成细密的噪点
+float interleavedGradientNoise(vec2 pixel) {
+    return fract(52.9829189 * fract(dot(pixel, vec2(0.06711056, 0.00583715))));
+}
+
+// 原来的 3x3 网格：9 次读取深度并在着色器中比较
+float manualPCF(vec3 projCoords, int cascade, float compareDepth) {
+    float shadow = 0.0;
+    vec2 texelSize = 1.0 / vec2(textureSize(shadowDepth, 0).xy);
+    for(int x = -1; x <= 1; ++x) {
+        for(int y = -1; y <= 1; ++y) {
+            float pcfDepth = texture(shadowDepth, vec3(projCoords.xy + vec2(x, y) * texelSize, cascade)).r;
+            shadow += compareDepth > pcfDepth ? 1.0 : 0.0;
+        }
+    }
+    return shadow / 9.0;
+}
+
+// 旋转的泊松圆盘：每次硬件比较采样已经覆盖 2x2 个 texel。
+// 先取外圈的 4 个点，全部完全受光或完全在阴影中时认为整个区域一致，直接返回；
+// 只有阴影边缘上的像素继续取剩下的点（共 pcfTapCount 个）
+float poissonPCF(vec3 projCoords, int cascade, float compareDepth) {
+    vec2 texelSize = 1.0 / vec2(textureSize(shadowMap, 0).xy);
+    float angle = interleavedGradientNoise(gl_FragCoord.xy) * 6.28318531;
+    float s = sin(angle);
+    float c = cos(angle);
+    mat2 rotation = mat2(c, s, -s, c) * (pcfRadius * texelSize.x);
+    
+    float lit = 0.0;
+    for (int i = 0; i < 4; ++i) {
+        vec2 offset = rotation * poissonDisk[i];
+        lit += texture(shadowMap, vec4(projCoords.xy + offset, cascade, compareDepth));
+    }
+    if (lit == 0.0 || lit == 4.0) {
+        return 1.0 - lit * 0.25;
+    }
+    
+    for (int i = 4; i < pcfTapCount; ++i) {
+        vec2 offset = rotation * poissonDisk[i];
+        lit += texture(shadowMap, vec4(projCoords.xy + offset, cascade, compareDepth));
+    }
+    return 1.0 - lit / float(pcfTapCount);
+}
+
+// 切比雪夫不等式给出光照比例的上界；减去 lightBleedReduction 再重新映射到 [0,1]，
+// 把两个遮挡物重叠处被错误估计为半亮的区域（漏光）压暗，代价是半影变窄
+float chebyshevUpperBound(vec2 moments, float depth, float minVariance) {
+    if (depth <= moments.x) {
+        return 1.0;
+    }
+    float variance = max(moments.y - moments.x * moments.x, minVariance);
+    float d = depth - moments.x;
+    float pMax = variance / (variance + d * d);
+    return clamp((pMax - lightBleedReduction) / (1.0 - lightBleedReduction), 0.0, 1.0);
+}
+
+// VSM / EVSM：一次三线性（各向异性）采样模糊后的矩。
+// 采样位于非一致的控制流中，用世界坐标的屏幕导数算出显式梯度
+float momentShadow(vec3 projCoords, int cascade, vec2 gradX, vec2 gradY) {
+    vec4 moments = textureGrad(momentMap, vec3(projCoords.xy, cascade), gradX, gradY);
+    float depth = projCoords.z;
+    
+    if (shadowFilter == SHADOW_FILTER_EVSM) {
+        float warped = depth * 2.0 - 1.0;
+        float positive = exp(evsmPositiveExponent * warped);
+        float negative = -exp(-evsmNegativeExponent * warped);
+        // 方差下限按指数变换在该深度处的斜率缩放
+        float positiveDeviation = 2.0 * MIN_DEPTH_DEVIATION * evsmPositiveExponent * positive;
+        float negativeDeviation = 2.0 * MIN_DEPTH_DEVIATION * evsmNegativeExponent * -negative;
+        float positiveLit = chebyshevUpperBound(moments.xy, positive, positiveDeviation * positiveDeviation);
+        float negativeLit = chebyshevUpperBound(moments.zw, negative, negativeDeviation * negativeDeviation);
+        return 1.0 - min(positiveLit, negativeLit);
+    }
+    return 1.0 - chebyshevUpperBound(moments.xy, depth, MIN_DEPTH_DEVIATION * MIN_DEPTH_DEVIATION);
+}
+
+// 计算阴影；dPdx、dPdy 是世界坐标的屏幕导数，在一致的控制流中求出
+float ShadowCalculation(vec3 dPdx, vec3 dPdy) {
+    int cascade = selectCascade();
+    if (cascade >= cascadeCount) {
+        return 0.0;
+    }
+    
+    // 执行透视除法（正交投影的 w 为 1）
+    vec4 fragPosLightSpace = lightSpaceMatrices[cascade] * vec4(FragPos, 1.0);
     vec3 projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
     
     // 将坐标转换到 [0,1] 范围
     projCoords = projCoords * 0.5 + 0.5;
     
-    // 从阴影贴图中获取最近的深度
-    float closestDepth = texture(shadowMap, projCoords.xy).r;
+    // 如果投影坐标超出范围，不应用阴影
+    if(projCoords.z > 1.0) {
+        return 0.0;
+    }
     
-    // 获取当前片段在光源空间中的深度
-    float currentDepth = projCoords.z;
+    // 矩阴影不需要深度偏移，方差下限与漏光抑制处理自阴影
+    if (shadowFilter != SHADOW_FILTER_PCF) {
+        // 正交投影是线性的，导数直接用矩阵的 3x3 部分变换；[-1,1] 到 [0,1] 再乘 0.5
+        mat3 lightSpace = mat3(lightSpaceMatrices[cascade]);
+        return momentShadow(projCoords, cascade, (lightSpace * dPdx).xy * 0.5, (lightSpace * dPdy).xy * 0.5);
+    }
     
     // 计算阴影偏移，减少阴影失真
     vec3 normal = normalize(Normal);
-    vec3 lightDir = normalize(lightPos - FragPos);
+    vec3 lightDir = normalize(lightPos.xyz - FragPos);
     float bias = max(0.05 * (1.0 - dot(normal, lightDir)), 0.005);
+    float compareDepth = projCoords.z - bias;
     
-    // 计算PCF（百分比更近过滤）以获得更柔和的阴影
-    float shadow = 0.0;
-    vec2 texelSize = 1.0 / textureSize(shadowMap, 0);
-    for(int x = -1; x <= 1; ++x) {
-        for(int y = -1; y <= 1; ++y) {
-            float pcfDepth = texture(shadowMap, projCoords.xy + vec2(x, y) * texelSize).r;
-            shadow += currentDepth - bias > pcfDepth ? 1.0 : 0.0;
-        }
+    if (pcfMode == PCF_MANUAL) {
+        return manualPCF(projCoords, cascade, compareDepth);
     }
-    shadow /= 9.0;
-    
-    // 如果投影坐标超出范围，不应用阴影
-    if(projCoords.z > 1.0) {
-        shadow = 0.0;
-    }
-    
-    return shadow;
+    return poissonPCF(projCoords, cascade, compareDepth);
 }
 
 void main() {
@@ -55,23 +194,23 @@ void main() {
     
     // 环境光
     float ambientStrength = 0.1;
-    vec3 ambient = ambientStrength * lightColor;
+    vec3 ambient = ambientStrength * lightColor.rgb;
     
     // 漫反射
     vec3 norm = normalize(Normal);
-    vec3 lightDir = normalize(lightPos - FragPos);
+    vec3 lightDir = normalize(lightPos.xyz - FragPos);
     float diff = max(dot(norm, lightDir), 0.0);
-    vec3 diffuse = diff * lightColor;
+    vec3 diffuse = diff * lightColor.rgb;
     
     // 镜面反射
     float specularStrength = 0.5;
-    vec3 viewDir = normalize(viewPos - FragPos);
+    vec3 viewDir = normalize(viewPos.xyz - FragPos);
     vec3 reflectDir = reflect(-lightDir, norm);
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32);
-    vec3 specular = specularStrength * spec * lightColor;
+    vec3 specular = specularStrength * spec * lightColor.rgb;
     
     // 计算阴影
-    float shadow = ShadowCalculation(FragPosLightSpace);
+    float shadow = ShadowCalculation(dFdx(FragPos), dFdy(FragPos));
     
     // 最终颜色
     vec3 result = (ambient + (1.0 - shadow) * (diffuse + specular)) * objectColor;
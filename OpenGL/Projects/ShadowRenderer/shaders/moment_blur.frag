@@ -0,0 +1,27 @@
+#version 330 core
+
+// 可分离高斯模糊的一维：沿 direction 读取 2*radius+1 个 texel，超出贴图时取边缘的 texel
+#define MAX_BLUR_RADIUS 8
+
+uniform sampler2DArray source;
+uniform int layer;
+uniform ivec2 direction;
+uniform int radius;
+uniform float weights[MAX_BLUR_RADIUS + 1];
+
+out vec4 moments;
+
+void main()
+{
+    ivec2 lastTexel = textureSize(source, 0).xy - 1;
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    
+    vec4 sum = texelFetch(source, ivec3(texel, layer), 0) * weights[0];
+    for (int i = 1; i <= radius; ++i) {
+        ivec2 offset = direction * i;
+        vec4 forward = texelFetch(source, ivec3(min(texel + offset, lastTexel), layer), 0);
+        vec4 backward = texelFetch(source, ivec3(max(texel - offset, ivec2(0)), layer), 0);
+        sum += (forward + backward) * weights[i];
+    }
+    moments = sum;
+}
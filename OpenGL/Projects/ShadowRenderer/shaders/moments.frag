@@ -0,0 +1,46 @@
+#version 330 core
+
+// 矩阴影贴图的深度通道：几何着色器已经选好了层，这里输出深度的矩
+#define SHADOW_FILTER_VSM 1
+#define SHADOW_FILTER_EVSM 2
+
+// 每帧共享的相机、光源与级联参数（与 src/main.cpp 中的 FrameData 一致）
+#define MAX_CASCADES 4
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 lightSpaceMatrices[MAX_CASCADES];
+    vec4 cascadeSplits;
+    int cascadeCount;
+    int pcfMode;
+    int pcfTapCount;
+    float pcfRadius;
+    int shadowFilter;
+    float lightBleedReduction;
+    float evsmPositiveExponent;
+    float evsmNegativeExponent;
+    vec4 viewPos;
+    vec4 lightPos;
+    vec4 lightColor;
+};
+
+out vec4 moments;
+
+void main()
+{
+    // 正交投影下 gl_FragCoord.z 与到光源的距离成线性关系
+    float depth = gl_FragCoord.z;
+    
+    if (shadowFilter == SHADOW_FILTER_EVSM) {
+        // 深度变换到 [-1, 1] 后分别做正、负指数变换
+        float warped = depth * 2.0 - 1.0;
+        float positive = exp(evsmPositiveExponent * warped);
+        float negative = -exp(-evsmNegativeExponent * warped);
+        moments = vec4(positive, positive * positive, negative, negative * negative);
+    } else {
+        // 把像素内深度沿斜面的变化计入二阶矩，减少倾斜表面上的自阴影
+        float dx = dFdx(depth);
+        float dy = dFdy(depth);
+        moments = vec4(depth, depth * depth + 0.25 * (dx * dx + dy * dy), 0.0, 0.0);
+    }
+}
@@ -4,17 +4,35 @@ layout (location = 0) in vec3 aPos;
 
 out vec3 FragPos;
 out vec3 Normal;
-out vec4 FragPosLightSpace;
+out float ViewDepth;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-uniform mat4 lightSpaceMatrix;
+
+// 每帧共享的相机、光源与级联参数（与 src/main.cpp 中的 FrameData 一致）
+#define MAX_CASCADES 4
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 lightSpaceMatrices[MAX_CASCADES];
+    vec4 cascadeSplits;
+    int cascadeCount;
+    int pcfMode;
+    int pcfTapCount;
+    float pcfRadius;
+    int shadowFilter;
+    float lightBleedReduction;
+    float evsmPositiveExponent;
+    float evsmNegativeExponent;
+    vec4 viewPos;
+    vec4 lightPos;
+    vec4 lightColor;
+};
 
 void main()
 {
     FragPos = vec3(model * vec4(aPos, 1.0));
     Normal = mat3(transpose(inverse(model))) * vec3(0.0, 1.0, 0.0); // 假设所有物体都是朝上的
-    FragPosLightSpace = lightSpaceMatrix * vec4(FragPos, 1.0);
-    gl_Position = projection * view * vec4(FragPos, 1.0);
+    vec4 viewPosition = view * vec4(FragPos, 1.0);
+    ViewDepth = -viewPosition.z;
+    gl_Position = projection * viewPosition;
 }
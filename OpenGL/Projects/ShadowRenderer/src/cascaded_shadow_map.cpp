@@ -0,0 +1,155 @@
+// cascaded_shadow_map.cpp
+// 级联划分、texel 对齐的光源空间矩阵与分层深度帧缓冲
+
+#include "cascaded_shadow_map.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace {
+
+// 包围球之外、沿光源方向仍然可能投射阴影的距离
+const float SHADOW_CASTER_DISTANCE = 10.0f;
+
+// 包围球半径按 1/16 取整，避免浮点误差让投影大小每帧略有变化
+const float RADIUS_QUANTUM = 1.0f / 16.0f;
+
+// 视图空间中 [nearDepth, farDepth] 段的视锥体在世界空间中的包围球
+void sliceBoundingSphere(const glm::mat4& inverseView, float tanHalfFovy, float aspect, float nearDepth,
+                         float farDepth, glm::vec3& center, float& radius) {
+    glm::vec3 corners[8];
+    int corner = 0;
+    for (float depth : {nearDepth, farDepth}) {
+        float halfHeight = depth * tanHalfFovy;
+        float halfWidth = halfHeight * aspect;
+        for (float y : {-halfHeight, halfHeight}) {
+            for (float x : {-halfWidth, halfWidth}) {
+                corners[corner++] = glm::vec3(inverseView * glm::vec4(x, y, -depth, 1.0f));
+            }
+        }
+    }
+
+    center = glm::vec3(0.0f);
+    for (const glm::vec3& point : corners) {
+        center += point;
+    }
+    center /= 8.0f;
+
+    radius = 0.0f;
+    for (const glm::vec3& point : corners) {
+        radius = std::max(radius, glm::length(point - center));
+    }
+    radius = std::ceil(radius / RADIUS_QUANTUM) * RADIUS_QUANTUM;
+}
+
+} // namespace
+
+bool createCascadedShadowMap(CascadedShadowMap& shadowMap, int size, int cascadeCount) {
+    shadowMap.size = size;
+    shadowMap.cascadeCount = cascadeCount;
+
+    // 每个级联一层；超出阴影贴图的位置按最远深度处理（不在阴影中）
+    // 比较结果为参考深度不大于贴图深度的比例，即光照比例；线性过滤时由硬件对 4 个比较结果做双线性插值
+    float borderColor[] = {1.0f, 1.0f, 1.0f, 1.0f};
+    glGenTextures(1, &shadowMap.depthTexture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, shadowMap.depthTexture);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, size, size, cascadeCount, 0, GL_DEPTH_COMPONENT,
+                 GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+    glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, borderColor);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    // 绑定到另一个纹理单元时覆盖纹理自身的采样参数，直接读取最近的深度值
+    glGenSamplers(1, &shadowMap.depthSampler);
+    glSamplerParameteri(shadowMap.depthSampler, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glSamplerParameteri(shadowMap.depthSampler, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glSamplerParameteri(shadowMap.depthSampler, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+    glSamplerParameteri(shadowMap.depthSampler, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+    glSamplerParameterfv(shadowMap.depthSampler, GL_TEXTURE_BORDER_COLOR, borderColor);
+    glSamplerParameteri(shadowMap.depthSampler, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+
+    // 整个纹理数组作为分层附件，几何着色器用 gl_Layer 选择写入的层
+    glGenFramebuffers(1, &shadowMap.framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, shadowMap.framebuffer);
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, shadowMap.depthTexture, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    if (!complete) {
+        std::cerr << "Shadow map framebuffer is not complete!" << std::endl;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    return complete;
+}
+
+CascadeSetup computeCascades(const CascadedShadowMap& shadowMap, const glm::mat4& view, float fovy, float aspect,
+                             float nearPlane, float shadowDistance, const glm::vec3& lightDirection) {
+    CascadeSetup setup = {};
+    int count = shadowMap.cascadeCount;
+
+    // 实用划分方案：对数划分让每个级联的 texel 在屏幕上的大小接近，均匀划分避免第一段过短
+    float ratio = shadowDistance / nearPlane;
+    for (int i = 0; i < MAX_CASCADES; ++i) {
+        float fraction = float(std::min(i + 1, count)) / float(count);
+        float logSplit = nearPlane * std::pow(ratio, fraction);
+        float uniformSplit = nearPlane + (shadowDistance - nearPlane) * fraction;
+        setup.splits[i] = CASCADE_SPLIT_LAMBDA * logSplit + (1.0f - CASCADE_SPLIT_LAMBDA) * uniformSplit;
+    }
+
+    glm::mat4 inverseView = glm::inverse(view);
+    float tanHalfFovy = std::tan(fovy * 0.5f);
+    glm::vec3 direction = glm::normalize(lightDirection);
+    glm::vec3 up = std::abs(direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+
+    for (int i = 0; i < count; ++i) {
+        float sliceNear = i == 0 ? nearPlane : setup.splits[i - 1];
+        glm::vec3 center;
+        float radius;
+        sliceBoundingSphere(inverseView, tanHalfFovy, aspect, sliceNear, setup.splits[i], center, radius);
+
+        // 相机从包围球外沿光线方向看向球心，深度范围向光源一侧延伸，包含球外的遮挡物
+        glm::vec3 eye = center - direction * (radius + SHADOW_CASTER_DISTANCE);
+        glm::mat4 lightView = glm::lookAt(eye, center, up);
+        glm::mat4 lightProjection =
+            glm::ortho(-radius, radius, -radius, radius, 0.0f, 2.0f * radius + SHADOW_CASTER_DISTANCE);
+
+        // 把世界原点投影到阴影贴图上，平移投影使它落在 texel 网格上：
+        // 投影大小固定时，整个场景相对 texel 网格的位置只随整数个 texel 变化
+        glm::mat4 shadowMatrix = lightProjection * lightView;
+        float halfSize = shadowMap.size * 0.5f;
+        glm::vec4 origin = shadowMatrix * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+        glm::vec2 texelOrigin = glm::vec2(origin) * halfSize;
+        glm::vec2 offset = (glm::round(texelOrigin) - texelOrigin) / halfSize;
+        lightProjection[3][0] += offset.x;
+        lightProjection[3][1] += offset.y;
+
+        setup.lightSpaceMatrices[i] = lightProjection * lightView;
+    }
+    return setup;
+}
+
+void beginShadowPass(CascadedShadowMap& shadowMap) {
+    glBindFramebuffer(GL_FRAMEBUFFER, shadowMap.framebuffer);
+    glViewport(0, 0, shadowMap.size, shadowMap.size);
+    glClear(GL_DEPTH_BUFFER_BIT);
+}
+
+void endShadowPass(CascadedShadowMap&) {
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void destroyCascadedShadowMap(CascadedShadowMap& shadowMap) {
+    glDeleteSamplers(1, &shadowMap.depthSampler);
+    glDeleteFramebuffers(1, &shadowMap.framebuffer);
+    glDeleteTextures(1, &shadowMap.depthTexture);
+    shadowMap = CascadedShadowMap();
+}
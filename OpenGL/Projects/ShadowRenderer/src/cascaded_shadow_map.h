@@ -0,0 +1,52 @@
+// cascaded_shadow_map.h
+// 级联阴影贴图：相机视锥体按深度分成若干段，每段使用一张覆盖该段的正交阴影贴图
+//
+// 分段采用实用划分方案（对数划分与均匀划分按 CASCADE_SPLIT_LAMBDA 混合），近处的级联覆盖范围小、精度高。
+// 所有级联是一个 GL_TEXTURE_2D_ARRAY 的各层，深度通道只绘制一次场景，由几何着色器把每个三角形
+// 复制到各层（gl_Layer）。每个级联的投影范围取视锥体段的包围球，大小不随相机旋转变化，
+// 再把光源空间的原点对齐到阴影贴图的 texel 网格，相机移动时阴影边缘不会闪烁
+//
+// 深度纹理开启了比较模式（GL_COMPARE_REF_TO_TEXTURE）与线性过滤，作为 sampler2DArrayShadow 采样时
+// 每次采样由硬件比较相邻的 4 个 texel 并双线性插值；depthSampler 关闭比较，用于直接读取深度
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+// 级联数上限，与着色器中的 MAX_CASCADES 一致
+const int MAX_CASCADES = 4;
+
+// 对数划分所占的比例，其余为均匀划分
+const float CASCADE_SPLIT_LAMBDA = 0.75f;
+
+struct CascadedShadowMap {
+    GLuint framebuffer = 0;
+    GLuint depthTexture = 0;
+    GLuint depthSampler = 0;
+    int size = 0;
+    int cascadeCount = 0;
+};
+
+// 每帧计算的级联参数
+struct CascadeSetup {
+    // 世界空间到各级联阴影贴图裁剪空间的矩阵
+    glm::mat4 lightSpaceMatrices[MAX_CASCADES];
+    // 各级联远端的视图空间深度
+    float splits[MAX_CASCADES];
+};
+
+// 创建 cascadeCount 层、每层 size × size 的深度纹理数组与分层帧缓冲
+bool createCascadedShadowMap(CascadedShadowMap& shadowMap, int size, int cascadeCount);
+
+// 按相机的视图矩阵与透视参数，把 [nearPlane, shadowDistance] 划分为各级联并计算光源空间矩阵；
+// lightDirection 为光线的传播方向（从光源指向场景）
+CascadeSetup computeCascades(const CascadedShadowMap& shadowMap, const glm::mat4& view, float fovy, float aspect,
+                             float nearPlane, float shadowDistance, const glm::vec3& lightDirection);
+
+// 绑定分层帧缓冲并清除深度；之后用深度程序绘制一次场景，再调用 endShadowPass
+void beginShadowPass(CascadedShadowMap& shadowMap);
+void endShadowPass(CascadedShadowMap& shadowMap);
+
+void destroyCascadedShadowMap(CascadedShadowMap& shadowMap);
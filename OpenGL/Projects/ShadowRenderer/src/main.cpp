@@ -4,26 +4,101 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <iostream>
-#include <fstream>
-#include <sstream>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
 
-// 窗口尺寸
+#include "cascaded_shadow_map.h"
+#include "gpu_timer.h"
+#include "moment_shadow_map.h"
+#include "shader_program.h"
+
+// 默认窗口尺寸，可用 --resolution 指定（例如 1920x1080、3840x2160，用于测量片段着色的开销）
 const int WIDTH = 800;
 const int HEIGHT = 600;
 
-// 阴影贴图尺寸
-const int SHADOW_WIDTH = 1024;
-const int SHADOW_HEIGHT = 1024;
+// 每个级联的阴影贴图尺寸
+const int SHADOW_MAP_SIZE = 1024;
+
+// 相机的透视参数，级联按相机视锥体划分
+const float CAMERA_FOVY = glm::radians(45.0f);
+const float CAMERA_NEAR = 0.1f;
+const float CAMERA_FAR = 100.0f;
+
+// 计算阴影的最远视图空间深度，覆盖整个地面
+const float SHADOW_DISTANCE = 25.0f;
+
+// 阴影过滤方式，与 fragment.glsl 中的 SHADOW_FILTER_*、PCF_* 一致
+const int SHADOW_FILTER_PCF = 0;   // 深度贴图 + 比较采样（见 PCF_*）
+const int SHADOW_FILTER_VSM = 1;   // 方差阴影贴图，GL_RG32F
+const int SHADOW_FILTER_EVSM = 2;  // 指数方差阴影贴图，GL_RGBA16F
+const int SHADOW_FILTER_COUNT = 3;
+const int PCF_MANUAL = 0;   // 原来的 3x3 网格：9 次最近点深度读取，在着色器中比较
+const int PCF_POISSON = 1;  // 硬件比较 + 逐像素旋转的泊松圆盘
+const int PCF_MAX_TAPS = 16;
 
-// 着色器程序ID
-GLuint simpleDepthShader, shaderProgram;
+// 每帧共享的相机与光源，与两个程序中的 layout(std140) uniform FrameData 一致（std140 中 vec3 按 vec4 对齐）
+struct FrameData {
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 lightSpaceMatrices[MAX_CASCADES];
+    glm::vec4 cascadeSplits;
+    GLint cascadeCount;
+    GLint pcfMode;
+    GLint pcfTapCount;
+    float pcfRadius;
+    GLint shadowFilter;
+    float lightBleedReduction;
+    float evsmPositiveExponent;
+    float evsmNegativeExponent;
+    glm::vec4 viewPos;
+    glm::vec4 lightPos;
+    glm::vec4 lightColor;
+};
+const GLuint FRAME_DATA_BINDING = 0;
+
+// 着色器程序与缓存的 model 位置；momentDepthShader 与 simpleDepthShader 的区别只是写入矩的片段着色器
+ShaderProgram simpleDepthShader, momentDepthShader, shaderProgram;
+GLint depthModelLoc = -1;
+GLint momentModelLoc = -1;
+GLint sceneModelLoc = -1;
+
+// 每帧更新一次的 uniform 缓冲区，阴影与主渲染共用
+UniformBuffer frameUniforms;
 
 // VAO和VBO
 GLuint cubeVAO, cubeVBO, planeVAO, planeVBO;
 
-// 阴影贴图FBO
-GLuint depthMapFBO;
-GLuint depthMap;
+// 级联阴影贴图，级联数可用 --cascades 指定（1 即整个阴影距离只用一张贴图）
+CascadedShadowMap shadowMap;
+int cascadeCount = MAX_CASCADES;
+
+// 阴影过滤：--pcf manual|poisson，--pcf-taps N（4 到 PCF_MAX_TAPS），--pcf-radius R（单位为 texel）
+int pcfMode = PCF_POISSON;
+int pcfTapCount = PCF_MAX_TAPS;
+float pcfRadius = 1.5f;
+
+// 矩阴影：--shadow-filter pcf|vsm|evsm（运行时按 F 切换），--light-bleed R（运行时按 [ ] 调整），
+// --evsm-exponent C，--moment-blur N（texel）。两种矩贴图在第一次使用时创建
+int shadowFilter = SHADOW_FILTER_PCF;
+float lightBleedReduction = 0.2f;
+float evsmExponent = EVSM_MAX_EXPONENT;
+int momentBlurRadius = 2;
+MomentShadowMap vsmShadowMap;
+MomentShadowMap evsmShadowMap;
+
+// 窗口与帧缓冲尺寸（帧缓冲随窗口大小变化）
+int windowWidth = WIDTH;
+int windowHeight = HEIGHT;
+int framebufferWidth = WIDTH;
+int framebufferHeight = HEIGHT;
+
+// 阴影通道与光照通道的GPU耗时
+GpuTimer shadowTimer;
+GpuTimer blurTimer;
+GpuTimer lightingTimer;
 
 // 光源位置
 glm::vec3 lightPos = glm::vec3(5.0f, 10.0f, 5.0f);
@@ -35,72 +110,40 @@ glm::vec3 cameraPos = glm::vec3(0.0f, 5.0f, 10.0f);
 float rotateAngle = 0.0f;
 
 // 函数声明
-std::string readShaderFile(const char* filePath);
-GLuint compileShader(GLenum type, const char* source);
-GLuint createShaderProgram(const char* vertexPath, const char* fragmentPath);
+bool createShaderPrograms();
 void setupBuffers();
-void setupShadowMap();
-void renderScene(const GLuint& shaderProgram, const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection);
+void renderScene(GLint modelLoc);
+MomentShadowMap* activeMomentShadowMap();
 void renderShadowMap();
+void reportPassTimes();
 void render();
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void processInput(GLFWwindow* window);
+void renderMomentShadowMap(MomentShadowMap& map);
+bool keyPressed(GLFWwindow* window, int key, bool& wasDown);
 
-// 读取着色器文件
-std::string readShaderFile(const char* filePath) {
-    std::ifstream file(filePath);
-    if (!file.is_open()) {
-        std::cerr << "Failed to open shader file: " << filePath << std::endl;
-        return "";
-    }
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    return buffer.str();
-}
-
-// 编译着色器
-GLuint compileShader(GLenum type, const char* source) {
-    GLuint shader = glCreateShader(type);
-    glShaderSource(shader, 1, &source, NULL);
-    glCompileShader(shader);
-    
-    GLint success;
-    GLchar infoLog[512];
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(shader, 512, NULL, infoLog);
-        std::cerr << "Shader compilation failed: " << infoLog << std::endl;
-        return 0;
+// 创建着色器程序，所有程序都连接到同一个 FrameData 绑定点
+bool createShaderPrograms() {
+    if (!simpleDepthShader.load("shaders/simple_depth.vert", "shaders/simple_depth.geom", "shaders/simple_depth.frag") ||
+        !momentDepthShader.load("shaders/simple_depth.vert", "shaders/simple_depth.geom", "shaders/moments.frag") ||
+        !shaderProgram.load("shaders/vertex.glsl", "shaders/fragment.glsl")) {
+        return false;
     }
-    return shader;
-}
-
-// 创建着色器程序
-GLuint createShaderProgram(const char* vertexPath, const char* fragmentPath) {
-    std::string vertexCode = readShaderFile(vertexPath);
-    std::string fragmentCode = readShaderFile(fragmentPath);
-    
-    GLuint vertexShader = compileShader(GL_VERTEX_SHADER, vertexCode.c_str());
-    GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentCode.c_str());
-    
-    GLuint program = glCreateProgram();
-    glAttachShader(program, vertexShader);
-    glAttachShader(program, fragmentShader);
-    glLinkProgram(program);
-    
-    GLint success;
-    GLchar infoLog[512];
-    glGetProgramiv(program, GL_LINK_STATUS, &success);
-    if (!success) {
-        glGetProgramInfoLog(program, 512, NULL, infoLog);
-        std::cerr << "Program linking failed: " << infoLog << std::endl;
-        return 0;
-    }
-    
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
-    
-    return program;
+    simpleDepthShader.bindUniformBlock("FrameData", FRAME_DATA_BINDING, sizeof(FrameData));
+    momentDepthShader.bindUniformBlock("FrameData", FRAME_DATA_BINDING, sizeof(FrameData));
+    shaderProgram.bindUniformBlock("FrameData", FRAME_DATA_BINDING, sizeof(FrameData));
+    depthModelLoc = simpleDepthShader.uniformLocation("model");
+    momentModelLoc = momentDepthShader.uniformLocation("model");
+    sceneModelLoc = shaderProgram.uniformLocation("model");
+    
+    // 阴影贴图固定使用纹理单元 0（硬件比较）与 1（直接读取深度，只用于 --pcf manual），矩贴图使用单元 2
+    shaderProgram.use();
+    glUniform1i(shaderProgram.uniformLocation("shadowMap"), 0);
+    glUniform1i(shaderProgram.uniformLocation("shadowDepth"), 1);
+    glUniform1i(shaderProgram.uniformLocation("momentMap"), 2);
+    glUseProgram(0);
+    
+    return frameUniforms.create(sizeof(FrameData), FRAME_DATA_BINDING);
 }
 
 // 设置缓冲区
@@ -188,160 +231,301 @@ void setupBuffers() {
     glBindVertexArray(0);
 }
 
-// 设置阴影贴图
-void setupShadowMap() {
-    // 创建深度贴图
-    glGenTextures(1, &depthMap);
-    glBindTexture(GL_TEXTURE_2D, depthMap);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, SHADOW_WIDTH, SHADOW_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    
-    // 创建帧缓冲对象
-    glGenFramebuffers(1, &depthMapFBO);
-    glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthMap, 0);
-    glDrawBuffer(GL_NONE);
-    glReadBuffer(GL_NONE);
-    
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-        std::cerr << "Shadow map framebuffer is not complete!" << std::endl;
-    }
-    
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-}
-
-// 渲染场景
-void renderScene(const GLuint& shaderProgram, const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection) {
-    glUseProgram(shaderProgram);
-    
-    // 设置矩阵
-    GLint modelLoc = glGetUniformLocation(shaderProgram, "model");
-    GLint viewLoc = glGetUniformLocation(shaderProgram, "view");
-    GLint projectionLoc = glGetUniformLocation(shaderProgram, "projection");
-    
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-    glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, glm::value_ptr(projection));
-    
+// 渲染场景，当前程序的 model 位置由调用方给出
+void renderScene(GLint modelLoc) {
     // 渲染立方体
     glBindVertexArray(cubeVAO);
+    glm::mat4 cubeModel = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    cubeModel = glm::rotate(cubeModel, rotateAngle, glm::vec3(1.0f, 1.0f, 1.0f));
+    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(cubeModel));
     glDrawArrays(GL_TRIANGLES, 0, 36);
     
     // 渲染地面
     glBindVertexArray(planeVAO);
+    glm::mat4 planeModel = glm::mat4(1.0f);
+    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(planeModel));
     glDrawArrays(GL_TRIANGLES, 0, 6);
     
     glBindVertexArray(0);
 }
 
-// 渲染阴影贴图
-void renderShadowMap() {
-    // 使用阴影映射着色器
-    glUseProgram(simpleDepthShader);
-    
-    // 光源的正交投影矩阵
-    float near_plane = 1.0f;
-    float far_plane = 25.0f;
-    glm::mat4 lightProjection = glm::ortho(-10.0f, 10.0f, -10.0f, 10.0f, near_plane, far_plane);
-    
-    // 光源的视图矩阵
-    glm::mat4 lightView = glm::lookAt(lightPos, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+// 当前过滤方式使用的矩贴图，第一次使用时创建；创建失败时退回 PCF 并返回 nullptr
+MomentShadowMap* activeMomentShadowMap() {
+    if (shadowFilter == SHADOW_FILTER_PCF) {
+        return nullptr;
+    }
     
-    // 光源的MVP矩阵
-    glm::mat4 lightSpaceMatrix = lightProjection * lightView;
+    bool evsm = shadowFilter == SHADOW_FILTER_EVSM;
+    MomentShadowMap& map = evsm ? evsmShadowMap : vsmShadowMap;
+    if (map.momentTexture == 0 && !createMomentShadowMap(map, shadowMap, evsm ? GL_RGBA16F : GL_RG32F)) {
+        std::cerr << "Falling back to PCF shadows" << std::endl;
+        destroyMomentShadowMap(map);
+        shadowFilter = SHADOW_FILTER_PCF;
+        return nullptr;
+    }
+    return &map;
+}
+
+// 渲染矩阴影贴图：一次绘制写入所有级联的矩，再逐层模糊并生成 mip
+void renderMomentShadowMap(MomentShadowMap& map) {
+    // 最远深度（1）的矩，没有被任何物体覆盖的 texel 不产生阴影
+    GLfloat clearMoments[4] = {1.0f, 1.0f, 0.0f, 0.0f};
+    if (shadowFilter == SHADOW_FILTER_EVSM) {
+        float positive = std::exp(evsmExponent);
+        float negative = -std::exp(-evsmExponent);
+        clearMoments[0] = positive;
+        clearMoments[1] = positive * positive;
+        clearMoments[2] = negative;
+        clearMoments[3] = negative * negative;
+    }
     
-    // 设置光源空间矩阵
-    GLint lightSpaceMatrixLoc = glGetUniformLocation(simpleDepthShader, "lightSpaceMatrix");
-    glUniformMatrix4fv(lightSpaceMatrixLoc, 1, GL_FALSE, glm::value_ptr(lightSpaceMatrix));
+    momentDepthShader.use();
+    beginGpuTimer(shadowTimer);
+    beginMomentPass(map, clearMoments);
+    renderScene(momentModelLoc);
+    endMomentPass(map);
+    endGpuTimer(shadowTimer);
+    
+    beginGpuTimer(blurTimer);
+    blurMomentShadowMap(map, momentBlurRadius);
+    endGpuTimer(blurTimer);
+    glViewport(0, 0, framebufferWidth, framebufferHeight);
+}
+
+// 渲染阴影贴图：一次绘制写入所有级联
+void renderShadowMap() {
+    MomentShadowMap* momentMap = activeMomentShadowMap();
+    if (momentMap) {
+        renderMomentShadowMap(*momentMap);
+        return;
+    }
     
-    // 渲染到深度贴图
-    glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
-    glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
-    glClear(GL_DEPTH_BUFFER_BIT);
+    // 使用阴影映射着色器，各级联的光源空间矩阵来自 FrameData
+    simpleDepthShader.use();
+    beginGpuTimer(shadowTimer);
+    beginShadowPass(shadowMap);
     
     // 启用多边形偏移，减少阴影失真
     glEnable(GL_POLYGON_OFFSET_FILL);
     glPolygonOffset(1.0f, 2.0f);
     
-    // 渲染立方体
-    glBindVertexArray(cubeVAO);
-    glm::mat4 cubeModel = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-    cubeModel = glm::rotate(cubeModel, rotateAngle, glm::vec3(1.0f, 1.0f, 1.0f));
-    GLint modelLoc = glGetUniformLocation(simpleDepthShader, "model");
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(cubeModel));
-    glDrawArrays(GL_TRIANGLES, 0, 36);
-    
-    // 渲染地面
-    glBindVertexArray(planeVAO);
-    glm::mat4 planeModel = glm::mat4(1.0f);
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(planeModel));
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+    renderScene(depthModelLoc);
     
     // 禁用多边形偏移
     glDisable(GL_POLYGON_OFFSET_FILL);
     
     // 恢复默认帧缓冲和视口
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glViewport(0, 0, WIDTH, HEIGHT);
+    endShadowPass(shadowMap);
+    endGpuTimer(shadowTimer);
+    glViewport(0, 0, framebufferWidth, framebufferHeight);
+}
+
+// 累计两个通道的GPU耗时，每秒输出一次每帧平均值；光照通道的耗时主要是片段着色中的阴影过滤
+void reportPassTimes() {
+    static double lastReportTime = glfwGetTime();
+    static double shadowMilliseconds = 0.0;
+    static double blurMilliseconds = 0.0;
+    static double lightingMilliseconds = 0.0;
+    static int frames = 0;
+    
+    shadowMilliseconds += shadowTimer.milliseconds;
+    blurMilliseconds += shadowFilter == SHADOW_FILTER_PCF ? 0.0 : blurTimer.milliseconds;
+    lightingMilliseconds += lightingTimer.milliseconds;
+    frames++;
+    
+    double now = glfwGetTime();
+    if (now - lastReportTime >= 1.0) {
+        double shadowAverage = shadowMilliseconds / frames;
+        double lightingAverage = lightingMilliseconds / frames;
+        std::string filter;
+        if (shadowFilter == SHADOW_FILTER_PCF) {
+            filter = pcfMode == PCF_MANUAL ? std::string("manual 3x3") : std::to_string(pcfTapCount) + "-tap Poisson";
+        } else {
+            filter = std::string(shadowFilter == SHADOW_FILTER_VSM ? "VSM" : "EVSM") + ", bleed " +
+                     std::to_string(lightBleedReduction).substr(0, 4);
+        }
+        std::cout << "Shadow pass (" << cascadeCount << " x " << SHADOW_MAP_SIZE << "^2): " << shadowAverage
+                  << " ms, " << shadowAverage / cascadeCount << " ms per cascade";
+        if (shadowFilter != SHADOW_FILTER_PCF) {
+            std::cout << ", blur + mips (radius " << momentBlurRadius << "): " << blurMilliseconds / frames << " ms";
+        }
+        std::cout << "; lighting pass (" << framebufferWidth << "x" << framebufferHeight << ", " << filter
+                  << "): " << lightingAverage << " ms" << std::endl;
+        shadowMilliseconds = 0.0;
+        blurMilliseconds = 0.0;
+        lightingMilliseconds = 0.0;
+        frames = 0;
+        lastReportTime = now;
+    }
 }
 
 // 渲染
 void render() {
-    // 渲染阴影贴图
+    // 每帧的相机、光源与级联参数只写入一次，两个渲染通道共用
+    FrameData frame = {};
+    frame.view = glm::lookAt(cameraPos, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    float aspect = (float)framebufferWidth / (float)framebufferHeight;
+    frame.projection = glm::perspective(CAMERA_FOVY, aspect, CAMERA_NEAR, CAMERA_FAR);
+    
+    // 平行光从光源位置照向原点
+    CascadeSetup cascades = computeCascades(shadowMap, frame.view, CAMERA_FOVY, aspect, CAMERA_NEAR,
+                                            SHADOW_DISTANCE, -lightPos);
+    for (int i = 0; i < MAX_CASCADES; ++i) {
+        frame.lightSpaceMatrices[i] = cascades.lightSpaceMatrices[i];
+        frame.cascadeSplits[i] = cascades.splits[i];
+    }
+    frame.cascadeCount = cascadeCount;
+    frame.pcfMode = pcfMode;
+    frame.pcfTapCount = pcfTapCount;
+    frame.pcfRadius = pcfRadius;
+    frame.shadowFilter = shadowFilter;
+    frame.lightBleedReduction = lightBleedReduction;
+    frame.evsmPositiveExponent = evsmExponent;
+    frame.evsmNegativeExponent = evsmExponent;
+    frame.viewPos = glm::vec4(cameraPos, 1.0f);
+    frame.lightPos = glm::vec4(lightPos, 1.0f);
+    frame.lightColor = glm::vec4(1.0f, 1.0f, 1.0f, 0.0f);
+    frameUniforms.update(frame);
+    
+    // 渲染阴影贴图；矩贴图第一次创建失败时会把 shadowFilter 改回 PCF，FrameData 需要重新写入
     renderShadowMap();
+    if (frame.shadowFilter != shadowFilter) {
+        frame.shadowFilter = shadowFilter;
+        frameUniforms.update(frame);
+    }
+    
+    beginGpuTimer(lightingTimer);
     
     // 清除颜色和深度缓冲
     glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     
-    // 使用主着色器
-    glUseProgram(shaderProgram);
-    
-    // 设置相机视图和投影矩阵
-    glm::mat4 view = glm::lookAt(cameraPos, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-    glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)WIDTH / (float)HEIGHT, 0.1f, 100.0f);
-    
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "view"), 1, GL_FALSE, glm::value_ptr(view));
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
-    
-    // 设置相机位置
-    glUniform3fv(glGetUniformLocation(shaderProgram, "viewPos"), 1, glm::value_ptr(cameraPos));
-    
-    // 设置光源参数
-    glUniform3fv(glGetUniformLocation(shaderProgram, "lightPos"), 1, glm::value_ptr(lightPos));
-    glUniform3fv(glGetUniformLocation(shaderProgram, "lightColor"), 1, glm::value_ptr(glm::vec3(1.0f, 1.0f, 1.0f)));
+    // 使用主着色器；同一张深度纹理在单元 1 上由采样器对象关闭比较
+    shaderProgram.use();
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, shadowMap.depthTexture);
+    glBindSampler(1, shadowMap.depthSampler);
+    if (MomentShadowMap* momentMap = activeMomentShadowMap()) {
+        glActiveTexture(GL_TEXTURE2);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, momentMap->momentTexture);
+    }
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, shadowMap.depthTexture);
     
-    // 渲染立方体
-    glBindVertexArray(cubeVAO);
-    glm::mat4 cubeModel = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-    cubeModel = glm::rotate(cubeModel, rotateAngle, glm::vec3(1.0f, 1.0f, 1.0f));
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(cubeModel));
-    glDrawArrays(GL_TRIANGLES, 0, 36);
+    renderScene(sceneModelLoc);
     
-    // 渲染地面
-    glBindVertexArray(planeVAO);
-    glm::mat4 planeModel = glm::mat4(1.0f);
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(planeModel));
-    glDrawArrays(GL_TRIANGLES, 0, 6);
-    
-    glBindVertexArray(0);
+    endGpuTimer(lightingTimer);
+    reportPassTimes();
 }
 
 // 窗口大小变化回调
 void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
+    // 最小化时大小为 0，保留原来的尺寸
+    if (width <= 0 || height <= 0) {
+        return;
+    }
+    framebufferWidth = width;
+    framebufferHeight = height;
     glViewport(0, 0, width, height);
 }
 
-// 处理输入
+// 按键刚按下的一帧返回 true
+bool keyPressed(GLFWwindow* window, int key, bool& wasDown) {
+    bool down = glfwGetKey(window, key) == GLFW_PRESS;
+    bool pressed = down && !wasDown;
+    wasDown = down;
+    return pressed;
+}
+
+// 处理输入：F 切换阴影过滤方式，[ 与 ] 调整矩阴影的漏光抑制
 void processInput(GLFWwindow* window) {
+    static bool filterKeyDown = false;
+    static bool decreaseKeyDown = false;
+    static bool increaseKeyDown = false;
+    
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
+    
+    if (keyPressed(window, GLFW_KEY_F, filterKeyDown)) {
+        shadowFilter = (shadowFilter + 1) % SHADOW_FILTER_COUNT;
+        const char* names[SHADOW_FILTER_COUNT] = {"PCF", "VSM", "EVSM"};
+        std::cout << "Shadow filter: " << names[shadowFilter] << std::endl;
+    }
+    
+    bool decrease = keyPressed(window, GLFW_KEY_LEFT_BRACKET, decreaseKeyDown);
+    bool increase = keyPressed(window, GLFW_KEY_RIGHT_BRACKET, increaseKeyDown);
+    if (decrease || increase) {
+        lightBleedReduction += increase ? 0.05f : -0.05f;
+        lightBleedReduction = glm::clamp(lightBleedReduction, 0.0f, 0.95f);
+        std::cout << "Light bleeding reduction: " << lightBleedReduction << std::endl;
+    }
 }
 
-int main() {
+int main(int argc, char** argv) {
+    // 命令行参数：--cascades N 指定级联数（1 到 MAX_CASCADES），用于与单张阴影贴图对比；
+    // --resolution WxH 指定窗口尺寸；--pcf manual 使用原来的 3x3 手动比较，poisson（默认）使用硬件比较的泊松圆盘，
+    // --pcf-taps N 与 --pcf-radius R 指定泊松圆盘的采样数与半径（texel）；
+    // --shadow-filter vsm|evsm 使用模糊后的矩阴影贴图，--light-bleed R（0 到 0.95）、--evsm-exponent C、
+    // --moment-blur N 分别指定漏光抑制、EVSM 指数与模糊半径
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--cascades") == 0 && i + 1 < argc) {
+            cascadeCount = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--resolution") == 0 && i + 1 < argc &&
+                   std::sscanf(argv[i + 1], "%dx%d", &windowWidth, &windowHeight) == 2) {
+            ++i;
+        } else if (std::strcmp(argv[i], "--pcf") == 0 && i + 1 < argc &&
+                   (std::strcmp(argv[i + 1], "manual") == 0 || std::strcmp(argv[i + 1], "poisson") == 0)) {
+            pcfMode = std::strcmp(argv[++i], "manual") == 0 ? PCF_MANUAL : PCF_POISSON;
+        } else if (std::strcmp(argv[i], "--pcf-taps") == 0 && i + 1 < argc) {
+            pcfTapCount = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--pcf-radius") == 0 && i + 1 < argc) {
+            pcfRadius = (float)std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--shadow-filter") == 0 && i + 1 < argc &&
+                   (std::strcmp(argv[i + 1], "pcf") == 0 || std::strcmp(argv[i + 1], "vsm") == 0 ||
+                    std::strcmp(argv[i + 1], "evsm") == 0)) {
+            ++i;
+            shadowFilter = std::strcmp(argv[i], "pcf") == 0   ? SHADOW_FILTER_PCF
+                           : std::strcmp(argv[i], "vsm") == 0 ? SHADOW_FILTER_VSM
+                                                              : SHADOW_FILTER_EVSM;
+        } else if (std::strcmp(argv[i], "--light-bleed") == 0 && i + 1 < argc) {
+            lightBleedReduction = (float)std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--evsm-exponent") == 0 && i + 1 < argc) {
+            evsmExponent = (float)std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--moment-blur") == 0 && i + 1 < argc) {
+            momentBlurRadius = std::atoi(argv[++i]);
+        } else {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--cascades N] [--resolution WxH] [--pcf manual|poisson] [--pcf-taps N] [--pcf-radius R]"
+                      << " [--shadow-filter pcf|vsm|evsm] [--light-bleed R] [--evsm-exponent C] [--moment-blur N]"
+                      << std::endl;
+            return -1;
+        }
+    }
+    if (cascadeCount < 1 || cascadeCount > MAX_CASCADES) {
+        std::cerr << "Cascade count must be between 1 and " << MAX_CASCADES << std::endl;
+        return -1;
+    }
+    if (pcfTapCount < 4 || pcfTapCount > PCF_MAX_TAPS) {
+        std::cerr << "PCF tap count must be between 4 and " << PCF_MAX_TAPS << std::endl;
+        return -1;
+    }
+    if (lightBleedReduction < 0.0f || lightBleedReduction > 0.95f) {
+        std::cerr << "Light bleeding reduction must be between 0 and 0.95" << std::endl;
+        return -1;
+    }
+    if (evsmExponent <= 0.0f || evsmExponent > EVSM_MAX_EXPONENT) {
+        std::cerr << "EVSM exponent must be in (0, " << EVSM_MAX_EXPONENT << "]" << std::endl;
+        return -1;
+    }
+    if (momentBlurRadius < 0 || momentBlurRadius > MOMENT_MAX_BLUR_RADIUS) {
+        std::cerr << "Moment blur radius must be between 0 and " << MOMENT_MAX_BLUR_RADIUS << std::endl;
+        return -1;
+    }
+    if (windowWidth <= 0 || windowHeight <= 0) {
+        std::cerr << "Invalid resolution" << std::endl;
+        return -1;
+    }
+    
     // 初始化GLFW
     if (!glfwInit()) {
         std::cerr << "Failed to initialize GLFW" << std::endl;
@@ -354,7 +538,7 @@ int main() {
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
     
     // 创建窗口
-    GLFWwindow* window = glfwCreateWindow(WIDTH, HEIGHT, "Shadow Renderer", NULL, NULL);
+    GLFWwindow* window = glfwCreateWindow(windowWidth, windowHeight, "Shadow Renderer", NULL, NULL);
     if (!window) {
         std::cerr << "Failed to create GLFW window" << std::endl;
         glfwTerminate();
@@ -364,8 +548,9 @@ int main() {
     // 设置当前上下文
     glfwMakeContextCurrent(window);
     
-    // 设置窗口大小变化回调
+    // 设置窗口大小变化回调；高 DPI 屏幕上帧缓冲可能大于窗口
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+    glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
     
     // 初始化GLEW
     if (glewInit() != GLEW_OK) {
@@ -374,26 +559,22 @@ int main() {
     }
     
     // 创建着色器程序
-    simpleDepthShader = createShaderProgram(
-        "shaders/simple_depth.vert",
-        "shaders/simple_depth.frag"
-    );
-    
-    shaderProgram = createShaderProgram(
-        "shaders/vertex.glsl",
-        "shaders/fragment.glsl"
-    );
-    
-    if (!simpleDepthShader || !shaderProgram) {
+    if (!createShaderPrograms()) {
         std::cerr << "Failed to create shader programs" << std::endl;
         return -1;
     }
+    reportShaderCacheStats();
     
     // 设置缓冲区
     setupBuffers();
     
     // 设置阴影贴图
-    setupShadowMap();
+    if (!createCascadedShadowMap(shadowMap, SHADOW_MAP_SIZE, cascadeCount)) {
+        return -1;
+    }
+    createGpuTimer(shadowTimer);
+    createGpuTimer(blurTimer);
+    createGpuTimer(lightingTimer);
     
     // 启用深度测试
     glEnable(GL_DEPTH_TEST);
@@ -429,10 +610,16 @@ int main() {
     glDeleteBuffers(1, &cubeVBO);
     glDeleteVertexArrays(1, &planeVAO);
     glDeleteBuffers(1, &planeVBO);
-    glDeleteTextures(1, &depthMap);
-    glDeleteFramebuffers(1, &depthMapFBO);
-    glDeleteProgram(simpleDepthShader);
-    glDeleteProgram(shaderProgram);
+    destroyMomentShadowMap(vsmShadowMap);
+    destroyMomentShadowMap(evsmShadowMap);
+    destroyCascadedShadowMap(shadowMap);
+    destroyGpuTimer(shadowTimer);
+    destroyGpuTimer(blurTimer);
+    destroyGpuTimer(lightingTimer);
+    simpleDepthShader.destroy();
+    momentDepthShader.destroy();
+    shaderProgram.destroy();
+    frameUniforms.destroy();
     
     // 终止GLFW
     glfwTerminate();
@@ -0,0 +1,173 @@
+// moment_shadow_map.cpp
+// 矩纹理数组、分层帧缓冲与逐层的可分离高斯模糊
+
+#include "moment_shadow_map.h"
+
+#include <cmath>
+#include <iostream>
+
+namespace {
+
+// 矩纹理的 mip 层数，一直到 1x1
+int mipLevelCount(int size) {
+    int levels = 1;
+    while (size > 1) {
+        size /= 2;
+        levels++;
+    }
+    return levels;
+}
+
+bool checkFramebuffer(const char* name) {
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << name << " framebuffer is not complete!" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// 以 source 的第 layer 层为输入，沿 direction 做一维模糊，写入当前绑定的帧缓冲
+void blurPass(MomentShadowMap& map, GLuint source, int layer, int dx, int dy) {
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, source);
+    glUniform1i(map.layerLocation, layer);
+    glUniform2i(map.directionLocation, dx, dy);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+}
+
+} // namespace
+
+bool createMomentShadowMap(MomentShadowMap& map, const CascadedShadowMap& shadowMap, GLenum format) {
+    map.format = format;
+    map.size = shadowMap.size;
+    map.cascadeCount = shadowMap.cascadeCount;
+
+    if (!map.blurProgram.load("shaders/moment_blur.vert", "shaders/moment_blur.frag")) {
+        return false;
+    }
+    map.sourceLocation = map.blurProgram.uniformLocation("source");
+    map.layerLocation = map.blurProgram.uniformLocation("layer");
+    map.directionLocation = map.blurProgram.uniformLocation("direction");
+    map.radiusLocation = map.blurProgram.uniformLocation("radius");
+    map.weightsLocation = map.blurProgram.uniformLocation("weights");
+
+    GLenum components = format == GL_RG32F ? GL_RG : GL_RGBA;
+
+    // 矩纹理数组：三线性过滤，mip 由 glGenerateMipmap 分配
+    glGenTextures(1, &map.momentTexture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, map.momentTexture);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, format, map.size, map.size, map.cascadeCount, 0, components, GL_FLOAT,
+                 NULL);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, mipLevelCount(map.size) - 1);
+    if (GLEW_EXT_texture_filter_anisotropic) {
+        // 掠射角下阴影贴图在屏幕上被强烈压缩，各向异性过滤避免远处的阴影糊成一片
+        GLfloat maxAnisotropy = 1.0f;
+        glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &maxAnisotropy);
+        glTexParameterf(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_ANISOTROPY_EXT, std::fmin(maxAnisotropy, 8.0f));
+    }
+    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+
+    // 模糊的中间结果只需要一层
+    glGenTextures(1, &map.blurTexture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, map.blurTexture);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, format, map.size, map.size, 1, 0, components, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, 0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    bool complete = true;
+
+    // 矩与深度都作为分层附件，几何着色器的 gl_Layer 同时选择两者的层
+    glGenFramebuffers(1, &map.framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, map.framebuffer);
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, map.momentTexture, 0);
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, shadowMap.depthTexture, 0);
+    complete = checkFramebuffer("Moment shadow map") && complete;
+
+    glGenFramebuffers(map.cascadeCount, map.layerFramebuffers);
+    for (int layer = 0; layer < map.cascadeCount; ++layer) {
+        glBindFramebuffer(GL_FRAMEBUFFER, map.layerFramebuffers[layer]);
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, map.momentTexture, 0, layer);
+        complete = checkFramebuffer("Moment blur layer") && complete;
+    }
+
+    glGenFramebuffers(1, &map.blurFramebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, map.blurFramebuffer);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, map.blurTexture, 0, 0);
+    complete = checkFramebuffer("Moment blur") && complete;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    // 全屏三角形由 gl_VertexID 生成，核心模式下仍然需要绑定一个 VAO
+    glGenVertexArrays(1, &map.emptyVAO);
+
+    map.blurProgram.use();
+    glUniform1i(map.sourceLocation, 0);
+    glUseProgram(0);
+
+    return complete;
+}
+
+void beginMomentPass(MomentShadowMap& map, const GLfloat clearMoments[4]) {
+    glBindFramebuffer(GL_FRAMEBUFFER, map.framebuffer);
+    glViewport(0, 0, map.size, map.size);
+    // 分层附件的清除作用于所有层
+    glClearBufferfv(GL_COLOR, 0, clearMoments);
+    glClear(GL_DEPTH_BUFFER_BIT);
+}
+
+void endMomentPass(MomentShadowMap&) {
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void blurMomentShadowMap(MomentShadowMap& map, int radius) {
+    if (radius > 0) {
+        // 离散高斯权重，sigma 取半径的一半，归一化使总和为 1
+        GLfloat weights[MOMENT_MAX_BLUR_RADIUS + 1] = {};
+        float sigma = radius * 0.5f;
+        float sum = 0.0f;
+        for (int i = 0; i <= radius; ++i) {
+            weights[i] = std::exp(-float(i * i) / (2.0f * sigma * sigma));
+            sum += i == 0 ? weights[i] : 2.0f * weights[i];
+        }
+        for (int i = 0; i <= radius; ++i) {
+            weights[i] /= sum;
+        }
+
+        glDisable(GL_DEPTH_TEST);
+        glViewport(0, 0, map.size, map.size);
+        map.blurProgram.use();
+        glUniform1i(map.radiusLocation, radius);
+        glUniform1fv(map.weightsLocation, radius + 1, weights);
+        glBindVertexArray(map.emptyVAO);
+
+        for (int layer = 0; layer < map.cascadeCount; ++layer) {
+            glBindFramebuffer(GL_FRAMEBUFFER, map.blurFramebuffer);
+            blurPass(map, map.momentTexture, layer, 1, 0);
+            glBindFramebuffer(GL_FRAMEBUFFER, map.layerFramebuffers[layer]);
+            blurPass(map, map.blurTexture, 0, 0, 1);
+        }
+
+        glBindVertexArray(0);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glEnable(GL_DEPTH_TEST);
+    }
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, map.momentTexture);
+    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+void destroyMomentShadowMap(MomentShadowMap& map) {
+    glDeleteFramebuffers(1, &map.framebuffer);
+    glDeleteFramebuffers(MAX_CASCADES, map.layerFramebuffers);
+    glDeleteFramebuffers(1, &map.blurFramebuffer);
+    glDeleteTextures(1, &map.momentTexture);
+    glDeleteTextures(1, &map.blurTexture);
+    glDeleteVertexArrays(1, &map.emptyVAO);
+    map = MomentShadowMap();
+}
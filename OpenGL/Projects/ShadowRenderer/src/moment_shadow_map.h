@@ -0,0 +1,54 @@
+// moment_shadow_map.h
+// 矩阴影贴图（VSM / EVSM）：深度通道写入深度的矩而不是只写深度，矩可以像普通纹理一样模糊与生成 mip，
+// 光照时一次三线性采样加切比雪夫不等式就得到光照比例，宽的软阴影不需要 N 次比较采样
+//
+// VSM 使用 GL_RG32F 存 (d, d²)；EVSM 使用 GL_RGBA16F 存正负两个指数变换后的深度及其平方，
+// 指数越大漏光越少，16 位浮点下指数不能超过 EVSM_MAX_EXPONENT。
+// 每个级联一层，深度测试借用 CascadedShadowMap 的深度纹理数组。模糊是可分离的高斯，
+// GL 3.3 没有计算着色器，逐层用两次全屏三角形完成（水平写入中间纹理，垂直写回），最后生成 mip
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include "cascaded_shadow_map.h"
+#include "shader_program.h"
+
+// 模糊半径上限（texel），与 moment_blur.frag 中的 MAX_BLUR_RADIUS 一致
+const int MOMENT_MAX_BLUR_RADIUS = 8;
+
+// exp(2c) 不能超过半精度浮点的最大值 65504
+const float EVSM_MAX_EXPONENT = 5.54f;
+
+struct MomentShadowMap {
+    // 分层帧缓冲：矩纹理数组为颜色附件，级联深度纹理数组为深度附件
+    GLuint framebuffer = 0;
+    GLuint momentTexture = 0;
+    // 模糊用：每层一个只附加该层的帧缓冲，以及单层的中间纹理
+    GLuint layerFramebuffers[MAX_CASCADES] = {};
+    GLuint blurFramebuffer = 0;
+    GLuint blurTexture = 0;
+    GLuint emptyVAO = 0;
+    ShaderProgram blurProgram;
+    GLint sourceLocation = -1;
+    GLint layerLocation = -1;
+    GLint directionLocation = -1;
+    GLint radiusLocation = -1;
+    GLint weightsLocation = -1;
+
+    GLenum format = 0;
+    int size = 0;
+    int cascadeCount = 0;
+};
+
+// 按 shadowMap 的尺寸与级联数创建 format（GL_RG32F 或 GL_RGBA16F）的矩纹理数组
+bool createMomentShadowMap(MomentShadowMap& map, const CascadedShadowMap& shadowMap, GLenum format);
+
+// 绑定分层帧缓冲，矩清除为 clearMoments（最远深度的矩），深度清除为 1；之后用矩程序绘制一次场景
+void beginMomentPass(MomentShadowMap& map, const GLfloat clearMoments[4]);
+void endMomentPass(MomentShadowMap& map);
+
+// 对每层做半径为 radius 的可分离高斯模糊（0 不模糊），然后重新生成 mip
+void blurMomentShadowMap(MomentShadowMap& map, int radius);
+
+void destroyMomentShadowMap(MomentShadowMap& map);
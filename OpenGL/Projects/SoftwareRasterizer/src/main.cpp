@@ -0,0 +1,363 @@
+// main.cpp
+// 软件光栅化器的命令行入口：无需GPU与窗口，离屏渲染 OpenGL 项目中的立方体/地面场景并报告吞吐量
+//
+// 用法:
+//   software_rasterizer [--scene advanced|shadow] [--cubes N] [--width W] [--height H]
+//                       [--threads T] [--frames F] [--output file.ppm]
+//
+// advanced 为 AdvancedRenderer 的彩色旋转立方体；shadow 为 ShadowRenderer 的立方体与地面（逐顶点 Phong 光照，不计算阴影），
+// --cubes N 在 shadow 场景的地面上均匀摆放 N x N 个旋转的小立方体以增加负载
+// 动画按固定的 60 帧/秒推进，统计时跳过第一帧（预热），最后一帧写入 --output
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "image_io.h"
+#include "job_system.h"
+#include "rasterizer.h"
+
+namespace {
+
+const float FRAME_TIME = 1.0f / 60.0f;
+
+// 命令行数值参数的上限，防止误输入时分配过多内存或线程
+const uint32_t MAX_CUBE_GRID = 256;
+const uint32_t MAX_IMAGE_SIZE = 16384;
+const uint32_t MAX_THREADS = 256;
+const uint32_t MAX_FRAMES = 100000;
+
+struct Options {
+    std::string scene = "shadow";
+    uint32_t cubeGrid = 0;
+    uint32_t width = 800;
+    uint32_t height = 600;
+    unsigned int threadCount = 0;
+    uint32_t frameCount = 60;
+    std::string output = "software_rasterizer.ppm";
+};
+
+// 场景中的一个物体：模型空间顶点，以及本帧经过光照后提交给光栅化器的顶点
+struct SceneObject {
+    std::vector<RasterVertex> modelVertices;
+    std::vector<RasterVertex> vertices;
+    glm::mat4 model = glm::mat4(1.0f);
+};
+
+struct Scene {
+    std::vector<SceneObject> objects;
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::vec3 cameraPos;
+    glm::vec3 clearColor;
+    bool lit = false;
+};
+
+// 与 AdvancedRenderer 相同的立方体（位置与颜色）
+const float CUBE_VERTICES[] = {
+    -0.5f, -0.5f, -0.5f,  0.0f, 0.0f, 0.0f,
+     0.5f, -0.5f, -0.5f,  1.0f, 0.0f, 0.0f,
+     0.5f,  0.5f, -0.5f,  1.0f, 1.0f, 0.0f,
+     0.5f,  0.5f, -0.5f,  1.0f, 1.0f, 0.0f,
+    -0.5f,  0.5f, -0.5f,  0.0f, 1.0f, 0.0f,
+    -0.5f, -0.5f, -0.5f,  0.0f, 0.0f, 0.0f,
+
+    -0.5f, -0.5f,  0.5f,  0.0f, 0.0f, 0.0f,
+     0.5f, -0.5f,  0.5f,  1.0f, 0.0f, 0.0f,
+     0.5f,  0.5f,  0.5f,  1.0f, 1.0f, 0.0f,
+     0.5f,  0.5f,  0.5f,  1.0f, 1.0f, 0.0f,
+    -0.5f,  0.5f,  0.5f,  0.0f, 1.0f, 0.0f,
+    -0.5f, -0.5f,  0.5f,  0.0f, 0.0f, 0.0f,
+
+    -0.5f,  0.5f,  0.5f,  1.0f, 0.0f, 0.0f,
+    -0.5f,  0.5f, -0.5f,  1.0f, 1.0f, 0.0f,
+    -0.5f, -0.5f, -0.5f,  0.0f, 1.0f, 0.0f,
+    -0.5f, -0.5f, -0.5f,  0.0f, 1.0f, 0.0f,
+    -0.5f, -0.5f,  0.5f,  0.0f, 0.0f, 0.0f,
+    -0.5f,  0.5f,  0.5f,  1.0f, 0.0f, 0.0f,
+
+     0.5f,  0.5f,  0.5f,  1.0f, 0.0f, 0.0f,
+     0.5f,  0.5f, -0.5f,  1.0f, 1.0f, 0.0f,
+     0.5f, -0.5f, -0.5f,  0.0f, 1.0f, 0.0f,
+     0.5f, -0.5f, -0.5f,  0.0f, 1.0f, 0.0f,
+     0.5f, -0.5f,  0.5f,  0.0f, 0.0f, 0.0f,
+     0.5f,  0.5f,  0.5f,  1.0f, 0.0f, 0.0f,
+
+    -0.5f, -0.5f, -0.5f,  0.0f, 1.0f, 0.0f,
+     0.5f, -0.5f, -0.5f,  1.0f, 1.0f, 0.0f,
+     0.5f, -0.5f,  0.5f,  1.0f, 0.0f, 0.0f,
+     0.5f, -0.5f,  0.5f,  1.0f, 0.0f, 0.0f,
+    -0.5f, -0.5f,  0.5f,  0.0f, 0.0f, 0.0f,
+    -0.5f, -0.5f, -0.5f,  0.0f, 1.0f, 0.0f,
+
+    -0.5f,  0.5f, -0.5f,  0.0f, 1.0f, 0.0f,
+     0.5f,  0.5f, -0.5f,  1.0f, 1.0f, 0.0f,
+     0.5f,  0.5f,  0.5f,  1.0f, 0.0f, 0.0f,
+     0.5f,  0.5f,  0.5f,  1.0f, 0.0f, 0.0f,
+    -0.5f,  0.5f,  0.5f,  0.0f, 0.0f, 0.0f,
+    -0.5f,  0.5f, -0.5f,  0.0f, 1.0f, 0.0f,
+};
+
+// ShadowRenderer 的光源与材质
+const glm::vec3 LIGHT_POS = glm::vec3(5.0f, 10.0f, 5.0f);
+const glm::vec3 LIGHT_COLOR = glm::vec3(1.0f);
+const glm::vec3 OBJECT_COLOR = glm::vec3(0.8f, 0.3f, 0.3f);
+
+void printUsage() {
+    std::cout << "usage: software_rasterizer [--scene advanced|shadow] [--cubes N] [--width W] [--height H]\n"
+              << "                           [--threads T] [--frames F] [--output file.ppm]" << std::endl;
+}
+
+// 解析 [1, maxValue] 范围内的正整数；std::stoul 会接受负号（"-1" 回绕为 ULONG_MAX），因此先要求全部为数字
+uint32_t parsePositive(const std::string& option, const std::string& value, uint32_t maxValue) {
+    bool digits = !value.empty() && value.size() <= 10 &&
+                  std::all_of(value.begin(), value.end(), [](unsigned char c) { return std::isdigit(c) != 0; });
+    unsigned long parsed = digits ? std::stoul(value) : 0;
+    if (parsed == 0 || parsed > maxValue) {
+        throw std::invalid_argument(option + " expects an integer in [1, " + std::to_string(maxValue) + "], got: " + value);
+    }
+    return static_cast<uint32_t>(parsed);
+}
+
+Options parseOptions(int argc, char** argv) {
+    Options options;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto nextValue = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                throw std::runtime_error("missing value for " + arg);
+            }
+            return argv[++i];
+        };
+
+        if (arg == "--scene") {
+            options.scene = nextValue();
+            if (options.scene != "advanced" && options.scene != "shadow") {
+                throw std::runtime_error("unknown scene: " + options.scene);
+            }
+        } else if (arg == "--cubes") {
+            options.cubeGrid = parsePositive(arg, nextValue(), MAX_CUBE_GRID);
+        } else if (arg == "--width") {
+            options.width = parsePositive(arg, nextValue(), MAX_IMAGE_SIZE);
+        } else if (arg == "--height") {
+            options.height = parsePositive(arg, nextValue(), MAX_IMAGE_SIZE);
+        } else if (arg == "--threads") {
+            options.threadCount = parsePositive(arg, nextValue(), MAX_THREADS);
+        } else if (arg == "--frames") {
+            options.frameCount = parsePositive(arg, nextValue(), MAX_FRAMES);
+        } else if (arg == "--output") {
+            options.output = nextValue();
+        } else {
+            throw std::runtime_error("unknown option: " + arg);
+        }
+    }
+
+    return options;
+}
+
+std::vector<RasterVertex> makeCube(float size) {
+    std::vector<RasterVertex> vertices;
+    for (size_t i = 0; i < sizeof(CUBE_VERTICES) / sizeof(float); i += 6) {
+        const float* v = CUBE_VERTICES + i;
+        vertices.push_back({glm::vec3(v[0], v[1], v[2]) * size, glm::vec3(v[3], v[4], v[5])});
+    }
+    return vertices;
+}
+
+// 与 ShadowRenderer 相同的 20x20 地面
+std::vector<RasterVertex> makePlane() {
+    const glm::vec3 corners[6] = {
+        {-10.0f, 0.0f, -10.0f}, {10.0f, 0.0f, -10.0f}, {10.0f, 0.0f, 10.0f},
+        {10.0f, 0.0f, 10.0f}, {-10.0f, 0.0f, 10.0f}, {-10.0f, 0.0f, -10.0f},
+    };
+
+    std::vector<RasterVertex> vertices;
+    for (const glm::vec3& corner : corners) {
+        vertices.push_back({corner, glm::vec3(1.0f)});
+    }
+    return vertices;
+}
+
+Scene createScene(const Options& options) {
+    Scene scene;
+    float aspect = static_cast<float>(options.width) / static_cast<float>(options.height);
+    scene.projection = glm::perspective(glm::radians(45.0f), aspect, 0.1f, 100.0f);
+
+    if (options.scene == "advanced") {
+        scene.cameraPos = glm::vec3(0.0f, 0.0f, 3.0f);
+        scene.view = glm::translate(glm::mat4(1.0f), -scene.cameraPos);
+        scene.clearColor = glm::vec3(0.2f, 0.3f, 0.3f);
+        scene.objects.push_back({makeCube(1.0f), {}, glm::mat4(1.0f)});
+        return scene;
+    }
+
+    scene.cameraPos = glm::vec3(0.0f, 5.0f, 10.0f);
+    scene.view = glm::lookAt(scene.cameraPos, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    scene.clearColor = glm::vec3(0.1f);
+    scene.lit = true;
+
+    scene.objects.push_back({makeCube(2.0f), {}, glm::mat4(1.0f)});
+    scene.objects.push_back({makePlane(), {}, glm::mat4(1.0f)});
+    for (uint32_t i = 0; i < options.cubeGrid * options.cubeGrid; i++) {
+        scene.objects.push_back({makeCube(0.5f), {}, glm::mat4(1.0f)});
+    }
+
+    return scene;
+}
+
+// 逐顶点计算 ShadowRenderer 片段着色器中的 Phong 光照，法线取三角形的面法线
+void lightVertices(SceneObject& object, const glm::vec3& cameraPos) {
+    object.vertices.resize(object.modelVertices.size());
+
+    for (size_t i = 0; i + 2 < object.modelVertices.size(); i += 3) {
+        glm::vec3 world[3];
+        for (int j = 0; j < 3; j++) {
+            world[j] = glm::vec3(object.model * glm::vec4(object.modelVertices[i + j].position, 1.0f));
+        }
+        glm::vec3 normal = glm::normalize(glm::cross(world[1] - world[0], world[2] - world[0]));
+
+        for (int j = 0; j < 3; j++) {
+            glm::vec3 lightDir = glm::normalize(LIGHT_POS - world[j]);
+            glm::vec3 viewDir = glm::normalize(cameraPos - world[j]);
+            // 面法线朝向与顶点顺序有关，翻转到朝向相机的一侧
+            glm::vec3 n = glm::dot(normal, viewDir) < 0.0f ? -normal : normal;
+
+            glm::vec3 ambient = 0.1f * LIGHT_COLOR;
+            glm::vec3 diffuse = std::max(glm::dot(n, lightDir), 0.0f) * LIGHT_COLOR;
+            glm::vec3 reflectDir = glm::reflect(-lightDir, n);
+            glm::vec3 specular = 0.5f * std::pow(std::max(glm::dot(viewDir, reflectDir), 0.0f), 32.0f) * LIGHT_COLOR;
+
+            object.vertices[i + j].position = object.modelVertices[i + j].position;
+            object.vertices[i + j].color = (ambient + diffuse + specular) * OBJECT_COLOR;
+        }
+    }
+}
+
+void updateScene(Scene& scene, const Options& options, float time) {
+    if (options.scene == "advanced") {
+        // AdvancedRenderer 每帧旋转 0.01 弧度
+        scene.objects[0].model = glm::rotate(glm::mat4(1.0f), time * 0.6f, glm::vec3(1.0f, 1.0f, 0.0f));
+        scene.objects[0].vertices = scene.objects[0].modelVertices;
+        return;
+    }
+
+    glm::mat4 cubeModel = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    scene.objects[0].model = glm::rotate(cubeModel, time, glm::vec3(1.0f, 1.0f, 1.0f));
+
+    uint32_t grid = options.cubeGrid;
+    float spacing = 20.0f / static_cast<float>(std::max(grid, 1u));
+    for (uint32_t i = 0; i < grid * grid; i++) {
+        float x = (static_cast<float>(i % grid) + 0.5f) * spacing - 10.0f;
+        float z = (static_cast<float>(i / grid) + 0.5f) * spacing - 10.0f;
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(x, 0.5f, z));
+        scene.objects[2 + i].model = glm::rotate(model, time + static_cast<float>(i), glm::vec3(0.0f, 1.0f, 0.0f));
+    }
+
+    for (SceneObject& object : scene.objects) {
+        lightVertices(object, scene.cameraPos);
+    }
+}
+
+int runBenchmark(const Options& options) {
+    JobSystem jobs(options.threadCount);
+    SoftwareRasterizer rasterizer(options.width, options.height, jobs);
+    Scene scene = createScene(options);
+
+    std::cout << "scene " << options.scene << ", " << options.width << "x" << options.height
+              << ", " << jobs.threadCount() << " threads, " << SoftwareRasterizer::simdName()
+              << ", tile " << SoftwareRasterizer::TILE_SIZE << "x" << SoftwareRasterizer::TILE_SIZE << std::endl;
+
+    RasterStats total;
+    uint32_t measuredFrames = 0;
+
+    for (uint32_t frame = 0; frame < options.frameCount; frame++) {
+        // 顶点光照在提交前完成，不计入光栅化器的耗时
+        updateScene(scene, options, static_cast<float>(frame) * FRAME_TIME);
+
+        rasterizer.clear(scene.clearColor);
+        glm::mat4 viewProjection = scene.projection * scene.view;
+        for (const SceneObject& object : scene.objects) {
+            rasterizer.draw(object.vertices, viewProjection * object.model);
+        }
+
+        RasterStats stats;
+        rasterizer.flush(&stats);
+
+        // 第一帧包含缓冲分配等一次性开销
+        if (frame == 0 && options.frameCount > 1) {
+            continue;
+        }
+
+        total.trianglesSubmitted += stats.trianglesSubmitted;
+        total.trianglesRasterized += stats.trianglesRasterized;
+        total.binnedTriangles += stats.binnedTriangles;
+        total.binnedTrianglesCulled += stats.binnedTrianglesCulled;
+        total.blocksRasterized += stats.blocksRasterized;
+        total.blocksCulled += stats.blocksCulled;
+        total.pixelsWritten += stats.pixelsWritten;
+        total.geometryMilliseconds += stats.geometryMilliseconds;
+        total.rasterMilliseconds += stats.rasterMilliseconds;
+        measuredFrames++;
+    }
+
+    double frames = static_cast<double>(measuredFrames);
+    double totalMilliseconds = total.geometryMilliseconds + total.rasterMilliseconds;
+    double seconds = totalMilliseconds / 1000.0;
+    double blocks = static_cast<double>(total.blocksRasterized + total.blocksCulled);
+
+    std::cout << std::fixed << std::setprecision(2)
+              << "triangles/frame: " << static_cast<double>(total.trianglesSubmitted) / frames << " submitted, "
+              << static_cast<double>(total.trianglesRasterized) / frames << " after clipping, "
+              << static_cast<double>(total.binnedTriangles) / frames << " tile bins" << std::endl;
+    std::cout << "frame: " << totalMilliseconds / frames << " ms (geometry " << total.geometryMilliseconds / frames
+              << " ms, raster " << total.rasterMilliseconds / frames << " ms) over " << measuredFrames << " frames" << std::endl;
+    std::cout << "throughput: " << static_cast<double>(total.trianglesSubmitted) / seconds / 1e6 << " Mtri/s, fill rate "
+              << static_cast<double>(total.pixelsWritten) / seconds / 1e6 << " Mpixel/s ("
+              << static_cast<double>(total.pixelsWritten) / frames << " pixels/frame)" << std::endl;
+    std::cout << "hierarchical depth culled " << 100.0 * static_cast<double>(total.binnedTrianglesCulled) / std::max(1.0, static_cast<double>(total.binnedTriangles))
+              << "% of tile bins, " << 100.0 * static_cast<double>(total.blocksCulled) / std::max(1.0, blocks) << "% of 8x8 blocks" << std::endl;
+
+    std::vector<glm::vec3> pixels;
+    rasterizer.resolve(pixels);
+    writePPM(options.output, options.width, options.height, pixels);
+    std::cout << "wrote " << options.output << std::endl;
+
+    return EXIT_SUCCESS;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc > 1 && (std::strcmp(argv[1], "--help") == 0 || std::strcmp(argv[1], "-h") == 0)) {
+        printUsage();
+        return EXIT_SUCCESS;
+    }
+
+    // 参数错误时给出原因与用法，而不是直接终止
+    Options options;
+    try {
+        options = parseOptions(argc, argv);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        printUsage();
+        return EXIT_FAILURE;
+    }
+
+    try {
+        return runBenchmark(options);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
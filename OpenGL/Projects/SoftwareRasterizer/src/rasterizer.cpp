@@ -0,0 +1,543 @@
+// rasterizer.cpp
+// 分块软件光栅化器的实现
+// 屏幕坐标吸附到 1/16 像素，边函数采用左上填充规则，共享边上的像素只属于其中一个三角形
+
+#include "rasterizer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "job_system.h"
+#include "simd.h"
+
+using simd::vfloat;
+
+namespace {
+
+// 屏幕坐标的亚像素精度
+constexpr float SUBPIXEL_STEPS = 16.0f;
+// 吸附后像素中心处的边函数值是 1/256 的整数倍，减去比它小的偏移就能把 E >= 0 变成 E > 0
+constexpr double EDGE_BIAS = 1.0 / 1024.0;
+// 像素块最小深度由角点估计，与逐像素计算的舍入不同，留一点余量保证剔除是保守的
+constexpr float HIERARCHICAL_DEPTH_EPSILON = 1e-6f;
+
+// 每个几何任务块至少处理的三角形数
+constexpr size_t MIN_GEOMETRY_GRAIN = 256;
+// 几何任务块数约为线程数的这个倍数：块太少负载不均，太多则分箱列表过多
+constexpr size_t GEOMETRY_BATCHES_PER_THREAD = 4;
+
+constexpr int PLANE_DEPTH = 0;
+constexpr int PLANE_INV_W = 1;
+constexpr int PLANE_RED = 2;
+constexpr int PLANE_COUNT = 5;
+
+constexpr int CLIP_PLANE_COUNT = 6;
+// Sutherland-Hodgman 每经过一个平面最多增加一个顶点
+constexpr int MAX_CLIP_VERTICES = 3 + CLIP_PLANE_COUNT;
+
+using Clock = std::chrono::steady_clock;
+
+// 裁剪空间中到 -w <= x, y, z <= w 各平面的有向距离，非负表示在内侧
+float clipDistance(const glm::vec4& p, int plane) {
+    switch (plane) {
+    case 0: return p.w + p.x;
+    case 1: return p.w - p.x;
+    case 2: return p.w + p.y;
+    case 3: return p.w - p.y;
+    case 4: return p.w + p.z;
+    default: return p.w - p.z;
+    }
+}
+
+uint32_t outcode(const glm::vec4& p) {
+    uint32_t code = 0;
+    for (int plane = 0; plane < CLIP_PLANE_COUNT; plane++) {
+        if (clipDistance(p, plane) < 0.0f) {
+            code |= 1u << plane;
+        }
+    }
+    return code;
+}
+
+float horizontalMax(vfloat v) {
+    float result = simd::lane(v, 0);
+    for (int i = 1; i < simd::WIDTH; i++) {
+        result = std::max(result, simd::lane(v, i));
+    }
+    return result;
+}
+
+int popcount(int bits) {
+    int count = 0;
+    for (; bits != 0; bits &= bits - 1) {
+        count++;
+    }
+    return count;
+}
+
+// 线性函数 a * x + b * y + c 在矩形 [x0, x1] x [y0, y1] 上的最小值与最大值
+float rectMin(float a, float b, float c, float x0, float x1, float y0, float y1) {
+    return c + std::min(a * x0, a * x1) + std::min(b * y0, b * y1);
+}
+
+float rectMax(float a, float b, float c, float x0, float x1, float y0, float y1) {
+    return c + std::max(a * x0, a * x1) + std::max(b * y0, b * y1);
+}
+
+} // namespace
+
+SoftwareRasterizer::SoftwareRasterizer(uint32_t width, uint32_t height, JobSystem& jobs)
+    : jobs(jobs), imageWidth(width), imageHeight(height) {
+    tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+    tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+    tiles.resize(static_cast<size_t>(tilesX) * tilesY);
+    tileStats.resize(tiles.size());
+
+    clear(glm::vec3(0.0f));
+}
+
+void SoftwareRasterizer::clear(const glm::vec3& color, float depth) {
+    clearPending = true;
+    clearColor = color;
+    clearDepth = depth;
+}
+
+void SoftwareRasterizer::draw(const std::vector<RasterVertex>& vertices, const glm::mat4& mvp) {
+    uint32_t triangleCount = static_cast<uint32_t>(vertices.size() / 3);
+    if (triangleCount > 0) {
+        drawCalls.push_back({vertices.data(), triangleCount, mvp});
+    }
+}
+
+void SoftwareRasterizer::flush(RasterStats* stats) {
+    auto start = Clock::now();
+
+    size_t triangleCount = 0;
+    for (const DrawCall& drawCall : drawCalls) {
+        triangleCount += drawCall.triangleCount;
+    }
+
+    size_t targetBatches = jobs.threadCount() * GEOMETRY_BATCHES_PER_THREAD;
+    size_t grain = std::max(MIN_GEOMETRY_GRAIN, (triangleCount + targetBatches - 1) / targetBatches);
+    batchCount = (triangleCount + grain - 1) / grain;
+
+    if (batches.size() < batchCount) {
+        batches.resize(batchCount);
+    }
+    for (size_t i = 0; i < batchCount; i++) {
+        GeometryBatch& batch = batches[i];
+        batch.triangles.clear();
+        batch.tileBins.resize(tiles.size());
+        for (auto& bin : batch.tileBins) {
+            bin.clear();
+        }
+        batch.trianglesRasterized = 0;
+        batch.binnedTriangles = 0;
+    }
+
+    jobs.parallelFor(0, triangleCount, grain, [&](size_t begin, size_t end) {
+        processGeometry(begin, end, batches[begin / grain]);
+    });
+
+    auto geometryEnd = Clock::now();
+
+    jobs.parallelFor(0, tiles.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t tileIndex = begin; tileIndex < end; tileIndex++) {
+            rasterizeTile(static_cast<uint32_t>(tileIndex));
+        }
+    });
+
+    auto rasterEnd = Clock::now();
+
+    if (stats != nullptr) {
+        *stats = RasterStats();
+        stats->trianglesSubmitted = triangleCount;
+        for (size_t i = 0; i < batchCount; i++) {
+            stats->trianglesRasterized += batches[i].trianglesRasterized;
+            stats->binnedTriangles += batches[i].binnedTriangles;
+        }
+        for (const TileStats& tile : tileStats) {
+            stats->binnedTrianglesCulled += tile.binnedTrianglesCulled;
+            stats->blocksRasterized += tile.blocksRasterized;
+            stats->blocksCulled += tile.blocksCulled;
+            stats->pixelsWritten += tile.pixelsWritten;
+        }
+        stats->geometryMilliseconds = std::chrono::duration<double, std::milli>(geometryEnd - start).count();
+        stats->rasterMilliseconds = std::chrono::duration<double, std::milli>(rasterEnd - geometryEnd).count();
+    }
+
+    drawCalls.clear();
+    clearPending = false;
+}
+
+void SoftwareRasterizer::resolve(std::vector<glm::vec3>& pixels) const {
+    pixels.resize(static_cast<size_t>(imageWidth) * imageHeight);
+
+    for (uint32_t y = 0; y < imageHeight; y++) {
+        for (uint32_t x = 0; x < imageWidth; x++) {
+            const TileBuffer& tile = tiles[(y / TILE_SIZE) * tilesX + x / TILE_SIZE];
+            uint32_t localX = x % TILE_SIZE;
+            uint32_t localY = y % TILE_SIZE;
+            uint32_t block = (localY / BLOCK_SIZE) * (TILE_SIZE / BLOCK_SIZE) + localX / BLOCK_SIZE;
+            uint32_t offset = block * BLOCK_SIZE * BLOCK_SIZE + (localY % BLOCK_SIZE) * BLOCK_SIZE + localX % BLOCK_SIZE;
+
+            pixels[static_cast<size_t>(y) * imageWidth + x] = glm::vec3(tile.red[offset], tile.green[offset], tile.blue[offset]);
+        }
+    }
+}
+
+const char* SoftwareRasterizer::simdName() {
+    return simd::NAME;
+}
+
+void SoftwareRasterizer::processGeometry(size_t firstTriangle, size_t lastTriangle, GeometryBatch& batch) const {
+    size_t drawIndex = 0;
+    size_t drawStart = 0;
+
+    for (size_t triangle = firstTriangle; triangle < lastTriangle; triangle++) {
+        while (triangle >= drawStart + drawCalls[drawIndex].triangleCount) {
+            drawStart += drawCalls[drawIndex].triangleCount;
+            drawIndex++;
+        }
+
+        const DrawCall& drawCall = drawCalls[drawIndex];
+        const RasterVertex* vertices = drawCall.vertices + (triangle - drawStart) * 3;
+
+        ClipVertex clipVertices[3];
+        for (int i = 0; i < 3; i++) {
+            clipVertices[i].position = drawCall.mvp * glm::vec4(vertices[i].position, 1.0f);
+            clipVertices[i].color = vertices[i].color;
+        }
+
+        clipTriangle(clipVertices, batch);
+    }
+}
+
+void SoftwareRasterizer::clipTriangle(const ClipVertex (&triangle)[3], GeometryBatch& batch) const {
+    uint32_t codes[3] = {outcode(triangle[0].position), outcode(triangle[1].position), outcode(triangle[2].position)};
+
+    // 三个顶点都在同一平面外侧时整个三角形不可见
+    if ((codes[0] & codes[1] & codes[2]) != 0) {
+        return;
+    }
+
+    if ((codes[0] | codes[1] | codes[2]) == 0) {
+        setupTriangle(triangle[0], triangle[1], triangle[2], batch);
+        return;
+    }
+
+    // Sutherland-Hodgman：只对顶点越过的平面逐个裁剪，结果为凸多边形
+    ClipVertex polygon[MAX_CLIP_VERTICES];
+    ClipVertex clipped[MAX_CLIP_VERTICES];
+    int vertexCount = 3;
+    std::copy(triangle, triangle + 3, polygon);
+
+    uint32_t crossed = codes[0] | codes[1] | codes[2];
+    for (int plane = 0; plane < CLIP_PLANE_COUNT && vertexCount > 0; plane++) {
+        if ((crossed & (1u << plane)) == 0) {
+            continue;
+        }
+
+        int clippedCount = 0;
+        for (int i = 0; i < vertexCount; i++) {
+            const ClipVertex& current = polygon[i];
+            const ClipVertex& next = polygon[(i + 1) % vertexCount];
+            float currentDistance = clipDistance(current.position, plane);
+            float nextDistance = clipDistance(next.position, plane);
+
+            if (currentDistance >= 0.0f) {
+                clipped[clippedCount++] = current;
+            }
+            if ((currentDistance >= 0.0f) != (nextDistance >= 0.0f)) {
+                float t = currentDistance / (currentDistance - nextDistance);
+                clipped[clippedCount].position = glm::mix(current.position, next.position, t);
+                clipped[clippedCount].color = glm::mix(current.color, next.color, t);
+                clippedCount++;
+            }
+        }
+
+        vertexCount = clippedCount;
+        std::copy(clipped, clipped + clippedCount, polygon);
+    }
+
+    for (int i = 1; i + 1 < vertexCount; i++) {
+        setupTriangle(polygon[0], polygon[i], polygon[i + 1], batch);
+    }
+}
+
+void SoftwareRasterizer::setupTriangle(const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2, GeometryBatch& batch) const {
+    const ClipVertex* vertices[3] = {&v0, &v1, &v2};
+
+    double screenX[3];
+    double screenY[3];
+    float attributes[3][PLANE_COUNT];
+    for (int i = 0; i < 3; i++) {
+        const glm::vec4& clip = vertices[i]->position;
+        float invW = 1.0f / clip.w;
+        glm::vec3 ndc = glm::vec3(clip.x, clip.y, clip.z) * invW;
+
+        // 视口变换，y 轴翻转使第一行为屏幕顶部
+        screenX[i] = std::round((ndc.x * 0.5f + 0.5f) * imageWidth * SUBPIXEL_STEPS) / SUBPIXEL_STEPS;
+        screenY[i] = std::round((0.5f - ndc.y * 0.5f) * imageHeight * SUBPIXEL_STEPS) / SUBPIXEL_STEPS;
+
+        // 颜色除以 w 后在屏幕空间线性插值，逐像素再除以插值后的 1/w 得到透视校正的结果
+        attributes[i][PLANE_DEPTH] = ndc.z * 0.5f + 0.5f;
+        attributes[i][PLANE_INV_W] = invW;
+        attributes[i][PLANE_RED + 0] = vertices[i]->color.r * invW;
+        attributes[i][PLANE_RED + 1] = vertices[i]->color.g * invW;
+        attributes[i][PLANE_RED + 2] = vertices[i]->color.b * invW;
+    }
+
+    // 两倍有向面积；为负时交换两个顶点，使三角形内部的边函数值都为正（不做背面剔除）
+    double area = (screenX[1] - screenX[0]) * (screenY[2] - screenY[0]) - (screenY[1] - screenY[0]) * (screenX[2] - screenX[0]);
+    if (area == 0.0) {
+        return;
+    }
+    if (area < 0.0) {
+        std::swap(screenX[1], screenX[2]);
+        std::swap(screenY[1], screenY[2]);
+        std::swap(attributes[1], attributes[2]);
+        area = -area;
+    }
+
+    // 包围盒内的像素中心 (x + 0.5, y + 0.5)
+    double minScreenX = std::min({screenX[0], screenX[1], screenX[2]});
+    double maxScreenX = std::max({screenX[0], screenX[1], screenX[2]});
+    double minScreenY = std::min({screenY[0], screenY[1], screenY[2]});
+    double maxScreenY = std::max({screenY[0], screenY[1], screenY[2]});
+
+    TriangleSetup setup;
+    setup.minX = std::max(0, static_cast<int32_t>(std::ceil(minScreenX - 0.5)));
+    setup.maxX = std::min(static_cast<int32_t>(imageWidth) - 1, static_cast<int32_t>(std::floor(maxScreenX - 0.5)));
+    setup.minY = std::max(0, static_cast<int32_t>(std::ceil(minScreenY - 0.5)));
+    setup.maxY = std::min(static_cast<int32_t>(imageHeight) - 1, static_cast<int32_t>(std::floor(maxScreenY - 0.5)));
+    if (setup.minX > setup.maxX || setup.minY > setup.maxY) {
+        return;
+    }
+
+    // 第 i 条边与顶点 i 相对，E_i(p) 与顶点 i 的重心坐标成正比
+    double edgeA[3], edgeB[3], edgeC[3];
+    for (int i = 0; i < 3; i++) {
+        int a = (i + 1) % 3;
+        int b = (i + 2) % 3;
+        edgeA[i] = screenY[a] - screenY[b];
+        edgeB[i] = screenX[b] - screenX[a];
+        edgeC[i] = -(edgeA[i] * screenX[a] + edgeB[i] * screenY[a]);
+
+        // 左上规则：上边（水平且内部在下方）与左边上的像素属于该三角形，其他边上的像素不属于
+        bool topLeft = edgeA[i] > 0.0 || (edgeA[i] == 0.0 && edgeB[i] > 0.0);
+
+        setup.edgeA[i] = static_cast<float>(edgeA[i]);
+        setup.edgeB[i] = static_cast<float>(edgeB[i]);
+        setup.edgeC[i] = edgeC[i] + 0.5 * (edgeA[i] + edgeB[i]) - (topLeft ? 0.0 : EDGE_BIAS);
+    }
+
+    for (int plane = 0; plane < PLANE_COUNT; plane++) {
+        double planeA = 0.0;
+        double planeB = 0.0;
+        double planeC = 0.0;
+        for (int i = 0; i < 3; i++) {
+            double weight = attributes[i][plane] / area;
+            planeA += weight * edgeA[i];
+            planeB += weight * edgeB[i];
+            planeC += weight * edgeC[i];
+        }
+        setup.planeA[plane] = static_cast<float>(planeA);
+        setup.planeB[plane] = static_cast<float>(planeB);
+        setup.planeC[plane] = planeC + 0.5 * (planeA + planeB);
+    }
+
+    setup.minDepth = std::min({attributes[0][PLANE_DEPTH], attributes[1][PLANE_DEPTH], attributes[2][PLANE_DEPTH]});
+
+    uint32_t triangleIndex = static_cast<uint32_t>(batch.triangles.size());
+    batch.triangles.push_back(setup);
+    batch.trianglesRasterized++;
+
+    // 分箱：跨多个屏幕块时用边函数在块内包围盒上的最大值排除与三角形不相交的块
+    uint32_t firstTileX = static_cast<uint32_t>(setup.minX) / TILE_SIZE;
+    uint32_t lastTileX = static_cast<uint32_t>(setup.maxX) / TILE_SIZE;
+    uint32_t firstTileY = static_cast<uint32_t>(setup.minY) / TILE_SIZE;
+    uint32_t lastTileY = static_cast<uint32_t>(setup.maxY) / TILE_SIZE;
+    bool singleTile = firstTileX == lastTileX && firstTileY == lastTileY;
+
+    for (uint32_t tileY = firstTileY; tileY <= lastTileY; tileY++) {
+        for (uint32_t tileX = firstTileX; tileX <= lastTileX; tileX++) {
+            if (!singleTile) {
+                double x0 = std::max<double>(setup.minX, tileX * TILE_SIZE);
+                double x1 = std::min<double>(setup.maxX, tileX * TILE_SIZE + TILE_SIZE - 1);
+                double y0 = std::max<double>(setup.minY, tileY * TILE_SIZE);
+                double y1 = std::min<double>(setup.maxY, tileY * TILE_SIZE + TILE_SIZE - 1);
+
+                bool outside = false;
+                for (int i = 0; i < 3 && !outside; i++) {
+                    double a = setup.edgeA[i];
+                    double b = setup.edgeB[i];
+                    outside = setup.edgeC[i] + std::max(a * x0, a * x1) + std::max(b * y0, b * y1) < 0.0;
+                }
+                if (outside) {
+                    continue;
+                }
+            }
+
+            batch.tileBins[tileY * tilesX + tileX].push_back(triangleIndex);
+            batch.binnedTriangles++;
+        }
+    }
+}
+
+void SoftwareRasterizer::rasterizeTile(uint32_t tileIndex) {
+    TileBuffer& tile = tiles[tileIndex];
+    TileStats& stats = tileStats[tileIndex];
+    stats = TileStats();
+
+    if (clearPending) {
+        std::fill(std::begin(tile.depth), std::end(tile.depth), clearDepth);
+        std::fill(std::begin(tile.red), std::end(tile.red), clearColor.r);
+        std::fill(std::begin(tile.green), std::end(tile.green), clearColor.g);
+        std::fill(std::begin(tile.blue), std::end(tile.blue), clearColor.b);
+        std::fill(std::begin(tile.blockMaxDepth), std::end(tile.blockMaxDepth), clearDepth);
+        tile.maxDepth = clearDepth;
+    }
+
+    uint32_t tileX = (tileIndex % tilesX) * TILE_SIZE;
+    uint32_t tileY = (tileIndex / tilesX) * TILE_SIZE;
+
+    // 按批次、批次内按下标遍历，保持提交顺序
+    for (size_t batchIndex = 0; batchIndex < batchCount; batchIndex++) {
+        const GeometryBatch& batch = batches[batchIndex];
+        for (uint32_t triangleIndex : batch.tileBins[tileIndex]) {
+            const TriangleSetup& triangle = batch.triangles[triangleIndex];
+            if (triangle.minDepth >= tile.maxDepth) {
+                stats.binnedTrianglesCulled++;
+                continue;
+            }
+            rasterizeTriangle(triangle, tileX, tileY, tile, stats);
+        }
+    }
+}
+
+void SoftwareRasterizer::rasterizeTriangle(const TriangleSetup& triangle, uint32_t tileX, uint32_t tileY, TileBuffer& tile, TileStats& stats) const {
+    // 换算到屏幕块内的局部坐标，数值较小，之后用 float 计算精度足够
+    float edgeA[3], edgeB[3], edgeC[3];
+    for (int i = 0; i < 3; i++) {
+        edgeA[i] = triangle.edgeA[i];
+        edgeB[i] = triangle.edgeB[i];
+        edgeC[i] = static_cast<float>(triangle.edgeC[i] + static_cast<double>(triangle.edgeA[i]) * tileX + static_cast<double>(triangle.edgeB[i]) * tileY);
+    }
+    float planeA[PLANE_COUNT], planeB[PLANE_COUNT], planeC[PLANE_COUNT];
+    for (int i = 0; i < PLANE_COUNT; i++) {
+        planeA[i] = triangle.planeA[i];
+        planeB[i] = triangle.planeB[i];
+        planeC[i] = static_cast<float>(triangle.planeC[i] + static_cast<double>(triangle.planeA[i]) * tileX + static_cast<double>(triangle.planeB[i]) * tileY);
+    }
+
+    int localMinX = std::max(triangle.minX - static_cast<int>(tileX), 0);
+    int localMaxX = std::min(triangle.maxX - static_cast<int>(tileX), static_cast<int>(TILE_SIZE) - 1);
+    int localMinY = std::max(triangle.minY - static_cast<int>(tileY), 0);
+    int localMaxY = std::min(triangle.maxY - static_cast<int>(tileY), static_cast<int>(TILE_SIZE) - 1);
+
+    alignas(32) static const float LANE_OFFSETS[8] = {0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f};
+    const vfloat laneOffsets = vfloat::load(LANE_OFFSETS);
+    const int blocksPerRow = static_cast<int>(TILE_SIZE / BLOCK_SIZE);
+    const int blockSize = static_cast<int>(BLOCK_SIZE);
+
+    bool depthChanged = false;
+
+    for (int blockY = localMinY / blockSize; blockY <= localMaxY / blockSize; blockY++) {
+        for (int blockX = localMinX / blockSize; blockX <= localMaxX / blockSize; blockX++) {
+            float x0 = static_cast<float>(blockX * blockSize);
+            float x1 = x0 + static_cast<float>(blockSize - 1);
+            float y0 = static_cast<float>(blockY * blockSize);
+            float y1 = y0 + static_cast<float>(blockSize - 1);
+
+            // 边函数是线性的，在像素块四角取到极值：任一条边的最大值为负则不相交，三条边最小值都非负则整块被覆盖
+            bool outside = false;
+            bool fullyCovered = true;
+            for (int i = 0; i < 3; i++) {
+                outside |= rectMax(edgeA[i], edgeB[i], edgeC[i], x0, x1, y0, y1) < 0.0f;
+                fullyCovered &= rectMin(edgeA[i], edgeB[i], edgeC[i], x0, x1, y0, y1) >= 0.0f;
+            }
+            if (outside) {
+                continue;
+            }
+
+            int block = blockY * blocksPerRow + blockX;
+            float blockMinDepth = std::max(triangle.minDepth,
+                                           rectMin(planeA[PLANE_DEPTH], planeB[PLANE_DEPTH], planeC[PLANE_DEPTH], x0, x1, y0, y1));
+            if (blockMinDepth - HIERARCHICAL_DEPTH_EPSILON >= tile.blockMaxDepth[block]) {
+                stats.blocksCulled++;
+                continue;
+            }
+            stats.blocksRasterized++;
+
+            size_t blockOffset = static_cast<size_t>(block) * BLOCK_SIZE * BLOCK_SIZE;
+            float* depth = tile.depth + blockOffset;
+            float* red = tile.red + blockOffset;
+            float* green = tile.green + blockOffset;
+            float* blue = tile.blue + blockOffset;
+
+            bool written = false;
+            for (int row = 0; row < blockSize; row++) {
+                float y = y0 + static_cast<float>(row);
+                vfloat edgeRow[3];
+                for (int i = 0; i < 3; i++) {
+                    edgeRow[i] = vfloat(edgeB[i] * y + edgeC[i]);
+                }
+                vfloat planeRow[PLANE_COUNT];
+                for (int i = 0; i < PLANE_COUNT; i++) {
+                    planeRow[i] = vfloat(planeB[i] * y + planeC[i]);
+                }
+
+                for (int column = 0; column < blockSize; column += simd::WIDTH) {
+                    vfloat x = vfloat(x0 + static_cast<float>(column)) + laneOffsets;
+
+                    vfloat mask = simd::trueMask();
+                    if (!fullyCovered) {
+                        for (int i = 0; i < 3; i++) {
+                            mask = mask & (vfloat(edgeA[i]) * x + edgeRow[i] >= vfloat(0.0f));
+                        }
+                        if (simd::none(mask)) {
+                            continue;
+                        }
+                    }
+
+                    int offset = row * blockSize + column;
+                    vfloat z = vfloat(planeA[PLANE_DEPTH]) * x + planeRow[PLANE_DEPTH];
+                    vfloat oldDepth = vfloat::load(depth + offset);
+                    mask = mask & (z < oldDepth);
+                    int bits = simd::movemask(mask);
+                    if (bits == 0) {
+                        continue;
+                    }
+
+                    vfloat w = vfloat(1.0f) / (vfloat(planeA[PLANE_INV_W]) * x + planeRow[PLANE_INV_W]);
+                    vfloat r = (vfloat(planeA[PLANE_RED + 0]) * x + planeRow[PLANE_RED + 0]) * w;
+                    vfloat g = (vfloat(planeA[PLANE_RED + 1]) * x + planeRow[PLANE_RED + 1]) * w;
+                    vfloat b = (vfloat(planeA[PLANE_RED + 2]) * x + planeRow[PLANE_RED + 2]) * w;
+
+                    simd::select(mask, z, oldDepth).store(depth + offset);
+                    simd::select(mask, r, vfloat::load(red + offset)).store(red + offset);
+                    simd::select(mask, g, vfloat::load(green + offset)).store(green + offset);
+                    simd::select(mask, b, vfloat::load(blue + offset)).store(blue + offset);
+
+                    stats.pixelsWritten += popcount(bits);
+                    written = true;
+                }
+            }
+
+            if (written) {
+                vfloat maxDepth = vfloat::load(depth);
+                for (int offset = simd::WIDTH; offset < blockSize * blockSize; offset += simd::WIDTH) {
+                    maxDepth = simd::max(maxDepth, vfloat::load(depth + offset));
+                }
+                tile.blockMaxDepth[block] = horizontalMax(maxDepth);
+                depthChanged = true;
+            }
+        }
+    }
+
+    if (depthChanged) {
+        tile.maxDepth = *std::max_element(std::begin(tile.blockMaxDepth), std::end(tile.blockMaxDepth));
+    }
+}
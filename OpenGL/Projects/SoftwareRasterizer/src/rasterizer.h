@@ -0,0 +1,142 @@
+// rasterizer.h
+// 分块（tile-binned）多线程软件光栅化器，用于在没有GPU的机器上运行 OpenGL 项目的场景并做基准测试
+//
+// 每帧分两个阶段：
+//   1. 几何阶段：按三角形分块并行做顶点变换、视锥裁剪与三角形建立，再把三角形分箱到覆盖的 64x64 屏幕块
+//   2. 光栅阶段：按屏幕块并行，依提交顺序遍历各块的三角形，以 8x8 像素为单位做层次深度剔除，
+//      块内用 SIMD 同时计算一行像素的边函数、深度与透视校正插值
+// 约定与 OpenGL 一致：裁剪空间 -w <= x, y, z <= w，深度映射到 [0, 1]，深度测试为 GL_LESS，输出图像第一行为屏幕顶部
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+class JobSystem;
+
+struct RasterVertex {
+    glm::vec3 position;
+    glm::vec3 color;
+};
+
+struct RasterStats {
+    // 提交的三角形数，以及裁剪后实际进入光栅化的三角形数（被裁剪切开的三角形可能变成多个）
+    uint64_t trianglesSubmitted = 0;
+    uint64_t trianglesRasterized = 0;
+    // 三角形与屏幕块的配对数，以及其中整个屏幕块都被层次深度剔除的配对数
+    uint64_t binnedTriangles = 0;
+    uint64_t binnedTrianglesCulled = 0;
+    // 与三角形相交并经过层次深度测试的 8x8 像素块数，以及被层次深度剔除的块数
+    uint64_t blocksRasterized = 0;
+    uint64_t blocksCulled = 0;
+    // 通过深度测试并写入的像素数
+    uint64_t pixelsWritten = 0;
+
+    double geometryMilliseconds = 0.0;
+    double rasterMilliseconds = 0.0;
+};
+
+class SoftwareRasterizer {
+public:
+    static constexpr uint32_t TILE_SIZE = 64;
+    static constexpr uint32_t BLOCK_SIZE = 8;
+
+    SoftwareRasterizer(uint32_t width, uint32_t height, JobSystem& jobs);
+
+    uint32_t width() const { return imageWidth; }
+    uint32_t height() const { return imageHeight; }
+
+    // 清屏在下一次 flush() 时由各屏幕块并行完成
+    void clear(const glm::vec3& color, float depth = 1.0f);
+
+    // 记录一次绘制（每3个顶点一个三角形）；只保存指针，顶点数据在 flush() 返回前必须保持有效
+    void draw(const std::vector<RasterVertex>& vertices, const glm::mat4& mvp);
+
+    // 执行本帧记录的清屏与全部绘制，stats 不为空时写入统计信息
+    void flush(RasterStats* stats = nullptr);
+
+    // 把分块存放的颜色缓冲转换为按行从上到下排列的图像
+    void resolve(std::vector<glm::vec3>& pixels) const;
+
+    static const char* simdName();
+
+private:
+    static constexpr uint32_t TILE_PIXELS = TILE_SIZE * TILE_SIZE;
+    static constexpr uint32_t BLOCKS_PER_TILE = (TILE_SIZE / BLOCK_SIZE) * (TILE_SIZE / BLOCK_SIZE);
+
+    struct DrawCall {
+        const RasterVertex* vertices;
+        uint32_t triangleCount;
+        glm::mat4 mvp;
+    };
+
+    struct ClipVertex {
+        glm::vec4 position;
+        glm::vec3 color;
+    };
+
+    // 三角形建立的结果：3条边函数与5个屏幕空间线性插值平面（深度、1/w、颜色/w），
+    // 都以 a * x + b * y + c 的形式表示，x、y 为整张图像上的像素坐标，c 已包含像素中心的 0.5 偏移
+    struct TriangleSetup {
+        float edgeA[3];
+        float edgeB[3];
+        double edgeC[3];
+        float planeA[5];
+        float planeB[5];
+        double planeC[5];
+        float minDepth;
+        int32_t minX, minY, maxX, maxY;
+    };
+
+    // 一个几何阶段任务块的输出：按提交顺序排列的三角形，以及每个屏幕块引用的三角形下标
+    struct GeometryBatch {
+        std::vector<TriangleSetup> triangles;
+        std::vector<std::vector<uint32_t>> tileBins;
+        uint64_t trianglesRasterized = 0;
+        uint64_t binnedTriangles = 0;
+    };
+
+    // 屏幕块内按 8x8 像素块连续存放，每个像素块内按行存放，便于 SIMD 整行读写
+    struct alignas(32) TileBuffer {
+        float depth[TILE_PIXELS];
+        float red[TILE_PIXELS];
+        float green[TILE_PIXELS];
+        float blue[TILE_PIXELS];
+        // 层次深度：每个像素块以及整个屏幕块当前的最大深度，三角形的最小深度不小于它时不可能通过深度测试
+        float blockMaxDepth[BLOCKS_PER_TILE];
+        float maxDepth;
+    };
+
+    struct TileStats {
+        uint64_t binnedTrianglesCulled = 0;
+        uint64_t blocksRasterized = 0;
+        uint64_t blocksCulled = 0;
+        uint64_t pixelsWritten = 0;
+    };
+
+    JobSystem& jobs;
+
+    uint32_t imageWidth;
+    uint32_t imageHeight;
+    uint32_t tilesX;
+    uint32_t tilesY;
+
+    std::vector<TileBuffer> tiles;
+    std::vector<TileStats> tileStats;
+
+    bool clearPending = false;
+    glm::vec3 clearColor = glm::vec3(0.0f);
+    float clearDepth = 1.0f;
+
+    std::vector<DrawCall> drawCalls;
+    std::vector<GeometryBatch> batches;
+    size_t batchCount = 0;
+
+    void processGeometry(size_t firstTriangle, size_t lastTriangle, GeometryBatch& batch) const;
+    void clipTriangle(const ClipVertex (&triangle)[3], GeometryBatch& batch) const;
+    void setupTriangle(const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2, GeometryBatch& batch) const;
+    void rasterizeTile(uint32_t tileIndex);
+    void rasterizeTriangle(const TriangleSetup& triangle, uint32_t tileX, uint32_t tileY, TileBuffer& tile, TileStats& stats) const;
+};
@@ -5,22 +5,31 @@ layout(location = 1) in vec3 fragNormal;
 layout(location = 2) in vec2 fragTexCoord;
 layout(location = 3) in vec3 fragLightPos;
 layout(location = 4) in vec3 fragViewPos;
+layout(location = 5) flat in vec3 fragAlbedo;
+layout(location = 6) flat in vec2 fragMetallicRoughness;
 
 layout(location = 0) out vec4 outColor;
 
-// PBR材质参数
-const float metallic = 0.5;
-const float roughness = 0.3;
-
-// 环境光
-const vec3 ambientColor = vec3(0.03);
+// 与顶点着色器共用的 uniform 块，这里只用到环境光照：
+// 辐照度 / π 的 9 个球谐系数，预滤波立方体贴图的最大 mip 层（见 src/environment_lighting.h）
+layout(binding = 0) uniform UniformBufferObject {
+    mat4 model;
+    mat4 view;
+    mat4 proj;
+    vec3 lightPos;
+    vec3 viewPos;
+    vec4 irradianceSH[9];
+    vec4 environmentParams;
+    mat4 invViewProj;
+} ubo;
+
+// 按 GGX 预滤波的环境立方体贴图（mip 层对应粗糙度）与 split-sum 的 BRDF 查找表
+layout(binding = 1) uniform samplerCube prefilterMap;
+layout(binding = 2) uniform sampler2D brdfLUT;
 
 // 光源颜色
 const vec3 lightColor = vec3(1.0, 1.0, 1.0);
 
-// 物体颜色
-const vec3 albedo = vec3(0.8, 0.8, 0.8);
-
 // 法线分布函数 - Trowbridge-Reitz GGX
 float DistributionGGX(vec3 N, vec3 H, float roughness) {
     float a = roughness * roughness;
@@ -61,7 +70,31 @@ vec3 FresnelSchlick(float cosTheta, vec3 F0) {
     return F0 + (1.0 - F0) * pow(clamp(1.0 - cosTheta, 0.0, 1.0), 5.0);
 }
 
+// 考虑粗糙度的菲涅尔，用于环境光照：粗糙表面在掠射角的反射不会趋近 1
+vec3 FresnelSchlickRoughness(float cosTheta, vec3 F0, float roughness) {
+    return F0 + (max(vec3(1.0 - roughness), F0) - F0) * pow(clamp(1.0 - cosTheta, 0.0, 1.0), 5.0);
+}
+
+// 由球谐系数求法线方向的辐照度 / π
+vec3 Irradiance(vec3 n) {
+    vec3 result = ubo.irradianceSH[0].rgb * 0.282095;
+    result += ubo.irradianceSH[1].rgb * 0.488603 * n.y;
+    result += ubo.irradianceSH[2].rgb * 0.488603 * n.z;
+    result += ubo.irradianceSH[3].rgb * 0.488603 * n.x;
+    result += ubo.irradianceSH[4].rgb * 1.092548 * n.x * n.y;
+    result += ubo.irradianceSH[5].rgb * 1.092548 * n.y * n.z;
+    result += ubo.irradianceSH[6].rgb * 0.315392 * (3.0 * n.z * n.z - 1.0);
+    result += ubo.irradianceSH[7].rgb * 1.092548 * n.x * n.z;
+    result += ubo.irradianceSH[8].rgb * 0.546274 * (n.x * n.x - n.y * n.y);
+    return max(result, vec3(0.0));
+}
+
 void main() {
+    // 每个实例的材质参数
+    vec3 albedo = fragAlbedo;
+    float metallic = fragMetallicRoughness.x;
+    float roughness = fragMetallicRoughness.y;
+
     // 标准化法向量
     vec3 N = normalize(fragNormal);
     // 视线方向
@@ -95,8 +128,13 @@ void main() {
     vec3 kD = vec3(1.0) - kS;
     kD *= 1.0 - metallic;
 
-    // 环境光
-    vec3 ambient = ambientColor * albedo;
+    // 环境光：漫反射由球谐求值，镜面反射为预滤波贴图与 BRDF 查找表的 split-sum 近似
+    vec3 ambientF = FresnelSchlickRoughness(NdotV, F0, roughness);
+    vec3 ambientKD = (1.0 - ambientF) * (1.0 - metallic);
+    vec3 R = reflect(-V, N);
+    vec3 prefiltered = textureLod(prefilterMap, R, roughness * ubo.environmentParams.x).rgb;
+    vec2 brdf = texture(brdfLUT, vec2(NdotV, roughness)).rg;
+    vec3 ambient = ambientKD * Irradiance(N) * albedo + prefiltered * (F0 * brdf.x + brdf.y);
 
     // 直接光照
     vec3 radiance = lightColor * NdotL;
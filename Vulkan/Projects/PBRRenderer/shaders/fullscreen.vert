@@ -0,0 +1,10 @@
+#version 450
+
+// 覆盖整个屏幕的三角形，由 gl_VertexIndex 生成，不需要顶点缓冲
+layout(location = 0) out vec2 fragNdc;
+
+void main() {
+    vec2 position = vec2((gl_VertexIndex << 1) & 2, gl_VertexIndex & 2) * 2.0 - 1.0;
+    fragNdc = position;
+    gl_Position = vec4(position, 0.0, 1.0);
+}
@@ -0,0 +1,29 @@
+#version 450
+
+// 延迟着色的几何子通道：只写材质与法线，光照在下一个子通道中逐像素计算
+layout(location = 0) in vec3 fragPos;
+layout(location = 1) in vec3 fragNormal;
+layout(location = 2) in vec2 fragTexCoord;
+layout(location = 3) in vec3 fragLightPos;
+layout(location = 4) in vec3 fragViewPos;
+layout(location = 5) flat in vec3 fragAlbedo;
+layout(location = 6) flat in vec2 fragMetallicRoughness;
+
+// G-buffer：反照率与金属度（RGBA8），八面体编码的世界空间法线与粗糙度（RGB10_A2）
+layout(location = 0) out vec4 outAlbedoMetallic;
+layout(location = 1) out vec4 outNormalRoughness;
+
+// 单位向量的八面体编码，映射到 [0, 1]
+vec2 EncodeOctahedron(vec3 n) {
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 e = n.xy;
+    if (n.z < 0.0) {
+        e = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return e * 0.5 + 0.5;
+}
+
+void main() {
+    outAlbedoMetallic = vec4(fragAlbedo, fragMetallicRoughness.x);
+    outNormalRoughness = vec4(EncodeOctahedron(normalize(fragNormal)), fragMetallicRoughness.y, 0.0);
+}
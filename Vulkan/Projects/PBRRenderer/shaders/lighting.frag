@@ -0,0 +1,172 @@
+#version 450
+
+// 延迟着色的光照子通道：从输入附件读取当前像素的 G-buffer，由深度重建世界空间位置后计算与前向着色相同的光照
+layout(location = 0) in vec2 fragNdc;
+
+layout(location = 0) out vec4 outColor;
+
+// 与顶点着色器共用的 uniform 块：光源与相机位置、环境光照，以及由深度重建位置用的逆视图投影矩阵
+layout(binding = 0) uniform UniformBufferObject {
+    mat4 model;
+    mat4 view;
+    mat4 proj;
+    vec3 lightPos;
+    vec3 viewPos;
+    vec4 irradianceSH[9];
+    vec4 environmentParams;
+    mat4 invViewProj;
+} ubo;
+
+// 按 GGX 预滤波的环境立方体贴图（mip 层对应粗糙度）与 split-sum 的 BRDF 查找表
+layout(binding = 1) uniform samplerCube prefilterMap;
+layout(binding = 2) uniform sampler2D brdfLUT;
+
+// 几何子通道写入的 G-buffer 与深度，只能读取当前像素，在分块渲染的 GPU 上一直留在片上内存中
+layout(set = 1, binding = 0, input_attachment_index = 0) uniform subpassInput gbufferAlbedoMetallic;
+layout(set = 1, binding = 1, input_attachment_index = 1) uniform subpassInput gbufferNormalRoughness;
+layout(set = 1, binding = 2, input_attachment_index = 2) uniform subpassInput gbufferDepth;
+
+// 光源颜色
+const vec3 lightColor = vec3(1.0, 1.0, 1.0);
+
+// 法线分布函数 - Trowbridge-Reitz GGX
+float DistributionGGX(vec3 N, vec3 H, float roughness) {
+    float a = roughness * roughness;
+    float a2 = a * a;
+    float NdotH = max(dot(N, H), 0.0);
+    float NdotH2 = NdotH * NdotH;
+
+    float num = a2;
+    float denom = (NdotH2 * (a2 - 1.0) + 1.0);
+    denom = 3.14159265359 * denom * denom;
+
+    return num / denom;
+}
+
+// 几何遮蔽函数 - Schlick-GGX
+float GeometrySchlickGGX(float NdotV, float roughness) {
+    float r = (roughness + 1.0);
+    float k = (r * r) / 8.0;
+
+    float num = NdotV;
+    float denom = NdotV * (1.0 - k) + k;
+
+    return num / denom;
+}
+
+// 几何遮蔽函数 - Smith
+float GeometrySmith(vec3 N, vec3 V, vec3 L, float roughness) {
+    float NdotV = max(dot(N, V), 0.0);
+    float NdotL = max(dot(N, L), 0.0);
+    float ggx1 = GeometrySchlickGGX(NdotV, roughness);
+    float ggx2 = GeometrySchlickGGX(NdotL, roughness);
+
+    return ggx1 * ggx2;
+}
+
+// 菲涅尔方程 - Schlick近似
+vec3 FresnelSchlick(float cosTheta, vec3 F0) {
+    return F0 + (1.0 - F0) * pow(clamp(1.0 - cosTheta, 0.0, 1.0), 5.0);
+}
+
+// 考虑粗糙度的菲涅尔，用于环境光照：粗糙表面在掠射角的反射不会趋近 1
+vec3 FresnelSchlickRoughness(float cosTheta, vec3 F0, float roughness) {
+    return F0 + (max(vec3(1.0 - roughness), F0) - F0) * pow(clamp(1.0 - cosTheta, 0.0, 1.0), 5.0);
+}
+
+// 由球谐系数求法线方向的辐照度 / π
+vec3 Irradiance(vec3 n) {
+    vec3 result = ubo.irradianceSH[0].rgb * 0.282095;
+    result += ubo.irradianceSH[1].rgb * 0.488603 * n.y;
+    result += ubo.irradianceSH[2].rgb * 0.488603 * n.z;
+    result += ubo.irradianceSH[3].rgb * 0.488603 * n.x;
+    result += ubo.irradianceSH[4].rgb * 1.092548 * n.x * n.y;
+    result += ubo.irradianceSH[5].rgb * 1.092548 * n.y * n.z;
+    result += ubo.irradianceSH[6].rgb * 0.315392 * (3.0 * n.z * n.z - 1.0);
+    result += ubo.irradianceSH[7].rgb * 1.092548 * n.x * n.z;
+    result += ubo.irradianceSH[8].rgb * 0.546274 * (n.x * n.x - n.y * n.y);
+    return max(result, vec3(0.0));
+}
+
+// 八面体编码的逆变换
+vec3 DecodeOctahedron(vec2 e) {
+    e = e * 2.0 - 1.0;
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0) {
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return normalize(n);
+}
+
+void main() {
+    // 没有几何体的像素保留清屏颜色
+    float depth = subpassLoad(gbufferDepth).r;
+    if (depth >= 1.0) {
+        discard;
+    }
+
+    vec4 albedoMetallic = subpassLoad(gbufferAlbedoMetallic);
+    vec4 normalRoughness = subpassLoad(gbufferNormalRoughness);
+    vec3 albedo = albedoMetallic.rgb;
+    float metallic = albedoMetallic.a;
+    float roughness = normalRoughness.b;
+    vec3 N = DecodeOctahedron(normalRoughness.rg);
+
+    // 由深度重建世界空间位置
+    vec4 worldPosition = ubo.invViewProj * vec4(fragNdc, depth, 1.0);
+    vec3 worldPos = worldPosition.xyz / worldPosition.w;
+
+    // 视线方向
+    vec3 V = normalize(ubo.viewPos - worldPos);
+    // 光照方向
+    vec3 L = normalize(ubo.lightPos - worldPos);
+    // 半程向量
+    vec3 H = normalize(V + L);
+
+    // 计算反射率
+    vec3 F0 = vec3(0.04);
+    F0 = mix(F0, albedo, metallic);
+
+    // 计算光源与法线的夹角
+    float NdotL = max(dot(N, L), 0.0);
+    // 计算视线与法线的夹角
+    float NdotV = max(dot(N, V), 0.0);
+
+    // BRDF项
+    float D = DistributionGGX(N, H, roughness);
+    float G = GeometrySmith(N, V, L, roughness);
+    vec3 F = FresnelSchlick(max(dot(H, V), 0.0), F0);
+
+    // 镜面反射项
+    vec3 numerator = D * G * F;
+    float denominator = 4.0 * NdotV * NdotL + 0.0001;
+    vec3 specular = numerator / denominator;
+
+    // 漫反射项
+    vec3 kS = F;
+    vec3 kD = vec3(1.0) - kS;
+    kD *= 1.0 - metallic;
+
+    // 环境光：漫反射由球谐求值，镜面反射为预滤波贴图与 BRDF 查找表的 split-sum 近似
+    vec3 ambientF = FresnelSchlickRoughness(NdotV, F0, roughness);
+    vec3 ambientKD = (1.0 - ambientF) * (1.0 - metallic);
+    vec3 R = reflect(-V, N);
+    vec3 prefiltered = textureLod(prefilterMap, R, roughness * ubo.environmentParams.x).rgb;
+    vec2 brdf = texture(brdfLUT, vec2(NdotV, roughness)).rg;
+    vec3 ambient = ambientKD * Irradiance(N) * albedo + prefiltered * (F0 * brdf.x + brdf.y);
+
+    // 直接光照
+    vec3 radiance = lightColor * NdotL;
+    vec3 diffuse = albedo / 3.14159265359;
+
+    // 总光照
+    vec3 lighting = (kD * diffuse + specular) * radiance;
+    lighting += ambient;
+
+    // 简单的曝光调整
+    lighting = lighting / (lighting + vec3(1.0));
+    // Gamma校正
+    lighting = pow(lighting, vec3(1.0 / 2.2));
+
+    outColor = vec4(lighting, 1.0);
+}
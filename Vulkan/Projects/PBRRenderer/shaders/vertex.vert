@@ -6,12 +6,20 @@ layout(location = 2) in vec2 inTexCoord;
 layout(location = 3) in vec3 inTangent;
 layout(location = 4) in vec3 inBitangent;
 
+// 每个实例（材质网格中的一个球）的变换与材质
+layout(location = 5) in mat4 inInstanceModel;
+layout(location = 9) in vec3 inAlbedo;
+layout(location = 10) in vec2 inMetallicRoughness;
+
 layout(binding = 0) uniform UniformBufferObject {
     mat4 model;
     mat4 view;
     mat4 proj;
     vec3 lightPos;
     vec3 viewPos;
+    vec4 irradianceSH[9];
+    vec4 environmentParams;
+    mat4 invViewProj;
 } ubo;
 
 layout(location = 0) out vec3 fragPos;
@@ -19,12 +27,18 @@ layout(location = 1) out vec3 fragNormal;
 layout(location = 2) out vec2 fragTexCoord;
 layout(location = 3) out vec3 fragLightPos;
 layout(location = 4) out vec3 fragViewPos;
+layout(location = 5) flat out vec3 fragAlbedo;
+layout(location = 6) flat out vec2 fragMetallicRoughness;
 
 void main() {
-    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPos, 1.0);
-    fragPos = vec3(ubo.model * vec4(inPos, 1.0));
-    fragNormal = mat3(transpose(inverse(ubo.model))) * inNormal;
+    mat4 model = ubo.model * inInstanceModel;
+    gl_Position = ubo.proj * ubo.view * model * vec4(inPos, 1.0);
+    fragPos = vec3(model * vec4(inPos, 1.0));
+    // 实例只有平移与均匀缩放，不需要逐顶点求逆转置
+    fragNormal = mat3(model) * inNormal;
     fragTexCoord = inTexCoord;
     fragLightPos = ubo.lightPos;
     fragViewPos = ubo.viewPos;
+    fragAlbedo = inAlbedo;
+    fragMetallicRoughness = inMetallicRoughness;
 }
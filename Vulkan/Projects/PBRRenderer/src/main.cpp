@@ -11,15 +11,34 @@
 #include <fstream>
 #include <chrono>
 #include <memory>
+#include <array>
+#include <string>
+#include <cmath>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include "environment_lighting.h"
 
 const int WIDTH = 800;
 const int HEIGHT = 600;
 const int MAX_FRAMES_IN_FLIGHT = 2;
 
+// Material grid: one sphere per instance, metallic increasing along x and roughness along y
+const uint32_t DEFAULT_INSTANCE_COUNT = 10000;
+const float GRID_SPACING = 2.5f;
+const uint32_t SPHERE_SEGMENTS = 32;
+const uint32_t SPHERE_RINGS = 16;
+
+// Timestamps around the scene render pass, per frame in flight
+const uint32_t TIMESTAMPS_PER_FRAME = 2;
+
+// Deferred G-buffer: albedo and metallic, octahedral normal and roughness; position is reconstructed from depth
+const VkFormat ALBEDO_METALLIC_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
+const VkFormat NORMAL_ROUGHNESS_FORMAT = VK_FORMAT_A2B10G10R10_UNORM_PACK32;
+
 const std::vector<const char*> validationLayers = {
     "VK_LAYER_KHRONOS_validation"
 };
@@ -49,12 +68,85 @@ struct SwapChainSupportDetails {
     std::vector<VkPresentModeKHR> presentModes;
 };
 
+// Matches the std140 layout of UniformBufferObject in the shaders: vec3 and arrays start on 16 bytes
 struct UniformBufferObject {
     glm::mat4 model;
     glm::mat4 view;
     glm::mat4 proj;
-    glm::vec3 lightPos;
-    glm::vec3 viewPos;
+    alignas(16) glm::vec3 lightPos;
+    alignas(16) glm::vec3 viewPos;
+    // Irradiance / pi as 9 SH coefficients and the prefiltered map's max lod in x (see environment_lighting.h)
+    alignas(16) glm::vec4 irradianceSH[9];
+    glm::vec4 environmentParams;
+    // Clip space to world space, for the deferred lighting subpass to rebuild positions from depth
+    glm::mat4 invViewProj;
+};
+
+// Per-instance vertex data (binding 1, input rate instance)
+struct InstanceData {
+    glm::mat4 model;
+    glm::vec3 albedo;
+    float metallic;
+    float roughness;
+
+    static VkVertexInputBindingDescription getBindingDescription() {
+        VkVertexInputBindingDescription bindingDescription = {};
+        bindingDescription.binding = 1;
+        bindingDescription.stride = sizeof(InstanceData);
+        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+        return bindingDescription;
+    }
+
+    static std::array<VkVertexInputAttributeDescription, 6> getAttributeDescriptions() {
+        std::array<VkVertexInputAttributeDescription, 6> attributeDescriptions = {};
+
+        // Model matrix, one column per location
+        for (uint32_t i = 0; i < 4; i++) {
+            attributeDescriptions[i].binding = 1;
+            attributeDescriptions[i].location = 5 + i;
+            attributeDescriptions[i].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+            attributeDescriptions[i].offset = offsetof(InstanceData, model) + sizeof(glm::vec4) * i;
+        }
+
+        // Albedo
+        attributeDescriptions[4].binding = 1;
+        attributeDescriptions[4].location = 9;
+        attributeDescriptions[4].format = VK_FORMAT_R32G32B32_SFLOAT;
+        attributeDescriptions[4].offset = offsetof(InstanceData, albedo);
+
+        // Metallic and roughness
+        attributeDescriptions[5].binding = 1;
+        attributeDescriptions[5].location = 10;
+        attributeDescriptions[5].format = VK_FORMAT_R32G32_SFLOAT;
+        attributeDescriptions[5].offset = offsetof(InstanceData, metallic);
+
+        return attributeDescriptions;
+    }
+};
+
+struct RendererSettings {
+    // Equirectangular Radiance .hdr file, empty for the procedural sky
+    std::string environmentPath;
+    // Read and write ibl_cache/; disabled to measure the cold precompute
+    bool iblCache = true;
+    // Spheres in the material grid
+    uint32_t instanceCount = DEFAULT_INSTANCE_COUNT;
+    // One vkCmdDrawIndexed for the whole grid, or one per sphere for comparison (I toggles)
+    bool instanced = true;
+    // Geometry and lighting subpasses over a transient G-buffer, or the single forward subpass (--forward)
+    bool deferred = true;
+};
+
+// Render pass attachment that is cleared on load and never stored. Its image is transient and, where the
+// device has a lazily allocated memory type, backed by memory that is only committed if the attachment
+// has to leave tile memory
+struct TransientAttachment {
+    VkImage image = VK_NULL_HANDLE;
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkImageView view = VK_NULL_HANDLE;
+    VkDeviceSize size = 0;
+    bool lazilyAllocated = false;
 };
 
 struct Vertex {
@@ -112,6 +204,8 @@ struct Vertex {
 
 class VulkanPBRRenderer {
 public:
+    explicit VulkanPBRRenderer(const RendererSettings& settings) : settings(settings) {}
+
     void run() {
         initWindow();
         initVulkan();
@@ -120,6 +214,8 @@ public:
     }
 
 private:
+    RendererSettings settings;
+
     GLFWwindow* window;
     VkInstance instance;
     VkDebugUtilsMessengerEXT debugMessenger;
@@ -133,10 +229,22 @@ private:
     VkFormat swapChainImageFormat;
     VkExtent2D swapChainExtent;
     std::vector<VkImageView> swapChainImageViews;
+    TransientAttachment depthAttachment;
+    VkFormat depthFormat;
     VkRenderPass renderPass;
     VkDescriptorSetLayout descriptorSetLayout;
     VkPipelineLayout pipelineLayout;
     VkPipeline graphicsPipeline;
+
+    // Deferred shading: subpass 0 writes the G-buffer, subpass 1 reads it back as input attachments
+    // (set 1) and shades one fullscreen triangle
+    TransientAttachment albedoMetallicAttachment;
+    TransientAttachment normalRoughnessAttachment;
+    VkDescriptorSetLayout inputAttachmentSetLayout = VK_NULL_HANDLE;
+    VkDescriptorPool inputAttachmentPool = VK_NULL_HANDLE;
+    VkDescriptorSet inputAttachmentSet;
+    VkPipelineLayout lightingPipelineLayout = VK_NULL_HANDLE;
+    VkPipeline lightingPipeline = VK_NULL_HANDLE;
     std::vector<VkFramebuffer> swapChainFramebuffers;
     VkCommandPool commandPool;
     std::vector<VkCommandBuffer> commandBuffers;
@@ -145,30 +253,57 @@ private:
     std::vector<VkFence> inFlightFences;
     size_t currentFrame = 0;
 
-    // Scene data
+    // Scene data: one sphere mesh drawn once per grid instance
     std::vector<Vertex> vertices;
     std::vector<uint32_t> indices;
+    std::vector<InstanceData> instances;
 
     // Buffers
     VkBuffer vertexBuffer;
     VkDeviceMemory vertexBufferMemory;
     VkBuffer indexBuffer;
     VkDeviceMemory indexBufferMemory;
+    VkBuffer instanceBuffer;
+    VkDeviceMemory instanceBufferMemory;
     std::vector<VkBuffer> uniformBuffers;
     std::vector<VkDeviceMemory> uniformBuffersMemory;
     std::vector<void*> uniformBuffersMapped;
 
+    // Image based lighting: GGX prefiltered cube map and split-sum BRDF lookup table
+    EnvironmentLighting environmentLighting;
+    VkImage prefilterImage;
+    VkDeviceMemory prefilterImageMemory;
+    VkImageView prefilterImageView;
+    VkSampler prefilterSampler;
+    VkImage brdfLutImage;
+    VkDeviceMemory brdfLutImageMemory;
+    VkImageView brdfLutImageView;
+    VkSampler brdfLutSampler;
+
     // Descriptors
     VkDescriptorPool descriptorPool;
     std::vector<VkDescriptorSet> descriptorSets;
 
-    // Camera
+    // Camera, framed around the grid in createInstanceBuffer()
     glm::mat4 model = glm::mat4(1.0f);
     glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 5.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-    glm::mat4 proj = glm::perspective(glm::radians(45.0f), static_cast<float>(WIDTH) / static_cast<float>(HEIGHT), 0.1f, 100.0f);
+    // The projection is built per frame from the swap chain extent
+    float farPlane = 100.0f;
     glm::vec3 lightPos = glm::vec3(0.0f, 2.0f, 2.0f);
     glm::vec3 viewPos = glm::vec3(0.0f, 0.0f, 5.0f);
 
+    // Frame timing: GPU time of the scene pass, CPU time to record it and the interval between frames
+    VkQueryPool timestampQueryPool = VK_NULL_HANDLE;
+    bool timestampsSupported = false;
+    float timestampPeriod = 1.0f;
+    std::array<bool, MAX_FRAMES_IN_FLIGHT> timestampsPending{};
+    double gpuMilliseconds = 0.0;
+    double recordMilliseconds = 0.0;
+    uint32_t gpuTimedFrames = 0;
+    uint32_t timedFrames = 0;
+    std::chrono::high_resolution_clock::time_point lastReportTime;
+    bool instancedKeyWasPressed = false;
+
     void initWindow() {
         glfwInit();
         glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
@@ -187,15 +322,21 @@ private:
         createRenderPass();
         createDescriptorSetLayout();
         createGraphicsPipeline();
-        createFramebuffers();
+        createLightingPipeline();
         createCommandPool();
+        createAttachments();
+        createFramebuffers();
+        createInputAttachmentDescriptors();
         loadModel();
         createVertexBuffer();
         createIndexBuffer();
+        createInstanceBuffer();
+        createEnvironmentTextures();
         createUniformBuffers();
         createDescriptorPool();
         createDescriptorSets();
         createCommandBuffers();
+        createTimestampQueries();
         createSyncObjects();
     }
 
@@ -588,6 +729,12 @@ private:
     }
 
     void createRenderPass() {
+        depthFormat = findDepthFormat();
+        if (settings.deferred) {
+            createDeferredRenderPass();
+            return;
+        }
+
         VkAttachmentDescription colorAttachment = {};
         colorAttachment.format = swapChainImageFormat;
         colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
@@ -598,27 +745,44 @@ private:
         colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
         colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
+        VkAttachmentDescription depthAttachment = {};
+        depthAttachment.format = depthFormat;
+        depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+        depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
         VkAttachmentReference colorAttachmentRef = {};
         colorAttachmentRef.attachment = 0;
         colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
+        VkAttachmentReference depthAttachmentRef = {};
+        depthAttachmentRef.attachment = 1;
+        depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
         VkSubpassDescription subpass = {};
         subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
         subpass.colorAttachmentCount = 1;
         subpass.pColorAttachments = &colorAttachmentRef;
+        subpass.pDepthStencilAttachment = &depthAttachmentRef;
 
         VkSubpassDependency dependency = {};
         dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
         dependency.dstSubpass = 0;
-        dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-        dependency.srcAccessMask = 0;
-        dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-        dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        dependency.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+        dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+        std::array<VkAttachmentDescription, 2> attachments = {colorAttachment, depthAttachment};
 
         VkRenderPassCreateInfo renderPassInfo = {};
         renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-        renderPassInfo.attachmentCount = 1;
-        renderPassInfo.pAttachments = &colorAttachment;
+        renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+        renderPassInfo.pAttachments = attachments.data();
         renderPassInfo.subpassCount = 1;
         renderPassInfo.pSubpasses = &subpass;
         renderPassInfo.dependencyCount = 1;
@@ -629,6 +793,101 @@ private:
         }
     }
 
+    // Attachments: 0 swap chain image, 1 depth, 2 albedo/metallic, 3 normal/roughness. Everything but the
+    // swap chain image is cleared on load and discarded on store, and the lighting subpass reads the G-buffer
+    // through input attachments, so a tiler can keep the whole G-buffer in tile memory for the entire pass
+    void createDeferredRenderPass() {
+        VkAttachmentDescription colorAttachment = {};
+        colorAttachment.format = swapChainImageFormat;
+        colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+        colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+        VkAttachmentDescription depthAttachment = colorAttachment;
+        depthAttachment.format = depthFormat;
+        depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+
+        VkAttachmentDescription albedoMetallicAttachment = depthAttachment;
+        albedoMetallicAttachment.format = ALBEDO_METALLIC_FORMAT;
+        albedoMetallicAttachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+        VkAttachmentDescription normalRoughnessAttachment = albedoMetallicAttachment;
+        normalRoughnessAttachment.format = NORMAL_ROUGHNESS_FORMAT;
+
+        // Subpass 0: geometry into the G-buffer
+        std::array<VkAttachmentReference, 2> gbufferAttachmentRefs = {};
+        gbufferAttachmentRefs[0] = {2, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+        gbufferAttachmentRefs[1] = {3, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+        VkAttachmentReference depthAttachmentRef = {1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
+
+        // Subpass 1: lighting, reading the G-buffer and depth at the current pixel
+        std::array<VkAttachmentReference, 3> inputAttachmentRefs = {};
+        inputAttachmentRefs[0] = {2, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+        inputAttachmentRefs[1] = {3, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+        inputAttachmentRefs[2] = {1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL};
+        VkAttachmentReference colorAttachmentRef = {0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+
+        std::array<VkSubpassDescription, 2> subpasses = {};
+        subpasses[0].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        subpasses[0].colorAttachmentCount = static_cast<uint32_t>(gbufferAttachmentRefs.size());
+        subpasses[0].pColorAttachments = gbufferAttachmentRefs.data();
+        subpasses[0].pDepthStencilAttachment = &depthAttachmentRef;
+
+        subpasses[1].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        subpasses[1].inputAttachmentCount = static_cast<uint32_t>(inputAttachmentRefs.size());
+        subpasses[1].pInputAttachments = inputAttachmentRefs.data();
+        subpasses[1].colorAttachmentCount = 1;
+        subpasses[1].pColorAttachments = &colorAttachmentRef;
+
+        std::array<VkSubpassDependency, 3> dependencies = {};
+
+        // The previous frame's geometry writes and lighting reads of the shared G-buffer finish before
+        // this frame's geometry subpass writes it
+        dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+        dependencies[0].dstSubpass = 0;
+        dependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        dependencies[0].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+        dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+        // The swap chain image is first written by the lighting subpass, after the acquire semaphore
+        dependencies[1].srcSubpass = VK_SUBPASS_EXTERNAL;
+        dependencies[1].dstSubpass = 1;
+        dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        dependencies[1].srcAccessMask = 0;
+        dependencies[1].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        dependencies[1].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+        // Lighting reads only the pixel it shades, so the dependency is per region and stays on chip
+        dependencies[2].srcSubpass = 0;
+        dependencies[2].dstSubpass = 1;
+        dependencies[2].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        dependencies[2].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        dependencies[2].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        dependencies[2].dstAccessMask = VK_ACCESS_INPUT_ATTACHMENT_READ_BIT;
+        dependencies[2].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+
+        std::array<VkAttachmentDescription, 4> attachments = {colorAttachment, depthAttachment, albedoMetallicAttachment, normalRoughnessAttachment};
+
+        VkRenderPassCreateInfo renderPassInfo = {};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+        renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+        renderPassInfo.pAttachments = attachments.data();
+        renderPassInfo.subpassCount = static_cast<uint32_t>(subpasses.size());
+        renderPassInfo.pSubpasses = subpasses.data();
+        renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+        renderPassInfo.pDependencies = dependencies.data();
+
+        if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create render pass!");
+        }
+    }
+
     void createDescriptorSetLayout() {
         VkDescriptorSetLayoutBinding uboLayoutBinding = {};
         uboLayoutBinding.binding = 0;
@@ -637,19 +896,54 @@ private:
         uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
         uboLayoutBinding.pImmutableSamplers = nullptr;
 
+        // 1: prefiltered environment cube map, 2: BRDF lookup table
+        VkDescriptorSetLayoutBinding prefilterLayoutBinding = {};
+        prefilterLayoutBinding.binding = 1;
+        prefilterLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        prefilterLayoutBinding.descriptorCount = 1;
+        prefilterLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+        VkDescriptorSetLayoutBinding brdfLutLayoutBinding = prefilterLayoutBinding;
+        brdfLutLayoutBinding.binding = 2;
+
+        std::array<VkDescriptorSetLayoutBinding, 3> bindings = {uboLayoutBinding, prefilterLayoutBinding, brdfLutLayoutBinding};
+
         VkDescriptorSetLayoutCreateInfo layoutInfo = {};
         layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-        layoutInfo.bindingCount = 1;
-        layoutInfo.pBindings = &uboLayoutBinding;
+        layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+        layoutInfo.pBindings = bindings.data();
 
         if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS) {
             throw std::runtime_error("failed to create descriptor set layout!");
         }
+
+        if (!settings.deferred) {
+            return;
+        }
+
+        // Set 1 of the lighting subpass: 0 albedo/metallic, 1 normal/roughness, 2 depth
+        std::array<VkDescriptorSetLayoutBinding, 3> inputBindings = {};
+        for (uint32_t i = 0; i < inputBindings.size(); i++) {
+            inputBindings[i].binding = i;
+            inputBindings[i].descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+            inputBindings[i].descriptorCount = 1;
+            inputBindings[i].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+        }
+
+        VkDescriptorSetLayoutCreateInfo inputLayoutInfo = {};
+        inputLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        inputLayoutInfo.bindingCount = static_cast<uint32_t>(inputBindings.size());
+        inputLayoutInfo.pBindings = inputBindings.data();
+
+        if (vkCreateDescriptorSetLayout(device, &inputLayoutInfo, nullptr, &inputAttachmentSetLayout) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create input attachment descriptor set layout!");
+        }
     }
 
+    // Scene pipeline: shades in the forward render pass, or writes the G-buffer in subpass 0 of the deferred one
     void createGraphicsPipeline() {
-        auto vertShaderCode = readFile("shaders/vertex.vert");
-        auto fragShaderCode = readFile("shaders/fragment.frag");
+        auto vertShaderCode = readFile("shaders/vertex.spv");
+        auto fragShaderCode = readFile(settings.deferred ? "shaders/gbuffer.spv" : "shaders/fragment.spv");
 
         VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
         VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
@@ -668,13 +962,20 @@ private:
 
         VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
 
-        auto bindingDescription = Vertex::getBindingDescription();
-        auto attributeDescriptions = Vertex::getAttributeDescriptions();
+        // Binding 0: sphere vertices, binding 1: per-instance transform and material
+        std::array<VkVertexInputBindingDescription, 2> bindingDescriptions = {Vertex::getBindingDescription(), InstanceData::getBindingDescription()};
+        std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
+        for (const auto& attribute : Vertex::getAttributeDescriptions()) {
+            attributeDescriptions.push_back(attribute);
+        }
+        for (const auto& attribute : InstanceData::getAttributeDescriptions()) {
+            attributeDescriptions.push_back(attribute);
+        }
 
         VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
         vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-        vertexInputInfo.vertexBindingDescriptionCount = 1;
-        vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+        vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
+        vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
         vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
         vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
 
@@ -709,7 +1010,8 @@ private:
         rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
         rasterizer.lineWidth = 1.0f;
         rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
-        rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
+        // The sphere is counter-clockwise seen from outside and the projection flips Y, which keeps that winding
+        rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
         rasterizer.depthBiasEnable = VK_FALSE;
         rasterizer.depthBiasConstantFactor = 0.0f;
         rasterizer.depthBiasClamp = 0.0f;
@@ -724,6 +1026,14 @@ private:
         multisampling.alphaToCoverageEnable = VK_FALSE;
         multisampling.alphaToOneEnable = VK_FALSE;
 
+        VkPipelineDepthStencilStateCreateInfo depthStencil = {};
+        depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+        depthStencil.depthTestEnable = VK_TRUE;
+        depthStencil.depthWriteEnable = VK_TRUE;
+        depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+        depthStencil.depthBoundsTestEnable = VK_FALSE;
+        depthStencil.stencilTestEnable = VK_FALSE;
+
         VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
         colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
         colorBlendAttachment.blendEnable = VK_FALSE;
@@ -734,12 +1044,15 @@ private:
         colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
         colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
 
+        // The geometry subpass writes both G-buffer attachments
+        std::array<VkPipelineColorBlendAttachmentState, 2> colorBlendAttachments = {colorBlendAttachment, colorBlendAttachment};
+
         VkPipelineColorBlendStateCreateInfo colorBlending = {};
         colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
         colorBlending.logicOpEnable = VK_FALSE;
         colorBlending.logicOp = VK_LOGIC_OP_COPY;
-        colorBlending.attachmentCount = 1;
-        colorBlending.pAttachments = &colorBlendAttachment;
+        colorBlending.attachmentCount = settings.deferred ? 2 : 1;
+        colorBlending.pAttachments = colorBlendAttachments.data();
         colorBlending.blendConstants[0] = 0.0f;
         colorBlending.blendConstants[1] = 0.0f;
         colorBlending.blendConstants[2] = 0.0f;
@@ -765,7 +1078,7 @@ private:
         pipelineInfo.pViewportState = &viewportState;
         pipelineInfo.pRasterizationState = &rasterizer;
         pipelineInfo.pMultisampleState = &multisampling;
-        pipelineInfo.pDepthStencilState = nullptr;
+        pipelineInfo.pDepthStencilState = &depthStencil;
         pipelineInfo.pColorBlendState = &colorBlending;
         pipelineInfo.pDynamicState = nullptr;
         pipelineInfo.layout = pipelineLayout;
@@ -782,6 +1095,122 @@ private:
         vkDestroyShaderModule(device, vertShaderModule, nullptr);
     }
 
+    // Lighting subpass of the deferred render pass: one fullscreen triangle without vertex buffers, shading
+    // each pixel from the G-buffer input attachments
+    void createLightingPipeline() {
+        if (!settings.deferred) {
+            return;
+        }
+
+        auto vertShaderCode = readFile("shaders/fullscreen.spv");
+        auto fragShaderCode = readFile("shaders/lighting.spv");
+
+        VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
+        VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
+
+        VkPipelineShaderStageCreateInfo vertShaderStageInfo = {};
+        vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
+        vertShaderStageInfo.module = vertShaderModule;
+        vertShaderStageInfo.pName = "main";
+
+        VkPipelineShaderStageCreateInfo fragShaderStageInfo = {};
+        fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+        fragShaderStageInfo.module = fragShaderModule;
+        fragShaderStageInfo.pName = "main";
+
+        VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
+
+        VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
+        vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+        VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
+        inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+        inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+        inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+        VkViewport viewport = {};
+        viewport.x = 0.0f;
+        viewport.y = 0.0f;
+        viewport.width = (float) swapChainExtent.width;
+        viewport.height = (float) swapChainExtent.height;
+        viewport.minDepth = 0.0f;
+        viewport.maxDepth = 1.0f;
+
+        VkRect2D scissor = {};
+        scissor.offset = {0, 0};
+        scissor.extent = swapChainExtent;
+
+        VkPipelineViewportStateCreateInfo viewportState = {};
+        viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+        viewportState.viewportCount = 1;
+        viewportState.pViewports = &viewport;
+        viewportState.scissorCount = 1;
+        viewportState.pScissors = &scissor;
+
+        VkPipelineRasterizationStateCreateInfo rasterizer = {};
+        rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+        rasterizer.depthClampEnable = VK_FALSE;
+        rasterizer.rasterizerDiscardEnable = VK_FALSE;
+        rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+        rasterizer.lineWidth = 1.0f;
+        rasterizer.cullMode = VK_CULL_MODE_NONE;
+        rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
+        rasterizer.depthBiasEnable = VK_FALSE;
+
+        VkPipelineMultisampleStateCreateInfo multisampling = {};
+        multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+        multisampling.sampleShadingEnable = VK_FALSE;
+        multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+        VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
+        colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+        colorBlendAttachment.blendEnable = VK_FALSE;
+
+        VkPipelineColorBlendStateCreateInfo colorBlending = {};
+        colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+        colorBlending.logicOpEnable = VK_FALSE;
+        colorBlending.attachmentCount = 1;
+        colorBlending.pAttachments = &colorBlendAttachment;
+
+        // Set 0 is the scene's uniform buffer and environment maps, set 1 the G-buffer
+        std::array<VkDescriptorSetLayout, 2> setLayouts = {descriptorSetLayout, inputAttachmentSetLayout};
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+        pipelineLayoutInfo.pSetLayouts = setLayouts.data();
+
+        if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &lightingPipelineLayout) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create lighting pipeline layout!");
+        }
+
+        VkGraphicsPipelineCreateInfo pipelineInfo = {};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+        pipelineInfo.stageCount = 2;
+        pipelineInfo.pStages = shaderStages;
+        pipelineInfo.pVertexInputState = &vertexInputInfo;
+        pipelineInfo.pInputAssemblyState = &inputAssembly;
+        pipelineInfo.pViewportState = &viewportState;
+        pipelineInfo.pRasterizationState = &rasterizer;
+        pipelineInfo.pMultisampleState = &multisampling;
+        pipelineInfo.pDepthStencilState = nullptr;
+        pipelineInfo.pColorBlendState = &colorBlending;
+        pipelineInfo.layout = lightingPipelineLayout;
+        pipelineInfo.renderPass = renderPass;
+        pipelineInfo.subpass = 1;
+        pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+        pipelineInfo.basePipelineIndex = -1;
+
+        if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &lightingPipeline) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create lighting pipeline!");
+        }
+
+        vkDestroyShaderModule(device, fragShaderModule, nullptr);
+        vkDestroyShaderModule(device, vertShaderModule, nullptr);
+    }
+
     std::vector<char> readFile(const std::string& filename) {
         std::ifstream file(filename, std::ios::ate | std::ios::binary);
 
@@ -818,13 +1247,14 @@ private:
         swapChainFramebuffers.resize(swapChainImageViews.size());
 
         for (size_t i = 0; i < swapChainImageViews.size(); i++) {
-            VkImageView attachments[] = {swapChainImageViews[i]};
+            // The forward render pass uses the first two
+            std::array<VkImageView, 4> attachments = {swapChainImageViews[i], depthAttachment.view, albedoMetallicAttachment.view, normalRoughnessAttachment.view};
 
             VkFramebufferCreateInfo framebufferInfo = {};
             framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
             framebufferInfo.renderPass = renderPass;
-            framebufferInfo.attachmentCount = 1;
-            framebufferInfo.pAttachments = attachments;
+            framebufferInfo.attachmentCount = settings.deferred ? 4 : 2;
+            framebufferInfo.pAttachments = attachments.data();
             framebufferInfo.width = swapChainExtent.width;
             framebufferInfo.height = swapChainExtent.height;
             framebufferInfo.layers = 1;
@@ -849,53 +1279,35 @@ private:
     }
 
     void loadModel() {
-        // Simple cube for demonstration
-        vertices = {
-            // Front face
-            {{-1.0f, -1.0f,  1.0f}, {0.0f,  0.0f,  1.0f}, {0.0f, 0.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}},
-            {{ 1.0f, -1.0f,  1.0f}, {0.0f,  0.0f,  1.0f}, {1.0f, 0.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}},
-            {{ 1.0f,  1.0f,  1.0f}, {0.0f,  0.0f,  1.0f}, {1.0f, 1.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}},
-            {{-1.0f,  1.0f,  1.0f}, {0.0f,  0.0f,  1.0f}, {0.0f, 1.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}},
-
-            // Back face
-            {{-1.0f, -1.0f, -1.0f}, {0.0f,  0.0f, -1.0f}, {1.0f, 0.0f}, {-1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}},
-            {{-1.0f,  1.0f, -1.0f}, {0.0f,  0.0f, -1.0f}, {1.0f, 1.0f}, {-1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}},
-            {{ 1.0f,  1.0f, -1.0f}, {0.0f,  0.0f, -1.0f}, {0.0f, 1.0f}, {-1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}},
-            {{ 1.0f, -1.0f, -1.0f}, {0.0f,  0.0f, -1.0f}, {0.0f, 0.0f}, {-1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}},
-
-            // Top face
-            {{-1.0f,  1.0f, -1.0f}, {0.0f,  1.0f,  0.0f}, {0.0f, 1.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 0.0f, -1.0f}},
-            {{-1.0f,  1.0f,  1.0f}, {0.0f,  1.0f,  0.0f}, {0.0f, 0.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 0.0f, -1.0f}},
-            {{ 1.0f,  1.0f,  1.0f}, {0.0f,  1.0f,  0.0f}, {1.0f, 0.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 0.0f, -1.0f}},
-            {{ 1.0f,  1.0f, -1.0f}, {0.0f,  1.0f,  0.0f}, {1.0f, 1.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 0.0f, -1.0f}},
-
-            // Bottom face
-            {{-1.0f, -1.0f, -1.0f}, {0.0f, -1.0f,  0.0f}, {1.0f, 1.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 1.0f}},
-            {{ 1.0f, -1.0f, -1.0f}, {0.0f, -1.0f,  0.0f}, {0.0f, 1.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 1.0f}},
-            {{ 1.0f, -1.0f,  1.0f}, {0.0f, -1.0f,  0.0f}, {0.0f, 0.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 1.0f}},
-            {{-1.0f, -1.0f,  1.0f}, {0.0f, -1.0f,  0.0f}, {1.0f, 0.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 1.0f}},
-
-            // Right face
-            {{ 1.0f, -1.0f, -1.0f}, {1.0f,  0.0f,  0.0f}, {1.0f, 0.0f}, {0.0f, 0.0f, -1.0f}, {0.0f, 1.0f, 0.0f}},
-            {{ 1.0f,  1.0f, -1.0f}, {1.0f,  0.0f,  0.0f}, {1.0f, 1.0f}, {0.0f, 0.0f, -1.0f}, {0.0f, 1.0f, 0.0f}},
-            {{ 1.0f,  1.0f,  1.0f}, {1.0f,  0.0f,  0.0f}, {0.0f, 1.0f}, {0.0f, 0.0f, -1.0f}, {0.0f, 1.0f, 0.0f}},
-            {{ 1.0f, -1.0f,  1.0f}, {1.0f,  0.0f,  0.0f}, {0.0f, 0.0f}, {0.0f, 0.0f, -1.0f}, {0.0f, 1.0f, 0.0f}},
-
-            // Left face
-            {{-1.0f, -1.0f, -1.0f}, {-1.0f,  0.0f,  0.0f}, {0.0f, 0.0f}, {0.0f, 0.0f, 1.0f}, {0.0f, 1.0f, 0.0f}},
-            {{-1.0f, -1.0f,  1.0f}, {-1.0f,  0.0f,  0.0f}, {1.0f, 0.0f}, {0.0f, 0.0f, 1.0f}, {0.0f, 1.0f, 0.0f}},
-            {{-1.0f,  1.0f,  1.0f}, {-1.0f,  0.0f,  0.0f}, {1.0f, 1.0f}, {0.0f, 0.0f, 1.0f}, {0.0f, 1.0f, 0.0f}},
-            {{-1.0f,  1.0f, -1.0f}, {-1.0f,  0.0f,  0.0f}, {0.0f, 1.0f}, {0.0f, 0.0f, 1.0f}, {0.0f, 1.0f, 0.0f}}
-        };
-
-        indices = {
-            0, 1, 2, 2, 3, 0,
-            4, 5, 6, 6, 7, 4,
-            8, 9, 10, 10, 11, 8,
-            12, 13, 14, 14, 15, 12,
-            16, 17, 18, 18, 19, 16,
-            20, 21, 22, 22, 23, 20
-        };
+        // Unit UV sphere, counter-clockwise seen from outside
+        vertices.clear();
+        indices.clear();
+
+        for (uint32_t ring = 0; ring <= SPHERE_RINGS; ring++) {
+            float phi = glm::pi<float>() * ring / SPHERE_RINGS;
+            for (uint32_t segment = 0; segment <= SPHERE_SEGMENTS; segment++) {
+                float theta = 2.0f * glm::pi<float>() * segment / SPHERE_SEGMENTS;
+                glm::vec3 normal(std::sin(phi) * std::cos(theta), std::cos(phi), std::sin(phi) * std::sin(theta));
+                glm::vec3 tangent(-std::sin(theta), 0.0f, std::cos(theta));
+
+                Vertex vertex = {};
+                vertex.pos = normal;
+                vertex.normal = normal;
+                vertex.texCoord = glm::vec2(static_cast<float>(segment) / SPHERE_SEGMENTS, static_cast<float>(ring) / SPHERE_RINGS);
+                vertex.tangent = tangent;
+                vertex.bitangent = glm::cross(normal, tangent);
+                vertices.push_back(vertex);
+            }
+        }
+
+        for (uint32_t ring = 0; ring < SPHERE_RINGS; ring++) {
+            for (uint32_t segment = 0; segment < SPHERE_SEGMENTS; segment++) {
+                uint32_t current = ring * (SPHERE_SEGMENTS + 1) + segment;
+                uint32_t below = current + SPHERE_SEGMENTS + 1;
+                indices.insert(indices.end(), {current, current + 1, below});
+                indices.insert(indices.end(), {current + 1, below + 1, below});
+            }
+        }
     }
 
     void createVertexBuffer() {
@@ -938,6 +1350,52 @@ private:
         vkFreeMemory(device, stagingBufferMemory, nullptr);
     }
 
+    // Lays the spheres out on a square grid in the XY plane and frames the camera and light around it
+    void createInstanceBuffer() {
+        uint32_t columns = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(settings.instanceCount))));
+        uint32_t rows = (settings.instanceCount + columns - 1) / columns;
+        glm::vec2 origin = -0.5f * GRID_SPACING * glm::vec2(columns - 1, rows - 1);
+
+        instances.resize(settings.instanceCount);
+        for (uint32_t i = 0; i < settings.instanceCount; i++) {
+            uint32_t column = i % columns;
+            uint32_t row = i / columns;
+            InstanceData& instance = instances[i];
+            instance.model = glm::translate(glm::mat4(1.0f), glm::vec3(origin + GRID_SPACING * glm::vec2(column, row), 0.0f));
+            instance.albedo = glm::vec3(0.8f, 0.8f, 0.8f);
+            instance.metallic = columns > 1 ? static_cast<float>(column) / (columns - 1) : 0.0f;
+            instance.roughness = glm::clamp(rows > 1 ? static_cast<float>(row) / (rows - 1) : 0.5f, 0.05f, 1.0f);
+        }
+
+        float halfExtent = 0.5f * GRID_SPACING * std::max(columns, rows) + 1.0f;
+        float distance = halfExtent / std::tan(glm::radians(22.5f)) + 1.0f;
+        viewPos = glm::vec3(0.0f, 0.0f, distance);
+        lightPos = glm::vec3(0.0f, 0.0f, 0.5f * distance);
+        view = glm::lookAt(viewPos, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        farPlane = 2.0f * distance;
+
+        VkDeviceSize bufferSize = sizeof(instances[0]) * instances.size();
+
+        VkBuffer stagingBuffer;
+        VkDeviceMemory stagingBufferMemory;
+        createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+
+        void* data;
+        vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
+        memcpy(data, instances.data(), (size_t) bufferSize);
+        vkUnmapMemory(device, stagingBufferMemory);
+
+        createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, instanceBuffer, instanceBufferMemory);
+
+        copyBuffer(stagingBuffer, instanceBuffer, bufferSize);
+
+        vkDestroyBuffer(device, stagingBuffer, nullptr);
+        vkFreeMemory(device, stagingBufferMemory, nullptr);
+
+        std::cout << settings.instanceCount << " spheres (" << columns << "x" << rows << "), "
+                  << indices.size() / 3 << " triangles each" << std::endl;
+    }
+
     void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory) {
         VkBufferCreateInfo bufferInfo = {};
         bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -977,7 +1435,7 @@ private:
         throw std::runtime_error("failed to find suitable memory type!");
     }
 
-    void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
+    VkCommandBuffer beginSingleTimeCommands() {
         VkCommandBufferAllocateInfo allocInfo = {};
         allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
         allocInfo.commandPool = commandPool;
@@ -993,10 +1451,10 @@ private:
 
         vkBeginCommandBuffer(commandBuffer, &beginInfo);
 
-        VkBufferCopy copyRegion = {};
-        copyRegion.size = size;
-        vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
+        return commandBuffer;
+    }
 
+    void endSingleTimeCommands(VkCommandBuffer commandBuffer) {
         vkEndCommandBuffer(commandBuffer);
 
         VkSubmitInfo submitInfo = {};
@@ -1010,6 +1468,348 @@ private:
         vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
     }
 
+    void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
+        VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+
+        VkBufferCopy copyRegion = {};
+        copyRegion.size = size;
+        vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
+
+        endSingleTimeCommands(commandBuffer);
+    }
+
+    void createImage(uint32_t width, uint32_t height, uint32_t mipLevels, uint32_t arrayLayers, VkImageCreateFlags flags, VkFormat format, VkImageUsageFlags usage, VkImage& image, VkDeviceMemory& imageMemory) {
+        VkImageCreateInfo imageInfo = {};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.flags = flags;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.extent.width = width;
+        imageInfo.extent.height = height;
+        imageInfo.extent.depth = 1;
+        imageInfo.mipLevels = mipLevels;
+        imageInfo.arrayLayers = arrayLayers;
+        imageInfo.format = format;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageInfo.usage = usage;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        if (vkCreateImage(device, &imageInfo, nullptr, &image) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create image!");
+        }
+
+        VkMemoryRequirements memRequirements;
+        vkGetImageMemoryRequirements(device, image, &memRequirements);
+
+        VkMemoryAllocateInfo allocInfo = {};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = memRequirements.size;
+        allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        if (vkAllocateMemory(device, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate image memory!");
+        }
+
+        vkBindImageMemory(device, image, imageMemory, 0);
+    }
+
+    // Whole-image barrier between the two layouts used for uploads
+    void transitionImageLayout(VkCommandBuffer commandBuffer, VkImage image, uint32_t mipLevels, uint32_t arrayLayers, VkImageLayout oldLayout, VkImageLayout newLayout) {
+        VkImageMemoryBarrier barrier = {};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.oldLayout = oldLayout;
+        barrier.newLayout = newLayout;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = image;
+        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.levelCount = mipLevels;
+        barrier.subresourceRange.layerCount = arrayLayers;
+
+        VkPipelineStageFlags srcStage;
+        VkPipelineStageFlags dstStage;
+        if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED) {
+            barrier.srcAccessMask = 0;
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            srcStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+            dstStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        } else {
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            srcStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+            dstStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        }
+
+        vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    }
+
+    VkImageView createImageView(VkImage image, VkImageViewType viewType, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels, uint32_t arrayLayers) {
+        VkImageViewCreateInfo viewInfo = {};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = image;
+        viewInfo.viewType = viewType;
+        viewInfo.format = format;
+        viewInfo.subresourceRange.aspectMask = aspectFlags;
+        viewInfo.subresourceRange.levelCount = mipLevels;
+        viewInfo.subresourceRange.layerCount = arrayLayers;
+
+        VkImageView imageView;
+        if (vkCreateImageView(device, &viewInfo, nullptr, &imageView) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create image view!");
+        }
+        return imageView;
+    }
+
+    VkFormat findDepthFormat() {
+        for (VkFormat format : {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT}) {
+            VkFormatProperties properties;
+            vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &properties);
+            if (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT) {
+                return format;
+            }
+        }
+
+        throw std::runtime_error("failed to find supported depth format!");
+    }
+
+    // Depth, plus the G-buffer when deferred; the deferred pass also reads depth as an input attachment
+    void createAttachments() {
+        VkImageUsageFlags inputUsage = settings.deferred ? VkImageUsageFlags(VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT) : VkImageUsageFlags(0);
+        depthAttachment = createTransientAttachment(depthFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | inputUsage, VK_IMAGE_ASPECT_DEPTH_BIT);
+        if (settings.deferred) {
+            albedoMetallicAttachment = createTransientAttachment(ALBEDO_METALLIC_FORMAT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | inputUsage, VK_IMAGE_ASPECT_COLOR_BIT);
+            normalRoughnessAttachment = createTransientAttachment(NORMAL_ROUGHNESS_FORMAT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | inputUsage, VK_IMAGE_ASPECT_COLOR_BIT);
+        }
+
+        VkDeviceSize requiredBytes, committedBytes;
+        queryAttachmentMemory(requiredBytes, committedBytes);
+        std::cout << (settings.deferred ? "deferred" : "forward") << " attachments at " << swapChainExtent.width << "x" << swapChainExtent.height
+                  << ": " << requiredBytes / (1024.0 * 1024.0) << " MB if fully backed, "
+                  << (depthAttachment.lazilyAllocated ? "lazily allocated" : "no lazily allocated memory type on this device") << std::endl;
+    }
+
+    // Swap chain sized attachment that is never loaded, stored or sampled. Prefers lazily allocated memory,
+    // which desktop GPUs usually lack; the image is then fully backed by device local memory
+    TransientAttachment createTransientAttachment(VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspectFlags) {
+        TransientAttachment attachment;
+
+        VkImageCreateInfo imageInfo = {};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.extent.width = swapChainExtent.width;
+        imageInfo.extent.height = swapChainExtent.height;
+        imageInfo.extent.depth = 1;
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.format = format;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageInfo.usage = usage | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        if (vkCreateImage(device, &imageInfo, nullptr, &attachment.image) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create attachment image!");
+        }
+
+        VkMemoryRequirements memRequirements;
+        vkGetImageMemoryRequirements(device, attachment.image, &memRequirements);
+        attachment.size = memRequirements.size;
+
+        VkPhysicalDeviceMemoryProperties memProperties;
+        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+        uint32_t memoryTypeIndex = memProperties.memoryTypeCount;
+        for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+            if ((memRequirements.memoryTypeBits & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT)) {
+                memoryTypeIndex = i;
+                attachment.lazilyAllocated = true;
+                break;
+            }
+        }
+        if (!attachment.lazilyAllocated) {
+            memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        }
+
+        VkMemoryAllocateInfo allocInfo = {};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = memRequirements.size;
+        allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+        if (vkAllocateMemory(device, &allocInfo, nullptr, &attachment.memory) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate attachment memory!");
+        }
+
+        vkBindImageMemory(device, attachment.image, attachment.memory, 0);
+        attachment.view = createImageView(attachment.image, VK_IMAGE_VIEW_TYPE_2D, format, aspectFlags, 1, 1);
+        return attachment;
+    }
+
+    void destroyTransientAttachment(TransientAttachment& attachment) {
+        if (attachment.image == VK_NULL_HANDLE) {
+            return;
+        }
+        vkDestroyImageView(device, attachment.view, nullptr);
+        vkDestroyImage(device, attachment.image, nullptr);
+        vkFreeMemory(device, attachment.memory, nullptr);
+        attachment = TransientAttachment();
+    }
+
+    // Sums the memory the attachments would need if fully backed and the part the driver has committed so
+    // far; the difference is what lazy allocation saves
+    void queryAttachmentMemory(VkDeviceSize& requiredBytes, VkDeviceSize& committedBytes) {
+        requiredBytes = 0;
+        committedBytes = 0;
+        for (const TransientAttachment* attachment : {&depthAttachment, &albedoMetallicAttachment, &normalRoughnessAttachment}) {
+            if (attachment->image == VK_NULL_HANDLE) {
+                continue;
+            }
+            VkDeviceSize committed = attachment->size;
+            if (attachment->lazilyAllocated) {
+                vkGetDeviceMemoryCommitment(device, attachment->memory, &committed);
+            }
+            requiredBytes += attachment->size;
+            committedBytes += committed;
+        }
+    }
+
+    // Points set 1 of the lighting subpass at the current G-buffer views
+    void createInputAttachmentDescriptors() {
+        if (!settings.deferred) {
+            return;
+        }
+
+        VkDescriptorPoolSize poolSize = {};
+        poolSize.type = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+        poolSize.descriptorCount = 3;
+
+        VkDescriptorPoolCreateInfo poolInfo = {};
+        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolInfo.poolSizeCount = 1;
+        poolInfo.pPoolSizes = &poolSize;
+        poolInfo.maxSets = 1;
+
+        if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &inputAttachmentPool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create input attachment descriptor pool!");
+        }
+
+        VkDescriptorSetAllocateInfo allocInfo = {};
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorPool = inputAttachmentPool;
+        allocInfo.descriptorSetCount = 1;
+        allocInfo.pSetLayouts = &inputAttachmentSetLayout;
+
+        if (vkAllocateDescriptorSets(device, &allocInfo, &inputAttachmentSet) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate input attachment descriptor set!");
+        }
+
+        std::array<VkDescriptorImageInfo, 3> imageInfos = {};
+        imageInfos[0] = {VK_NULL_HANDLE, albedoMetallicAttachment.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+        imageInfos[1] = {VK_NULL_HANDLE, normalRoughnessAttachment.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+        imageInfos[2] = {VK_NULL_HANDLE, depthAttachment.view, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL};
+
+        std::array<VkWriteDescriptorSet, 3> descriptorWrites = {};
+        for (uint32_t i = 0; i < descriptorWrites.size(); i++) {
+            descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrites[i].dstSet = inputAttachmentSet;
+            descriptorWrites[i].dstBinding = i;
+            descriptorWrites[i].dstArrayElement = 0;
+            descriptorWrites[i].descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+            descriptorWrites[i].descriptorCount = 1;
+            descriptorWrites[i].pImageInfo = &imageInfos[i];
+        }
+
+        vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+    }
+
+    VkSampler createLinearSampler(float maxLod) {
+        VkSamplerCreateInfo samplerInfo = {};
+        samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+        samplerInfo.magFilter = VK_FILTER_LINEAR;
+        samplerInfo.minFilter = VK_FILTER_LINEAR;
+        samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+        samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.minLod = 0.0f;
+        samplerInfo.maxLod = maxLod;
+
+        VkSampler sampler;
+        if (vkCreateSampler(device, &samplerInfo, nullptr, &sampler) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create sampler!");
+        }
+        return sampler;
+    }
+
+    // Loads or precomputes the environment lighting and uploads the prefiltered cube map (every mip
+    // comes from the precompute) and the BRDF lookup table through one staging buffer.
+    // Cube map filtering is always seamless in Vulkan.
+    void createEnvironmentTextures() {
+        if (!loadEnvironmentLighting(settings.environmentPath, settings.iblCache, environmentLighting)) {
+            throw std::runtime_error("failed to load environment lighting!");
+        }
+        reportEnvironmentLighting(environmentLighting);
+
+        VkDeviceSize specularSize = environmentLighting.specular.size() * sizeof(uint16_t);
+        VkDeviceSize brdfLutSize = environmentLighting.brdfLut.size() * sizeof(uint16_t);
+
+        VkBuffer stagingBuffer;
+        VkDeviceMemory stagingBufferMemory;
+        createBuffer(specularSize + brdfLutSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+
+        void* data;
+        vkMapMemory(device, stagingBufferMemory, 0, specularSize + brdfLutSize, 0, &data);
+        memcpy(data, environmentLighting.specular.data(), static_cast<size_t>(specularSize));
+        memcpy(static_cast<char*>(data) + specularSize, environmentLighting.brdfLut.data(), static_cast<size_t>(brdfLutSize));
+        vkUnmapMemory(device, stagingBufferMemory);
+
+        createImage(IBL_SPECULAR_SIZE, IBL_SPECULAR_SIZE, IBL_SPECULAR_MIP_LEVELS, 6, VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT, VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, prefilterImage, prefilterImageMemory);
+        createImage(IBL_BRDF_LUT_SIZE, IBL_BRDF_LUT_SIZE, 1, 1, 0, VK_FORMAT_R16G16_SFLOAT, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, brdfLutImage, brdfLutImageMemory);
+
+        // One region per mip level and face, laid out as in EnvironmentLighting::specular
+        std::vector<VkBufferImageCopy> specularRegions;
+        for (int level = 0; level < IBL_SPECULAR_MIP_LEVELS; level++) {
+            uint32_t size = static_cast<uint32_t>(specularMipSize(level));
+            for (int face = 0; face < 6; face++) {
+                VkBufferImageCopy region = {};
+                region.bufferOffset = specularOffset(level, face) * sizeof(uint16_t);
+                region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+                region.imageSubresource.mipLevel = static_cast<uint32_t>(level);
+                region.imageSubresource.baseArrayLayer = static_cast<uint32_t>(face);
+                region.imageSubresource.layerCount = 1;
+                region.imageExtent = {size, size, 1};
+                specularRegions.push_back(region);
+            }
+        }
+
+        VkBufferImageCopy brdfLutRegion = {};
+        brdfLutRegion.bufferOffset = specularSize;
+        brdfLutRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        brdfLutRegion.imageSubresource.layerCount = 1;
+        brdfLutRegion.imageExtent = {IBL_BRDF_LUT_SIZE, IBL_BRDF_LUT_SIZE, 1};
+
+        VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+        transitionImageLayout(commandBuffer, prefilterImage, IBL_SPECULAR_MIP_LEVELS, 6, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+        transitionImageLayout(commandBuffer, brdfLutImage, 1, 1, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+        vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, prefilterImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(specularRegions.size()), specularRegions.data());
+        vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, brdfLutImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &brdfLutRegion);
+        transitionImageLayout(commandBuffer, prefilterImage, IBL_SPECULAR_MIP_LEVELS, 6, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        transitionImageLayout(commandBuffer, brdfLutImage, 1, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        endSingleTimeCommands(commandBuffer);
+
+        vkDestroyBuffer(device, stagingBuffer, nullptr);
+        vkFreeMemory(device, stagingBufferMemory, nullptr);
+
+        prefilterImageView = createImageView(prefilterImage, VK_IMAGE_VIEW_TYPE_CUBE, VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, IBL_SPECULAR_MIP_LEVELS, 6);
+        brdfLutImageView = createImageView(brdfLutImage, VK_IMAGE_VIEW_TYPE_2D, VK_FORMAT_R16G16_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, 1, 1);
+        prefilterSampler = createLinearSampler(static_cast<float>(IBL_SPECULAR_MIP_LEVELS - 1));
+        brdfLutSampler = createLinearSampler(0.0f);
+
+        // Only the SH coefficients are needed after the upload
+        environmentLighting.specular = std::vector<uint16_t>();
+        environmentLighting.brdfLut = std::vector<uint16_t>();
+    }
+
     void createUniformBuffers() {
         VkDeviceSize bufferSize = sizeof(UniformBufferObject);
 
@@ -1025,14 +1825,16 @@ private:
     }
 
     void createDescriptorPool() {
-        VkDescriptorPoolSize poolSize = {};
-        poolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        poolSize.descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+        std::array<VkDescriptorPoolSize, 2> poolSizes = {};
+        poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        poolSizes[0].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+        poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        poolSizes[1].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT * 2);
 
         VkDescriptorPoolCreateInfo poolInfo = {};
         poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-        poolInfo.poolSizeCount = 1;
-        poolInfo.pPoolSizes = &poolSize;
+        poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+        poolInfo.pPoolSizes = poolSizes.data();
         poolInfo.maxSets = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
 
         if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
@@ -1060,16 +1862,38 @@ private:
             bufferInfo.offset = 0;
             bufferInfo.range = sizeof(UniformBufferObject);
 
-            VkWriteDescriptorSet descriptorWrite = {};
-            descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            descriptorWrite.dstSet = descriptorSets[i];
-            descriptorWrite.dstBinding = 0;
-            descriptorWrite.dstArrayElement = 0;
-            descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-            descriptorWrite.descriptorCount = 1;
-            descriptorWrite.pBufferInfo = &bufferInfo;
-
-            vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, nullptr);
+            VkDescriptorImageInfo prefilterInfo = {};
+            prefilterInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            prefilterInfo.imageView = prefilterImageView;
+            prefilterInfo.sampler = prefilterSampler;
+
+            VkDescriptorImageInfo brdfLutInfo = {};
+            brdfLutInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            brdfLutInfo.imageView = brdfLutImageView;
+            brdfLutInfo.sampler = brdfLutSampler;
+
+            std::array<VkWriteDescriptorSet, 3> descriptorWrites = {};
+            descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrites[0].dstSet = descriptorSets[i];
+            descriptorWrites[0].dstBinding = 0;
+            descriptorWrites[0].dstArrayElement = 0;
+            descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+            descriptorWrites[0].descriptorCount = 1;
+            descriptorWrites[0].pBufferInfo = &bufferInfo;
+
+            descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrites[1].dstSet = descriptorSets[i];
+            descriptorWrites[1].dstBinding = 1;
+            descriptorWrites[1].dstArrayElement = 0;
+            descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            descriptorWrites[1].descriptorCount = 1;
+            descriptorWrites[1].pImageInfo = &prefilterInfo;
+
+            descriptorWrites[2] = descriptorWrites[1];
+            descriptorWrites[2].dstBinding = 2;
+            descriptorWrites[2].pImageInfo = &brdfLutInfo;
+
+            vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
         }
     }
 
@@ -1087,6 +1911,27 @@ private:
         }
     }
 
+    void createTimestampQueries() {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+        timestampsSupported = properties.limits.timestampComputeAndGraphics == VK_TRUE;
+        timestampPeriod = properties.limits.timestampPeriod;
+        lastReportTime = std::chrono::high_resolution_clock::now();
+        if (!timestampsSupported) {
+            std::cout << "GPU timestamps not supported, only CPU times will be reported" << std::endl;
+            return;
+        }
+
+        VkQueryPoolCreateInfo queryPoolInfo = {};
+        queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        queryPoolInfo.queryCount = TIMESTAMPS_PER_FRAME * MAX_FRAMES_IN_FLIGHT;
+
+        if (vkCreateQueryPool(device, &queryPoolInfo, nullptr, &timestampQueryPool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create timestamp query pool!");
+        }
+    }
+
     void createSyncObjects() {
         imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
         renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
@@ -1110,18 +1955,19 @@ private:
     }
 
     void updateUniformBuffer(uint32_t currentImage) {
-        static auto startTime = std::chrono::high_resolution_clock::now();
-
-        auto currentTime = std::chrono::high_resolution_clock::now();
-        float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
-
         UniformBufferObject ubo = {};
-        ubo.model = glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        ubo.model = model;
         ubo.view = view;
-        ubo.proj = proj;
+        float aspect = static_cast<float>(swapChainExtent.width) / static_cast<float>(swapChainExtent.height);
+        ubo.proj = glm::perspective(glm::radians(45.0f), aspect, 0.1f, farPlane);
         ubo.proj[1][1] *= -1;
         ubo.lightPos = lightPos;
-        ubo.viewPos = glm::vec3(0.0f, 0.0f, 5.0f);
+        ubo.viewPos = viewPos;
+        for (int i = 0; i < 9; i++) {
+            ubo.irradianceSH[i] = environmentLighting.irradianceSH[i];
+        }
+        ubo.environmentParams = glm::vec4(static_cast<float>(IBL_SPECULAR_MIP_LEVELS - 1), 0.0f, 0.0f, 0.0f);
+        ubo.invViewProj = glm::inverse(ubo.proj * ubo.view);
 
         memcpy(uniformBuffersMapped[currentImage], &ubo, sizeof(ubo));
     }
@@ -1141,25 +1987,59 @@ private:
         renderPassInfo.renderArea.offset = {0, 0};
         renderPassInfo.renderArea.extent = swapChainExtent;
 
-        VkClearValue clearColor = {{{0.1f, 0.1f, 0.1f, 1.0f}}};
-        renderPassInfo.clearValueCount = 1;
-        renderPassInfo.pClearValues = &clearColor;
+        // The G-buffer clears are only used when deferred; the lighting subpass leaves background pixels at the
+        // swap chain clear color
+        std::array<VkClearValue, 4> clearValues = {};
+        clearValues[0].color = {{0.1f, 0.1f, 0.1f, 1.0f}};
+        clearValues[1].depthStencil = {1.0f, 0};
+        clearValues[2].color = {{0.0f, 0.0f, 0.0f, 0.0f}};
+        clearValues[3].color = {{0.0f, 0.0f, 0.0f, 0.0f}};
+        renderPassInfo.clearValueCount = settings.deferred ? 4 : 2;
+        renderPassInfo.pClearValues = clearValues.data();
+
+        uint32_t firstQuery = static_cast<uint32_t>(currentFrame * TIMESTAMPS_PER_FRAME);
+        if (timestampsSupported) {
+            vkCmdResetQueryPool(commandBuffer, timestampQueryPool, firstQuery, TIMESTAMPS_PER_FRAME);
+            vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestampQueryPool, firstQuery);
+        }
 
         vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
 
         vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
 
-        VkBuffer vertexBuffers[] = {vertexBuffer};
-        VkDeviceSize offsets[] = {0};
-        vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+        VkBuffer vertexBuffers[] = {vertexBuffer, instanceBuffer};
+        VkDeviceSize offsets[] = {0, 0};
+        vkCmdBindVertexBuffers(commandBuffer, 0, 2, vertexBuffers, offsets);
         vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT32);
 
         vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[currentFrame], 0, nullptr);
 
-        vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(indices.size()), 1, 0, 0, 0);
+        // Per-object mode selects each sphere's instance data through firstInstance, so both modes run
+        // the same shaders on the same buffers and differ only in the number of draws
+        uint32_t indexCount = static_cast<uint32_t>(indices.size());
+        if (settings.instanced) {
+            vkCmdDrawIndexed(commandBuffer, indexCount, settings.instanceCount, 0, 0, 0);
+        } else {
+            for (uint32_t i = 0; i < settings.instanceCount; i++) {
+                vkCmdDrawIndexed(commandBuffer, indexCount, 1, 0, 0, i);
+            }
+        }
+
+        if (settings.deferred) {
+            vkCmdNextSubpass(commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, lightingPipeline);
+            std::array<VkDescriptorSet, 2> lightingSets = {descriptorSets[currentFrame], inputAttachmentSet};
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, lightingPipelineLayout, 0, static_cast<uint32_t>(lightingSets.size()), lightingSets.data(), 0, nullptr);
+            vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+        }
 
         vkCmdEndRenderPass(commandBuffer);
 
+        if (timestampsSupported) {
+            vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestampQueryPool, firstQuery + 1);
+            timestampsPending[currentFrame] = true;
+        }
+
         if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
             throw std::runtime_error("failed to record command buffer!");
         }
@@ -1168,12 +2048,61 @@ private:
     void mainLoop() {
         while (!glfwWindowShouldClose(window)) {
             glfwPollEvents();
+            processInput();
             drawFrame();
         }
 
         vkDeviceWaitIdle(device);
     }
 
+    // I switches between one instanced draw and one draw per sphere
+    void processInput() {
+        bool instancedKeyPressed = glfwGetKey(window, GLFW_KEY_I) == GLFW_PRESS;
+        if (instancedKeyPressed && !instancedKeyWasPressed) {
+            settings.instanced = !settings.instanced;
+            uint32_t drawCount = settings.instanced ? 1 : settings.instanceCount;
+            std::cout << "draw mode: " << (settings.instanced ? "instanced" : "per-object") << " (" << drawCount << " draws)" << std::endl;
+        }
+        instancedKeyWasPressed = instancedKeyPressed;
+    }
+
+    // Reads the timestamps last submitted from this frame slot (its fence has been waited on, so this
+    // does not block) and prints averages once per second
+    void readTimestamps() {
+        if (timestampsSupported && timestampsPending[currentFrame]) {
+            std::array<uint64_t, TIMESTAMPS_PER_FRAME> timestamps = {};
+            VkResult result = vkGetQueryPoolResults(device, timestampQueryPool, static_cast<uint32_t>(currentFrame * TIMESTAMPS_PER_FRAME),
+                                                    TIMESTAMPS_PER_FRAME, sizeof(timestamps), timestamps.data(), sizeof(uint64_t),
+                                                    VK_QUERY_RESULT_64_BIT);
+            timestampsPending[currentFrame] = false;
+            if (result == VK_SUCCESS) {
+                gpuMilliseconds += (timestamps[1] - timestamps[0]) * (timestampPeriod / 1e6);
+                gpuTimedFrames++;
+            }
+        }
+
+        auto now = std::chrono::high_resolution_clock::now();
+        double elapsedMilliseconds = std::chrono::duration<double, std::milli>(now - lastReportTime).count();
+        if (elapsedMilliseconds >= 1000.0 && timedFrames > 0) {
+            std::cout << (settings.deferred ? "deferred" : "forward") << ", " << (settings.instanced ? "instanced" : "per-object") << ", "
+                      << settings.instanceCount << " spheres: frame " << elapsedMilliseconds / timedFrames << " ms, command recording "
+                      << recordMilliseconds / timedFrames << " ms";
+            if (gpuTimedFrames > 0) {
+                std::cout << ", GPU " << gpuMilliseconds / gpuTimedFrames << " ms";
+            }
+            // Attachment memory the lazy allocation saved: everything the driver did not commit
+            VkDeviceSize requiredBytes, committedBytes;
+            queryAttachmentMemory(requiredBytes, committedBytes);
+            std::cout << ", attachments " << committedBytes / (1024.0 * 1024.0) << " of " << requiredBytes / (1024.0 * 1024.0)
+                      << " MB committed (" << (requiredBytes - committedBytes) / (1024.0 * 1024.0) << " MB saved)" << std::endl;
+            gpuMilliseconds = 0.0;
+            recordMilliseconds = 0.0;
+            gpuTimedFrames = 0;
+            timedFrames = 0;
+            lastReportTime = now;
+        }
+    }
+
     void drawFrame() {
         vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
 
@@ -1187,12 +2116,16 @@ private:
             throw std::runtime_error("failed to acquire swap chain image!");
         }
 
+        readTimestamps();
         updateUniformBuffer(currentFrame);
 
         vkResetFences(device, 1, &inFlightFences[currentFrame]);
 
+        auto recordStart = std::chrono::high_resolution_clock::now();
         vkResetCommandBuffer(commandBuffers[currentFrame], 0);
         recordCommandBuffer(commandBuffers[currentFrame], imageIndex);
+        recordMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - recordStart).count();
+        timedFrames++;
 
         VkSubmitInfo submitInfo = {};
         submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
@@ -1251,7 +2184,10 @@ private:
         createImageViews();
         createRenderPass();
         createGraphicsPipeline();
+        createLightingPipeline();
+        createAttachments();
         createFramebuffers();
+        createInputAttachmentDescriptors();
         createCommandBuffers();
     }
 
@@ -1265,14 +2201,33 @@ private:
             vkFreeMemory(device, uniformBuffersMemory[i], nullptr);
         }
 
+        vkDestroyBuffer(device, instanceBuffer, nullptr);
+        vkFreeMemory(device, instanceBufferMemory, nullptr);
+
         vkDestroyBuffer(device, indexBuffer, nullptr);
         vkFreeMemory(device, indexBufferMemory, nullptr);
 
         vkDestroyBuffer(device, vertexBuffer, nullptr);
         vkFreeMemory(device, vertexBufferMemory, nullptr);
 
+        vkDestroySampler(device, prefilterSampler, nullptr);
+        vkDestroyImageView(device, prefilterImageView, nullptr);
+        vkDestroyImage(device, prefilterImage, nullptr);
+        vkFreeMemory(device, prefilterImageMemory, nullptr);
+        vkDestroySampler(device, brdfLutSampler, nullptr);
+        vkDestroyImageView(device, brdfLutImageView, nullptr);
+        vkDestroyImage(device, brdfLutImage, nullptr);
+        vkFreeMemory(device, brdfLutImageMemory, nullptr);
+
         vkDestroyDescriptorPool(device, descriptorPool, nullptr);
         vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+        if (inputAttachmentSetLayout != VK_NULL_HANDLE) {
+            vkDestroyDescriptorSetLayout(device, inputAttachmentSetLayout, nullptr);
+        }
+
+        if (timestampQueryPool != VK_NULL_HANDLE) {
+            vkDestroyQueryPool(device, timestampQueryPool, nullptr);
+        }
 
         vkDestroyCommandPool(device, commandPool, nullptr);
 
@@ -1296,10 +2251,26 @@ private:
     }
 
     void cleanupSwapChain() {
+        destroyTransientAttachment(depthAttachment);
+        destroyTransientAttachment(albedoMetallicAttachment);
+        destroyTransientAttachment(normalRoughnessAttachment);
+
+        if (inputAttachmentPool != VK_NULL_HANDLE) {
+            vkDestroyDescriptorPool(device, inputAttachmentPool, nullptr);
+            inputAttachmentPool = VK_NULL_HANDLE;
+        }
+
         for (auto framebuffer : swapChainFramebuffers) {
             vkDestroyFramebuffer(device, framebuffer, nullptr);
         }
 
+        if (lightingPipeline != VK_NULL_HANDLE) {
+            vkDestroyPipeline(device, lightingPipeline, nullptr);
+            vkDestroyPipelineLayout(device, lightingPipelineLayout, nullptr);
+            lightingPipeline = VK_NULL_HANDLE;
+            lightingPipelineLayout = VK_NULL_HANDLE;
+        }
+
         vkDestroyPipeline(device, graphicsPipeline, nullptr);
         vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
         vkDestroyRenderPass(device, renderPass, nullptr);
@@ -1312,8 +2283,30 @@ private:
     }
 };
 
-int main() {
-    VulkanPBRRenderer app;
+int main(int argc, char** argv) {
+    // Optional arguments: --environment file.hdr, --no-ibl-cache, --instances N (spheres in the material
+    // grid), --per-object (start with one draw per sphere, I toggles at runtime), --forward (single subpass
+    // forward shading instead of the deferred G-buffer subpasses)
+    RendererSettings settings;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--environment" && i + 1 < argc) {
+            settings.environmentPath = argv[++i];
+        } else if (arg == "--no-ibl-cache") {
+            settings.iblCache = false;
+        } else if (arg == "--instances" && i + 1 < argc) {
+            settings.instanceCount = static_cast<uint32_t>(std::max(1, std::stoi(argv[++i])));
+        } else if (arg == "--per-object") {
+            settings.instanced = false;
+        } else if (arg == "--forward") {
+            settings.deferred = false;
+        } else {
+            std::cerr << "usage: pbr_renderer [--environment file.hdr] [--no-ibl-cache] [--instances N] [--per-object] [--forward]" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    VulkanPBRRenderer app(settings);
 
     try {
         app.run();
@@ -0,0 +1,7 @@
+#version 450
+
+// Fullscreen triangle generated from gl_VertexIndex, no vertex buffer needed
+void main() {
+    vec2 position = vec2((gl_VertexIndex << 1) & 2, gl_VertexIndex & 2);
+    gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+}
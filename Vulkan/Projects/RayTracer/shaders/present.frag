@@ -0,0 +1,46 @@
+#version 450
+
+// Accumulation image written by pathtrace.comp (linear radiance)
+layout(binding = 3, rgba32f) uniform readonly image2D accumImage;
+
+// Only the top-left renderWidth x renderHeight texels are valid (dynamic resolution)
+layout(push_constant) uniform PresentConstants {
+    ivec2 renderExtent;
+    ivec2 outputExtent;
+} pc;
+
+// Only needed when the swap chain is not an sRGB format
+layout(constant_id = 0) const bool APPLY_GAMMA = false;
+
+layout(location = 0) out vec4 outColor;
+
+vec3 loadClamped(ivec2 texel) {
+    return imageLoad(accumImage, clamp(texel, ivec2(0), pc.renderExtent - 1)).rgb;
+}
+
+// Storage images cannot be sampled, so the bilinear filter is done by hand
+vec3 sampleBilinear(vec2 position) {
+    vec2 texel = position - 0.5;
+    ivec2 base = ivec2(floor(texel));
+    vec2 f = texel - vec2(base);
+
+    vec3 top = mix(loadClamped(base), loadClamped(base + ivec2(1, 0)), f.x);
+    vec3 bottom = mix(loadClamped(base + ivec2(0, 1)), loadClamped(base + ivec2(1, 1)), f.x);
+    return mix(top, bottom, f.y);
+}
+
+void main() {
+    vec3 color;
+    if (pc.renderExtent == pc.outputExtent) {
+        color = imageLoad(accumImage, ivec2(gl_FragCoord.xy)).rgb;
+    } else {
+        vec2 scale = vec2(pc.renderExtent) / vec2(pc.outputExtent);
+        color = sampleBilinear(gl_FragCoord.xy * scale);
+    }
+
+    if (APPLY_GAMMA) {
+        color = pow(color, vec3(1.0 / 2.2));
+    }
+
+    outColor = vec4(color, 1.0);
+}
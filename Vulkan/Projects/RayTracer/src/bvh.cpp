@@ -0,0 +1,396 @@
+// bvh.cpp
+// 分箱SAH BVH构建器实现
+
+#include "bvh.h"
+#include "job_system.h"
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+
+namespace {
+
+constexpr int BIN_COUNT = 16;
+constexpr uint32_t MAX_LEAF_SIZE = 4;
+constexpr float TRAVERSAL_COST = 1.0f;
+constexpr float INTERSECT_COST = 1.0f;
+
+// 超过这个深度后改用中位数划分，保证树深度有上限（着色器中的遍历栈是固定大小的）
+constexpr uint32_t MAX_SAH_DEPTH = 32;
+
+// 图元数超过该值的节点使用并行分箱
+constexpr size_t PARALLEL_BINNING_THRESHOLD = 1 << 16;
+constexpr size_t PARALLEL_GRAIN_SIZE = 1 << 14;
+
+struct Bin {
+    AABB bounds;
+    uint32_t count = 0;
+};
+
+struct BinSet {
+    Bin bins[3][BIN_COUNT];
+
+    void merge(const BinSet& other) {
+        for (int axis = 0; axis < 3; axis++) {
+            for (int i = 0; i < BIN_COUNT; i++) {
+                bins[axis][i].bounds.grow(other.bins[axis][i].bounds);
+                bins[axis][i].count += other.bins[axis][i].count;
+            }
+        }
+    }
+};
+
+// 顶层树节点，子树部分由工作线程构建后再拼接
+struct TopNode {
+    AABB bounds;
+    uint32_t first = 0;
+    uint32_t count = 0;
+    int left = -1;
+    int right = -1;
+    int subtree = -1;
+};
+
+class BVHBuilder {
+public:
+    BVHBuilder(const std::vector<AABB>& primBounds, JobSystem& jobs, std::vector<uint32_t>& indices)
+        : primBounds(primBounds), jobs(jobs), indices(indices) {}
+
+    std::vector<BVHNode> build(BVHBuildStats& stats) {
+        uint32_t primCount = static_cast<uint32_t>(primBounds.size());
+
+        centroids.resize(primCount);
+        indices.resize(primCount);
+        jobs.parallelFor(0, primCount, PARALLEL_GRAIN_SIZE, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                centroids[i] = primBounds[i].centroid();
+                indices[i] = static_cast<uint32_t>(i);
+            }
+        });
+
+        // 子树大小阈值：让每个线程分到若干棵子树，以平衡负载
+        subtreeThreshold = std::max<uint32_t>(primCount / (jobs.threadCount() * 8), 1024);
+
+        buildTop(0, primCount, 0);
+
+        subtreeNodes.resize(subtreeRanges.size());
+        subtreeDepths.resize(subtreeRanges.size(), 0);
+        jobs.parallelFor(0, subtreeRanges.size(), 1, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                const SubtreeRange& range = subtreeRanges[i];
+                subtreeNodes[i].reserve(2 * range.count / MAX_LEAF_SIZE + 1);
+                buildSubtree(range.first, range.count, range.depth, subtreeNodes[i], subtreeDepths[i]);
+            }
+        });
+
+        std::vector<BVHNode> nodes;
+        nodes.reserve(2 * primCount / MAX_LEAF_SIZE + topNodes.size() + 1);
+        emitTop(0, nodes);
+
+        stats.nodeCount = static_cast<uint32_t>(nodes.size());
+        stats.leafCount = 0;
+        for (const BVHNode& node : nodes) {
+            if (node.count > 0) {
+                stats.leafCount++;
+            }
+        }
+        stats.maxDepth = topMaxDepth;
+        for (uint32_t depth : subtreeDepths) {
+            stats.maxDepth = std::max(stats.maxDepth, depth);
+        }
+
+        return nodes;
+    }
+
+private:
+    struct SubtreeRange {
+        uint32_t first;
+        uint32_t count;
+        uint32_t depth;
+    };
+
+    const std::vector<AABB>& primBounds;
+    JobSystem& jobs;
+    std::vector<uint32_t>& indices;
+    std::vector<glm::vec3> centroids;
+
+    uint32_t subtreeThreshold = 0;
+    uint32_t topMaxDepth = 0;
+    std::vector<TopNode> topNodes;
+    std::vector<SubtreeRange> subtreeRanges;
+    std::vector<std::vector<BVHNode>> subtreeNodes;
+    std::vector<uint32_t> subtreeDepths;
+
+    void computeBounds(uint32_t first, uint32_t count, AABB& bounds, AABB& centroidBounds) const {
+        for (uint32_t i = first; i < first + count; i++) {
+            bounds.grow(primBounds[indices[i]]);
+            centroidBounds.grow(centroids[indices[i]]);
+        }
+    }
+
+    void computeBoundsParallel(uint32_t first, uint32_t count, AABB& bounds, AABB& centroidBounds) {
+        if (count < PARALLEL_BINNING_THRESHOLD) {
+            computeBounds(first, count, bounds, centroidBounds);
+            return;
+        }
+
+        std::mutex mergeMutex;
+        jobs.parallelFor(first, first + count, PARALLEL_GRAIN_SIZE, [&](size_t begin, size_t end) {
+            AABB localBounds;
+            AABB localCentroidBounds;
+            computeBounds(static_cast<uint32_t>(begin), static_cast<uint32_t>(end - begin), localBounds, localCentroidBounds);
+
+            std::lock_guard<std::mutex> lock(mergeMutex);
+            bounds.grow(localBounds);
+            centroidBounds.grow(localCentroidBounds);
+        });
+    }
+
+    static int binIndex(float value, float minValue, float scale) {
+        int bin = static_cast<int>((value - minValue) * scale);
+        return std::min(std::max(bin, 0), BIN_COUNT - 1);
+    }
+
+    void binRange(uint32_t first, uint32_t count, const AABB& centroidBounds, const glm::vec3& scale, BinSet& binSet) const {
+        for (uint32_t i = first; i < first + count; i++) {
+            uint32_t prim = indices[i];
+            for (int axis = 0; axis < 3; axis++) {
+                Bin& bin = binSet.bins[axis][binIndex(centroids[prim][axis], centroidBounds.min[axis], scale[axis])];
+                bin.bounds.grow(primBounds[prim]);
+                bin.count++;
+            }
+        }
+    }
+
+    // 选择划分方式并重排 indices，返回 false 表示应当生成叶子
+    bool splitRange(uint32_t first, uint32_t count, uint32_t depth, const AABB& bounds, const AABB& centroidBounds,
+                    bool parallel, uint32_t& leftCount) {
+        if (count <= 1) {
+            return false;
+        }
+
+        glm::vec3 extent = centroidBounds.max - centroidBounds.min;
+        int longestAxis = 0;
+        if (extent.y > extent[longestAxis]) longestAxis = 1;
+        if (extent.z > extent[longestAxis]) longestAxis = 2;
+
+        // 所有图元中心重合，无法按空间划分
+        if (extent[longestAxis] <= 0.0f) {
+            if (count <= MAX_LEAF_SIZE) {
+                return false;
+            }
+            leftCount = count / 2;
+            return true;
+        }
+
+        if (depth >= MAX_SAH_DEPTH) {
+            return medianSplit(first, count, longestAxis, leftCount);
+        }
+
+        glm::vec3 scale(0.0f);
+        for (int axis = 0; axis < 3; axis++) {
+            if (extent[axis] > 0.0f) {
+                scale[axis] = BIN_COUNT * (1.0f - 1e-5f) / extent[axis];
+            }
+        }
+
+        BinSet binSet;
+        if (parallel && count >= PARALLEL_BINNING_THRESHOLD) {
+            std::mutex mergeMutex;
+            jobs.parallelFor(first, first + count, PARALLEL_GRAIN_SIZE, [&](size_t begin, size_t end) {
+                BinSet localBins;
+                binRange(static_cast<uint32_t>(begin), static_cast<uint32_t>(end - begin), centroidBounds, scale, localBins);
+
+                std::lock_guard<std::mutex> lock(mergeMutex);
+                binSet.merge(localBins);
+            });
+        } else {
+            binRange(first, count, centroidBounds, scale, binSet);
+        }
+
+        // 扫描每个轴上 BIN_COUNT - 1 个候选划分平面
+        float bestCost = std::numeric_limits<float>::max();
+        int bestAxis = -1;
+        int bestSplit = 0;
+
+        for (int axis = 0; axis < 3; axis++) {
+            if (extent[axis] <= 0.0f) {
+                continue;
+            }
+
+            float leftArea[BIN_COUNT - 1];
+            uint32_t leftCounts[BIN_COUNT - 1];
+            AABB accumulated;
+            uint32_t accumulatedCount = 0;
+            for (int i = 0; i < BIN_COUNT - 1; i++) {
+                accumulated.grow(binSet.bins[axis][i].bounds);
+                accumulatedCount += binSet.bins[axis][i].count;
+                leftArea[i] = accumulated.surfaceArea();
+                leftCounts[i] = accumulatedCount;
+            }
+
+            accumulated = AABB();
+            accumulatedCount = 0;
+            for (int i = BIN_COUNT - 1; i > 0; i--) {
+                accumulated.grow(binSet.bins[axis][i].bounds);
+                accumulatedCount += binSet.bins[axis][i].count;
+
+                if (leftCounts[i - 1] == 0 || accumulatedCount == 0) {
+                    continue;
+                }
+
+                float cost = leftArea[i - 1] * leftCounts[i - 1] + accumulated.surfaceArea() * accumulatedCount;
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestSplit = i - 1;
+                }
+            }
+        }
+
+        if (bestAxis < 0) {
+            if (count <= MAX_LEAF_SIZE) {
+                return false;
+            }
+            return medianSplit(first, count, longestAxis, leftCount);
+        }
+
+        float area = bounds.surfaceArea();
+        float splitCost = TRAVERSAL_COST + INTERSECT_COST * (area > 0.0f ? bestCost / area : 0.0f);
+        float leafCost = INTERSECT_COST * count;
+        if (splitCost >= leafCost && count <= MAX_LEAF_SIZE) {
+            return false;
+        }
+
+        float minValue = centroidBounds.min[bestAxis];
+        float axisScale = scale[bestAxis];
+        auto begin = indices.begin() + first;
+        auto middle = std::partition(begin, begin + count, [&](uint32_t prim) {
+            return binIndex(centroids[prim][bestAxis], minValue, axisScale) <= bestSplit;
+        });
+
+        leftCount = static_cast<uint32_t>(middle - begin);
+        if (leftCount == 0 || leftCount == count) {
+            return medianSplit(first, count, longestAxis, leftCount);
+        }
+        return true;
+    }
+
+    bool medianSplit(uint32_t first, uint32_t count, int axis, uint32_t& leftCount) {
+        leftCount = count / 2;
+        auto begin = indices.begin() + first;
+        std::nth_element(begin, begin + leftCount, begin + count, [&](uint32_t a, uint32_t b) {
+            return centroids[a][axis] < centroids[b][axis];
+        });
+        return true;
+    }
+
+    // 顶层构建：大节点并行分箱，足够小的节点留给工作线程作为独立子树
+    int buildTop(uint32_t first, uint32_t count, uint32_t depth) {
+        int nodeIndex = static_cast<int>(topNodes.size());
+        topNodes.emplace_back();
+        topNodes[nodeIndex].first = first;
+        topNodes[nodeIndex].count = count;
+        topMaxDepth = std::max(topMaxDepth, depth);
+
+        if (count <= subtreeThreshold) {
+            topNodes[nodeIndex].subtree = static_cast<int>(subtreeRanges.size());
+            subtreeRanges.push_back({first, count, depth});
+            return nodeIndex;
+        }
+
+        AABB bounds;
+        AABB centroidBounds;
+        computeBoundsParallel(first, count, bounds, centroidBounds);
+        topNodes[nodeIndex].bounds = bounds;
+
+        uint32_t leftCount = 0;
+        if (!splitRange(first, count, depth, bounds, centroidBounds, true, leftCount)) {
+            return nodeIndex;
+        }
+
+        int left = buildTop(first, leftCount, depth + 1);
+        int right = buildTop(first + leftCount, count - leftCount, depth + 1);
+        topNodes[nodeIndex].left = left;
+        topNodes[nodeIndex].right = right;
+        return nodeIndex;
+    }
+
+    // 在单个线程内按深度优先顺序构建子树
+    void buildSubtree(uint32_t first, uint32_t count, uint32_t depth, std::vector<BVHNode>& out, uint32_t& maxDepth) {
+        maxDepth = std::max(maxDepth, depth);
+
+        AABB bounds;
+        AABB centroidBounds;
+        computeBounds(first, count, bounds, centroidBounds);
+
+        uint32_t nodeIndex = static_cast<uint32_t>(out.size());
+        out.push_back({bounds.min, first, bounds.max, count});
+
+        uint32_t leftCount = 0;
+        if (!splitRange(first, count, depth, bounds, centroidBounds, false, leftCount)) {
+            return;
+        }
+
+        buildSubtree(first, leftCount, depth + 1, out, maxDepth);
+        uint32_t rightIndex = static_cast<uint32_t>(out.size());
+        buildSubtree(first + leftCount, count - leftCount, depth + 1, out, maxDepth);
+
+        out[nodeIndex].leftOrFirst = rightIndex;
+        out[nodeIndex].count = 0;
+    }
+
+    // 把顶层树和各子树拼接成一个深度优先顺序的扁平数组
+    void emitTop(int topIndex, std::vector<BVHNode>& out) const {
+        const TopNode& top = topNodes[topIndex];
+
+        if (top.subtree >= 0) {
+            uint32_t offset = static_cast<uint32_t>(out.size());
+            for (BVHNode node : subtreeNodes[top.subtree]) {
+                if (node.count == 0) {
+                    node.leftOrFirst += offset;
+                }
+                out.push_back(node);
+            }
+            return;
+        }
+
+        uint32_t nodeIndex = static_cast<uint32_t>(out.size());
+        out.push_back({top.bounds.min, top.first, top.bounds.max, top.count});
+
+        if (top.left < 0) {
+            return;
+        }
+
+        emitTop(top.left, out);
+        uint32_t rightIndex = static_cast<uint32_t>(out.size());
+        emitTop(top.right, out);
+
+        out[nodeIndex].leftOrFirst = rightIndex;
+        out[nodeIndex].count = 0;
+    }
+};
+
+} // namespace
+
+std::vector<BVHNode> buildBVH(const std::vector<AABB>& primBounds, JobSystem& jobs,
+                              std::vector<uint32_t>& primOrder, BVHBuildStats* stats) {
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    BVHBuildStats localStats;
+    std::vector<BVHNode> nodes;
+    primOrder.clear();
+
+    if (!primBounds.empty()) {
+        BVHBuilder builder(primBounds, jobs, primOrder);
+        nodes = builder.build(localStats);
+    }
+
+    auto endTime = std::chrono::high_resolution_clock::now();
+    localStats.buildTimeMs = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+
+    if (stats != nullptr) {
+        *stats = localStats;
+    }
+
+    return nodes;
+}
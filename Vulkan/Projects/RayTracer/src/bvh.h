@@ -0,0 +1,69 @@
+// bvh.h
+// 分箱SAH（Surface Area Heuristic）BVH构建器
+// 输出深度优先顺序的扁平节点数组，可以直接作为SSBO上传给着色器做基于栈的遍历
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+class JobSystem;
+
+struct AABB {
+    glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+    glm::vec3 max = glm::vec3(-std::numeric_limits<float>::max());
+
+    void grow(const glm::vec3& point) {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+
+    void grow(const AABB& other) {
+        min = glm::min(min, other.min);
+        max = glm::max(max, other.max);
+    }
+
+    bool empty() const {
+        return max.x < min.x || max.y < min.y || max.z < min.z;
+    }
+
+    float surfaceArea() const {
+        if (empty()) {
+            return 0.0f;
+        }
+        glm::vec3 extent = max - min;
+        return 2.0f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+    }
+
+    glm::vec3 centroid() const {
+        return (min + max) * 0.5f;
+    }
+};
+
+// 与着色器中的 BVHNode 布局一致（std430，32字节）
+// 内部节点：count == 0，左孩子紧跟在当前节点之后（index + 1），leftOrFirst 为右孩子的索引
+// 叶子节点：count > 0，leftOrFirst 为重排后图元数组中的起始索引
+struct BVHNode {
+    glm::vec3 boundsMin;
+    uint32_t leftOrFirst;
+    glm::vec3 boundsMax;
+    uint32_t count;
+};
+
+static_assert(sizeof(BVHNode) == 32, "BVHNode must match the std430 layout used in the shaders");
+
+struct BVHBuildStats {
+    double buildTimeMs = 0.0;
+    uint32_t nodeCount = 0;
+    uint32_t leafCount = 0;
+    uint32_t maxDepth = 0;
+};
+
+// 根据每个图元的包围盒构建BVH
+// primOrder 返回叶子中图元的排列：重排后的第 i 个图元对应原数组中的 primOrder[i]
+// 顶层节点使用并行分箱，划分出足够多的子树后再由工作线程各自独立构建
+std::vector<BVHNode> buildBVH(const std::vector<AABB>& primBounds, JobSystem& jobs,
+                              std::vector<uint32_t>& primOrder, BVHBuildStats* stats = nullptr);
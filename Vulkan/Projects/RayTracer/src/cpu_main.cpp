@@ -0,0 +1,322 @@
+// cpu_main.cpp
+// CPU参考光线追踪器的命令行入口（无需Vulkan与窗口）
+//
+// 用法:
+//   cpu_ray_tracer [--width W] [--height H] [--spheres N] [--threads T] [--tile S]
+//                  [--frames F] [--output file.ppm] [--srgb]
+//                  [--denoise [--light-radius R] [--pan D] [--reference-spp N]]
+//   cpu_ray_tracer --diff a.ppm b.ppm
+//
+// --srgb 会在写出前做一次sRGB编码，与Vulkan版本经 B8G8R8A8_SRGB 交换链呈现后的截图一致；
+// 不加时输出的是线性颜色值
+//
+// --denoise 验证时空降噪器：以 1 spp 的随机软阴影渲染 F 帧（相机每帧沿X轴平移 D），逐帧降噪，
+// 再与最后一帧相机位置处 N spp 平均得到的参考图比较，输出降噪前后的RMSE；
+// 降噪结果写入 --output，带噪声的原图与参考图分别写入加上 _noisy、_reference 后缀的文件
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "cpu_tracer.h"
+#include "denoiser.h"
+#include "image_io.h"
+#include "job_system.h"
+#include "scene.h"
+
+namespace {
+
+struct Options {
+    CpuTracerSettings settings;
+    uint32_t extraSphereCount = 0;
+    unsigned int threadCount = 0;
+    // 0 表示使用默认值：性能测试3帧，降噪验证16帧
+    uint32_t frameCount = 0;
+    std::string output = "cpu_reference.ppm";
+    bool srgb = false;
+
+    bool denoise = false;
+    float lightRadius = 0.5f;
+    float cameraPan = 0.02f;
+    uint32_t referenceSamples = 256;
+};
+
+void printUsage() {
+    std::cout << "usage: cpu_ray_tracer [--width W] [--height H] [--spheres N] [--threads T] [--tile S]\n"
+              << "                      [--frames F] [--output file.ppm] [--srgb]\n"
+              << "                      [--denoise [--light-radius R] [--pan D] [--reference-spp N]]\n"
+              << "       cpu_ray_tracer --diff a.ppm b.ppm" << std::endl;
+}
+
+Options parseOptions(int argc, char** argv) {
+    Options options;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto nextValue = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                throw std::runtime_error("missing value for " + arg);
+            }
+            return argv[++i];
+        };
+
+        if (arg == "--width") {
+            options.settings.width = static_cast<uint32_t>(std::stoul(nextValue()));
+        } else if (arg == "--height") {
+            options.settings.height = static_cast<uint32_t>(std::stoul(nextValue()));
+        } else if (arg == "--spheres") {
+            options.extraSphereCount = static_cast<uint32_t>(std::stoul(nextValue()));
+        } else if (arg == "--threads") {
+            options.threadCount = static_cast<unsigned int>(std::stoul(nextValue()));
+        } else if (arg == "--tile") {
+            options.settings.tileSize = static_cast<uint32_t>(std::stoul(nextValue()));
+        } else if (arg == "--frames") {
+            options.frameCount = std::max(1u, static_cast<uint32_t>(std::stoul(nextValue())));
+        } else if (arg == "--output") {
+            options.output = nextValue();
+        } else if (arg == "--srgb") {
+            options.srgb = true;
+        } else if (arg == "--denoise") {
+            options.denoise = true;
+        } else if (arg == "--light-radius") {
+            options.lightRadius = std::stof(nextValue());
+        } else if (arg == "--pan") {
+            options.cameraPan = std::stof(nextValue());
+        } else if (arg == "--reference-spp") {
+            options.referenceSamples = std::max(1u, static_cast<uint32_t>(std::stoul(nextValue())));
+        } else {
+            throw std::runtime_error("unknown argument: " + arg);
+        }
+    }
+
+    if (options.settings.width == 0 || options.settings.height == 0) {
+        throw std::runtime_error("image size must be non-zero!");
+    }
+    if (options.frameCount == 0) {
+        options.frameCount = options.denoise ? 16 : 3;
+    }
+
+    return options;
+}
+
+// 逐像素比较两张图像，输出RMSE、最大误差和超出阈值的像素数；尺寸不同或存在明显差异时返回失败
+int diffImages(const std::string& fileA, const std::string& fileB) {
+    uint32_t widthA, heightA, widthB, heightB;
+    std::vector<glm::vec3> pixelsA, pixelsB;
+    readPPM(fileA, widthA, heightA, pixelsA);
+    readPPM(fileB, widthB, heightB, pixelsB);
+
+    if (widthA != widthB || heightA != heightB) {
+        std::cerr << "size mismatch: " << widthA << "x" << heightA << " vs " << widthB << "x" << heightB << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // 允许2个量化级的误差：GPU与CPU的 pow/sqrt 精度不同
+    const float threshold = 2.0f / 255.0f + 1e-6f;
+
+    double sumSquared = 0.0;
+    float maxError = 0.0f;
+    size_t differing = 0;
+    for (size_t i = 0; i < pixelsA.size(); i++) {
+        glm::vec3 delta = glm::abs(pixelsA[i] - pixelsB[i]);
+        float error = std::max(delta.r, std::max(delta.g, delta.b));
+        sumSquared += glm::dot(delta, delta) / 3.0;
+        maxError = std::max(maxError, error);
+        if (error > threshold) {
+            differing++;
+        }
+    }
+
+    double rmse = std::sqrt(sumSquared / static_cast<double>(pixelsA.size()));
+    std::cout << "RMSE " << rmse * 255.0 << " / 255, max error " << maxError * 255.0f << " / 255, "
+              << differing << " of " << pixelsA.size() << " pixels differ by more than 2 levels" << std::endl;
+
+    // 少量边缘像素（球体轮廓、棋盘格边界）允许不同
+    return differing * 1000 <= pixelsA.size() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// 创建演示场景，并把相机与光源同步到渲染设置中
+CpuTracerSettings setupScene(const Options& options, JobSystem& jobSystem, Scene& scene) {
+    BVHBuildStats buildStats;
+    scene.setSpheres(createDemoSpheres(options.extraSphereCount), jobSystem, &buildStats);
+    scene.setPlane(createDemoPlane());
+    scene.addLight(createDemoLight());
+
+    std::cout << "BVH: " << scene.spheres().size() << " spheres, " << buildStats.nodeCount << " nodes, "
+              << buildStats.leafCount << " leaves, depth " << buildStats.maxDepth << ", built in "
+              << buildStats.buildTimeMs << " ms on " << jobSystem.threadCount() << " threads" << std::endl;
+
+    // CPU参考渲染器只支持一个点光源，且相机固定朝向 -Z
+    CpuTracerSettings settings = options.settings;
+    settings.cameraPos = scene.camera().position;
+    settings.lightPos = scene.lights()[0].position;
+    settings.lightColor = scene.lights()[0].color;
+    return settings;
+}
+
+void writeImage(const Options& options, const std::string& file, std::vector<glm::vec3> pixels) {
+    if (options.srgb) {
+        for (glm::vec3& pixel : pixels) {
+            pixel = linearToSrgb(pixel);
+        }
+    }
+    writePPM(file, options.settings.width, options.settings.height, pixels);
+    std::cout << "wrote " << file << std::endl;
+}
+
+int renderReference(const Options& options) {
+    JobSystem jobSystem(options.threadCount);
+
+    Scene scene;
+    CpuTracerSettings settings = setupScene(options, jobSystem, scene);
+
+    CpuRayTracer tracer(scene.spheres(), scene.nodes(), scene.plane());
+    std::vector<glm::vec3> framebuffer;
+
+    // 第一帧用于预热缓存，统计其余帧中最快的一帧
+    double bestTimeMs = 0.0;
+    double totalTimeMs = 0.0;
+    CpuTracerStats stats;
+    for (uint32_t frame = 0; frame < options.frameCount; frame++) {
+        tracer.render(settings, jobSystem, framebuffer, &stats);
+        if (frame == 0 && options.frameCount > 1) {
+            continue;
+        }
+        totalTimeMs += stats.renderTimeMs;
+        bestTimeMs = bestTimeMs == 0.0 ? stats.renderTimeMs : std::min(bestTimeMs, stats.renderTimeMs);
+    }
+
+    uint32_t measuredFrames = options.frameCount > 1 ? options.frameCount - 1 : 1;
+    uint64_t raysPerFrame = stats.primaryRays + stats.shadowRays;
+    double mraysPerSecond = static_cast<double>(raysPerFrame) / (bestTimeMs * 1000.0);
+
+    std::cout << options.settings.width << "x" << options.settings.height << ", "
+              << CpuRayTracer::simdName() << " x" << CpuRayTracer::packetWidth() << " packets, "
+              << options.settings.tileSize << "px tiles" << std::endl;
+    std::cout << "frame: best " << bestTimeMs << " ms, avg " << totalTimeMs / measuredFrames << " ms ("
+              << stats.primaryRays << " primary + " << stats.shadowRays << " shadow rays)" << std::endl;
+    std::cout << "throughput: " << mraysPerSecond << " Mrays/s, "
+              << mraysPerSecond / jobSystem.threadCount() << " Mrays/s per core" << std::endl;
+
+    writeImage(options, options.output, framebuffer);
+
+    return EXIT_SUCCESS;
+}
+
+// 在扩展名前插入后缀：out.ppm -> out_noisy.ppm
+std::string withSuffix(const std::string& file, const std::string& suffix) {
+    size_t dot = file.find_last_of('.');
+    size_t slash = file.find_last_of("/\\");
+    if (dot == std::string::npos || (slash != std::string::npos && slash > dot)) {
+        return file + suffix;
+    }
+    return file.substr(0, dot) + suffix + file.substr(dot);
+}
+
+// 按截断到 [0, 1] 后的线性颜色计算均方根误差
+double computeRmse(const std::vector<glm::vec3>& a, const std::vector<glm::vec3>& b) {
+    double sumSquared = 0.0;
+    for (size_t i = 0; i < a.size(); i++) {
+        glm::vec3 delta = glm::clamp(a[i], 0.0f, 1.0f) - glm::clamp(b[i], 0.0f, 1.0f);
+        sumSquared += glm::dot(delta, delta) / 3.0;
+    }
+    return std::sqrt(sumSquared / static_cast<double>(a.size()));
+}
+
+int validateDenoiser(const Options& options) {
+    JobSystem jobSystem(options.threadCount);
+
+    Scene scene;
+    CpuTracerSettings settings = setupScene(options, jobSystem, scene);
+    settings.lightRadius = options.lightRadius;
+
+    CpuRayTracer tracer(scene.spheres(), scene.nodes(), scene.plane());
+
+    // 与CPU渲染器的固定相机一致：朝向 -Z，垂直视野90度（tan(fov / 2) = 1）
+    DenoiserCamera camera;
+    camera.right = glm::vec3(1.0f, 0.0f, 0.0f);
+    camera.up = glm::vec3(0.0f, 1.0f, 0.0f);
+    camera.forward = glm::vec3(0.0f, 0.0f, -1.0f);
+
+    // 相机逐帧平移，最后一帧回到场景中的相机位置
+    const glm::vec3 finalCameraPos = settings.cameraPos;
+    auto cameraPosAt = [&](uint32_t frame) {
+        float offset = static_cast<float>(static_cast<int>(frame) - static_cast<int>(options.frameCount - 1)) * options.cameraPan;
+        return finalCameraPos + offset * camera.right;
+    };
+
+    // 参考图：最后一帧相机位置处多个随机种子的平均
+    std::vector<glm::vec3> reference(static_cast<size_t>(settings.width) * settings.height, glm::vec3(0.0f));
+    std::vector<glm::vec3> framebuffer;
+    settings.cameraPos = finalCameraPos;
+    for (uint32_t sample = 0; sample < options.referenceSamples; sample++) {
+        // 种子与验证帧错开
+        settings.frameIndex = 0x10000u + sample;
+        tracer.render(settings, jobSystem, framebuffer);
+        for (size_t i = 0; i < reference.size(); i++) {
+            reference[i] += framebuffer[i];
+        }
+    }
+    for (glm::vec3& pixel : reference) {
+        pixel /= static_cast<float>(options.referenceSamples);
+    }
+
+    CpuDenoiser denoiser;
+    std::vector<GBufferTexel> gbuffer;
+    std::vector<glm::vec3> denoised;
+    double totalDenoiseMs = 0.0;
+    for (uint32_t frame = 0; frame < options.frameCount; frame++) {
+        settings.cameraPos = cameraPosAt(frame);
+        settings.frameIndex = frame;
+        tracer.render(settings, jobSystem, framebuffer, nullptr, &gbuffer);
+
+        camera.position = settings.cameraPos;
+        auto startTime = std::chrono::high_resolution_clock::now();
+        denoiser.denoise(settings.width, settings.height, framebuffer, gbuffer, camera, jobSystem, denoised);
+        auto endTime = std::chrono::high_resolution_clock::now();
+        totalDenoiseMs += std::chrono::duration<double, std::milli>(endTime - startTime).count();
+    }
+
+    std::cout << options.settings.width << "x" << options.settings.height << ", " << options.frameCount
+              << " frames at 1 spp, light radius " << options.lightRadius << ", camera pan " << options.cameraPan
+              << " per frame, reference " << options.referenceSamples << " spp" << std::endl;
+    std::cout << "RMSE vs reference: noisy " << computeRmse(framebuffer, reference) * 255.0 << " / 255, denoised "
+              << computeRmse(denoised, reference) * 255.0 << " / 255" << std::endl;
+    std::cout << "denoise: avg " << totalDenoiseMs / options.frameCount << " ms per frame on "
+              << jobSystem.threadCount() << " threads" << std::endl;
+
+    writeImage(options, options.output, denoised);
+    writeImage(options, withSuffix(options.output, "_noisy"), framebuffer);
+    writeImage(options, withSuffix(options.output, "_reference"), reference);
+
+    return EXIT_SUCCESS;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    try {
+        if (argc > 1 && (std::strcmp(argv[1], "--help") == 0 || std::strcmp(argv[1], "-h") == 0)) {
+            printUsage();
+            return EXIT_SUCCESS;
+        }
+        if (argc > 1 && std::strcmp(argv[1], "--diff") == 0) {
+            if (argc != 4) {
+                printUsage();
+                return EXIT_FAILURE;
+            }
+            return diffImages(argv[2], argv[3]);
+        }
+
+        Options options = parseOptions(argc, argv);
+        return options.denoise ? validateDenoiser(options) : renderReference(options);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
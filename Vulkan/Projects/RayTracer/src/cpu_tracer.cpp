@@ -0,0 +1,468 @@
+// cpu_tracer.cpp
+// CPU参考光线追踪器实现
+// 光线按 simd::WIDTH 条一组（同一行上相邻的像素）打包，BVH遍历与求交以光线包为单位进行，着色按通道逐个计算
+
+#include "cpu_tracer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+
+#include "job_system.h"
+#include "simd.h"
+
+namespace {
+
+using simd::vfloat;
+
+constexpr int PACKET_WIDTH = simd::WIDTH;
+constexpr int STACK_SIZE = 64;
+// 与着色器中 closestHit 的初始 t 相同
+constexpr float MISS_T = 1000000.0f;
+// 命中图元的编号：>= 0 为球体索引，PLANE_ID 为地面，NO_HIT 为未命中
+constexpr float NO_HIT = -1.0f;
+constexpr float PLANE_ID = -2.0f;
+
+struct RayPacket {
+    vfloat ox, oy, oz;
+    vfloat dx, dy, dz;
+    vfloat invDx, invDy, invDz;
+    // 包内第一条有效光线的方向，用于决定内部节点两个孩子的访问顺序
+    glm::vec3 leadDir;
+};
+
+struct PacketHit {
+    vfloat t;
+    vfloat prim;
+};
+
+struct TraceContext {
+    const Sphere* spheres;
+    const BVHNode* nodes;
+    size_t nodeCount;
+    Plane plane;
+};
+
+void finalizePacket(RayPacket& ray, const float* dirX, const float* dirY, const float* dirZ, int leadLane) {
+    ray.dx = vfloat::load(dirX);
+    ray.dy = vfloat::load(dirY);
+    ray.dz = vfloat::load(dirZ);
+    ray.invDx = vfloat(1.0f) / ray.dx;
+    ray.invDy = vfloat(1.0f) / ray.dy;
+    ray.invDz = vfloat(1.0f) / ray.dz;
+    ray.leadDir = glm::vec3(dirX[leadLane], dirY[leadLane], dirZ[leadLane]);
+}
+
+vfloat abs(vfloat a) {
+    return simd::andNot(vfloat(-0.0f), a);
+}
+
+// 返回光线与包围盒在 [0, tMax] 内相交的通道掩码
+vfloat intersectAABB(const RayPacket& ray, const BVHNode& node, vfloat tMax) {
+    vfloat t0x = (vfloat(node.boundsMin.x) - ray.ox) * ray.invDx;
+    vfloat t1x = (vfloat(node.boundsMax.x) - ray.ox) * ray.invDx;
+    vfloat t0y = (vfloat(node.boundsMin.y) - ray.oy) * ray.invDy;
+    vfloat t1y = (vfloat(node.boundsMax.y) - ray.oy) * ray.invDy;
+    vfloat t0z = (vfloat(node.boundsMin.z) - ray.oz) * ray.invDz;
+    vfloat t1z = (vfloat(node.boundsMax.z) - ray.oz) * ray.invDz;
+
+    vfloat tNear = simd::max(simd::max(simd::min(t0x, t1x), simd::min(t0y, t1y)),
+                             simd::max(simd::min(t0z, t1z), vfloat(0.0f)));
+    vfloat tFar = simd::min(simd::min(simd::max(t0x, t1x), simd::max(t0y, t1y)),
+                            simd::min(simd::max(t0z, t1z), tMax));
+    return tNear <= tFar;
+}
+
+// 与着色器的 intersectSphere 相同：优先取较近的交点，两个交点都在身后时返回 -1
+vfloat intersectSphere(const RayPacket& ray, const Sphere& sphere) {
+    vfloat ocx = ray.ox - vfloat(sphere.center.x);
+    vfloat ocy = ray.oy - vfloat(sphere.center.y);
+    vfloat ocz = ray.oz - vfloat(sphere.center.z);
+
+    vfloat a = ray.dx * ray.dx + ray.dy * ray.dy + ray.dz * ray.dz;
+    vfloat b = vfloat(2.0f) * (ocx * ray.dx + ocy * ray.dy + ocz * ray.dz);
+    vfloat c = ocx * ocx + ocy * ocy + ocz * ocz - vfloat(sphere.radius * sphere.radius);
+    vfloat discriminant = b * b - vfloat(4.0f) * a * c;
+
+    vfloat root = simd::sqrt(simd::max(discriminant, vfloat(0.0f)));
+    vfloat twoA = vfloat(2.0f) * a;
+    vfloat t1 = (vfloat(0.0f) - b - root) / twoA;
+    vfloat t2 = (vfloat(0.0f) - b + root) / twoA;
+    vfloat t = simd::select(t1 < vfloat(0.0f), t2, t1);
+
+    vfloat valid = (discriminant >= vfloat(0.0f)) & (t >= vfloat(0.0f));
+    return simd::select(valid, t, vfloat(-1.0f));
+}
+
+vfloat intersectPlane(const RayPacket& ray, const Plane& plane) {
+    vfloat denom = ray.dx * vfloat(plane.normal.x) + ray.dy * vfloat(plane.normal.y) + ray.dz * vfloat(plane.normal.z);
+    vfloat numer = (vfloat(plane.point.x) - ray.ox) * vfloat(plane.normal.x) +
+                   (vfloat(plane.point.y) - ray.oy) * vfloat(plane.normal.y) +
+                   (vfloat(plane.point.z) - ray.oz) * vfloat(plane.normal.z);
+    vfloat t = numer / denom;
+
+    vfloat valid = (abs(denom) >= vfloat(0.0001f)) & (t >= vfloat(0.0f));
+    return simd::select(valid, t, vfloat(-1.0f));
+}
+
+// 内部节点的孩子按代表光线方向排序：沿两个孩子中心相距最远的轴，先访问光线先到达的那一个
+void orderChildren(const TraceContext& ctx, const RayPacket& ray, uint32_t nodeIndex, uint32_t& nearChild, uint32_t& farChild) {
+    nearChild = nodeIndex + 1;
+    farChild = ctx.nodes[nodeIndex].leftOrFirst;
+
+    const BVHNode& a = ctx.nodes[nearChild];
+    const BVHNode& b = ctx.nodes[farChild];
+    glm::vec3 delta = (b.boundsMin + b.boundsMax) - (a.boundsMin + a.boundsMax);
+    glm::vec3 absDelta = glm::abs(delta);
+
+    int axis = 0;
+    if (absDelta.y > absDelta.x) axis = 1;
+    if (absDelta.z > absDelta[axis]) axis = 2;
+
+    if (delta[axis] * ray.leadDir[axis] < 0.0f) {
+        std::swap(nearChild, farChild);
+    }
+}
+
+void closestHit(const TraceContext& ctx, const RayPacket& ray, vfloat active, PacketHit& hit) {
+    hit.t = vfloat(MISS_T);
+    hit.prim = vfloat(NO_HIT);
+
+    if (ctx.nodeCount > 0) {
+        uint32_t stack[STACK_SIZE];
+        int stackPtr = 0;
+        stack[stackPtr++] = 0;
+
+        while (stackPtr > 0) {
+            uint32_t nodeIndex = stack[--stackPtr];
+            const BVHNode& node = ctx.nodes[nodeIndex];
+            if (simd::none(intersectAABB(ray, node, hit.t) & active)) {
+                continue;
+            }
+
+            if (node.count > 0) {
+                for (uint32_t i = node.leftOrFirst; i < node.leftOrFirst + node.count; i++) {
+                    vfloat t = intersectSphere(ray, ctx.spheres[i]);
+                    vfloat closer = (t > vfloat(0.0f)) & (t < hit.t) & active;
+                    hit.t = simd::select(closer, t, hit.t);
+                    hit.prim = simd::select(closer, vfloat(static_cast<float>(i)), hit.prim);
+                }
+            } else if (stackPtr + 2 <= STACK_SIZE) {
+                uint32_t nearChild, farChild;
+                orderChildren(ctx, ray, nodeIndex, nearChild, farChild);
+                stack[stackPtr++] = farChild;
+                stack[stackPtr++] = nearChild;
+            }
+        }
+    }
+
+    vfloat tPlane = intersectPlane(ray, ctx.plane);
+    vfloat closer = (tPlane > vfloat(0.0f)) & (tPlane < hit.t) & active;
+    hit.t = simd::select(closer, tPlane, hit.t);
+    hit.prim = simd::select(closer, vfloat(PLANE_ID), hit.prim);
+}
+
+// 阴影光线：返回在 (0, maxT) 内被遮挡的通道掩码，所有通道都被遮挡后提前退出
+vfloat occluded(const TraceContext& ctx, const RayPacket& ray, vfloat active, vfloat maxT) {
+    vfloat tPlane = intersectPlane(ray, ctx.plane);
+    vfloat result = (tPlane > vfloat(0.0f)) & (tPlane < maxT) & active;
+    vfloat pending = simd::andNot(result, active);
+
+    if (ctx.nodeCount == 0 || simd::none(pending)) {
+        return result;
+    }
+
+    uint32_t stack[STACK_SIZE];
+    int stackPtr = 0;
+    stack[stackPtr++] = 0;
+
+    while (stackPtr > 0) {
+        uint32_t nodeIndex = stack[--stackPtr];
+        const BVHNode& node = ctx.nodes[nodeIndex];
+        if (simd::none(intersectAABB(ray, node, maxT) & pending)) {
+            continue;
+        }
+
+        if (node.count > 0) {
+            for (uint32_t i = node.leftOrFirst; i < node.leftOrFirst + node.count; i++) {
+                vfloat t = intersectSphere(ray, ctx.spheres[i]);
+                vfloat blocked = (t > vfloat(0.0f)) & (t < maxT) & pending;
+                result = result | blocked;
+                pending = simd::andNot(blocked, pending);
+            }
+            if (simd::none(pending)) {
+                break;
+            }
+        } else if (stackPtr + 2 <= STACK_SIZE) {
+            uint32_t nearChild, farChild;
+            orderChildren(ctx, ray, nodeIndex, nearChild, farChild);
+            stack[stackPtr++] = farChild;
+            stack[stackPtr++] = nearChild;
+        }
+    }
+
+    return result;
+}
+
+// 与着色器相同的 PCG 哈希随机数
+uint32_t pcgHash(uint32_t value) {
+    uint32_t state = value * 747796405u + 2891336453u;
+    uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
+float randomFloat(uint32_t& state) {
+    state = pcgHash(state);
+    return static_cast<float>(state >> 8) * (1.0f / 16777216.0f);
+}
+
+glm::vec3 randomUnitVector(uint32_t& state) {
+    float z = randomFloat(state) * 2.0f - 1.0f;
+    float phi = randomFloat(state) * 2.0f * 3.14159265359f;
+    float r = std::sqrt(std::max(1.0f - z * z, 0.0f));
+    return glm::vec3(r * std::cos(phi), r * std::sin(phi), z);
+}
+
+// GLSL 的 mod 结果总是与除数同号
+float glslMod(float x, float y) {
+    return x - y * std::floor(x / y);
+}
+
+struct ShadeInput {
+    glm::vec3 point;
+    glm::vec3 normal;
+    glm::vec3 color;
+    float metallic;
+    float roughness;
+};
+
+glm::vec3 calculateLighting(const ShadeInput& hit, const glm::vec3& lightPos, bool inShadow, const CpuTracerSettings& settings) {
+    glm::vec3 ambient = 0.1f * settings.lightColor;
+
+    glm::vec3 lightDir = glm::normalize(lightPos - hit.point);
+    float diff = std::max(glm::dot(hit.normal, lightDir), 0.0f);
+    glm::vec3 diffuse = diff * settings.lightColor;
+
+    glm::vec3 viewDir = glm::normalize(settings.cameraPos - hit.point);
+    glm::vec3 reflectDir = glm::reflect(-lightDir, hit.normal);
+    float spec = std::pow(std::max(glm::dot(viewDir, reflectDir), 0.0f), 32.0f / hit.roughness);
+    glm::vec3 specular = hit.metallic * spec * settings.lightColor;
+
+    float shadowFactor = inShadow ? 0.3f : 1.0f;
+    return (ambient + shadowFactor * (diffuse + specular)) * hit.color;
+}
+
+glm::vec3 skyColor(const glm::vec3& direction) {
+    glm::vec3 unitDir = glm::normalize(direction);
+    float t = 0.5f * (unitDir.y + 1.0f);
+    return glm::mix(glm::vec3(0.8f, 0.9f, 1.0f), glm::vec3(1.0f, 1.0f, 1.0f), t);
+}
+
+struct TileCounters {
+    uint64_t primaryRays = 0;
+    uint64_t shadowRays = 0;
+};
+
+void renderTile(const TraceContext& ctx, const CpuTracerSettings& settings,
+                uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1,
+                glm::vec3* framebuffer, GBufferTexel* gbuffer, TileCounters& counters) {
+    alignas(32) float laneOffsets[PACKET_WIDTH];
+    for (int lane = 0; lane < PACKET_WIDTH; lane++) {
+        laneOffsets[lane] = static_cast<float>(lane);
+    }
+
+    const float width = static_cast<float>(settings.width);
+    const float height = static_cast<float>(settings.height);
+    const float aspect = width / height;
+
+    alignas(32) float dirX[PACKET_WIDTH], dirY[PACKET_WIDTH], dirZ[PACKET_WIDTH];
+    alignas(32) float hitT[PACKET_WIDTH], hitPrim[PACKET_WIDTH];
+    alignas(32) float shadowOx[PACKET_WIDTH], shadowOy[PACKET_WIDTH], shadowOz[PACKET_WIDTH];
+    alignas(32) float lightX[PACKET_WIDTH], lightY[PACKET_WIDTH], lightZ[PACKET_WIDTH];
+    alignas(32) float lightDist[PACKET_WIDTH];
+    ShadeInput shade[PACKET_WIDTH];
+    glm::vec3 lightSamples[PACKET_WIDTH];
+    const uint32_t frameSeed = pcgHash(settings.frameIndex);
+
+    for (uint32_t y = y0; y < y1; y++) {
+        // 与 pathtrace.comp 的参考比对模式相同：uv 由像素中心计算（不做抖动），第0行在图像顶部
+        float uvY = 1.0f - ((static_cast<float>(y) + 0.5f) / height) * 2.0f;
+
+        for (uint32_t x = x0; x < x1; x += PACKET_WIDTH) {
+            int laneCount = static_cast<int>(std::min<uint32_t>(PACKET_WIDTH, x1 - x));
+            vfloat active = (vfloat(static_cast<float>(x)) + vfloat::load(laneOffsets)) < vfloat(static_cast<float>(x1));
+
+            for (int lane = 0; lane < PACKET_WIDTH; lane++) {
+                // 超出图块的通道复用最后一条有效光线，避免产生 NaN
+                uint32_t px = x + static_cast<uint32_t>(std::min(lane, laneCount - 1));
+                float uvX = ((static_cast<float>(px) + 0.5f) / width) * 2.0f - 1.0f;
+                glm::vec3 dir = glm::normalize(glm::vec3(uvX * aspect, uvY, -1.0f));
+                dirX[lane] = dir.x;
+                dirY[lane] = dir.y;
+                dirZ[lane] = dir.z;
+            }
+
+            RayPacket primary;
+            primary.ox = vfloat(settings.cameraPos.x);
+            primary.oy = vfloat(settings.cameraPos.y);
+            primary.oz = vfloat(settings.cameraPos.z);
+            finalizePacket(primary, dirX, dirY, dirZ, 0);
+
+            PacketHit hit;
+            closestHit(ctx, primary, active, hit);
+            hit.t.store(hitT);
+            hit.prim.store(hitPrim);
+            counters.primaryRays += static_cast<uint64_t>(laneCount);
+
+            int leadLane = -1;
+            for (int lane = 0; lane < PACKET_WIDTH; lane++) {
+                glm::vec3 origin = settings.cameraPos;
+                if (lane >= laneCount || hitPrim[lane] == NO_HIT) {
+                    shadowOx[lane] = origin.x;
+                    shadowOy[lane] = origin.y;
+                    shadowOz[lane] = origin.z;
+                    lightX[lane] = lightY[lane] = 0.0f;
+                    lightZ[lane] = 1.0f;
+                    lightDist[lane] = 0.0f;
+                    continue;
+                }
+
+                glm::vec3 dir(dirX[lane], dirY[lane], dirZ[lane]);
+                ShadeInput& s = shade[lane];
+                s.point = origin + hitT[lane] * dir;
+
+                if (hitPrim[lane] == PLANE_ID) {
+                    s.normal = ctx.plane.normal;
+                    bool isEven = glslMod(std::floor(s.point.x) + std::floor(s.point.z), 2.0f) == 0.0f;
+                    s.color = isEven ? glm::vec3(0.2f) : glm::vec3(0.8f);
+                    s.metallic = 0.0f;
+                    s.roughness = 0.8f;
+                } else {
+                    const Sphere& sphere = ctx.spheres[static_cast<uint32_t>(hitPrim[lane])];
+                    s.normal = glm::normalize(s.point - sphere.center);
+                    s.color = sphere.color;
+                    s.metallic = sphere.metallic;
+                    s.roughness = sphere.roughness;
+                }
+
+                // 软阴影：与着色器一样在光源球面上取一个随机点
+                glm::vec3 lightPos = settings.lightPos;
+                if (settings.lightRadius > 0.0f) {
+                    uint32_t rngState = pcgHash((y * settings.width + x + static_cast<uint32_t>(lane)) ^ frameSeed);
+                    lightPos += settings.lightRadius * randomUnitVector(rngState);
+                }
+                lightSamples[lane] = lightPos;
+
+                glm::vec3 shadowOrigin = s.point + 0.001f * s.normal;
+                glm::vec3 lightDir = glm::normalize(lightPos - s.point);
+                shadowOx[lane] = shadowOrigin.x;
+                shadowOy[lane] = shadowOrigin.y;
+                shadowOz[lane] = shadowOrigin.z;
+                lightX[lane] = lightDir.x;
+                lightY[lane] = lightDir.y;
+                lightZ[lane] = lightDir.z;
+                lightDist[lane] = glm::length(lightPos - s.point);
+                if (leadLane < 0) {
+                    leadLane = lane;
+                }
+            }
+
+            int shadowMask = 0;
+            if (leadLane >= 0) {
+                vfloat shadowActive = (hit.t < vfloat(MISS_T)) & active;
+
+                RayPacket shadow;
+                shadow.ox = vfloat::load(shadowOx);
+                shadow.oy = vfloat::load(shadowOy);
+                shadow.oz = vfloat::load(shadowOz);
+                finalizePacket(shadow, lightX, lightY, lightZ, leadLane);
+
+                shadowMask = simd::movemask(occluded(ctx, shadow, shadowActive, vfloat::load(lightDist)));
+                for (int activeBits = simd::movemask(shadowActive); activeBits != 0; activeBits &= activeBits - 1) {
+                    counters.shadowRays++;
+                }
+            }
+
+            glm::vec3* row = framebuffer + static_cast<size_t>(y) * settings.width;
+            for (int lane = 0; lane < laneCount; lane++) {
+                glm::vec3 color;
+                if (hitPrim[lane] == NO_HIT) {
+                    color = skyColor(glm::vec3(dirX[lane], dirY[lane], dirZ[lane]));
+                } else {
+                    color = calculateLighting(shade[lane], lightSamples[lane], (shadowMask >> lane) & 1, settings);
+                }
+                row[x + lane] = color;
+            }
+
+            if (gbuffer) {
+                GBufferTexel* gbufferRow = gbuffer + static_cast<size_t>(y) * settings.width;
+                for (int lane = 0; lane < laneCount; lane++) {
+                    GBufferTexel& texel = gbufferRow[x + lane];
+                    texel = GBufferTexel();
+                    if (hitPrim[lane] != NO_HIT) {
+                        texel.position = shade[lane].point;
+                        texel.normal = shade[lane].normal;
+                        texel.albedo = shade[lane].color;
+                        texel.hit = true;
+                    }
+                }
+            }
+        }
+    }
+}
+
+} // namespace
+
+CpuRayTracer::CpuRayTracer(const std::vector<Sphere>& spheres, const std::vector<BVHNode>& nodes, const Plane& plane)
+    : spheres(spheres), nodes(nodes), plane(plane) {
+}
+
+const char* CpuRayTracer::simdName() {
+    return simd::NAME;
+}
+
+int CpuRayTracer::packetWidth() {
+    return PACKET_WIDTH;
+}
+
+void CpuRayTracer::render(const CpuTracerSettings& settings, JobSystem& jobs,
+                          std::vector<glm::vec3>& framebuffer, CpuTracerStats* stats,
+                          std::vector<GBufferTexel>* gbuffer) const {
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    framebuffer.resize(static_cast<size_t>(settings.width) * settings.height);
+    if (gbuffer) {
+        gbuffer->resize(framebuffer.size());
+    }
+
+    TraceContext ctx{spheres.data(), nodes.data(), nodes.size(), plane};
+
+    const uint32_t tileSize = std::max(settings.tileSize, 1u);
+    const uint32_t tilesX = (settings.width + tileSize - 1) / tileSize;
+    const uint32_t tilesY = (settings.height + tileSize - 1) / tileSize;
+
+    std::atomic<uint64_t> primaryRays{0};
+    std::atomic<uint64_t> shadowRays{0};
+
+    jobs.parallelFor(0, static_cast<size_t>(tilesX) * tilesY, 1, [&](size_t begin, size_t end) {
+        TileCounters counters;
+        for (size_t tile = begin; tile < end; tile++) {
+            uint32_t x0 = static_cast<uint32_t>(tile % tilesX) * tileSize;
+            uint32_t y0 = static_cast<uint32_t>(tile / tilesX) * tileSize;
+            uint32_t x1 = std::min(x0 + tileSize, settings.width);
+            uint32_t y1 = std::min(y0 + tileSize, settings.height);
+            renderTile(ctx, settings, x0, y0, x1, y1, framebuffer.data(), gbuffer ? gbuffer->data() : nullptr, counters);
+        }
+        primaryRays += counters.primaryRays;
+        shadowRays += counters.shadowRays;
+    });
+
+    auto endTime = std::chrono::high_resolution_clock::now();
+
+    if (stats) {
+        stats->renderTimeMs = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+        stats->primaryRays = primaryRays.load();
+        stats->shadowRays = shadowRays.load();
+    }
+}
@@ -0,0 +1,60 @@
+// cpu_tracer.h
+// 多线程SIMD CPU参考光线追踪器
+// 只计算直接光照，着色逻辑与 shaders/pathtrace.comp 的参考比对模式（R 键：maxBounces = 0、
+// 光线穿过像素中心、光源取球心）逐项对应，lightRadius = 0 时可以和该模式下的Vulkan截图逐像素比对，
+// 同时作为性能基线；lightRadius > 0 时按像素随机采样光源得到带噪声的软阴影，用于验证降噪器
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "denoiser.h"
+#include "scene.h"
+
+class JobSystem;
+
+struct CpuTracerSettings {
+    uint32_t width = 800;
+    uint32_t height = 600;
+    // 每个任务处理 tileSize x tileSize 的像素块
+    uint32_t tileSize = 16;
+
+    // 与 main.cpp 中 updateUniformBuffer 写入的值保持一致
+    glm::vec3 cameraPos = glm::vec3(0.0f, 0.0f, -3.0f);
+    glm::vec3 lightPos = glm::vec3(2.0f, 2.0f, -2.0f);
+    glm::vec3 lightColor = glm::vec3(1.0f, 1.0f, 1.0f);
+    // 光源半径，0 为硬阴影（确定性结果）；大于0时每个像素在光源球面上取一个随机点（1 spp）
+    float lightRadius = 0.0f;
+    // 随机数种子，与着色器的 frameIndex 作用相同
+    uint32_t frameIndex = 0;
+};
+
+struct CpuTracerStats {
+    double renderTimeMs = 0.0;
+    uint64_t primaryRays = 0;
+    uint64_t shadowRays = 0;
+};
+
+class CpuRayTracer {
+public:
+    // spheres 必须已经按 nodes 的叶子顺序重排（见 Scene::spheres），两者在渲染期间需保持有效
+    CpuRayTracer(const std::vector<Sphere>& spheres, const std::vector<BVHNode>& nodes, const Plane& plane);
+
+    // 渲染一帧，framebuffer 中为线性颜色值（未截断），与累积图像中的内容一致
+    // 像素按行从上到下存放；gbuffer 不为空时同时写出每个像素主光线命中处的表面信息
+    void render(const CpuTracerSettings& settings, JobSystem& jobs,
+                std::vector<glm::vec3>& framebuffer, CpuTracerStats* stats = nullptr,
+                std::vector<GBufferTexel>* gbuffer = nullptr) const;
+
+    // 当前编译使用的SIMD指令集名称与每个光线包的宽度
+    static const char* simdName();
+    static int packetWidth();
+
+private:
+    const std::vector<Sphere>& spheres;
+    const std::vector<BVHNode>& nodes;
+    Plane plane;
+};
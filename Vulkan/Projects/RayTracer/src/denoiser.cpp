@@ -0,0 +1,286 @@
+// denoiser.cpp
+// CPU时空降噪器实现，每个步骤都按行并行
+
+#include "denoiser.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "job_system.h"
+
+namespace {
+
+// 每个任务处理的行数
+constexpr size_t ROW_GRAIN = 8;
+
+// B3样条核 [1/16, 1/4, 3/8, 1/4, 1/16] 的一半，按到中心的距离索引
+constexpr float ATROUS_KERNEL[3] = {3.0f / 8.0f, 1.0f / 4.0f, 1.0f / 16.0f};
+
+// 方差的3x3高斯模糊权重，按 |dx| + |dy| 索引
+constexpr float VARIANCE_KERNEL[3] = {1.0f / 4.0f, 1.0f / 8.0f, 1.0f / 16.0f};
+
+// 历史太短时亮度矩还不可靠，改用空间邻域估计方差
+constexpr float MIN_TEMPORAL_VARIANCE_HISTORY = 4.0f;
+
+// 时间重投影时，历史像素的法线与位置必须与当前像素足够接近
+constexpr float REPROJECT_NORMAL_THRESHOLD = 0.9f;
+constexpr float REPROJECT_DEPTH_PIXELS = 2.0f;
+
+// 反照率过小时解调会放大噪声
+constexpr float MIN_ALBEDO = 0.001f;
+
+float luminance(const glm::vec3& color) {
+    return glm::dot(color, glm::vec3(0.2126f, 0.7152f, 0.0722f));
+}
+
+glm::vec3 demodulate(const glm::vec3& color, const GBufferTexel& texel) {
+    return texel.hit ? color / glm::max(texel.albedo, glm::vec3(MIN_ALBEDO)) : color;
+}
+
+// position 处一个像素在世界空间中的尺寸
+float pixelFootprint(const DenoiserCamera& camera, const glm::vec3& position, float pixelSpread) {
+    return glm::length(position - camera.position) * pixelSpread;
+}
+
+// 把世界空间位置投影到上一帧相机的连续像素坐标（像素中心为 i + 0.5），位于相机后方时返回 false
+bool projectToPrevious(const DenoiserCamera& camera, const glm::vec3& position, float width, float height, glm::vec2& pixel) {
+    glm::vec3 v = position - camera.position;
+    float z = glm::dot(v, camera.forward);
+    if (z <= 0.0f) {
+        return false;
+    }
+
+    float aspect = width / height;
+    float u = glm::dot(v, camera.right) / glm::dot(camera.right, camera.right) / z / aspect;
+    float w = glm::dot(v, camera.up) / glm::dot(camera.up, camera.up) / z;
+
+    pixel.x = (u + 1.0f) * 0.5f * width;
+    pixel.y = (1.0f - w) * 0.5f * height;
+    return true;
+}
+
+} // namespace
+
+void CpuDenoiser::reset() {
+    historyValid = false;
+}
+
+void CpuDenoiser::denoise(uint32_t width, uint32_t height, const std::vector<glm::vec3>& noisy,
+                          const std::vector<GBufferTexel>& gbuffer, const DenoiserCamera& camera,
+                          JobSystem& jobs, std::vector<glm::vec3>& output) {
+    const size_t pixelCount = static_cast<size_t>(width) * height;
+    if (width != historyWidth || height != historyHeight) {
+        historyWidth = width;
+        historyHeight = height;
+        historyValid = false;
+        previousGBuffer.assign(pixelCount, GBufferTexel());
+        historyColor.assign(pixelCount, glm::vec4(0.0f));
+        historyMoments.assign(pixelCount, glm::vec2(0.0f));
+        filterBuffers[0].assign(pixelCount, glm::vec4(0.0f));
+        filterBuffers[1].assign(pixelCount, glm::vec4(0.0f));
+        moments.assign(pixelCount, glm::vec2(0.0f));
+        historyLength.assign(pixelCount, 0.0f);
+    }
+    output.resize(pixelCount);
+
+    const int w = static_cast<int>(width);
+    const int h = static_cast<int>(height);
+    const float pixelSpread = 2.0f * glm::length(camera.up) / static_cast<float>(height);
+
+    // 时间累积：把当前帧与重投影到上一帧位置的历史按指数滑动平均混合，同时累积亮度的一阶、二阶矩
+    jobs.parallelFor(0, height, ROW_GRAIN, [&](size_t rowBegin, size_t rowEnd) {
+        for (int y = static_cast<int>(rowBegin); y < static_cast<int>(rowEnd); y++) {
+            for (int x = 0; x < w; x++) {
+                size_t index = static_cast<size_t>(y) * width + x;
+                const GBufferTexel& texel = gbuffer[index];
+                glm::vec3 color = demodulate(noisy[index], texel);
+
+                // 天空没有噪声，原样通过
+                if (!texel.hit) {
+                    filterBuffers[0][index] = glm::vec4(color, 0.0f);
+                    moments[index] = glm::vec2(0.0f);
+                    historyLength[index] = 0.0f;
+                    continue;
+                }
+
+                float lum = luminance(color);
+
+                // 双线性取历史，四个样本各自检查法线与平面距离，丢弃被遮挡或属于其他物体的样本
+                glm::vec3 prevColor(0.0f);
+                glm::vec2 prevMoments(0.0f);
+                float prevLength = 0.0f;
+                float weightSum = 0.0f;
+                glm::vec2 prevPixel;
+                if (historyValid && projectToPrevious(previousCamera, texel.position, static_cast<float>(w), static_cast<float>(h), prevPixel)) {
+                    glm::vec2 texelPos = prevPixel - 0.5f;
+                    glm::ivec2 base(static_cast<int>(std::floor(texelPos.x)), static_cast<int>(std::floor(texelPos.y)));
+                    glm::vec2 f = texelPos - glm::vec2(base);
+                    float depthTolerance = REPROJECT_DEPTH_PIXELS * pixelFootprint(camera, texel.position, pixelSpread);
+
+                    for (int tap = 0; tap < 4; tap++) {
+                        glm::ivec2 q = base + glm::ivec2(tap & 1, tap >> 1);
+                        if (q.x < 0 || q.y < 0 || q.x >= w || q.y >= h) {
+                            continue;
+                        }
+
+                        size_t prevIndex = static_cast<size_t>(q.y) * width + q.x;
+                        const GBufferTexel& prev = previousGBuffer[prevIndex];
+                        if (!prev.hit || glm::dot(prev.normal, texel.normal) < REPROJECT_NORMAL_THRESHOLD ||
+                            std::abs(glm::dot(prev.position - texel.position, texel.normal)) > depthTolerance) {
+                            continue;
+                        }
+
+                        float weight = ((tap & 1) ? f.x : 1.0f - f.x) * ((tap >> 1) ? f.y : 1.0f - f.y);
+                        prevColor += weight * glm::vec3(historyColor[prevIndex]);
+                        prevMoments += weight * historyMoments[prevIndex];
+                        prevLength += weight * historyColor[prevIndex].a;
+                        weightSum += weight;
+                    }
+                }
+
+                bool reprojected = weightSum > 0.01f;
+                float length = 1.0f;
+                glm::vec3 integrated = color;
+                glm::vec2 currentMoments(lum, lum * lum);
+                if (reprojected) {
+                    prevColor /= weightSum;
+                    prevMoments /= weightSum;
+                    prevLength /= weightSum;
+
+                    length = std::min(prevLength + 1.0f, settings.maxHistoryLength);
+                    float alpha = std::max(1.0f / length, settings.minBlendFactor);
+                    integrated = glm::mix(prevColor, color, alpha);
+                    currentMoments = glm::mix(prevMoments, currentMoments, alpha);
+                }
+
+                float variance = std::max(currentMoments.y - currentMoments.x * currentMoments.x, 0.0f);
+
+                // 历史不足时用3x3邻域内同一表面上的亮度估计方差
+                if (length < MIN_TEMPORAL_VARIANCE_HISTORY) {
+                    float sum = 0.0f;
+                    float sumSquared = 0.0f;
+                    float count = 0.0f;
+                    for (int dy = -1; dy <= 1; dy++) {
+                        for (int dx = -1; dx <= 1; dx++) {
+                            int sx = x + dx;
+                            int sy = y + dy;
+                            if (sx < 0 || sy < 0 || sx >= w || sy >= h) {
+                                continue;
+                            }
+                            size_t neighbor = static_cast<size_t>(sy) * width + sx;
+                            const GBufferTexel& other = gbuffer[neighbor];
+                            if (!other.hit || glm::dot(other.normal, texel.normal) < REPROJECT_NORMAL_THRESHOLD) {
+                                continue;
+                            }
+                            float l = luminance(demodulate(noisy[neighbor], other));
+                            sum += l;
+                            sumSquared += l * l;
+                            count += 1.0f;
+                        }
+                    }
+                    float mean = sum / count;
+                    variance = std::max(variance, sumSquared / count - mean * mean);
+                }
+
+                filterBuffers[0][index] = glm::vec4(integrated, variance);
+                moments[index] = currentMoments;
+                historyLength[index] = length;
+            }
+        }
+    });
+
+    // à-trous 小波滤波：步长每次翻倍，权重由法线、平面距离与按方差归一化的亮度差共同决定
+    for (uint32_t iteration = 0; iteration < settings.atrousIterations; iteration++) {
+        const std::vector<glm::vec4>& source = filterBuffers[iteration % 2];
+        std::vector<glm::vec4>& target = filterBuffers[(iteration + 1) % 2];
+        const int step = 1 << iteration;
+        const bool lastIteration = iteration + 1 == settings.atrousIterations;
+
+        jobs.parallelFor(0, height, ROW_GRAIN, [&](size_t rowBegin, size_t rowEnd) {
+            for (int y = static_cast<int>(rowBegin); y < static_cast<int>(rowEnd); y++) {
+                for (int x = 0; x < w; x++) {
+                    size_t index = static_cast<size_t>(y) * width + x;
+                    const GBufferTexel& texel = gbuffer[index];
+                    glm::vec4 center = source[index];
+                    glm::vec4 result = center;
+
+                    if (texel.hit) {
+                        // 亮度权重使用模糊后的方差，减小方差估计本身的噪声
+                        float variance = 0.0f;
+                        for (int dy = -1; dy <= 1; dy++) {
+                            for (int dx = -1; dx <= 1; dx++) {
+                                int sx = std::clamp(x + dx, 0, w - 1);
+                                int sy = std::clamp(y + dy, 0, h - 1);
+                                variance += VARIANCE_KERNEL[std::abs(dx) + std::abs(dy)] * source[static_cast<size_t>(sy) * width + sx].a;
+                            }
+                        }
+
+                        float centerLum = luminance(glm::vec3(center));
+                        float lumScale = settings.luminanceSigma * std::sqrt(std::max(variance, 0.0f)) + 1e-4f;
+                        float footprint = pixelFootprint(camera, texel.position, pixelSpread);
+
+                        glm::vec3 colorSum(0.0f);
+                        float varianceSum = 0.0f;
+                        float weightSum = 0.0f;
+                        for (int dy = -2; dy <= 2; dy++) {
+                            for (int dx = -2; dx <= 2; dx++) {
+                                int sx = x + dx * step;
+                                int sy = y + dy * step;
+                                if (sx < 0 || sy < 0 || sx >= w || sy >= h) {
+                                    continue;
+                                }
+
+                                size_t neighbor = static_cast<size_t>(sy) * width + sx;
+                                const GBufferTexel& other = gbuffer[neighbor];
+                                if (!other.hit) {
+                                    continue;
+                                }
+
+                                glm::vec4 sample = source[neighbor];
+                                float distance = step * std::sqrt(static_cast<float>(dx * dx + dy * dy));
+                                float normalWeight = std::pow(std::max(glm::dot(texel.normal, other.normal), 0.0f), settings.normalSigma);
+                                float planeDistance = std::abs(glm::dot(other.position - texel.position, texel.normal));
+                                float positionWeight = std::exp(-planeDistance / (settings.positionSigma * footprint * distance + 1e-4f));
+                                float lumWeight = std::exp(-std::abs(luminance(glm::vec3(sample)) - centerLum) / lumScale);
+
+                                float weight = ATROUS_KERNEL[std::abs(dx)] * ATROUS_KERNEL[std::abs(dy)] *
+                                               normalWeight * positionWeight * lumWeight;
+                                colorSum += weight * glm::vec3(sample);
+                                varianceSum += weight * weight * sample.a;
+                                weightSum += weight;
+                            }
+                        }
+
+                        result = glm::vec4(colorSum / weightSum, varianceSum / (weightSum * weightSum));
+                    }
+
+                    target[index] = result;
+
+                    // 第一次滤波的结果作为下一帧的历史：比原始累积值更平滑，重投影更稳定
+                    if (iteration == 0) {
+                        historyColor[index] = glm::vec4(glm::vec3(result), historyLength[index]);
+                        historyMoments[index] = moments[index];
+                    }
+
+                    if (lastIteration) {
+                        output[index] = texel.hit ? glm::vec3(result) * texel.albedo : glm::vec3(result);
+                    }
+                }
+            }
+        });
+    }
+
+    // 没有做 à-trous 时直接输出时间累积的结果
+    if (settings.atrousIterations == 0) {
+        for (size_t i = 0; i < pixelCount; i++) {
+            const GBufferTexel& texel = gbuffer[i];
+            historyColor[i] = glm::vec4(glm::vec3(filterBuffers[0][i]), historyLength[i]);
+            historyMoments[i] = moments[i];
+            output[i] = texel.hit ? glm::vec3(filterBuffers[0][i]) * texel.albedo : glm::vec3(filterBuffers[0][i]);
+        }
+    }
+
+    previousGBuffer = gbuffer;
+    previousCamera = camera;
+    historyValid = true;
+}
@@ -0,0 +1,72 @@
+// denoiser.h
+// 时空降噪器的CPU实现：时间重投影累积 + 以法线、位置和亮度方差为引导的 à-trous 小波滤波
+// 算法与 shaders/denoise_temporal.comp、shaders/denoise_atrous.comp 逐项对应，用于在没有GPU的环境下验证降噪效果
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+class JobSystem;
+
+// 主光线第一次命中处的表面信息，hit 为 false 表示该像素看到的是天空
+struct GBufferTexel {
+    glm::vec3 position = glm::vec3(0.0f);
+    glm::vec3 normal = glm::vec3(0.0f);
+    glm::vec3 albedo = glm::vec3(1.0f);
+    bool hit = false;
+};
+
+// 与 pathtrace.comp 的相机约定一致：right/up 已乘以 tan(fov / 2)，forward 为单位向量
+struct DenoiserCamera {
+    glm::vec3 position;
+    glm::vec3 right;
+    glm::vec3 up;
+    glm::vec3 forward;
+};
+
+struct DenoiserSettings {
+    uint32_t atrousIterations = 5;
+    // 历史长度上限，决定了静止时最多等效累积多少帧
+    float maxHistoryLength = 32.0f;
+    // 新样本的最小混合权重，避免历史过长导致拖影
+    float minBlendFactor = 0.2f;
+    float normalSigma = 128.0f;
+    float positionSigma = 1.0f;
+    float luminanceSigma = 4.0f;
+};
+
+class CpuDenoiser {
+public:
+    explicit CpuDenoiser(const DenoiserSettings& settings = DenoiserSettings()) : settings(settings) {}
+
+    // 对一帧带噪声的线性颜色降噪，gbuffer 与 noisy 同尺寸、按行从上到下存放
+    // 颜色先按反照率解调，滤波后再乘回，避免纹理（棋盘格）被模糊
+    // 与上一帧尺寸不同或调用过 reset() 时不使用历史
+    void denoise(uint32_t width, uint32_t height, const std::vector<glm::vec3>& noisy,
+                 const std::vector<GBufferTexel>& gbuffer, const DenoiserCamera& camera,
+                 JobSystem& jobs, std::vector<glm::vec3>& output);
+
+    void reset();
+
+private:
+    DenoiserSettings settings;
+
+    uint32_t historyWidth = 0;
+    uint32_t historyHeight = 0;
+    bool historyValid = false;
+    DenoiserCamera previousCamera{};
+
+    std::vector<GBufferTexel> previousGBuffer;
+    // rgb 为历史颜色（解调后），a 为历史长度
+    std::vector<glm::vec4> historyColor;
+    // 亮度的一阶、二阶矩
+    std::vector<glm::vec2> historyMoments;
+
+    // rgb 为颜色，a 为亮度方差
+    std::vector<glm::vec4> filterBuffers[2];
+    std::vector<glm::vec2> moments;
+    std::vector<float> historyLength;
+};
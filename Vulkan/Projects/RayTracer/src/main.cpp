@@ -9,22 +9,79 @@
 #include <limits>
 #include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <cstring>
 #include <fstream>
+#include <iomanip>
 #include <optional>
 #include <set>
+#include <sstream>
 
 #include <glm/glm.hpp>
-#include <glm/gtc/matrix_transform.hpp>
 
+#include "bvh.h"
+#include "job_system.h"
+#include "scene.h"
+
+// 与 pathtrace.comp 中的 std140 布局一致：每个 vec3 后面紧跟一个4字节标量
 struct UniformBufferObject {
-    alignas(16) glm::mat4 model;
-    alignas(16) glm::mat4 view;
-    alignas(16) glm::mat4 proj;
     alignas(16) glm::vec3 cameraPos;
-    alignas(16) float time;
-    alignas(16) glm::vec3 lightPos;
-    alignas(16) glm::vec3 lightColor;
+    uint32_t frameIndex;
+    alignas(16) glm::vec3 cameraRight;
+    uint32_t accumulatedSamples;
+    alignas(16) glm::vec3 cameraUp;
+    uint32_t samplesPerFrame;
+    alignas(16) glm::vec3 cameraForward;
+    uint32_t maxBounces;
+    alignas(16) glm::vec3 planePoint;
+    float planeMetallic;
+    alignas(16) glm::vec3 planeNormal;
+    float planeRoughness;
+    alignas(16) glm::vec3 planeColor;
+    uint32_t lightCount;
+    uint32_t renderWidth;
+    uint32_t renderHeight;
+    uint32_t denoise;
+    uint32_t reference;
+};
+
+// 降噪管线共用的 push constant，布局与 denoise_temporal.comp、denoise_atrous.comp 一致
+struct DenoiseConstants {
+    alignas(16) glm::vec3 cameraPos;
+    float pixelSpread;
+    alignas(16) glm::vec3 prevCameraPos;
+    uint32_t historyValid;
+    alignas(16) glm::vec3 prevCameraRight;
+    int32_t stepSize;
+    alignas(16) glm::vec3 prevCameraUp;
+    int32_t source;
+    alignas(16) glm::vec3 prevCameraForward;
+    int32_t target;
+    int32_t renderWidth;
+    int32_t renderHeight;
+};
+
+// 相机的位置与基向量，right/up 已乘以 tan(fov / 2)
+struct CameraBasis {
+    glm::vec3 position;
+    glm::vec3 right;
+    glm::vec3 up;
+    glm::vec3 forward;
+};
+
+// 计算着色器读写的图像，始终处于 VK_IMAGE_LAYOUT_GENERAL
+struct StorageImage {
+    VkImage image;
+    VkDeviceMemory memory;
+    VkImageView view;
+};
+
+// 呈现管线的 push constant：把缩放后的追踪结果拉伸到整个交换链图像
+struct PresentConstants {
+    int32_t renderWidth;
+    int32_t renderHeight;
+    int32_t outputWidth;
+    int32_t outputHeight;
 };
 
 struct QueueFamilyIndices {
@@ -47,6 +104,32 @@ const uint32_t HEIGHT = 600;
 
 const uint32_t MAX_FRAMES_IN_FLIGHT = 2;
 
+// 计算着色器的线程组大小（8x8 像素块）
+const uint32_t TILE_SIZE = 8;
+
+// 路径追踪参数
+const uint32_t MAX_BOUNCES = 4;
+const uint32_t MAX_SAMPLES_PER_FRAME = 64;
+// 累积到这么多采样后认为图像已经收敛，之后只做呈现不再追踪
+const uint32_t MAX_ACCUMULATED_SAMPLES = 4096;
+// 每帧用于路径追踪的GPU时间预算（毫秒），每帧的采样数会据此自动调整
+const float DEFAULT_TRACE_BUDGET_MS = 12.0f;
+
+// 动态分辨率：追踪分辨率在交换链尺寸的 50%~100% 之间按 5% 的步长调整，
+// 每次调整都会重置累积，因此两次调整之间至少间隔若干帧
+const float MIN_RENDER_SCALE = 0.5f;
+const float RENDER_SCALE_STEP = 0.05f;
+const uint32_t RENDER_SCALE_CHANGE_INTERVAL = 8;
+
+// 降噪：à-trous 滤波的级数（步长依次为 1, 2, 4, ...），降噪模式下每帧只追踪1个采样
+const uint32_t DENOISE_ATROUS_ITERATIONS = 5;
+const uint32_t DENOISE_SAMPLES_PER_FRAME = 1;
+// denoise_atrous.comp 中 target 为该值时输出到累积图像
+const int32_t DENOISE_TARGET_OUTPUT = 2;
+
+// 每帧用于增量上传场景修改的暂存缓冲大小，超出时整体重建场景缓冲
+const VkDeviceSize SCENE_STAGING_BUFFER_SIZE = 1 << 20;
+
 const std::vector<const char*> validationLayers = {
     "VK_LAYER_KHRONOS_validation"
 };
@@ -57,44 +140,19 @@ const bool enableValidationLayers = false;
 const bool enableValidationLayers = true;
 #endif
 
-struct Vertex {
-    glm::vec3 pos;
-    glm::vec3 normal;
-    glm::vec2 texCoord;
-
-    static VkVertexInputBindingDescription getBindingDescription() {
-        VkVertexInputBindingDescription bindingDescription{};
-        bindingDescription.binding = 0;
-        bindingDescription.stride = sizeof(Vertex);
-        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-
-        return bindingDescription;
-    }
-
-    static std::array<VkVertexInputAttributeDescription, 3> getAttributeDescriptions() {
-        std::array<VkVertexInputAttributeDescription, 3> attributeDescriptions{};
-
-        attributeDescriptions[0].binding = 0;
-        attributeDescriptions[0].location = 0;
-        attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-        attributeDescriptions[0].offset = offsetof(Vertex, pos);
-
-        attributeDescriptions[1].binding = 0;
-        attributeDescriptions[1].location = 1;
-        attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-        attributeDescriptions[1].offset = offsetof(Vertex, normal);
-
-        attributeDescriptions[2].binding = 0;
-        attributeDescriptions[2].location = 2;
-        attributeDescriptions[2].format = VK_FORMAT_R32G32_SFLOAT;
-        attributeDescriptions[2].offset = offsetof(Vertex, texCoord);
-
-        return attributeDescriptions;
-    }
-};
-
 class VulkanRayTracer {
 public:
+    explicit VulkanRayTracer(uint32_t extraSphereCount = 0, float traceBudgetMs = DEFAULT_TRACE_BUDGET_MS, const std::string& renderScaleLogFile = "")
+        : extraSphereCount(extraSphereCount), traceBudgetMs(traceBudgetMs) {
+        if (!renderScaleLogFile.empty()) {
+            renderScaleLog.open(renderScaleLogFile);
+            if (!renderScaleLog.is_open()) {
+                throw std::runtime_error("failed to open file! " + renderScaleLogFile);
+            }
+            renderScaleLog << "frame,trace_ms,render_scale,render_width,render_height,samples" << std::endl;
+        }
+    }
+
     void run() {
         initWindow();
         initVulkan();
@@ -124,8 +182,18 @@ private:
 
     VkRenderPass renderPass;
     VkDescriptorSetLayout descriptorSetLayout;
+    // 呈现：用全屏三角形把累积图像绘制到交换链
     VkPipelineLayout pipelineLayout;
     VkPipeline graphicsPipeline;
+    // 路径追踪计算管线
+    VkPipelineLayout computePipelineLayout;
+    VkPipeline computePipeline;
+    // 降噪：时间累积与 à-trous 滤波两条计算管线，共用一个只包含图像的描述符集
+    VkDescriptorSetLayout denoiseDescriptorSetLayout;
+    VkPipelineLayout denoisePipelineLayout;
+    VkPipeline temporalPipeline;
+    VkPipeline atrousPipeline;
+    VkDescriptorSet denoiseDescriptorSet;
 
     VkCommandPool commandPool;
     std::vector<VkCommandBuffer> commandBuffers;
@@ -135,26 +203,97 @@ private:
     std::vector<VkFence> inFlightFences;
     size_t currentFrame = 0;
 
-    std::vector<Vertex> vertices;
-    std::vector<uint32_t> indices;
-    VkBuffer vertexBuffer;
-    VkDeviceMemory vertexBufferMemory;
-    VkBuffer indexBuffer;
-    VkDeviceMemory indexBufferMemory;
-
     std::vector<VkBuffer> uniformBuffers;
     std::vector<VkDeviceMemory> uniformBuffersMemory;
     std::vector<void*> uniformBuffersMapped;
     VkDescriptorPool descriptorPool;
     std::vector<VkDescriptorSet> descriptorSets;
 
+    // 场景：球体、BVH与光源存放在所有帧共享的设备本地缓冲中，
+    // 修改过的区间先写入当前帧的暂存缓冲，再在该帧的命令缓冲开头复制过去
+    uint32_t extraSphereCount = 0;
+    JobSystem jobSystem;
+    Scene scene;
+    VkBuffer sphereBuffer;
+    VkDeviceMemory sphereBufferMemory;
+    VkBuffer bvhBuffer;
+    VkDeviceMemory bvhBufferMemory;
+    VkBuffer lightBuffer;
+    VkDeviceMemory lightBufferMemory;
+    std::vector<VkBuffer> sceneStagingBuffers;
+    std::vector<VkDeviceMemory> sceneStagingBuffersMemory;
+    std::vector<void*> sceneStagingBuffersMapped;
+    std::vector<VkBufferCopy> sphereCopies;
+    std::vector<VkBufferCopy> bvhCopies;
+    std::vector<VkBufferCopy> lightCopies;
+
+    // 演示增量更新：空格键切换红色球体的上下浮动与光源的环绕
+    bool animateScene = false;
+    bool spaceWasPressed = false;
+    float animationTime = 0.0f;
+
+    // 浮点累积缓冲（按交换链尺寸分配），动态分辨率下只使用左上角 renderExtent() 大小的区域
+    StorageImage accumulationImage;
+    uint32_t accumulatedSamples = 0;
+    uint32_t frameIndex = 0;
+
+    // 降噪用的图像，与累积缓冲同尺寸：路径追踪写出的G-buffer与反照率、上一帧的G-buffer，
+    // 时间累积的颜色与亮度矩历史，以及 à-trous 滤波来回使用的两张图像
+    StorageImage gbufferImage;
+    StorageImage albedoImage;
+    StorageImage prevGbufferImage;
+    StorageImage historyColorImage;
+    StorageImage momentsImage;
+    StorageImage historyMomentsImage;
+    std::array<StorageImage, 2> filterImages;
+
+    // F 键切换降噪模式；历史在分辨率改变或刚开启时无效
+    bool denoiseEnabled = false;
+    bool denoiseKeyWasPressed = false;
+    bool denoiseHistoryValid = false;
+
+    // R 键切换参考比对模式：只做直接光照（maxBounces = 0），光线穿过像素中心、光源取球心，
+    // 输出与 cpu_ray_tracer 的默认设置（lightRadius = 0）逐像素对应
+    bool referenceMode = false;
+    bool referenceKeyWasPressed = false;
+    CameraBasis previousCamera{};
+
+    // 每帧在路径追踪前后各写一个时间戳，用于按GPU耗时调整追踪分辨率与采样数
+    VkQueryPool timestampQueryPool;
+    bool timestampsSupported = false;
+    float timestampPeriod = 1.0f;
+    std::array<uint32_t, MAX_FRAMES_IN_FLIGHT> frameSamples{};
+    std::array<float, MAX_FRAMES_IN_FLIGHT> frameRenderScales{};
+    float traceBudgetMs = DEFAULT_TRACE_BUDGET_MS;
+    uint32_t samplesPerFrame = 1;
+    float renderScale = 1.0f;
+    uint32_t framesSinceScaleChange = 0;
+    // 换算到100%分辨率下的单次采样耗时（平滑后），与当前缩放比例无关
+    double smoothedFullResMsPerSample = 0.0;
+    double lastTraceTimeMs = 0.0;
+    // 逐帧记录所选的缩放比例（可选，由命令行指定文件）
+    std::ofstream renderScaleLog;
+
+    bool framebufferResized = false;
+
+    // 相机（位于 scene 中）：WASD/QE 移动，方向键或按住鼠标左键拖动转向
+    double lastCursorX = 0.0;
+    double lastCursorY = 0.0;
+    bool cursorDragging = false;
+
     void initWindow() {
         glfwInit();
 
         glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-        glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
 
         window = glfwCreateWindow(WIDTH, HEIGHT, "Vulkan Ray Tracer", nullptr, nullptr);
+        glfwSetWindowUserPointer(window, this);
+        glfwSetFramebufferSizeCallback(window, framebufferResizeCallback);
+    }
+
+    static void framebufferResizeCallback(GLFWwindow* window, int width, int height) {
+        auto app = reinterpret_cast<VulkanRayTracer*>(glfwGetWindowUserPointer(window));
+        app->framebufferResized = true;
     }
 
     void initVulkan() {
@@ -168,11 +307,14 @@ private:
         createRenderPass();
         createDescriptorSetLayout();
         createGraphicsPipeline();
+        createComputePipeline();
+        createDenoisePipelines();
         createFramebuffers();
         createCommandPool();
-        createVertexBuffer();
-        createIndexBuffer();
+        createStorageImages();
+        createSceneBuffers();
         createUniformBuffers();
+        createTimestampQueries();
         createDescriptorPool();
         createDescriptorSets();
         createCommandBuffers();
@@ -372,7 +514,8 @@ private:
 
         int i = 0;
         for (const auto& queueFamily : queueFamilies) {
-            if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+            // 路径追踪与呈现在同一个队列上提交，需要同时支持图形与计算
+            if ((queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) && (queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT)) {
                 indices.graphicsFamily = i;
             }
 
@@ -577,7 +720,8 @@ private:
         VkAttachmentDescription colorAttachment{};
         colorAttachment.format = swapChainImageFormat;
         colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-        colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        // 全屏三角形覆盖所有像素，无需清除
+        colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
         colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
@@ -620,26 +764,106 @@ private:
         uboLayoutBinding.binding = 0;
         uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
         uboLayoutBinding.descriptorCount = 1;
-        uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+        uboLayoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
         uboLayoutBinding.pImmutableSamplers = nullptr;
 
+        VkDescriptorSetLayoutBinding sphereLayoutBinding{};
+        sphereLayoutBinding.binding = 1;
+        sphereLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        sphereLayoutBinding.descriptorCount = 1;
+        sphereLayoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        sphereLayoutBinding.pImmutableSamplers = nullptr;
+
+        VkDescriptorSetLayoutBinding bvhLayoutBinding{};
+        bvhLayoutBinding.binding = 2;
+        bvhLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bvhLayoutBinding.descriptorCount = 1;
+        bvhLayoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        bvhLayoutBinding.pImmutableSamplers = nullptr;
+
+        // 计算着色器写入累积结果，呈现用的片元着色器读取
+        VkDescriptorSetLayoutBinding accumLayoutBinding{};
+        accumLayoutBinding.binding = 3;
+        accumLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        accumLayoutBinding.descriptorCount = 1;
+        accumLayoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+        accumLayoutBinding.pImmutableSamplers = nullptr;
+
+        VkDescriptorSetLayoutBinding lightLayoutBinding{};
+        lightLayoutBinding.binding = 4;
+        lightLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        lightLayoutBinding.descriptorCount = 1;
+        lightLayoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        lightLayoutBinding.pImmutableSamplers = nullptr;
+
+        // 路径追踪写出降噪用的G-buffer与反照率
+        VkDescriptorSetLayoutBinding gbufferLayoutBinding{};
+        gbufferLayoutBinding.binding = 5;
+        gbufferLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        gbufferLayoutBinding.descriptorCount = 1;
+        gbufferLayoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        gbufferLayoutBinding.pImmutableSamplers = nullptr;
+
+        VkDescriptorSetLayoutBinding albedoLayoutBinding{};
+        albedoLayoutBinding.binding = 6;
+        albedoLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        albedoLayoutBinding.descriptorCount = 1;
+        albedoLayoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        albedoLayoutBinding.pImmutableSamplers = nullptr;
+
+        std::array<VkDescriptorSetLayoutBinding, 7> bindings = {uboLayoutBinding, sphereLayoutBinding, bvhLayoutBinding, accumLayoutBinding, lightLayoutBinding, gbufferLayoutBinding, albedoLayoutBinding};
+
         VkDescriptorSetLayoutCreateInfo layoutInfo{};
         layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-        layoutInfo.bindingCount = 1;
-        layoutInfo.pBindings = &uboLayoutBinding;
+        layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+        layoutInfo.pBindings = bindings.data();
 
         if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS) {
             throw std::runtime_error("failed to create descriptor set layout!");
         }
+
+        // 降噪描述符集：0 累积图像，1 G-buffer，2 反照率，3 上一帧G-buffer，4 颜色历史，
+        // 5 亮度矩，6 亮度矩历史，7/8 两张滤波图像
+        std::array<VkDescriptorSetLayoutBinding, 9> denoiseBindings{};
+        for (uint32_t i = 0; i < denoiseBindings.size(); i++) {
+            denoiseBindings[i].binding = i;
+            denoiseBindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+            denoiseBindings[i].descriptorCount = 1;
+            denoiseBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+            denoiseBindings[i].pImmutableSamplers = nullptr;
+        }
+
+        VkDescriptorSetLayoutCreateInfo denoiseLayoutInfo{};
+        denoiseLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        denoiseLayoutInfo.bindingCount = static_cast<uint32_t>(denoiseBindings.size());
+        denoiseLayoutInfo.pBindings = denoiseBindings.data();
+
+        if (vkCreateDescriptorSetLayout(device, &denoiseLayoutInfo, nullptr, &denoiseDescriptorSetLayout) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create denoise descriptor set layout!");
+        }
     }
 
     void createGraphicsPipeline() {
-        auto vertexShaderCode = readFile("shaders/vertex.spv");
-        auto fragmentShaderCode = readFile("shaders/fragment.spv");
+        auto vertexShaderCode = readFile("shaders/fullscreen.spv");
+        auto fragmentShaderCode = readFile("shaders/present.spv");
 
         VkShaderModule vertexShaderModule = createShaderModule(vertexShaderCode);
         VkShaderModule fragmentShaderModule = createShaderModule(fragmentShaderCode);
 
+        // 交换链不是sRGB格式时由片元着色器自己做gamma校正
+        VkBool32 applyGamma = isSrgbFormat(swapChainImageFormat) ? VK_FALSE : VK_TRUE;
+
+        VkSpecializationMapEntry specializationEntry{};
+        specializationEntry.constantID = 0;
+        specializationEntry.offset = 0;
+        specializationEntry.size = sizeof(VkBool32);
+
+        VkSpecializationInfo specializationInfo{};
+        specializationInfo.mapEntryCount = 1;
+        specializationInfo.pMapEntries = &specializationEntry;
+        specializationInfo.dataSize = sizeof(VkBool32);
+        specializationInfo.pData = &applyGamma;
+
         VkPipelineShaderStageCreateInfo vertexShaderStageInfo{};
         vertexShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
         vertexShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
@@ -651,18 +875,15 @@ private:
         fragmentShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
         fragmentShaderStageInfo.module = fragmentShaderModule;
         fragmentShaderStageInfo.pName = "main";
+        fragmentShaderStageInfo.pSpecializationInfo = &specializationInfo;
 
         VkPipelineShaderStageCreateInfo shaderStages[] = {vertexShaderStageInfo, fragmentShaderStageInfo};
 
-        auto bindingDescription = Vertex::getBindingDescription();
-        auto attributeDescriptions = Vertex::getAttributeDescriptions();
-
+        // 全屏三角形的顶点由 gl_VertexIndex 生成，没有顶点输入
         VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
         vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-        vertexInputInfo.vertexBindingDescriptionCount = 1;
-        vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
-        vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-        vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+        vertexInputInfo.vertexBindingDescriptionCount = 0;
+        vertexInputInfo.vertexAttributeDescriptionCount = 0;
 
         VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
         inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
@@ -694,7 +915,7 @@ private:
         rasterizer.rasterizerDiscardEnable = VK_FALSE;
         rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
         rasterizer.lineWidth = 1.0f;
-        rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
+        rasterizer.cullMode = VK_CULL_MODE_NONE;
         rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
         rasterizer.depthBiasEnable = VK_FALSE;
 
@@ -703,14 +924,6 @@ private:
         multisampling.sampleShadingEnable = VK_FALSE;
         multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
 
-        VkPipelineDepthStencilStateCreateInfo depthStencil{};
-        depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-        depthStencil.depthTestEnable = VK_TRUE;
-        depthStencil.depthWriteEnable = VK_TRUE;
-        depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
-        depthStencil.depthBoundsTestEnable = VK_FALSE;
-        depthStencil.stencilTestEnable = VK_FALSE;
-
         VkPipelineColorBlendAttachmentState colorBlendAttachment{};
         colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
         colorBlendAttachment.blendEnable = VK_FALSE;
@@ -730,7 +943,13 @@ private:
         pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
         pipelineLayoutInfo.setLayoutCount = 1;
         pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
-        pipelineLayoutInfo.pushConstantRangeCount = 0;
+
+        VkPushConstantRange pushConstantRange{};
+        pushConstantRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+        pushConstantRange.offset = 0;
+        pushConstantRange.size = sizeof(PresentConstants);
+        pipelineLayoutInfo.pushConstantRangeCount = 1;
+        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
 
         if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
             throw std::runtime_error("failed to create pipeline layout!");
@@ -745,7 +964,7 @@ private:
         pipelineInfo.pViewportState = &viewportState;
         pipelineInfo.pRasterizationState = &rasterizer;
         pipelineInfo.pMultisampleState = &multisampling;
-        pipelineInfo.pDepthStencilState = &depthStencil;
+        pipelineInfo.pDepthStencilState = nullptr;
         pipelineInfo.pColorBlendState = &colorBlending;
         pipelineInfo.pDynamicState = nullptr;
         pipelineInfo.layout = pipelineLayout;
@@ -762,6 +981,87 @@ private:
         vkDestroyShaderModule(device, vertexShaderModule, nullptr);
     }
 
+    bool isSrgbFormat(VkFormat format) {
+        return format == VK_FORMAT_B8G8R8A8_SRGB || format == VK_FORMAT_R8G8B8A8_SRGB || format == VK_FORMAT_A8B8G8R8_SRGB_PACK32;
+    }
+
+    void createComputePipeline() {
+        auto computeShaderCode = readFile("shaders/pathtrace.spv");
+        VkShaderModule computeShaderModule = createShaderModule(computeShaderCode);
+
+        VkPipelineShaderStageCreateInfo computeShaderStageInfo{};
+        computeShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        computeShaderStageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        computeShaderStageInfo.module = computeShaderModule;
+        computeShaderStageInfo.pName = "main";
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = 1;
+        pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+
+        if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &computePipelineLayout) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create compute pipeline layout!");
+        }
+
+        VkComputePipelineCreateInfo pipelineInfo{};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.stage = computeShaderStageInfo;
+        pipelineInfo.layout = computePipelineLayout;
+
+        if (vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &computePipeline) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create compute pipeline!");
+        }
+
+        vkDestroyShaderModule(device, computeShaderModule, nullptr);
+    }
+
+    void createDenoisePipelines() {
+        VkPushConstantRange pushConstantRange{};
+        pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        pushConstantRange.offset = 0;
+        pushConstantRange.size = sizeof(DenoiseConstants);
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = 1;
+        pipelineLayoutInfo.pSetLayouts = &denoiseDescriptorSetLayout;
+        pipelineLayoutInfo.pushConstantRangeCount = 1;
+        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+        if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &denoisePipelineLayout) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create denoise pipeline layout!");
+        }
+
+        temporalPipeline = createDenoisePipeline("shaders/denoise_temporal.spv");
+        atrousPipeline = createDenoisePipeline("shaders/denoise_atrous.spv");
+    }
+
+    VkPipeline createDenoisePipeline(const std::string& filename) {
+        auto computeShaderCode = readFile(filename);
+        VkShaderModule computeShaderModule = createShaderModule(computeShaderCode);
+
+        VkPipelineShaderStageCreateInfo computeShaderStageInfo{};
+        computeShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        computeShaderStageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        computeShaderStageInfo.module = computeShaderModule;
+        computeShaderStageInfo.pName = "main";
+
+        VkComputePipelineCreateInfo pipelineInfo{};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.stage = computeShaderStageInfo;
+        pipelineInfo.layout = denoisePipelineLayout;
+
+        VkPipeline pipeline;
+        if (vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create denoise pipeline!");
+        }
+
+        vkDestroyShaderModule(device, computeShaderModule, nullptr);
+
+        return pipeline;
+    }
+
     void createFramebuffers() {
         swapChainFramebuffers.resize(swapChainImageViews.size());
 
@@ -798,104 +1098,228 @@ private:
         }
     }
 
-    void createVertexBuffer() {
-        createVertexData();
+    // 累积图像与降噪用的图像都与交换链同尺寸，创建后直接转换到 GENERAL 布局供计算与片元着色器读写
+    void createStorageImages() {
+        createStorageImage(VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_USAGE_STORAGE_BIT, accumulationImage);
+
+        // G-buffer与亮度矩在帧末复制为下一帧的历史
+        createStorageImage(VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, gbufferImage);
+        createStorageImage(VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_USAGE_STORAGE_BIT, albedoImage);
+        createStorageImage(VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, prevGbufferImage);
+        createStorageImage(VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_USAGE_STORAGE_BIT, historyColorImage);
+        createStorageImage(VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, momentsImage);
+        createStorageImage(VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, historyMomentsImage);
+        for (StorageImage& filterImage : filterImages) {
+            createStorageImage(VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_USAGE_STORAGE_BIT, filterImage);
+        }
 
-        VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
+        accumulatedSamples = 0;
+        denoiseHistoryValid = false;
+    }
 
-        VkBuffer stagingBuffer;
-        VkDeviceMemory stagingBufferMemory;
-        createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+    void createStorageImage(VkFormat format, VkImageUsageFlags usage, StorageImage& storageImage) {
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.extent.width = swapChainExtent.width;
+        imageInfo.extent.height = swapChainExtent.height;
+        imageInfo.extent.depth = 1;
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.format = format;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageInfo.usage = usage;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        if (vkCreateImage(device, &imageInfo, nullptr, &storageImage.image) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create storage image!");
+        }
 
-        void* data;
-        vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
-        memcpy(data, vertices.data(), (size_t) bufferSize);
-        vkUnmapMemory(device, stagingBufferMemory);
+        VkMemoryRequirements memRequirements;
+        vkGetImageMemoryRequirements(device, storageImage.image, &memRequirements);
 
-        createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBuffer, vertexBufferMemory);
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = memRequirements.size;
+        allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
-        copyBuffer(stagingBuffer, vertexBuffer, bufferSize);
+        if (vkAllocateMemory(device, &allocInfo, nullptr, &storageImage.memory) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate storage image memory!");
+        }
 
-        vkDestroyBuffer(device, stagingBuffer, nullptr);
-        vkFreeMemory(device, stagingBufferMemory, nullptr);
+        vkBindImageMemory(device, storageImage.image, storageImage.memory, 0);
+
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = storageImage.image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = format;
+        viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        viewInfo.subresourceRange.baseMipLevel = 0;
+        viewInfo.subresourceRange.levelCount = 1;
+        viewInfo.subresourceRange.baseArrayLayer = 0;
+        viewInfo.subresourceRange.layerCount = 1;
+
+        if (vkCreateImageView(device, &viewInfo, nullptr, &storageImage.view) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create storage image view!");
+        }
+
+        VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = storageImage.image;
+        barrier.subresourceRange = viewInfo.subresourceRange;
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+        endSingleTimeCommands(commandBuffer);
+    }
+
+    void cleanupStorageImages() {
+        cleanupStorageImage(accumulationImage);
+        cleanupStorageImage(gbufferImage);
+        cleanupStorageImage(albedoImage);
+        cleanupStorageImage(prevGbufferImage);
+        cleanupStorageImage(historyColorImage);
+        cleanupStorageImage(momentsImage);
+        cleanupStorageImage(historyMomentsImage);
+        for (StorageImage& filterImage : filterImages) {
+            cleanupStorageImage(filterImage);
+        }
+    }
+
+    void cleanupStorageImage(StorageImage& storageImage) {
+        vkDestroyImageView(device, storageImage.view, nullptr);
+        vkDestroyImage(device, storageImage.image, nullptr);
+        vkFreeMemory(device, storageImage.memory, nullptr);
+    }
+
+    void createSceneBuffers() {
+        BVHBuildStats stats;
+        scene.setSpheres(createDemoSpheres(extraSphereCount), jobSystem, &stats);
+        scene.setPlane(createDemoPlane());
+        scene.addLight(createDemoLight());
+
+        std::cout << "BVH: " << scene.spheres().size() << " spheres, " << stats.nodeCount << " nodes, "
+                  << stats.leafCount << " leaves, depth " << stats.maxDepth << ", built in "
+                  << stats.buildTimeMs << " ms on " << jobSystem.threadCount() << " threads" << std::endl;
+
+        createSceneStorageBuffers();
+
+        sceneStagingBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+        sceneStagingBuffersMemory.resize(MAX_FRAMES_IN_FLIGHT);
+        sceneStagingBuffersMapped.resize(MAX_FRAMES_IN_FLIGHT);
+
+        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+            createBuffer(SCENE_STAGING_BUFFER_SIZE, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, sceneStagingBuffers[i], sceneStagingBuffersMemory[i]);
+
+            vkMapMemory(device, sceneStagingBuffersMemory[i], 0, SCENE_STAGING_BUFFER_SIZE, 0, &sceneStagingBuffersMapped[i]);
+        }
+    }
+
+    // 按场景当前内容整体创建球体、BVH与光源缓冲
+    void createSceneStorageBuffers() {
+        const std::vector<Sphere>& spheres = scene.spheres();
+        const std::vector<BVHNode>& nodes = scene.nodes();
+        createDeviceLocalBuffer(spheres.data(), sizeof(spheres[0]) * spheres.size(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, sphereBuffer, sphereBufferMemory);
+        createDeviceLocalBuffer(nodes.data(), sizeof(nodes[0]) * nodes.size(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, bvhBuffer, bvhBufferMemory);
+
+        // 光源缓冲按最大数量分配，增删光源时只需要更新 lightCount
+        std::vector<PointLight> lights(Scene::MAX_LIGHTS);
+        std::copy(scene.lights().begin(), scene.lights().end(), lights.begin());
+        createDeviceLocalBuffer(lights.data(), sizeof(lights[0]) * lights.size(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, lightBuffer, lightBufferMemory);
+
+        scene.clearChanges();
     }
 
-    void createVertexData() {
-        vertices = {
-            // Front face
-            {{-1.0f, -1.0f,  1.0f}, {0.0f, 0.0f, 1.0f}, {0.0f, 0.0f}},
-            {{ 1.0f, -1.0f,  1.0f}, {0.0f, 0.0f, 1.0f}, {1.0f, 0.0f}},
-            {{ 1.0f,  1.0f,  1.0f}, {0.0f, 0.0f, 1.0f}, {1.0f, 1.0f}},
-            {{ 1.0f,  1.0f,  1.0f}, {0.0f, 0.0f, 1.0f}, {1.0f, 1.0f}},
-            {{-1.0f,  1.0f,  1.0f}, {0.0f, 0.0f, 1.0f}, {0.0f, 1.0f}},
-            {{-1.0f, -1.0f,  1.0f}, {0.0f, 0.0f, 1.0f}, {0.0f, 0.0f}},
-
-            // Back face
-            {{-1.0f, -1.0f, -1.0f}, {0.0f, 0.0f, -1.0f}, {1.0f, 0.0f}},
-            {{ 1.0f, -1.0f, -1.0f}, {0.0f, 0.0f, -1.0f}, {0.0f, 0.0f}},
-            {{ 1.0f,  1.0f, -1.0f}, {0.0f, 0.0f, -1.0f}, {0.0f, 1.0f}},
-            {{ 1.0f,  1.0f, -1.0f}, {0.0f, 0.0f, -1.0f}, {0.0f, 1.0f}},
-            {{-1.0f,  1.0f, -1.0f}, {0.0f, 0.0f, -1.0f}, {1.0f, 1.0f}},
-            {{-1.0f, -1.0f, -1.0f}, {0.0f, 0.0f, -1.0f}, {1.0f, 0.0f}},
-
-            // Left face
-            {{-1.0f,  1.0f, -1.0f}, {-1.0f, 0.0f, 0.0f}, {1.0f, 0.0f}},
-            {{-1.0f,  1.0f,  1.0f}, {-1.0f, 0.0f, 0.0f}, {0.0f, 0.0f}},
-            {{-1.0f, -1.0f,  1.0f}, {-1.0f, 0.0f, 0.0f}, {0.0f, 1.0f}},
-            {{-1.0f, -1.0f,  1.0f}, {-1.0f, 0.0f, 0.0f}, {0.0f, 1.0f}},
-            {{-1.0f, -1.0f, -1.0f}, {-1.0f, 0.0f, 0.0f}, {1.0f, 1.0f}},
-            {{-1.0f,  1.0f, -1.0f}, {-1.0f, 0.0f, 0.0f}, {1.0f, 0.0f}},
-
-            // Right face
-            {{ 1.0f,  1.0f, -1.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 0.0f}},
-            {{ 1.0f,  1.0f,  1.0f}, {1.0f, 0.0f, 0.0f}, {1.0f, 0.0f}},
-            {{ 1.0f, -1.0f,  1.0f}, {1.0f, 0.0f, 0.0f}, {1.0f, 1.0f}},
-            {{ 1.0f, -1.0f,  1.0f}, {1.0f, 0.0f, 0.0f}, {1.0f, 1.0f}},
-            {{ 1.0f, -1.0f, -1.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 1.0f}},
-            {{ 1.0f,  1.0f, -1.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 0.0f}},
-
-            // Top face
-            {{-1.0f,  1.0f,  1.0f}, {0.0f, 1.0f, 0.0f}, {0.0f, 0.0f}},
-            {{ 1.0f,  1.0f,  1.0f}, {0.0f, 1.0f, 0.0f}, {1.0f, 0.0f}},
-            {{ 1.0f,  1.0f, -1.0f}, {0.0f, 1.0f, 0.0f}, {1.0f, 1.0f}},
-            {{ 1.0f,  1.0f, -1.0f}, {0.0f, 1.0f, 0.0f}, {1.0f, 1.0f}},
-            {{-1.0f,  1.0f, -1.0f}, {0.0f, 1.0f, 0.0f}, {0.0f, 1.0f}},
-            {{-1.0f,  1.0f,  1.0f}, {0.0f, 1.0f, 0.0f}, {0.0f, 0.0f}},
-
-            // Bottom face
-            {{-1.0f, -1.0f,  1.0f}, {0.0f, -1.0f, 0.0f}, {0.0f, 0.0f}},
-            {{ 1.0f, -1.0f,  1.0f}, {0.0f, -1.0f, 0.0f}, {1.0f, 0.0f}},
-            {{ 1.0f, -1.0f, -1.0f}, {0.0f, -1.0f, 0.0f}, {1.0f, 1.0f}},
-            {{ 1.0f, -1.0f, -1.0f}, {0.0f, -1.0f, 0.0f}, {1.0f, 1.0f}},
-            {{-1.0f, -1.0f, -1.0f}, {0.0f, -1.0f, 0.0f}, {0.0f, 1.0f}},
-            {{-1.0f, -1.0f,  1.0f}, {0.0f, -1.0f, 0.0f}, {0.0f, 0.0f}}
+    void cleanupSceneStorageBuffers() {
+        vkDestroyBuffer(device, lightBuffer, nullptr);
+        vkFreeMemory(device, lightBufferMemory, nullptr);
+        vkDestroyBuffer(device, bvhBuffer, nullptr);
+        vkFreeMemory(device, bvhBufferMemory, nullptr);
+        vkDestroyBuffer(device, sphereBuffer, nullptr);
+        vkFreeMemory(device, sphereBufferMemory, nullptr);
+    }
+
+    // 把场景自上次上传以来修改过的区间写入本帧的暂存缓冲，并记录需要在命令缓冲中执行的复制
+    // 球体数量改变或修改量超出暂存缓冲容量时，等待GPU空闲后整体重建场景缓冲
+    // 有任何修改时返回 true，调用者据此重置累积
+    bool uploadSceneChanges() {
+        sphereCopies.clear();
+        bvhCopies.clear();
+        lightCopies.clear();
+
+        if (!scene.hasChanges()) {
+            return false;
+        }
+
+        auto rangeBytes = [](const std::vector<IndexRange>& ranges, VkDeviceSize elementSize) {
+            VkDeviceSize total = 0;
+            for (const IndexRange& range : ranges) {
+                total += (range.end - range.begin) * elementSize;
+            }
+            return total;
         };
 
-        indices = {
-            0, 1, 2, 3, 4, 5,  // Front face
-            6, 7, 8, 9, 10, 11, // Back face
-            12, 13, 14, 15, 16, 17, // Left face
-            18, 19, 20, 21, 22, 23, // Right face
-            24, 25, 26, 27, 28, 29, // Top face
-            30, 31, 32, 33, 34, 35  // Bottom face
+        VkDeviceSize stagingSize = rangeBytes(scene.dirtySpheres(), sizeof(Sphere)) +
+                                   rangeBytes(scene.dirtyNodes(), sizeof(BVHNode)) +
+                                   rangeBytes(scene.dirtyLights(), sizeof(PointLight));
+
+        if (scene.layoutChanged() || stagingSize > SCENE_STAGING_BUFFER_SIZE) {
+            vkDeviceWaitIdle(device);
+            cleanupSceneStorageBuffers();
+            createSceneStorageBuffers();
+            updateSceneDescriptors();
+            return true;
+        }
+
+        char* staging = static_cast<char*>(sceneStagingBuffersMapped[currentFrame]);
+        VkDeviceSize stagingOffset = 0;
+        auto stageRanges = [&](const void* source, VkDeviceSize elementSize, const std::vector<IndexRange>& ranges, std::vector<VkBufferCopy>& copies) {
+            for (const IndexRange& range : ranges) {
+                VkBufferCopy copyRegion{};
+                copyRegion.srcOffset = stagingOffset;
+                copyRegion.dstOffset = range.begin * elementSize;
+                copyRegion.size = (range.end - range.begin) * elementSize;
+
+                memcpy(staging + stagingOffset, static_cast<const char*>(source) + copyRegion.dstOffset, (size_t) copyRegion.size);
+                stagingOffset += copyRegion.size;
+                copies.push_back(copyRegion);
+            }
         };
-    }
 
-    void createIndexBuffer() {
-        VkDeviceSize bufferSize = sizeof(indices[0]) * indices.size();
+        stageRanges(scene.spheres().data(), sizeof(Sphere), scene.dirtySpheres(), sphereCopies);
+        stageRanges(scene.nodes().data(), sizeof(BVHNode), scene.dirtyNodes(), bvhCopies);
+        stageRanges(scene.lights().data(), sizeof(PointLight), scene.dirtyLights(), lightCopies);
 
+        scene.clearChanges();
+        return true;
+    }
+
+    // 通过暂存缓冲把数据上传到设备本地缓冲
+    void createDeviceLocalBuffer(const void* srcData, VkDeviceSize bufferSize, VkBufferUsageFlags usage, VkBuffer& buffer, VkDeviceMemory& bufferMemory) {
         VkBuffer stagingBuffer;
         VkDeviceMemory stagingBufferMemory;
         createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
 
         void* data;
         vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
-        memcpy(data, indices.data(), (size_t) bufferSize);
+        memcpy(data, srcData, (size_t) bufferSize);
         vkUnmapMemory(device, stagingBufferMemory);
 
-        createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffer, indexBufferMemory);
+        createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer, bufferMemory);
 
-        copyBuffer(stagingBuffer, indexBuffer, bufferSize);
+        copyBuffer(stagingBuffer, buffer, bufferSize);
 
         vkDestroyBuffer(device, stagingBuffer, nullptr);
         vkFreeMemory(device, stagingBufferMemory, nullptr);
@@ -940,7 +1364,7 @@ private:
         throw std::runtime_error("failed to find suitable memory type!");
     }
 
-    void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
+    VkCommandBuffer beginSingleTimeCommands() {
         VkCommandBufferAllocateInfo allocInfo{};
         allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
         allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
@@ -956,10 +1380,10 @@ private:
 
         vkBeginCommandBuffer(commandBuffer, &beginInfo);
 
-        VkBufferCopy copyRegion{};
-        copyRegion.size = size;
-        vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
+        return commandBuffer;
+    }
 
+    void endSingleTimeCommands(VkCommandBuffer commandBuffer) {
         vkEndCommandBuffer(commandBuffer);
 
         VkSubmitInfo submitInfo{};
@@ -973,6 +1397,16 @@ private:
         vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
     }
 
+    void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
+        VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+
+        VkBufferCopy copyRegion{};
+        copyRegion.size = size;
+        vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
+
+        endSingleTimeCommands(commandBuffer);
+    }
+
     void createUniformBuffers() {
         VkDeviceSize bufferSize = sizeof(UniformBufferObject);
 
@@ -987,15 +1421,40 @@ private:
         }
     }
 
+    void createTimestampQueries() {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+        // 不支持时间戳时退化为固定的每帧采样数
+        timestampsSupported = properties.limits.timestampComputeAndGraphics == VK_TRUE;
+        timestampPeriod = properties.limits.timestampPeriod;
+        if (!timestampsSupported) {
+            std::cout << "GPU timestamps not supported, tracing 1 sample per frame" << std::endl;
+            return;
+        }
+
+        VkQueryPoolCreateInfo queryPoolInfo{};
+        queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        queryPoolInfo.queryCount = MAX_FRAMES_IN_FLIGHT * 2;
+
+        if (vkCreateQueryPool(device, &queryPoolInfo, nullptr, &timestampQueryPool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create timestamp query pool!");
+        }
+    }
+
     void createDescriptorPool() {
         std::vector<VkDescriptorPoolSize> poolSizes;
         poolSizes.push_back({VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT)});
+        poolSizes.push_back({VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT) * 3});
+        // 每帧的描述符集有3张存储图像，另外还有一个降噪描述符集（9张）
+        poolSizes.push_back({VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT) * 3 + 9});
 
         VkDescriptorPoolCreateInfo poolInfo{};
         poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
         poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
         poolInfo.pPoolSizes = poolSizes.data();
-        poolInfo.maxSets = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+        poolInfo.maxSets = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT) + 1;
 
         if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
             throw std::runtime_error("failed to create descriptor pool!");
@@ -1015,6 +1474,16 @@ private:
             throw std::runtime_error("failed to allocate descriptor sets!");
         }
 
+        VkDescriptorSetAllocateInfo denoiseAllocInfo{};
+        denoiseAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        denoiseAllocInfo.descriptorPool = descriptorPool;
+        denoiseAllocInfo.descriptorSetCount = 1;
+        denoiseAllocInfo.pSetLayouts = &denoiseDescriptorSetLayout;
+
+        if (vkAllocateDescriptorSets(device, &denoiseAllocInfo, &denoiseDescriptorSet) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate denoise descriptor set!");
+        }
+
         for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
             VkDescriptorBufferInfo bufferInfo{};
             bufferInfo.buffer = uniformBuffers[i];
@@ -1032,56 +1501,90 @@ private:
 
             vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, nullptr);
         }
-    }
 
-    void createCommandBuffers() {
-        commandBuffers.resize(swapChainFramebuffers.size());
+        updateSceneDescriptors();
+        updateImageDescriptors();
+    }
 
-        VkCommandBufferAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        allocInfo.commandPool = commandPool;
-        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        allocInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
+    // 场景缓冲在球体数量变化时会被重建，需要单独更新它们的描述符
+    void updateSceneDescriptors() {
+        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+            std::array<VkDescriptorBufferInfo, 3> bufferInfos{};
+            bufferInfos[0] = {sphereBuffer, 0, VK_WHOLE_SIZE};
+            bufferInfos[1] = {bvhBuffer, 0, VK_WHOLE_SIZE};
+            bufferInfos[2] = {lightBuffer, 0, VK_WHOLE_SIZE};
+            std::array<uint32_t, 3> bindings = {1, 2, 4};
+
+            std::array<VkWriteDescriptorSet, 3> descriptorWrites{};
+            for (size_t j = 0; j < descriptorWrites.size(); j++) {
+                descriptorWrites[j].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                descriptorWrites[j].dstSet = descriptorSets[i];
+                descriptorWrites[j].dstBinding = bindings[j];
+                descriptorWrites[j].dstArrayElement = 0;
+                descriptorWrites[j].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+                descriptorWrites[j].descriptorCount = 1;
+                descriptorWrites[j].pBufferInfo = &bufferInfos[j];
+            }
 
-        if (vkAllocateCommandBuffers(device, &allocInfo, commandBuffers.data()) != VK_SUCCESS) {
-            throw std::runtime_error("failed to allocate command buffers!");
+            vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
         }
+    }
 
-        for (size_t i = 0; i < commandBuffers.size(); i++) {
-            VkCommandBufferBeginInfo beginInfo{};
-            beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    // 存储图像随交换链重建，需要单独更新它们的描述符
+    void updateImageDescriptors() {
+        std::vector<VkDescriptorImageInfo> imageInfos;
+        std::vector<VkWriteDescriptorSet> descriptorWrites;
+        // 先确定数量，保证 pImageInfo 指向的元素不会因扩容失效
+        imageInfos.reserve(MAX_FRAMES_IN_FLIGHT * 3 + 9);
 
-            if (vkBeginCommandBuffer(commandBuffers[i], &beginInfo) != VK_SUCCESS) {
-                throw std::runtime_error("failed to begin recording command buffer!");
-            }
+        auto writeImage = [&](VkDescriptorSet set, uint32_t binding, const StorageImage& storageImage) {
+            VkDescriptorImageInfo imageInfo{};
+            imageInfo.imageView = storageImage.view;
+            imageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+            imageInfos.push_back(imageInfo);
 
-            VkRenderPassBeginInfo renderPassInfo{};
-            renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-            renderPassInfo.renderPass = renderPass;
-            renderPassInfo.framebuffer = swapChainFramebuffers[i];
-            renderPassInfo.renderArea.offset = {0, 0};
-            renderPassInfo.renderArea.extent = swapChainExtent;
-
-            VkClearValue clearColor = {{{0.1f, 0.1f, 0.1f, 1.0f}}};
-            renderPassInfo.clearValueCount = 1;
-            renderPassInfo.pClearValues = &clearColor;
+            VkWriteDescriptorSet descriptorWrite{};
+            descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrite.dstSet = set;
+            descriptorWrite.dstBinding = binding;
+            descriptorWrite.dstArrayElement = 0;
+            descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+            descriptorWrite.descriptorCount = 1;
+            descriptorWrite.pImageInfo = &imageInfos.back();
+            descriptorWrites.push_back(descriptorWrite);
+        };
 
-            vkCmdBeginRenderPass(commandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+            writeImage(descriptorSets[i], 3, accumulationImage);
+            writeImage(descriptorSets[i], 5, gbufferImage);
+            writeImage(descriptorSets[i], 6, albedoImage);
+        }
 
-            vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+        writeImage(denoiseDescriptorSet, 0, accumulationImage);
+        writeImage(denoiseDescriptorSet, 1, gbufferImage);
+        writeImage(denoiseDescriptorSet, 2, albedoImage);
+        writeImage(denoiseDescriptorSet, 3, prevGbufferImage);
+        writeImage(denoiseDescriptorSet, 4, historyColorImage);
+        writeImage(denoiseDescriptorSet, 5, momentsImage);
+        writeImage(denoiseDescriptorSet, 6, historyMomentsImage);
+        writeImage(denoiseDescriptorSet, 7, filterImages[0]);
+        writeImage(denoiseDescriptorSet, 8, filterImages[1]);
+
+        vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+    }
 
-            VkBuffer vertexBuffers[] = {vertexBuffer};
-            VkDeviceSize offsets[] = {0};
-            vkCmdBindVertexBuffers(commandBuffers[i], 0, 1, vertexBuffers, offsets);
-            vkCmdBindIndexBuffer(commandBuffers[i], indexBuffer, 0, VK_INDEX_TYPE_UINT32);
-            vkCmdBindDescriptorSets(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[currentFrame], 0, nullptr);
-            vkCmdDrawIndexed(commandBuffers[i], static_cast<uint32_t>(indices.size()), 1, 0, 0, 0);
+    // 命令缓冲每帧重新录制，这里只负责分配
+    void createCommandBuffers() {
+        commandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
 
-            vkCmdEndRenderPass(commandBuffers[i]);
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = commandPool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
 
-            if (vkEndCommandBuffer(commandBuffers[i]) != VK_SUCCESS) {
-                throw std::runtime_error("failed to record command buffer!");
-            }
+        if (vkAllocateCommandBuffers(device, &allocInfo, commandBuffers.data()) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate command buffers!");
         }
     }
 
@@ -1108,42 +1611,247 @@ private:
     }
 
     void mainLoop() {
-        auto startTime = std::chrono::high_resolution_clock::now();
+        auto lastTime = std::chrono::high_resolution_clock::now();
+        auto lastTitleUpdate = lastTime;
 
         while (!glfwWindowShouldClose(window)) {
             glfwPollEvents();
 
             auto currentTime = std::chrono::high_resolution_clock::now();
-            float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
+            float deltaTime = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - lastTime).count();
+            lastTime = currentTime;
+
+            // 相机移动后之前累积的结果失效，从头开始收敛
+            if (updateCamera(deltaTime)) {
+                accumulatedSamples = 0;
+            }
 
-            updateUniformBuffer(time);
-            drawFrame(time);
+            updateSceneAnimation(deltaTime);
+            updateDenoiseMode();
+            updateReferenceMode();
+
+            drawFrame();
+
+            if (std::chrono::duration<float, std::chrono::seconds::period>(currentTime - lastTitleUpdate).count() > 0.5f) {
+                updateWindowTitle();
+                lastTitleUpdate = currentTime;
+            }
         }
 
         vkDeviceWaitIdle(device);
     }
 
-    void updateUniformBuffer(float) {
-        static auto startTime = std::chrono::high_resolution_clock::now();
-        auto currentTime = std::chrono::high_resolution_clock::now();
-        float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
+    // 红色球体上下浮动（只重新拟合它所在叶子到根路径上的节点），光源绕场景中心旋转
+    void updateSceneAnimation(float deltaTime) {
+        bool spacePressed = glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS;
+        if (spacePressed && !spaceWasPressed) {
+            animateScene = !animateScene;
+        }
+        spaceWasPressed = spacePressed;
+
+        if (!animateScene) {
+            return;
+        }
+
+        animationTime += deltaTime;
+
+        const Sphere& sphere = scene.sphere(0);
+        glm::vec3 center = sphere.center;
+        center.y = 1.5f + 0.5f * std::sin(animationTime * 2.0f);
+        scene.setSphereGeometry(0, center, sphere.radius);
+
+        PointLight light = scene.lights()[0];
+        light.position = glm::vec3(3.0f * std::cos(animationTime), 2.0f, -5.0f + 3.0f * std::sin(animationTime));
+        scene.setLight(0, light);
+    }
+
+    // F 键切换降噪模式：开启后每帧只追踪1个采样，由时空降噪器代替逐帧累积
+    void updateDenoiseMode() {
+        bool keyPressed = glfwGetKey(window, GLFW_KEY_F) == GLFW_PRESS;
+        if (keyPressed && !denoiseKeyWasPressed) {
+            denoiseEnabled = !denoiseEnabled;
+            denoiseHistoryValid = false;
+            accumulatedSamples = 0;
+            std::cout << "denoiser " << (denoiseEnabled ? "on" : "off") << std::endl;
+        }
+        denoiseKeyWasPressed = keyPressed;
+    }
+
+    // R 键切换参考比对模式，切换后累积结果失效
+    void updateReferenceMode() {
+        bool keyPressed = glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS;
+        if (keyPressed && !referenceKeyWasPressed) {
+            referenceMode = !referenceMode;
+            denoiseHistoryValid = false;
+            accumulatedSamples = 0;
+            std::cout << "reference mode " << (referenceMode ? "on" : "off") << std::endl;
+        }
+        referenceKeyWasPressed = keyPressed;
+    }
+
+    // 处理键盘与鼠标输入，相机位置或朝向改变时返回 true
+    bool updateCamera(float deltaTime) {
+        const float moveSpeed = 3.0f;
+        const float turnSpeed = 60.0f;
+        const float mouseSensitivity = 0.1f;
+
+        Camera& camera = scene.camera();
+        glm::vec3 oldPos = camera.position;
+        float oldYaw = camera.yaw;
+        float oldPitch = camera.pitch;
+
+        if (glfwGetKey(window, GLFW_KEY_LEFT) == GLFW_PRESS) camera.yaw -= turnSpeed * deltaTime;
+        if (glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS) camera.yaw += turnSpeed * deltaTime;
+        if (glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS) camera.pitch += turnSpeed * deltaTime;
+        if (glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS) camera.pitch -= turnSpeed * deltaTime;
+
+        double cursorX, cursorY;
+        glfwGetCursorPos(window, &cursorX, &cursorY);
+        bool dragging = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS;
+        if (dragging && cursorDragging) {
+            camera.yaw += static_cast<float>(cursorX - lastCursorX) * mouseSensitivity;
+            camera.pitch -= static_cast<float>(cursorY - lastCursorY) * mouseSensitivity;
+        }
+        cursorDragging = dragging;
+        lastCursorX = cursorX;
+        lastCursorY = cursorY;
+
+        camera.pitch = std::clamp(camera.pitch, -89.0f, 89.0f);
+
+        glm::vec3 forward = camera.forward();
+        glm::vec3 right = glm::normalize(glm::cross(forward, glm::vec3(0.0f, 1.0f, 0.0f)));
+        float distance = moveSpeed * deltaTime;
+
+        if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) camera.position += forward * distance;
+        if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) camera.position -= forward * distance;
+        if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) camera.position += right * distance;
+        if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) camera.position -= right * distance;
+        if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS) camera.position.y += distance;
+        if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS) camera.position.y -= distance;
+
+        return camera.position != oldPos || camera.yaw != oldYaw || camera.pitch != oldPitch;
+    }
+
+    void updateWindowTitle() {
+        std::ostringstream title;
+        title << "Vulkan Ray Tracer - " << accumulatedSamples << " spp";
+        if (denoiseEnabled) {
+            title << " denoised";
+        }
+        if (referenceMode) {
+            title << " reference";
+        }
+        if (accumulatedSamples < MAX_ACCUMULATED_SAMPLES) {
+            title << " (" << samplesPerFrame << "/frame, " << static_cast<int>(std::round(renderScale * 100.0f)) << "% res";
+            if (timestampsSupported) {
+                title << ", " << std::fixed << std::setprecision(1) << lastTraceTimeMs << " ms";
+            }
+            title << ")";
+        }
+        glfwSetWindowTitle(window, title.str().c_str());
+    }
+
+    CameraBasis cameraBasis() {
+        const Camera& camera = scene.camera();
+        glm::vec3 forward = camera.forward();
+        glm::vec3 right = glm::normalize(glm::cross(forward, glm::vec3(0.0f, 1.0f, 0.0f)));
+        glm::vec3 up = glm::cross(right, forward);
+        float tanHalfFov = std::tan(glm::radians(camera.verticalFov) * 0.5f);
+
+        return {camera.position, right * tanHalfFov, up * tanHalfFov, forward};
+    }
+
+    void updateUniformBuffer(uint32_t samples) {
+        CameraBasis camera = cameraBasis();
+        const Plane& plane = scene.plane();
 
         UniformBufferObject ubo{};
-        ubo.model = glm::rotate(glm::mat4(1.0f), time * glm::radians(45.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-        ubo.view = glm::lookAt(glm::vec3(0.0f, 0.0f, -3.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-        ubo.proj = glm::perspective(glm::radians(45.0f), swapChainExtent.width / (float) swapChainExtent.height, 0.1f, 100.0f);
-        ubo.proj[1][1] *= -1;
-        ubo.cameraPos = glm::vec3(0.0f, 0.0f, -3.0f);
-        ubo.lightPos = glm::vec3(2.0f, 2.0f, -2.0f);
-        ubo.lightColor = glm::vec3(1.0f, 1.0f, 1.0f);
-        ubo.time = time;
+        ubo.cameraPos = camera.position;
+        ubo.frameIndex = frameIndex;
+        ubo.cameraRight = camera.right;
+        ubo.accumulatedSamples = accumulatedSamples;
+        ubo.cameraUp = camera.up;
+        ubo.samplesPerFrame = samples;
+        ubo.cameraForward = camera.forward;
+        ubo.maxBounces = referenceMode ? 0 : MAX_BOUNCES;
+        ubo.planePoint = plane.point;
+        ubo.planeMetallic = plane.metallic;
+        ubo.planeNormal = plane.normal;
+        ubo.planeRoughness = plane.roughness;
+        ubo.planeColor = plane.color;
+        ubo.lightCount = static_cast<uint32_t>(scene.lights().size());
+        VkExtent2D extent = renderExtent();
+        ubo.renderWidth = extent.width;
+        ubo.renderHeight = extent.height;
+        ubo.denoise = denoiseEnabled ? 1 : 0;
+        ubo.reference = referenceMode ? 1 : 0;
 
         memcpy(uniformBuffersMapped[currentFrame], &ubo, sizeof(ubo));
     }
 
-    void drawFrame(float time) {
+    // 追踪分辨率：交换链尺寸乘以当前缩放比例
+    VkExtent2D renderExtent() const {
+        VkExtent2D extent;
+        extent.width = std::max(1u, static_cast<uint32_t>(std::lround(swapChainExtent.width * renderScale)));
+        extent.height = std::max(1u, static_cast<uint32_t>(std::lround(swapChainExtent.height * renderScale)));
+        return extent;
+    }
+
+    // 读回该帧槽位上一次提交的路径追踪耗时（调用前已等待过对应的 fence）
+    void readTraceTimestamps() {
+        if (!timestampsSupported || frameSamples[currentFrame] == 0) {
+            return;
+        }
+
+        uint64_t timestamps[2];
+        VkResult result = vkGetQueryPoolResults(device, timestampQueryPool, static_cast<uint32_t>(currentFrame) * 2, 2,
+                                                sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+        if (result == VK_SUCCESS) {
+            lastTraceTimeMs = static_cast<double>(timestamps[1] - timestamps[0]) * timestampPeriod / 1000000.0;
+            updateRenderBudget(lastTraceTimeMs, frameSamples[currentFrame], frameRenderScales[currentFrame]);
+        }
+
+        frameSamples[currentFrame] = 0;
+    }
+
+    // 追踪耗时与像素数近似成正比，先换算出100%分辨率下的单次采样耗时，再据此选择：
+    // 预算内连1个采样都追踪不完时降低分辨率，有余量时先恢复分辨率，到100%后再增加每帧采样数
+    void updateRenderBudget(double traceTimeMs, uint32_t samples, float scale) {
+        double fullResMsPerSample = traceTimeMs / (samples * scale * scale);
+        smoothedFullResMsPerSample = smoothedFullResMsPerSample == 0.0 ? fullResMsPerSample
+                                                                       : smoothedFullResMsPerSample * 0.8 + fullResMsPerSample * 0.2;
+        double msPerSample = std::max(smoothedFullResMsPerSample, 0.001);
+
+        // 向下取整到步长，保证所选分辨率在预算之内
+        double idealScale = std::sqrt(traceBudgetMs / msPerSample);
+        float targetScale = static_cast<float>(std::floor(idealScale / RENDER_SCALE_STEP + 1e-3) * RENDER_SCALE_STEP);
+        targetScale = std::clamp(targetScale, MIN_RENDER_SCALE, 1.0f);
+        // 参考比对模式下始终以完整分辨率追踪，与CPU参考图的尺寸一致
+        if (referenceMode) {
+            targetScale = 1.0f;
+        }
+
+        framesSinceScaleChange++;
+        if (std::abs(targetScale - renderScale) > RENDER_SCALE_STEP * 0.5f && framesSinceScaleChange >= RENDER_SCALE_CHANGE_INTERVAL) {
+            renderScale = targetScale;
+            framesSinceScaleChange = 0;
+            accumulatedSamples = 0;
+            denoiseHistoryValid = false;
+
+            VkExtent2D extent = renderExtent();
+            std::cout << "render scale " << static_cast<int>(std::round(renderScale * 100.0f)) << "% ("
+                      << extent.width << "x" << extent.height << ")" << std::endl;
+        }
+
+        double budgetSamples = traceBudgetMs / (msPerSample * renderScale * renderScale);
+        samplesPerFrame = std::clamp(static_cast<uint32_t>(budgetSamples), 1u, MAX_SAMPLES_PER_FRAME);
+    }
+
+    void drawFrame() {
         vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
 
+        readTraceTimestamps();
+
         uint32_t imageIndex;
         VkResult result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
 
@@ -1156,19 +1864,45 @@ private:
 
         vkResetFences(device, 1, &inFlightFences[currentFrame]);
 
-        vkResetCommandBuffer(commandBuffers[imageIndex], 0);
-        recordCommandBuffer(commandBuffers[imageIndex], imageIndex, time);
+        // 场景改变后之前累积的结果同样失效
+        if (uploadSceneChanges()) {
+            accumulatedSamples = 0;
+        }
+
+        // 图像收敛后采样数为0，只呈现不追踪；降噪模式下不做逐帧累积，时间上的累积由降噪器完成
+        uint32_t samples;
+        if (denoiseEnabled) {
+            accumulatedSamples = 0;
+            samples = DENOISE_SAMPLES_PER_FRAME;
+        } else {
+            samples = std::min(samplesPerFrame, MAX_ACCUMULATED_SAMPLES - accumulatedSamples);
+        }
+        updateUniformBuffer(samples);
+
+        vkResetCommandBuffer(commandBuffers[currentFrame], 0);
+        recordCommandBuffer(commandBuffers[currentFrame], imageIndex, samples);
+
+        frameSamples[currentFrame] = samples;
+        frameRenderScales[currentFrame] = renderScale;
+        if (renderScaleLog.is_open()) {
+            VkExtent2D extent = renderExtent();
+            renderScaleLog << frameIndex << "," << lastTraceTimeMs << "," << renderScale << ","
+                           << extent.width << "," << extent.height << "," << samples << "\n";
+        }
+        accumulatedSamples += samples;
+        frameIndex++;
 
         VkSubmitInfo submitInfo{};
         submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
+        // 路径追踪不依赖交换链图像，只有呈现阶段需要等待图像可用
         VkSemaphore waitSemaphores[] = {imageAvailableSemaphores[currentFrame]};
         VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
         submitInfo.waitSemaphoreCount = 1;
         submitInfo.pWaitSemaphores = waitSemaphores;
         submitInfo.pWaitDstStageMask = waitStages;
         submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &commandBuffers[imageIndex];
+        submitInfo.pCommandBuffers = &commandBuffers[currentFrame];
 
         VkSemaphore signalSemaphores[] = {renderFinishedSemaphores[currentFrame]};
         submitInfo.signalSemaphoreCount = 1;
@@ -1190,7 +1924,8 @@ private:
 
         result = vkQueuePresentKHR(presentQueue, &presentInfo);
 
-        if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || glfwGetWindowAttrib(window, GLFW_RESIZABLE)) {
+        if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || framebufferResized) {
+            framebufferResized = false;
             recreateSwapChain();
         } else if (result != VK_SUCCESS) {
             throw std::runtime_error("failed to present swap chain image!");
@@ -1199,7 +1934,7 @@ private:
         currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
     }
 
-    void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex, float time) {
+    void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t samples) {
         VkCommandBufferBeginInfo beginInfo{};
         beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
         beginInfo.flags = 0;
@@ -1209,6 +1944,49 @@ private:
             throw std::runtime_error("failed to begin recording command buffer!");
         }
 
+        recordSceneCopies(commandBuffer);
+
+        if (samples > 0) {
+            uint32_t firstQuery = static_cast<uint32_t>(currentFrame) * 2;
+            if (timestampsSupported) {
+                vkCmdResetQueryPool(commandBuffer, timestampQueryPool, firstQuery, 2);
+            }
+
+            // 上一帧对累积图像的写入（路径追踪、降噪）和读取（呈现）都完成后才能继续累积
+            VkMemoryBarrier accumulateBarrier{};
+            accumulateBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            accumulateBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+            accumulateBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                                 VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &accumulateBarrier, 0, nullptr, 0, nullptr);
+
+            if (timestampsSupported) {
+                vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestampQueryPool, firstQuery);
+            }
+
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline);
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipelineLayout, 0, 1, &descriptorSets[currentFrame], 0, nullptr);
+            VkExtent2D extent = renderExtent();
+            vkCmdDispatch(commandBuffer, (extent.width + TILE_SIZE - 1) / TILE_SIZE, (extent.height + TILE_SIZE - 1) / TILE_SIZE, 1);
+
+            // 降噪的耗时同样与像素数成正比，计入同一段时间戳，由动态分辨率一起控制
+            if (denoiseEnabled) {
+                recordDenoise(commandBuffer);
+            }
+
+            if (timestampsSupported) {
+                vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, timestampQueryPool, firstQuery + 1);
+            }
+
+            // 路径追踪的结果对呈现用的片元着色器可见
+            VkMemoryBarrier presentBarrier{};
+            presentBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            presentBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+            presentBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                                 0, 1, &presentBarrier, 0, nullptr, 0, nullptr);
+        }
+
         VkRenderPassBeginInfo renderPassInfo{};
         renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
         renderPassInfo.renderPass = renderPass;
@@ -1216,20 +1994,20 @@ private:
         renderPassInfo.renderArea.offset = {0, 0};
         renderPassInfo.renderArea.extent = swapChainExtent;
 
-        VkClearValue clearColor = {{{0.1f, 0.1f, 0.1f, 1.0f}}};
-        renderPassInfo.clearValueCount = 1;
-        renderPassInfo.pClearValues = &clearColor;
-
         vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
 
         vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
-
-        VkBuffer vertexBuffers[] = {vertexBuffer};
-        VkDeviceSize offsets[] = {0};
-        vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
-        vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT32);
         vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[currentFrame], 0, nullptr);
-        vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(indices.size()), 1, 0, 0, 0);
+
+        VkExtent2D extent = renderExtent();
+        PresentConstants presentConstants{};
+        presentConstants.renderWidth = static_cast<int32_t>(extent.width);
+        presentConstants.renderHeight = static_cast<int32_t>(extent.height);
+        presentConstants.outputWidth = static_cast<int32_t>(swapChainExtent.width);
+        presentConstants.outputHeight = static_cast<int32_t>(swapChainExtent.height);
+        vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(presentConstants), &presentConstants);
+
+        vkCmdDraw(commandBuffer, 3, 1, 0, 0);
 
         vkCmdEndRenderPass(commandBuffer);
 
@@ -1238,6 +2016,110 @@ private:
         }
     }
 
+    // 前一个计算调度的写入对下一个计算调度可见
+    void recordComputeBarrier(VkCommandBuffer commandBuffer) {
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             0, 1, &barrier, 0, nullptr, 0, nullptr);
+    }
+
+    // 时间累积后做若干级 à-trous 滤波，最后一级乘回反照率写入累积图像；
+    // 随后把本帧的G-buffer与亮度矩复制为下一帧的历史
+    void recordDenoise(VkCommandBuffer commandBuffer) {
+        VkExtent2D extent = renderExtent();
+        CameraBasis camera = cameraBasis();
+
+        DenoiseConstants constants{};
+        constants.cameraPos = camera.position;
+        constants.pixelSpread = 2.0f * glm::length(camera.up) / static_cast<float>(extent.height);
+        constants.prevCameraPos = previousCamera.position;
+        constants.historyValid = denoiseHistoryValid ? 1 : 0;
+        constants.prevCameraRight = previousCamera.right;
+        constants.prevCameraUp = previousCamera.up;
+        constants.prevCameraForward = previousCamera.forward;
+        constants.renderWidth = static_cast<int32_t>(extent.width);
+        constants.renderHeight = static_cast<int32_t>(extent.height);
+
+        uint32_t groupCountX = (extent.width + TILE_SIZE - 1) / TILE_SIZE;
+        uint32_t groupCountY = (extent.height + TILE_SIZE - 1) / TILE_SIZE;
+
+        recordComputeBarrier(commandBuffer);
+
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, temporalPipeline);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, denoisePipelineLayout, 0, 1, &denoiseDescriptorSet, 0, nullptr);
+        vkCmdPushConstants(commandBuffer, denoisePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+        vkCmdDispatch(commandBuffer, groupCountX, groupCountY, 1);
+
+        // 时间累积的结果在 filterImages[0]，之后在两张图像之间来回滤波
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, atrousPipeline);
+        for (uint32_t i = 0; i < DENOISE_ATROUS_ITERATIONS; i++) {
+            recordComputeBarrier(commandBuffer);
+
+            constants.stepSize = 1 << i;
+            constants.source = static_cast<int32_t>(i % 2);
+            constants.target = i + 1 == DENOISE_ATROUS_ITERATIONS ? DENOISE_TARGET_OUTPUT : static_cast<int32_t>((i + 1) % 2);
+            vkCmdPushConstants(commandBuffer, denoisePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+            vkCmdDispatch(commandBuffer, groupCountX, groupCountY, 1);
+        }
+
+        VkMemoryBarrier copyBarrier{};
+        copyBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        copyBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        copyBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             0, 1, &copyBarrier, 0, nullptr, 0, nullptr);
+
+        VkImageCopy copyRegion{};
+        copyRegion.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+        copyRegion.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+        copyRegion.extent = {extent.width, extent.height, 1};
+        vkCmdCopyImage(commandBuffer, gbufferImage.image, VK_IMAGE_LAYOUT_GENERAL, prevGbufferImage.image, VK_IMAGE_LAYOUT_GENERAL, 1, &copyRegion);
+        vkCmdCopyImage(commandBuffer, momentsImage.image, VK_IMAGE_LAYOUT_GENERAL, historyMomentsImage.image, VK_IMAGE_LAYOUT_GENERAL, 1, &copyRegion);
+
+        // 下一帧的路径追踪会覆盖G-buffer，时间累积会读取复制出的历史
+        VkMemoryBarrier historyBarrier{};
+        historyBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        historyBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        historyBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             0, 1, &historyBarrier, 0, nullptr, 0, nullptr);
+
+        previousCamera = camera;
+        denoiseHistoryValid = true;
+    }
+
+    // 把本帧暂存的场景修改复制到设备本地缓冲
+    void recordSceneCopies(VkCommandBuffer commandBuffer) {
+        if (sphereCopies.empty() && bvhCopies.empty() && lightCopies.empty()) {
+            return;
+        }
+
+        // 上一帧的路径追踪可能还在读取这些缓冲，复制要等它结束
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             0, 0, nullptr, 0, nullptr, 0, nullptr);
+
+        VkBuffer stagingBuffer = sceneStagingBuffers[currentFrame];
+        if (!sphereCopies.empty()) {
+            vkCmdCopyBuffer(commandBuffer, stagingBuffer, sphereBuffer, static_cast<uint32_t>(sphereCopies.size()), sphereCopies.data());
+        }
+        if (!bvhCopies.empty()) {
+            vkCmdCopyBuffer(commandBuffer, stagingBuffer, bvhBuffer, static_cast<uint32_t>(bvhCopies.size()), bvhCopies.data());
+        }
+        if (!lightCopies.empty()) {
+            vkCmdCopyBuffer(commandBuffer, stagingBuffer, lightBuffer, static_cast<uint32_t>(lightCopies.size()), lightCopies.data());
+        }
+
+        VkMemoryBarrier copyBarrier{};
+        copyBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        copyBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        copyBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             0, 1, &copyBarrier, 0, nullptr, 0, nullptr);
+    }
+
     void recreateSwapChain() {
         int width = 0, height = 0;
         glfwGetFramebufferSize(window, &width, &height);
@@ -1256,10 +2138,13 @@ private:
         createRenderPass();
         createGraphicsPipeline();
         createFramebuffers();
-        createCommandBuffers();
+        createStorageImages();
+        updateImageDescriptors();
     }
 
     void cleanupSwapChain() {
+        cleanupStorageImages();
+
         for (auto framebuffer : swapChainFramebuffers) {
             vkDestroyFramebuffer(device, framebuffer, nullptr);
         }
@@ -1283,12 +2168,25 @@ private:
             vkFreeMemory(device, uniformBuffersMemory[i], nullptr);
         }
 
-        vkDestroyBuffer(device, indexBuffer, nullptr);
-        vkFreeMemory(device, indexBufferMemory, nullptr);
-        vkDestroyBuffer(device, vertexBuffer, nullptr);
-        vkFreeMemory(device, vertexBufferMemory, nullptr);
+        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+            vkDestroyBuffer(device, sceneStagingBuffers[i], nullptr);
+            vkFreeMemory(device, sceneStagingBuffersMemory[i], nullptr);
+        }
+
+        cleanupSceneStorageBuffers();
+
+        if (timestampsSupported) {
+            vkDestroyQueryPool(device, timestampQueryPool, nullptr);
+        }
+
+        vkDestroyPipeline(device, computePipeline, nullptr);
+        vkDestroyPipelineLayout(device, computePipelineLayout, nullptr);
+        vkDestroyPipeline(device, temporalPipeline, nullptr);
+        vkDestroyPipeline(device, atrousPipeline, nullptr);
+        vkDestroyPipelineLayout(device, denoisePipelineLayout, nullptr);
 
         vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+        vkDestroyDescriptorSetLayout(device, denoiseDescriptorSetLayout, nullptr);
         vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
 
         vkDestroyCommandPool(device, commandPool, nullptr);
@@ -1348,10 +2246,30 @@ private:
     }
 };
 
-int main() {
-    VulkanRayTracer app;
+int main(int argc, char** argv) {
+    // 可选参数：额外随机生成的球体数量（用于测试BVH在大场景下的性能）、每帧路径追踪的GPU时间预算（毫秒），
+    // 以及逐帧记录动态分辨率缩放比例的CSV文件
+    uint32_t extraSphereCount = 0;
+    float traceBudgetMs = DEFAULT_TRACE_BUDGET_MS;
+    try {
+        if (argc > 1) {
+            extraSphereCount = static_cast<uint32_t>(std::stoul(argv[1]));
+        }
+        if (argc > 2) {
+            traceBudgetMs = std::stof(argv[2]);
+        }
+    } catch (const std::exception&) {
+        std::cerr << "usage: ray_tracer [sphere count] [trace budget ms] [render scale log.csv]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::string renderScaleLogFile;
+    if (argc > 3) {
+        renderScaleLogFile = argv[3];
+    }
 
     try {
+        VulkanRayTracer app(extraSphereCount, traceBudgetMs, renderScaleLogFile);
         app.run();
     } catch (const std::exception& e) {
         std::cerr << e.what() << std::endl;
@@ -0,0 +1,197 @@
+// scene.cpp
+// 场景对象的增量修改与演示场景的生成
+
+#include "scene.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+
+std::vector<Sphere> createDemoSpheres(uint32_t extraSphereCount) {
+    std::vector<Sphere> spheres;
+    spheres.reserve(4 + extraSphereCount);
+
+    spheres.push_back({glm::vec3(0.0f, 1.0f, -5.0f), 1.0f, glm::vec3(0.8f, 0.2f, 0.2f), 0.0f, 0.3f, {}});
+    spheres.push_back({glm::vec3(2.0f, 1.0f, -5.0f), 1.0f, glm::vec3(0.2f, 0.8f, 0.2f), 0.5f, 0.5f, {}});
+    spheres.push_back({glm::vec3(-2.0f, 1.0f, -5.0f), 1.0f, glm::vec3(0.2f, 0.2f, 0.8f), 0.8f, 0.2f, {}});
+    spheres.push_back({glm::vec3(0.0f, 1.5f, -3.0f), 0.5f, glm::vec3(0.8f, 0.8f, 0.2f), 0.2f, 0.7f, {}});
+
+    // 固定种子，保证每次运行（以及CPU参考渲染）得到相同的场景
+    std::mt19937 gen(1337);
+    std::uniform_real_distribution<float> randX(-30.0f, 30.0f);
+    std::uniform_real_distribution<float> randZ(-60.0f, -6.0f);
+    std::uniform_real_distribution<float> randRadius(0.05f, 0.25f);
+    std::uniform_real_distribution<float> rand01(0.0f, 1.0f);
+
+    for (uint32_t i = 0; i < extraSphereCount; i++) {
+        Sphere sphere{};
+        sphere.radius = randRadius(gen);
+        sphere.center = glm::vec3(randX(gen), sphere.radius, randZ(gen));
+        sphere.color = glm::vec3(rand01(gen), rand01(gen), rand01(gen));
+        sphere.metallic = rand01(gen);
+        // 着色器中用 32 / roughness 作为高光指数，避免除以过小的值
+        sphere.roughness = 0.05f + 0.95f * rand01(gen);
+        spheres.push_back(sphere);
+    }
+
+    return spheres;
+}
+
+Plane createDemoPlane() {
+    return Plane{glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.5f), 0.0f, 0.8f};
+}
+
+PointLight createDemoLight() {
+    return PointLight{glm::vec3(2.0f, 2.0f, -2.0f), 0.1f, glm::vec3(1.0f), 0.0f};
+}
+
+glm::vec3 Camera::forward() const {
+    float yawRadians = glm::radians(yaw);
+    float pitchRadians = glm::radians(pitch);
+    return glm::normalize(glm::vec3(std::cos(yawRadians) * std::cos(pitchRadians), std::sin(pitchRadians),
+                                    std::sin(yawRadians) * std::cos(pitchRadians)));
+}
+
+void markDirty(std::vector<IndexRange>& ranges, uint32_t index) {
+    // 找到第一个结束位置不小于 index 的区间
+    auto it = std::lower_bound(ranges.begin(), ranges.end(), index,
+                               [](const IndexRange& range, uint32_t value) { return range.end < value; });
+
+    if (it != ranges.end() && it->begin <= index + 1) {
+        // index 落在区间内或与其相邻
+        it->begin = std::min(it->begin, index);
+        it->end = std::max(it->end, index + 1);
+
+        // 向后扩展后可能与下一个区间相接
+        auto next = it + 1;
+        if (next != ranges.end() && next->begin <= it->end) {
+            it->end = std::max(it->end, next->end);
+            ranges.erase(next);
+        }
+    } else {
+        ranges.insert(it, IndexRange{index, index + 1});
+    }
+}
+
+void Scene::setSpheres(std::vector<Sphere> spheres, JobSystem& jobs, BVHBuildStats* stats) {
+    std::vector<AABB> primBounds(spheres.size());
+    for (size_t i = 0; i < spheres.size(); i++) {
+        glm::vec3 extent(spheres[i].radius);
+        primBounds[i].min = spheres[i].center - extent;
+        primBounds[i].max = spheres[i].center + extent;
+    }
+
+    std::vector<uint32_t> primOrder;
+    nodeData = buildBVH(primBounds, jobs, primOrder, stats);
+
+    // 按叶子顺序重排球体，叶子可以直接引用连续的球体区间
+    sphereData.resize(spheres.size());
+    sphereSlots.resize(spheres.size());
+    for (size_t slot = 0; slot < primOrder.size(); slot++) {
+        sphereData[slot] = spheres[primOrder[slot]];
+        sphereSlots[primOrder[slot]] = static_cast<uint32_t>(slot);
+    }
+
+    // 深度优先顺序下孩子总在父节点之后，记录父节点用于局部重新拟合
+    nodeParents.assign(nodeData.size(), UINT32_MAX);
+    leafOfSlot.assign(sphereData.size(), 0);
+    for (uint32_t i = 0; i < nodeData.size(); i++) {
+        const BVHNode& node = nodeData[i];
+        if (node.count == 0) {
+            nodeParents[i + 1] = i;
+            nodeParents[node.leftOrFirst] = i;
+        } else {
+            for (uint32_t slot = node.leftOrFirst; slot < node.leftOrFirst + node.count; slot++) {
+                leafOfSlot[slot] = i;
+            }
+        }
+    }
+
+    bufferLayoutChanged = true;
+    sceneChanged = true;
+}
+
+void Scene::setSphereMaterial(uint32_t sphereId, const glm::vec3& color, float metallic, float roughness) {
+    uint32_t slot = sphereSlots.at(sphereId);
+    Sphere& sphere = sphereData[slot];
+    sphere.color = color;
+    sphere.metallic = metallic;
+    sphere.roughness = roughness;
+
+    markDirty(dirtySphereRanges, slot);
+    sceneChanged = true;
+}
+
+void Scene::setSphereGeometry(uint32_t sphereId, const glm::vec3& center, float radius) {
+    uint32_t slot = sphereSlots.at(sphereId);
+    Sphere& sphere = sphereData[slot];
+    sphere.center = center;
+    sphere.radius = radius;
+
+    markDirty(dirtySphereRanges, slot);
+    refitLeafToRoot(leafOfSlot[slot]);
+    sceneChanged = true;
+}
+
+void Scene::refitLeafToRoot(uint32_t nodeIndex) {
+    while (nodeIndex != UINT32_MAX) {
+        BVHNode& node = nodeData[nodeIndex];
+
+        AABB bounds;
+        if (node.count > 0) {
+            for (uint32_t i = node.leftOrFirst; i < node.leftOrFirst + node.count; i++) {
+                glm::vec3 extent(sphereData[i].radius);
+                bounds.grow(sphereData[i].center - extent);
+                bounds.grow(sphereData[i].center + extent);
+            }
+        } else {
+            const BVHNode& left = nodeData[nodeIndex + 1];
+            const BVHNode& right = nodeData[node.leftOrFirst];
+            bounds.grow(left.boundsMin);
+            bounds.grow(left.boundsMax);
+            bounds.grow(right.boundsMin);
+            bounds.grow(right.boundsMax);
+        }
+
+        if (bounds.min == node.boundsMin && bounds.max == node.boundsMax) {
+            break;
+        }
+
+        node.boundsMin = bounds.min;
+        node.boundsMax = bounds.max;
+        markDirty(dirtyNodeRanges, nodeIndex);
+        nodeIndex = nodeParents[nodeIndex];
+    }
+}
+
+void Scene::setPlane(const Plane& plane) {
+    groundPlane = plane;
+    sceneChanged = true;
+}
+
+uint32_t Scene::addLight(const PointLight& light) {
+    if (lightData.size() >= MAX_LIGHTS) {
+        throw std::runtime_error("too many lights in scene!");
+    }
+
+    lightData.push_back(light);
+    uint32_t index = static_cast<uint32_t>(lightData.size() - 1);
+    markDirty(dirtyLightRanges, index);
+    sceneChanged = true;
+    return index;
+}
+
+void Scene::setLight(uint32_t index, const PointLight& light) {
+    lightData.at(index) = light;
+    markDirty(dirtyLightRanges, index);
+    sceneChanged = true;
+}
+
+void Scene::clearChanges() {
+    dirtySphereRanges.clear();
+    dirtyNodeRanges.clear();
+    dirtyLightRanges.clear();
+    bufferLayoutChanged = false;
+    sceneChanged = false;
+}
@@ -0,0 +1,137 @@
+// scene.h
+// 光线追踪场景：图元定义（内存布局与着色器中的 std430 结构保持一致）与主机端的场景对象
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "bvh.h"
+
+struct Sphere {
+    glm::vec3 center;
+    float radius;
+    glm::vec3 color;
+    float metallic;
+    float roughness;
+    float padding[3];
+};
+
+static_assert(sizeof(Sphere) == 48, "Sphere must match the std430 layout used in the shaders");
+
+struct Plane {
+    glm::vec3 point;
+    glm::vec3 normal;
+    glm::vec3 color;
+    float metallic;
+    float roughness;
+};
+
+// 点光源，与着色器中 LightBuffer 的 std430 布局一致
+// radius > 0 时在以 position 为中心的球面上采样，得到软阴影
+struct PointLight {
+    glm::vec3 position;
+    float radius;
+    glm::vec3 color;
+    float padding;
+};
+
+static_assert(sizeof(PointLight) == 32, "PointLight must match the std430 layout used in the shaders");
+
+// 第一人称相机，角度均以度为单位
+struct Camera {
+    glm::vec3 position = glm::vec3(0.0f, 0.0f, -3.0f);
+    float yaw = -90.0f;
+    float pitch = 0.0f;
+    float verticalFov = 90.0f;
+
+    glm::vec3 forward() const;
+};
+
+// 元素下标区间 [begin, end)
+struct IndexRange {
+    uint32_t begin;
+    uint32_t end;
+};
+
+// 主机端的场景描述：球体（含材质）、BVH、地面、光源与相机
+// 所有修改都通过成员函数进行，并按元素区间记录自上次 clearChanges() 以来改动过的数据，
+// 渲染器据此只重新上传变化的部分
+class Scene {
+public:
+    // 光源缓冲按固定容量分配，增删光源不需要重建缓冲
+    static const uint32_t MAX_LIGHTS = 8;
+
+    // 替换全部球体并重建BVH；之后用传入数组中的下标作为球体ID
+    void setSpheres(std::vector<Sphere> spheres, JobSystem& jobs, BVHBuildStats* stats = nullptr);
+
+    // 只修改材质，BVH不受影响
+    void setSphereMaterial(uint32_t sphereId, const glm::vec3& color, float metallic, float roughness);
+
+    // 移动或缩放球体：沿叶子到根的路径重新拟合包围盒，包围盒不再变化时提前停止
+    // 大幅移动会降低BVH质量，此时应调用 setSpheres 重建
+    void setSphereGeometry(uint32_t sphereId, const glm::vec3& center, float radius);
+
+    const Sphere& sphere(uint32_t sphereId) const { return sphereData[sphereSlots[sphereId]]; }
+
+    void setPlane(const Plane& plane);
+
+    // 返回新光源的下标；超过 MAX_LIGHTS 时抛出 std::runtime_error
+    uint32_t addLight(const PointLight& light);
+    void setLight(uint32_t index, const PointLight& light);
+
+    Camera& camera() { return sceneCamera; }
+    const Camera& camera() const { return sceneCamera; }
+
+    // 按BVH叶子顺序排列，可以直接上传
+    const std::vector<Sphere>& spheres() const { return sphereData; }
+    const std::vector<BVHNode>& nodes() const { return nodeData; }
+    const std::vector<PointLight>& lights() const { return lightData; }
+    const Plane& plane() const { return groundPlane; }
+
+    // 以下区间均按元素下标给出，互不重叠且按升序排列
+    const std::vector<IndexRange>& dirtySpheres() const { return dirtySphereRanges; }
+    const std::vector<IndexRange>& dirtyNodes() const { return dirtyNodeRanges; }
+    const std::vector<IndexRange>& dirtyLights() const { return dirtyLightRanges; }
+
+    // 球体或节点数量改变，GPU缓冲需要整体重建
+    bool layoutChanged() const { return bufferLayoutChanged; }
+
+    // 自上次 clearChanges() 以来是否有任何影响渲染结果的修改（相机除外）
+    bool hasChanges() const { return sceneChanged; }
+    void clearChanges();
+
+private:
+    std::vector<Sphere> sphereData;
+    std::vector<BVHNode> nodeData;
+    std::vector<PointLight> lightData;
+    Plane groundPlane{};
+    Camera sceneCamera;
+
+    // sphereSlots[id] 为球体在 sphereData 中的位置，leafOfSlot[slot] 为包含它的叶子节点
+    std::vector<uint32_t> sphereSlots;
+    std::vector<uint32_t> leafOfSlot;
+    std::vector<uint32_t> nodeParents;
+
+    std::vector<IndexRange> dirtySphereRanges;
+    std::vector<IndexRange> dirtyNodeRanges;
+    std::vector<IndexRange> dirtyLightRanges;
+    bool bufferLayoutChanged = false;
+    bool sceneChanged = false;
+
+    void refitLeafToRoot(uint32_t nodeIndex);
+};
+
+// 把下标 index 加入区间列表，与相邻或重叠的区间合并
+void markDirty(std::vector<IndexRange>& ranges, uint32_t index);
+
+// 创建演示场景：原有的4个球体，再加上 extraSphereCount 个随机散布在地面上的小球
+std::vector<Sphere> createDemoSpheres(uint32_t extraSphereCount);
+
+// 地面平面（无限大，不参与BVH）
+Plane createDemoPlane();
+
+// 演示场景的光源
+PointLight createDemoLight();
@@ -0,0 +1,27 @@
+#version 450
+
+// 阴影通道：变换到光源的裁剪空间，深度贴图与矩阴影贴图共用
+// 与 src/main.cpp 中的 UniformBufferObject 一致（std140）
+layout(binding = 0) uniform UniformBufferObject {
+    mat4 view;
+    mat4 proj;
+    mat4 lightSpaceMatrix;
+    vec3 cameraPos;
+    float time;
+    vec3 lightPos;
+    int shadowFilter;
+    float lightBleedReduction;
+    float evsmPositiveExponent;
+    float evsmNegativeExponent;
+} ubo;
+
+// 每个物体的模型矩阵
+layout(push_constant) uniform ObjectConstants {
+    mat4 model;
+} object;
+
+layout(location = 0) in vec3 inPosition;
+
+void main() {
+    gl_Position = ubo.lightSpaceMatrix * object.model * vec4(inPosition, 1.0);
+}
@@ -0,0 +1,182 @@
+#version 450
+
+// 阴影过滤方式，与 src/main.cpp 中的 SHADOW_FILTER_* 一致
+#define SHADOW_FILTER_PCF 0
+#define SHADOW_FILTER_VSM 1
+#define SHADOW_FILTER_EVSM 2
+
+// 矩阴影的方差下限对应的深度标准差（[0,1] 深度），避免平坦表面方差接近 0 时的数值问题与自阴影
+#define MIN_DEPTH_DEVIATION 0.0005
+
+// 与 src/main.cpp 中的 MAX_POINT_LIGHTS 一致
+#define MAX_POINT_LIGHTS 4
+
+// 与 src/main.cpp 中的 UniformBufferObject 一致（std140）
+layout(binding = 0) uniform UniformBufferObject {
+    mat4 view;
+    mat4 proj;
+    mat4 lightSpaceMatrix;
+    vec3 cameraPos;
+    float time;
+    vec3 lightPos;
+    int shadowFilter;
+    float lightBleedReduction;
+    float evsmPositiveExponent;
+    float evsmNegativeExponent;
+    // 点光源：xyz 为位置，w 为阴影的远平面（也是光照的作用范围）
+    int pointLightCount;
+    vec4 pointLights[MAX_POINT_LIGHTS];
+    vec4 pointLightColors[MAX_POINT_LIGHTS];
+    // 每个点光源 6 个面的投影 * 视图矩阵，顺序为 +X -X +Y -Y +Z -Z
+    mat4 pointLightMatrices[MAX_POINT_LIGHTS * 6];
+} ubo;
+
+// 比较采样器：每次采样由硬件比较相邻 4 个 texel 并双线性插值，返回光照比例
+layout(binding = 1) uniform sampler2DShadow shadowMap;
+// 模糊后带 mip 的矩阴影贴图
+layout(binding = 2) uniform sampler2D vsmMap;
+layout(binding = 3) uniform sampler2D evsmMap;
+// 点光源阴影图集：第 i 个光源的立方体面占第 6i 到 6i+5 层
+layout(binding = 4) uniform sampler2DArrayShadow pointShadowAtlas;
+
+layout(location = 0) in vec3 fragPosition;
+layout(location = 1) in vec3 fragNormal;
+
+layout(location = 0) out vec4 outColor;
+
+// 3x3 个硬件比较采样
+float pcfShadow(vec3 projCoords) {
+    vec2 texelSize = 1.0 / vec2(textureSize(shadowMap, 0));
+    float lit = 0.0;
+    for (int x = -1; x <= 1; ++x) {
+        for (int y = -1; y <= 1; ++y) {
+            lit += texture(shadowMap, vec3(projCoords.xy + vec2(x, y) * texelSize, projCoords.z));
+        }
+    }
+    return 1.0 - lit / 9.0;
+}
+
+// 切比雪夫不等式给出光照比例的上界；减去 lightBleedReduction 再重新映射到 [0,1]，
+// 把两个遮挡物重叠处被错误估计为半亮的区域（漏光）压暗，代价是半影变窄
+float chebyshevUpperBound(vec2 moments, float depth, float minVariance) {
+    if (depth <= moments.x) {
+        return 1.0;
+    }
+    float variance = max(moments.y - moments.x * moments.x, minVariance);
+    float d = depth - moments.x;
+    float pMax = variance / (variance + d * d);
+    return clamp((pMax - ubo.lightBleedReduction) / (1.0 - ubo.lightBleedReduction), 0.0, 1.0);
+}
+
+// VSM / EVSM：一次三线性（各向异性）采样。采样位于非一致的控制流中，使用显式梯度
+float momentShadow(vec3 projCoords, vec2 gradX, vec2 gradY) {
+    float depth = projCoords.z;
+
+    if (ubo.shadowFilter == SHADOW_FILTER_EVSM) {
+        vec4 moments = textureGrad(evsmMap, projCoords.xy, gradX, gradY);
+        float warped = depth * 2.0 - 1.0;
+        float positive = exp(ubo.evsmPositiveExponent * warped);
+        float negative = -exp(-ubo.evsmNegativeExponent * warped);
+        // 方差下限按指数变换在该深度处的斜率缩放
+        float positiveDeviation = 2.0 * MIN_DEPTH_DEVIATION * ubo.evsmPositiveExponent * positive;
+        float negativeDeviation = 2.0 * MIN_DEPTH_DEVIATION * ubo.evsmNegativeExponent * -negative;
+        float positiveLit = chebyshevUpperBound(moments.xy, positive, positiveDeviation * positiveDeviation);
+        float negativeLit = chebyshevUpperBound(moments.zw, negative, negativeDeviation * negativeDeviation);
+        return 1.0 - min(positiveLit, negativeLit);
+    }
+
+    vec2 moments = textureGrad(vsmMap, projCoords.xy, gradX, gradY).xy;
+    return 1.0 - chebyshevUpperBound(moments, depth, MIN_DEPTH_DEVIATION * MIN_DEPTH_DEVIATION);
+}
+
+// dPdx、dPdy 是世界坐标的屏幕导数，在一致的控制流中求出
+float shadowCalculation(vec3 dPdx, vec3 dPdy) {
+    vec4 lightSpacePosition = ubo.lightSpaceMatrix * vec4(fragPosition, 1.0);
+    vec3 projCoords = lightSpacePosition.xyz / lightSpacePosition.w;
+    projCoords.xy = projCoords.xy * 0.5 + 0.5;
+
+    // 光源视锥体之外不在阴影中
+    if (projCoords.z > 1.0 || any(lessThan(projCoords.xy, vec2(0.0))) || any(greaterThan(projCoords.xy, vec2(1.0)))) {
+        return 0.0;
+    }
+
+    if (ubo.shadowFilter == SHADOW_FILTER_PCF) {
+        return pcfShadow(projCoords);
+    }
+
+    // 正交投影是线性的，导数直接用矩阵的 3x3 部分变换；[-1,1] 到 [0,1] 再乘 0.5
+    mat3 lightSpace = mat3(ubo.lightSpaceMatrix);
+    return momentShadow(projCoords, (lightSpace * dPdx).xy * 0.5, (lightSpace * dPdy).xy * 0.5);
+}
+
+// 按主轴选择立方体的面，用该面的矩阵投影后在图集的对应层做 3x3 比较采样
+float pointShadow(int light, vec3 normal) {
+    vec3 toFragment = fragPosition - ubo.pointLights[light].xyz;
+    vec3 absolute = abs(toFragment);
+    int face;
+    if (absolute.x >= absolute.y && absolute.x >= absolute.z) {
+        face = toFragment.x > 0.0 ? 0 : 1;
+    } else if (absolute.y >= absolute.z) {
+        face = toFragment.y > 0.0 ? 2 : 3;
+    } else {
+        face = toFragment.z > 0.0 ? 4 : 5;
+    }
+
+    // 沿法线偏移，偏移量随距离增大（透视投影下 texel 覆盖的世界尺寸与距离成正比）
+    float lightDistance = length(toFragment);
+    vec3 position = fragPosition + normal * (0.02 + 0.01 * lightDistance);
+    vec4 clip = ubo.pointLightMatrices[light * 6 + face] * vec4(position, 1.0);
+    vec3 projCoords = clip.xyz / clip.w;
+    projCoords.xy = projCoords.xy * 0.5 + 0.5;
+    if (projCoords.z > 1.0) {
+        return 0.0;
+    }
+
+    float layer = float(light * 6 + face);
+    vec2 texelSize = 1.0 / vec2(textureSize(pointShadowAtlas, 0).xy);
+    float lit = 0.0;
+    for (int x = -1; x <= 1; ++x) {
+        for (int y = -1; y <= 1; ++y) {
+            lit += texture(pointShadowAtlas, vec4(projCoords.xy + vec2(x, y) * texelSize, layer, projCoords.z));
+        }
+    }
+    return 1.0 - lit / 9.0;
+}
+
+void main() {
+    vec3 objectColor = vec3(0.8, 0.3, 0.3);
+    vec3 lightColor = vec3(1.0);
+
+    vec3 normal = normalize(fragNormal);
+    vec3 lightDir = normalize(ubo.lightPos - fragPosition);
+    vec3 viewDir = normalize(ubo.cameraPos - fragPosition);
+
+    vec3 ambient = 0.1 * lightColor;
+    vec3 diffuse = max(dot(normal, lightDir), 0.0) * lightColor;
+    vec3 halfwayDir = normalize(lightDir + viewDir);
+    vec3 specular = 0.5 * pow(max(dot(normal, halfwayDir), 0.0), 32.0) * lightColor;
+
+    float shadow = shadowCalculation(dFdx(fragPosition), dFdy(fragPosition));
+
+    vec3 color = ambient + (1.0 - shadow) * (diffuse + specular);
+
+    // 点光源：Blinn-Phong，按距离平方衰减并在作用范围处平滑降到 0
+    for (int i = 0; i < ubo.pointLightCount; ++i) {
+        vec3 toLight = ubo.pointLights[i].xyz - fragPosition;
+        float lightDistance = length(toLight);
+        float range = ubo.pointLights[i].w;
+        if (lightDistance >= range) {
+            continue;
+        }
+        vec3 pointDir = toLight / lightDistance;
+        float falloff = clamp(1.0 - pow(lightDistance / range, 4.0), 0.0, 1.0);
+        float attenuation = falloff * falloff / (1.0 + lightDistance * lightDistance);
+        vec3 pointColor = ubo.pointLightColors[i].rgb;
+        vec3 pointHalfway = normalize(pointDir + viewDir);
+        vec3 pointDiffuse = max(dot(normal, pointDir), 0.0) * pointColor;
+        vec3 pointSpecular = 0.5 * pow(max(dot(normal, pointHalfway), 0.0), 32.0) * pointColor;
+        color += (1.0 - pointShadow(i, normal)) * attenuation * (pointDiffuse + pointSpecular);
+    }
+
+    outColor = vec4(color * objectColor, 1.0);
+}
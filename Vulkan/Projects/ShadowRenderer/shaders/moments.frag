@@ -0,0 +1,38 @@
+#version 450
+
+// 矩阴影贴图的阴影通道：输出深度的矩（VSM 为 RG32F，EVSM 为 RGBA16F）
+#define SHADOW_FILTER_EVSM 2
+
+// 与 src/main.cpp 中的 UniformBufferObject 一致（std140）
+layout(binding = 0) uniform UniformBufferObject {
+    mat4 view;
+    mat4 proj;
+    mat4 lightSpaceMatrix;
+    vec3 cameraPos;
+    float time;
+    vec3 lightPos;
+    int shadowFilter;
+    float lightBleedReduction;
+    float evsmPositiveExponent;
+    float evsmNegativeExponent;
+} ubo;
+
+layout(location = 0) out vec4 outMoments;
+
+void main() {
+    // 正交投影下 gl_FragCoord.z 与到光源的距离成线性关系
+    float depth = gl_FragCoord.z;
+
+    if (ubo.shadowFilter == SHADOW_FILTER_EVSM) {
+        // 深度变换到 [-1, 1] 后分别做正、负指数变换
+        float warped = depth * 2.0 - 1.0;
+        float positive = exp(ubo.evsmPositiveExponent * warped);
+        float negative = -exp(-ubo.evsmNegativeExponent * warped);
+        outMoments = vec4(positive, positive * positive, negative, negative * negative);
+    } else {
+        // 把像素内深度沿斜面的变化计入二阶矩，减少倾斜表面上的自阴影
+        float dx = dFdx(depth);
+        float dy = dFdy(depth);
+        outMoments = vec4(depth, depth * depth + 0.25 * (dx * dx + dy * dy), 0.0, 0.0);
+    }
+}
@@ -0,0 +1,36 @@
+#version 450
+#extension GL_EXT_multiview : require
+
+// 点光源阴影通道：一次绘制经 multiview 写入立方体的 6 个面，gl_ViewIndex 选择面的矩阵，
+// 渲染目标是阴影图集中该光源的 6 层
+#define MAX_POINT_LIGHTS 4
+
+// 与 src/main.cpp 中的 UniformBufferObject 一致（std140）
+layout(binding = 0) uniform UniformBufferObject {
+    mat4 view;
+    mat4 proj;
+    mat4 lightSpaceMatrix;
+    vec3 cameraPos;
+    float time;
+    vec3 lightPos;
+    int shadowFilter;
+    float lightBleedReduction;
+    float evsmPositiveExponent;
+    float evsmNegativeExponent;
+    int pointLightCount;
+    vec4 pointLights[MAX_POINT_LIGHTS];
+    vec4 pointLightColors[MAX_POINT_LIGHTS];
+    mat4 pointLightMatrices[MAX_POINT_LIGHTS * 6];
+} ubo;
+
+// 每个物体的模型矩阵，以及正在渲染阴影的点光源
+layout(push_constant) uniform ObjectConstants {
+    mat4 model;
+    int pointLight;
+} object;
+
+layout(location = 0) in vec3 inPosition;
+
+void main() {
+    gl_Position = ubo.pointLightMatrices[object.pointLight * 6 + gl_ViewIndex] * object.model * vec4(inPosition, 1.0);
+}
@@ -0,0 +1,35 @@
+#version 450
+
+// 与 src/main.cpp 中的 UniformBufferObject 一致（std140）
+layout(binding = 0) uniform UniformBufferObject {
+    mat4 view;
+    mat4 proj;
+    mat4 lightSpaceMatrix;
+    vec3 cameraPos;
+    float time;
+    vec3 lightPos;
+    int shadowFilter;
+    float lightBleedReduction;
+    float evsmPositiveExponent;
+    float evsmNegativeExponent;
+} ubo;
+
+// 每个物体的模型矩阵
+layout(push_constant) uniform ObjectConstants {
+    mat4 model;
+} object;
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inNormal;
+layout(location = 2) in vec2 inTexCoord;
+
+layout(location = 0) out vec3 fragPosition;
+layout(location = 1) out vec3 fragNormal;
+
+void main() {
+    vec4 worldPosition = object.model * vec4(inPosition, 1.0);
+    fragPosition = worldPosition.xyz;
+    // 模型矩阵只有旋转与平移
+    fragNormal = mat3(object.model) * inNormal;
+    gl_Position = ubo.proj * ubo.view * worldPosition;
+}
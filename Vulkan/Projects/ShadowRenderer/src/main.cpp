@@ -9,22 +9,97 @@
 #include <limits>
 #include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <cstdlib>
 #include <cstring>
 #include <fstream>
 #include <optional>
 #include <set>
 
+// Vulkan 的裁剪空间深度范围是 [0, 1]
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/constants.hpp>
+
+// 阴影过滤方式，与 lighting.frag 中的 SHADOW_FILTER_* 一致
+const int32_t SHADOW_FILTER_PCF = 0;   // 深度贴图 + 3x3 硬件比较采样
+const int32_t SHADOW_FILTER_VSM = 1;   // 方差阴影贴图，RG32F
+const int32_t SHADOW_FILTER_EVSM = 2;  // 指数方差阴影贴图，RGBA16F
+const int32_t SHADOW_FILTER_COUNT = 3;
+const char* const SHADOW_FILTER_NAMES[SHADOW_FILTER_COUNT] = {"PCF", "VSM", "EVSM"};
+
+// 矩阴影贴图的模糊半径上限（texel），与 moment_blur.comp 中的 MAX_BLUR_RADIUS 一致
+const int32_t MAX_BLUR_RADIUS = 8;
+
+// exp(2c) 不能超过半精度浮点的最大值 65504
+const float EVSM_MAX_EXPONENT = 5.54f;
+
+// 点光源数量上限，与 lighting.frag / point_depth.vert 中的 MAX_POINT_LIGHTS 一致
+const int32_t MAX_POINT_LIGHTS = 4;
+// 点光源阴影图集中每个立方体面的边长
+const uint32_t POINT_SHADOW_SIZE = 512;
+// 点光源的作用范围，也是阴影投影的远平面
+const float POINT_LIGHT_RANGE = 8.0f;
+const float POINT_SHADOW_NEAR = 0.05f;
+
+// 命令行可指定的阴影参数
+struct ShadowSettings {
+    int32_t filter = SHADOW_FILTER_PCF;
+    // 切比雪夫上界中减去的比例，越大漏光越少、半影越窄
+    float lightBleedReduction = 0.2f;
+    float evsmExponent = EVSM_MAX_EXPONENT;
+    int32_t blurRadius = 2;
+    // 静态投射物的阴影只在光源或静态几何体变化时重新渲染
+    bool shadowCache = true;
+    // 光源绕场景旋转；停下来时静态阴影可以一直复用
+    bool animateLight = true;
+    // 带立方体阴影的点光源数量（0 到 MAX_POINT_LIGHTS）
+    int32_t pointLightCount = 2;
+};
 
+// 与各着色器中的 UniformBufferObject 一致（std140：vec3 后面紧跟一个4字节标量）
 struct UniformBufferObject {
-    alignas(16) glm::mat4 model;
     alignas(16) glm::mat4 view;
     alignas(16) glm::mat4 proj;
+    alignas(16) glm::mat4 lightSpaceMatrix;
     alignas(16) glm::vec3 cameraPos;
-    alignas(16) float time;
+    float time;
     alignas(16) glm::vec3 lightPos;
-    alignas(16) glm::mat4 lightSpaceMatrix;
+    int32_t shadowFilter;
+    float lightBleedReduction;
+    float evsmPositiveExponent;
+    float evsmNegativeExponent;
+    int32_t pointLightCount;
+    // xyz 为位置，w 为作用范围
+    alignas(16) glm::vec4 pointLights[MAX_POINT_LIGHTS];
+    glm::vec4 pointLightColors[MAX_POINT_LIGHTS];
+    // 每个点光源 6 个面的投影 * 视图矩阵，顺序为 +X -X +Y -Y +Z -Z
+    glm::mat4 pointLightMatrices[MAX_POINT_LIGHTS * 6];
+};
+
+// 每个物体的 push constant；pointLight 只在点光源阴影通道中使用
+struct ObjectConstants {
+    glm::mat4 model;
+    int32_t pointLight;
+};
+
+// 阴影渲染通道的用途
+enum class ShadowPassType {
+    // 清除后绘制静态投射物，结束时转到 TRANSFER_SRC_OPTIMAL 等待复制
+    Cache,
+    // 从 TRANSFER_DST_OPTIMAL 载入复制来的缓存，再绘制动态投射物
+    Composite,
+    // 清除后经 multiview 一次绘制立方体的 6 个面，结束时可采样
+    PointLight
+};
+
+// 与 moment_blur.comp 中的 push constant 布局一致（std430）
+struct BlurConstants {
+    glm::ivec2 direction;
+    int32_t radius;
+    int32_t padding;
+    float weights[MAX_BLUR_RADIUS + 1];
 };
 
 struct QueueFamilyIndices {
@@ -78,13 +153,53 @@ struct Vertex {
     }
 };
 
+// 一种格式的矩阴影贴图：带完整 mip 链的矩图像、可分离模糊用的中间图像，以及渲染与模糊所需的对象
+struct MomentShadowMap {
+    VkFormat format;
+    VkImage image;
+    VkDeviceMemory imageMemory;
+    // 全部 mip，光照时三线性采样
+    VkImageView view;
+    // 只有第 0 层：渲染目标，也是模糊的输入与输出
+    VkImageView levelView;
+    VkImage blurImage;
+    VkDeviceMemory blurImageMemory;
+    VkImageView blurView;
+    // 每帧的合成通道：载入缓存的静态矩与深度，再绘制动态投射物
+    VkRenderPass renderPass;
+    VkFramebuffer framebuffer;
+    VkPipeline pipeline;
+    VkPipeline blurPipeline;
+    // 静态投射物的矩缓存（只有第 0 层），与 staticDepthMap 一起构成缓存通道的附件
+    VkImage staticImage;
+    VkDeviceMemory staticImageMemory;
+    VkImageView staticView;
+    VkRenderPass staticRenderPass;
+    VkFramebuffer staticFramebuffer;
+    // 0：水平（矩 → 中间图像），1：垂直（中间图像 → 矩）
+    std::array<VkDescriptorSet, 2> blurDescriptorSets;
+};
+
 const uint32_t WIDTH = 800;
 const uint32_t HEIGHT = 600;
 const uint32_t SHADOW_WIDTH = 1024;
 const uint32_t SHADOW_HEIGHT = 1024;
+// 矩阴影贴图的 mip 层数（1024 一直到 1）
+const uint32_t SHADOW_MIP_LEVELS = 11;
+
+// 索引缓冲区中地面与立方体的范围
+const uint32_t FLOOR_INDEX_COUNT = 6;
+const uint32_t CUBE_INDEX_COUNT = 36;
+
+// 模型空间中以原点为中心的包围球半径，点光源阴影按它剔除投射物
+const float FLOOR_BOUNDING_RADIUS = 7.08f;
+const float CUBE_BOUNDING_RADIUS = 1.74f;
 
 const uint32_t MAX_FRAMES_IN_FLIGHT = 2;
 
+// 每个帧槽位的 GPU 时间戳：阴影通道开始、阴影贴图渲染完成、模糊与 mip 完成、点光源阴影完成、光照通道完成
+const uint32_t TIMESTAMPS_PER_FRAME = 5;
+
 const std::vector<const char*> validationLayers = {
     "VK_LAYER_KHRONOS_validation"
 };
@@ -99,6 +214,26 @@ const std::vector<const char*> deviceExtensions = {
     VK_KHR_SWAPCHAIN_EXTENSION_NAME
 };
 
+// 包围球是否与 viewProjection 的视锥体相交（深度范围 [0, 1]）。平面取自矩阵的行组合，法线指向视锥体内侧
+bool sphereInFrustum(const glm::mat4& viewProjection, const glm::vec3& center, float radius) {
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; i++) {
+        rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+    }
+    const glm::vec4 planes[6] = {
+        rows[3] + rows[0], rows[3] - rows[0],
+        rows[3] + rows[1], rows[3] - rows[1],
+        rows[2], rows[3] - rows[2]
+    };
+    for (const glm::vec4& plane : planes) {
+        float length = glm::length(glm::vec3(plane));
+        if (glm::dot(glm::vec3(plane), center) + plane.w < -radius * length) {
+            return false;
+        }
+    }
+    return true;
+}
+
 VkResult CreateDebugUtilsMessengerEXT(VkInstance instance, const VkDebugUtilsMessengerCreateInfoEXT* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkDebugUtilsMessengerEXT* pDebugMessenger) {
     auto func = (PFN_vkCreateDebugUtilsMessengerEXT) vkGetInstanceProcAddr(instance, "vkCreateDebugUtilsMessengerEXT");
     if (func != nullptr) {
@@ -117,6 +252,8 @@ void DestroyDebugUtilsMessengerEXT(VkInstance instance, VkDebugUtilsMessengerEXT
 
 class VulkanShadowRenderer {
 public:
+    explicit VulkanShadowRenderer(const ShadowSettings& settings) : settings(settings) {}
+
     void run() {
         initWindow();
         initVulkan();
@@ -141,6 +278,7 @@ private:
     std::vector<VkFramebuffer> swapChainFramebuffers;
     VkRenderPass renderPass;
     VkDescriptorSetLayout descriptorSetLayout;
+    // 场景、深度与矩三种图形管线共用：描述符集 + 模型矩阵 push constant
     VkPipelineLayout pipelineLayout;
     VkPipeline graphicsPipeline;
     VkCommandPool commandPool;
@@ -150,22 +288,84 @@ private:
     std::vector<VkFence> inFlightFences;
     size_t currentFrame = 0;
 
+    // 主渲染通道的深度缓冲
+    VkImage sceneDepthImage;
+    VkDeviceMemory sceneDepthImageMemory;
+    VkImageView sceneDepthImageView;
+
     // Shadow mapping resources
     VkImage depthMap;
     VkDeviceMemory depthMapMemory;
     VkImageView depthMapView;
+    // 开启比较的采样器，PCF 用
     VkSampler depthMapSampler;
     VkFramebuffer depthMapFramebuffer;
+    // 载入复制来的静态深度，叠加动态投射物
     VkRenderPass depthPass;
-    VkPipelineLayout depthPipelineLayout;
     VkPipeline depthPipeline;
-    VkDescriptorSetLayout depthDescriptorSetLayout;
-    std::vector<VkDescriptorSet> depthDescriptorSets;
+
+    // 阴影缓存：静态投射物（地面）的深度只在光源矩阵、静态物体的模型矩阵或过滤方式变化时重新渲染，
+    // 动态投射物（立方体）每帧叠加在缓存之上
+    VkImage staticDepthMap;
+    VkDeviceMemory staticDepthMapMemory;
+    VkImageView staticDepthMapView;
+    VkRenderPass staticDepthPass;
+    VkFramebuffer staticDepthFramebuffer;
+    bool shadowCacheValid = false;
+    glm::mat4 cachedLightSpaceMatrix;
+    glm::mat4 cachedStaticModel;
+    int32_t cachedFilter = SHADOW_FILTER_PCF;
+    // 静态阴影通道渲染与跳过的帧数：自启动以来的总数，以及当前统计周期内的数量
+    uint64_t staticShadowPassRenders = 0;
+    uint64_t staticShadowPassSkips = 0;
+    uint32_t reportStaticRenders = 0;
+    uint32_t reportStaticSkips = 0;
+
+    // 点光源阴影：一张深度图集，每个光源一个 6 层的数组视图与 multiview 帧缓冲
+    VkImage pointShadowAtlas;
+    VkDeviceMemory pointShadowAtlasMemory;
+    VkImageView pointShadowAtlasView;
+    std::array<VkImageView, MAX_POINT_LIGHTS> pointShadowFaceViews;
+    std::array<VkFramebuffer, MAX_POINT_LIGHTS> pointShadowFramebuffers;
+    VkSampler pointShadowSampler;
+    VkRenderPass pointShadowPass;
+    VkPipeline pointShadowPipeline;
+    // 当前帧的点光源位置与各面矩阵，剔除投射物时使用
+    std::array<glm::vec3, MAX_POINT_LIGHTS> pointLightPositions;
+    std::array<glm::mat4, MAX_POINT_LIGHTS * 6> pointLightMatrices;
+    // 当前统计周期内点光源阴影通道绘制与剔除的投射物数
+    uint32_t reportPointCasterDraws = 0;
+    uint32_t reportPointCasterCulls = 0;
+
+    // 矩阴影贴图：0 为 VSM，1 为 EVSM（下标为 filter - 1）
+    ShadowSettings settings;
+    std::array<MomentShadowMap, 2> momentMaps;
+    // 三线性 + 各向异性，光照时采样矩
+    VkSampler momentSampler;
+    // 模糊的输入只用 texelFetch
+    VkSampler blurSampler;
+    VkDescriptorSetLayout blurDescriptorSetLayout;
+    VkPipelineLayout blurPipelineLayout;
+    bool filterKeyWasPressed = false;
+    bool decreaseKeyWasPressed = false;
+    bool increaseKeyWasPressed = false;
+    bool cacheKeyWasPressed = false;
+    bool lightKeyWasPressed = false;
+    bool pointLightKeyWasPressed = false;
+
+    // GPU 计时，每秒输出一次各通道的平均耗时
+    VkQueryPool timestampQueryPool = VK_NULL_HANDLE;
+    bool timestampsSupported = false;
+    float timestampPeriod = 1.0f;
+    std::array<bool, MAX_FRAMES_IN_FLIGHT> timestampsPending{};
+    double shadowMilliseconds = 0.0;
+    double blurMilliseconds = 0.0;
+    double pointShadowMilliseconds = 0.0;
+    double lightingMilliseconds = 0.0;
+    uint32_t timedFrames = 0;
+    std::chrono::high_resolution_clock::time_point lastReportTime;
 
     // Uniform buffer
-    VkBuffer uniformBuffer;
-    VkDeviceMemory uniformBufferMemory;
-    void* uniformBufferMapped;
     std::vector<VkBuffer> uniformBuffers;
     std::vector<VkDeviceMemory> uniformBuffersMemory;
     std::vector<void*> uniformBuffersMapped;
@@ -182,6 +382,13 @@ private:
     VkDescriptorPool descriptorPool;
     std::vector<VkDescriptorSet> descriptorSets;
 
+    // 当前帧的模型矩阵与光源矩阵
+    glm::mat4 cubeModel;
+    glm::mat4 floorModel;
+    glm::mat4 lightSpaceMatrix;
+    // 光源旋转的时间，暂停时不再累加
+    float lightTime = 0.0f;
+
     void initWindow() {
         glfwInit();
         glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
@@ -200,20 +407,26 @@ private:
         createImageViews();
         createRenderPass();
         createDescriptorSetLayout();
+        createPipelineLayout();
         createGraphicsPipeline();
         createCommandPool();
-        createDepthResources();
+        createSceneDepthResources();
         createFramebuffers();
+        createDepthResources();
+        createDepthPass();
+        createDepthPipeline();
+        createDepthMapFramebuffer();
+        createMomentShadowMaps();
+        createBlurPipelines();
         createVertexBuffer();
         createIndexBuffer();
         createUniformBuffers();
         createDescriptorPool();
         createDescriptorSets();
+        createBlurDescriptorSets();
+        createCommandBuffers();
+        createTimestampQueries();
         createSyncObjects();
-        createDepthPass();
-        createDepthPipelineLayout();
-        createDepthPipeline();
-        createDepthMapFramebuffer();
     }
 
     void createInstance() {
@@ -227,7 +440,8 @@ private:
         appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
         appInfo.pEngineName = "No Engine";
         appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-        appInfo.apiVersion = VK_API_VERSION_1_0;
+        // 点光源阴影使用 Vulkan 1.1 核心的 multiview
+        appInfo.apiVersion = VK_API_VERSION_1_1;
 
         VkInstanceCreateInfo createInfo{};
         createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -310,14 +524,26 @@ private:
             queueCreateInfos.push_back(queueCreateInfo);
         }
 
+        VkPhysicalDeviceFeatures supportedFeatures;
+        vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+
         VkPhysicalDeviceFeatures deviceFeatures{};
         deviceFeatures.depthClamp = VK_TRUE;
+        // RG32F 的存储图像属于扩展格式
+        deviceFeatures.shaderStorageImageExtendedFormats = VK_TRUE;
+        deviceFeatures.samplerAnisotropy = supportedFeatures.samplerAnisotropy;
 
         VkDeviceCreateInfo createInfo{};
         createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
         createInfo.pQueueCreateInfos = queueCreateInfos.data();
         createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
         createInfo.pEnabledFeatures = &deviceFeatures;
+
+        VkPhysicalDeviceMultiviewFeatures multiviewFeatures{};
+        multiviewFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MULTIVIEW_FEATURES;
+        multiviewFeatures.multiview = VK_TRUE;
+        createInfo.pNext = &multiviewFeatures;
+
         createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
         createInfo.ppEnabledExtensionNames = deviceExtensions.data();
 
@@ -449,13 +675,14 @@ private:
         subpass.pColorAttachments = &colorAttachmentRef;
         subpass.pDepthStencilAttachment = &depthAttachmentRef;
 
+        // 场景深度缓冲在上一帧的深度测试完成后才能清除
         VkSubpassDependency dependency{};
         dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
         dependency.dstSubpass = 0;
-        dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-        dependency.srcAccessMask = 0;
-        dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-        dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        dependency.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+        dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 
         std::array<VkAttachmentDescription, 2> attachments = {colorAttachment, depthAttachment};
         VkRenderPassCreateInfo renderPassInfo{};
@@ -480,14 +707,17 @@ private:
         uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
         uboLayoutBinding.pImmutableSamplers = nullptr;
 
-        VkDescriptorSetLayoutBinding samplerLayoutBinding{};
-        samplerLayoutBinding.binding = 1;
-        samplerLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        samplerLayoutBinding.descriptorCount = 1;
-        samplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-        samplerLayoutBinding.pImmutableSamplers = nullptr;
+        // 1：深度贴图（比较采样），2：VSM 矩，3：EVSM 矩，4：点光源阴影图集（比较采样）
+        std::array<VkDescriptorSetLayoutBinding, 5> bindings{};
+        bindings[0] = uboLayoutBinding;
+        for (uint32_t binding = 1; binding < bindings.size(); binding++) {
+            bindings[binding].binding = binding;
+            bindings[binding].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            bindings[binding].descriptorCount = 1;
+            bindings[binding].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+            bindings[binding].pImmutableSamplers = nullptr;
+        }
 
-        std::array<VkDescriptorSetLayoutBinding, 2> bindings = {uboLayoutBinding, samplerLayoutBinding};
         VkDescriptorSetLayoutCreateInfo layoutInfo{};
         layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
         layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
@@ -498,9 +728,27 @@ private:
         }
     }
 
+    void createPipelineLayout() {
+        VkPushConstantRange pushConstantRange{};
+        pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+        pushConstantRange.offset = 0;
+        pushConstantRange.size = sizeof(ObjectConstants);
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = 1;
+        pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+        pipelineLayoutInfo.pushConstantRangeCount = 1;
+        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+        if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create pipeline layout!");
+        }
+    }
+
     void createGraphicsPipeline() {
-        auto vertexShaderCode = readFile("shaders/vertex.vert");
-        auto fragmentShaderCode = readFile("shaders/fragment.frag");
+        auto vertexShaderCode = readFile("shaders/scene.spv");
+        auto fragmentShaderCode = readFile("shaders/lighting.spv");
 
         VkShaderModule vertexShaderModule = createShaderModule(vertexShaderCode);
         VkShaderModule fragmentShaderModule = createShaderModule(fragmentShaderCode);
@@ -552,6 +800,7 @@ private:
         viewportState.scissorCount = 1;
         viewportState.pScissors = &scissor;
 
+        // 投影矩阵翻转了 Y，逆时针的三角形在帧缓冲中仍是正面
         VkPipelineRasterizationStateCreateInfo rasterizer{};
         rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
         rasterizer.depthClampEnable = VK_FALSE;
@@ -559,7 +808,7 @@ private:
         rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
         rasterizer.lineWidth = 1.0f;
         rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
-        rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
+        rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
         rasterizer.depthBiasEnable = VK_FALSE;
 
         VkPipelineMultisampleStateCreateInfo multisampling{};
@@ -599,15 +848,6 @@ private:
         dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
         dynamicState.pDynamicStates = dynamicStates.data();
 
-        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-        pipelineLayoutInfo.setLayoutCount = 1;
-        pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
-
-        if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create pipeline layout!");
-        }
-
         VkGraphicsPipelineCreateInfo pipelineInfo{};
         pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
         pipelineInfo.stageCount = 2;
@@ -640,17 +880,29 @@ private:
         VkCommandPoolCreateInfo poolInfo{};
         poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
         poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
-        poolInfo.flags = 0;
+        // 每帧重新录制命令缓冲区
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 
         if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
             throw std::runtime_error("failed to create command pool!");
         }
     }
 
+    void createSceneDepthResources() {
+        VkFormat depthFormat = findDepthFormat();
+        createImage(swapChainExtent.width, swapChainExtent.height, 1, depthFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, sceneDepthImage, sceneDepthImageMemory);
+        sceneDepthImageView = createImageView(sceneDepthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
+    }
+
     void createDepthResources() {
-        createImage(SHADOW_WIDTH, SHADOW_HEIGHT, VK_FORMAT_D32_SFLOAT, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depthMap, depthMapMemory);
+        createImage(SHADOW_WIDTH, SHADOW_HEIGHT, 1, VK_FORMAT_D32_SFLOAT, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depthMap, depthMapMemory);
         depthMapView = createImageView(depthMap, VK_FORMAT_D32_SFLOAT, VK_IMAGE_ASPECT_DEPTH_BIT);
 
+        // 静态投射物的深度缓存，每帧复制到 depthMap 后再叠加动态投射物
+        createImage(SHADOW_WIDTH, SHADOW_HEIGHT, 1, VK_FORMAT_D32_SFLOAT, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, staticDepthMap, staticDepthMapMemory);
+        staticDepthMapView = createImageView(staticDepthMap, VK_FORMAT_D32_SFLOAT, VK_IMAGE_ASPECT_DEPTH_BIT);
+
+        // 比较结果为参考深度不大于贴图深度的比例，即光照比例；线性过滤时硬件对相邻 4 个比较结果双线性插值
         VkSamplerCreateInfo samplerInfo{};
         samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
         samplerInfo.magFilter = VK_FILTER_LINEAR;
@@ -662,16 +914,42 @@ private:
         samplerInfo.maxAnisotropy = 1.0f;
         samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
         samplerInfo.unnormalizedCoordinates = VK_FALSE;
-        samplerInfo.compareEnable = VK_FALSE;
-        samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
-        samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+        samplerInfo.compareEnable = VK_TRUE;
+        samplerInfo.compareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+        samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
         samplerInfo.mipLodBias = 0.0f;
         samplerInfo.minLod = 0.0f;
-        samplerInfo.maxLod = 1.0f;
+        samplerInfo.maxLod = 0.0f;
 
         if (vkCreateSampler(device, &samplerInfo, nullptr, &depthMapSampler) != VK_SUCCESS) {
             throw std::runtime_error("failed to create depth map sampler!");
         }
+
+        // 点光源阴影图集：所有点光源共用一次分配，第 i 个光源的立方体面占第 6i 到 6i+5 层
+        uint32_t atlasLayers = MAX_POINT_LIGHTS * 6;
+        createImage(POINT_SHADOW_SIZE, POINT_SHADOW_SIZE, 1, VK_FORMAT_D32_SFLOAT, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, pointShadowAtlas, pointShadowAtlasMemory, atlasLayers);
+        pointShadowAtlasView = createImageView(pointShadowAtlas, VK_FORMAT_D32_SFLOAT, VK_IMAGE_ASPECT_DEPTH_BIT, 1, VK_IMAGE_VIEW_TYPE_2D_ARRAY, 0, atlasLayers);
+        for (int32_t light = 0; light < MAX_POINT_LIGHTS; light++) {
+            pointShadowFaceViews[light] = createImageView(pointShadowAtlas, VK_FORMAT_D32_SFLOAT, VK_IMAGE_ASPECT_DEPTH_BIT, 1, VK_IMAGE_VIEW_TYPE_2D_ARRAY, light * 6, 6);
+        }
+
+        // 未启用的光源从不渲染，整个图集先转到可采样的布局
+        VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+        VkImageMemoryBarrier barrier = imageBarrier(pointShadowAtlas, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                                    0, VK_ACCESS_SHADER_READ_BIT, 0, 1, VK_IMAGE_ASPECT_DEPTH_BIT);
+        barrier.subresourceRange.layerCount = atlasLayers;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+                             0, nullptr, 0, nullptr, 1, &barrier);
+        endSingleTimeCommands(commandBuffer);
+
+        // 立方体的面在接缝处夹取到边缘，不能像方向光那样用白色边框
+        samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+
+        if (vkCreateSampler(device, &samplerInfo, nullptr, &pointShadowSampler) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create point shadow sampler!");
+        }
     }
 
     void createFramebuffers() {
@@ -680,7 +958,7 @@ private:
         for (size_t i = 0; i < swapChainImageViews.size(); i++) {
             std::array<VkImageView, 2> attachments = {
                 swapChainImageViews[i],
-                depthMapView
+                sceneDepthImageView
             };
 
             VkFramebufferCreateInfo framebufferInfo{};
@@ -699,21 +977,43 @@ private:
     }
 
     void createVertexBuffer() {
+        // 每个面 4 个顶点，法线朝外，从外面看为逆时针
         std::vector<Vertex> vertices = {
             // Floor
-            {{-5.0f, 0.0f, -5.0f}, {0.0f, 1.0f, 0.0f}, {0.0f, 0.0f}},
-            {{5.0f, 0.0f, -5.0f}, {0.0f, 1.0f, 0.0f}, {1.0f, 0.0f}},
-            {{5.0f, 0.0f, 5.0f}, {0.0f, 1.0f, 0.0f}, {1.0f, 1.0f}},
-            {{-5.0f, 0.0f, 5.0f}, {0.0f, 1.0f, 0.0f}, {0.0f, 1.0f}},
-            // Cube
-            {{-1.0f, 1.0f, -1.0f}, {0.0f, 0.0f, 0.0f}, {0.0f, 0.0f}},
-            {{1.0f, 1.0f, -1.0f}, {0.0f, 0.0f, 0.0f}, {1.0f, 0.0f}},
-            {{1.0f, 1.0f, 1.0f}, {0.0f, 0.0f, 0.0f}, {1.0f, 1.0f}},
-            {{-1.0f, 1.0f, 1.0f}, {0.0f, 0.0f, 0.0f}, {0.0f, 1.0f}},
-            {{-1.0f, -1.0f, -1.0f}, {0.0f, 0.0f, 0.0f}, {0.0f, 0.0f}},
-            {{1.0f, -1.0f, -1.0f}, {0.0f, 0.0f, 0.0f}, {1.0f, 0.0f}},
-            {{1.0f, -1.0f, 1.0f}, {0.0f, 0.0f, 0.0f}, {1.0f, 1.0f}},
-            {{-1.0f, -1.0f, 1.0f}, {0.0f, 0.0f, 0.0f}, {0.0f, 1.0f}}
+            {{-5.0f, 0.0f, 5.0f}, {0.0f, 1.0f, 0.0f}, {0.0f, 0.0f}},
+            {{5.0f, 0.0f, 5.0f}, {0.0f, 1.0f, 0.0f}, {1.0f, 0.0f}},
+            {{5.0f, 0.0f, -5.0f}, {0.0f, 1.0f, 0.0f}, {1.0f, 1.0f}},
+            {{-5.0f, 0.0f, -5.0f}, {0.0f, 1.0f, 0.0f}, {0.0f, 1.0f}},
+            // Cube: +X
+            {{1.0f, -1.0f, 1.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 0.0f}},
+            {{1.0f, -1.0f, -1.0f}, {1.0f, 0.0f, 0.0f}, {1.0f, 0.0f}},
+            {{1.0f, 1.0f, -1.0f}, {1.0f, 0.0f, 0.0f}, {1.0f, 1.0f}},
+            {{1.0f, 1.0f, 1.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 1.0f}},
+            // -X
+            {{-1.0f, -1.0f, -1.0f}, {-1.0f, 0.0f, 0.0f}, {0.0f, 0.0f}},
+            {{-1.0f, -1.0f, 1.0f}, {-1.0f, 0.0f, 0.0f}, {1.0f, 0.0f}},
+            {{-1.0f, 1.0f, 1.0f}, {-1.0f, 0.0f, 0.0f}, {1.0f, 1.0f}},
+            {{-1.0f, 1.0f, -1.0f}, {-1.0f, 0.0f, 0.0f}, {0.0f, 1.0f}},
+            // +Y
+            {{-1.0f, 1.0f, 1.0f}, {0.0f, 1.0f, 0.0f}, {0.0f, 0.0f}},
+            {{1.0f, 1.0f, 1.0f}, {0.0f, 1.0f, 0.0f}, {1.0f, 0.0f}},
+            {{1.0f, 1.0f, -1.0f}, {0.0f, 1.0f, 0.0f}, {1.0f, 1.0f}},
+            {{-1.0f, 1.0f, -1.0f}, {0.0f, 1.0f, 0.0f}, {0.0f, 1.0f}},
+            // -Y
+            {{-1.0f, -1.0f, -1.0f}, {0.0f, -1.0f, 0.0f}, {0.0f, 0.0f}},
+            {{1.0f, -1.0f, -1.0f}, {0.0f, -1.0f, 0.0f}, {1.0f, 0.0f}},
+            {{1.0f, -1.0f, 1.0f}, {0.0f, -1.0f, 0.0f}, {1.0f, 1.0f}},
+            {{-1.0f, -1.0f, 1.0f}, {0.0f, -1.0f, 0.0f}, {0.0f, 1.0f}},
+            // +Z
+            {{-1.0f, -1.0f, 1.0f}, {0.0f, 0.0f, 1.0f}, {0.0f, 0.0f}},
+            {{1.0f, -1.0f, 1.0f}, {0.0f, 0.0f, 1.0f}, {1.0f, 0.0f}},
+            {{1.0f, 1.0f, 1.0f}, {0.0f, 0.0f, 1.0f}, {1.0f, 1.0f}},
+            {{-1.0f, 1.0f, 1.0f}, {0.0f, 0.0f, 1.0f}, {0.0f, 1.0f}},
+            // -Z
+            {{1.0f, -1.0f, -1.0f}, {0.0f, 0.0f, -1.0f}, {0.0f, 0.0f}},
+            {{-1.0f, -1.0f, -1.0f}, {0.0f, 0.0f, -1.0f}, {1.0f, 0.0f}},
+            {{-1.0f, 1.0f, -1.0f}, {0.0f, 0.0f, -1.0f}, {1.0f, 1.0f}},
+            {{1.0f, 1.0f, -1.0f}, {0.0f, 0.0f, -1.0f}, {0.0f, 1.0f}}
         };
 
         VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
@@ -736,24 +1036,12 @@ private:
     }
 
     void createIndexBuffer() {
-        std::vector<uint32_t> indices = {
-            // Floor
-            0, 1, 2,
-            2, 3, 0,
-            // Cube
-            4, 5, 6,
-            6, 7, 4,
-            8, 12, 11,
-            11, 9, 8,
-            9, 11, 6,
-            6, 5, 9,
-            5, 10, 11,
-            11, 6, 5,
-            10, 4, 7,
-            7, 11, 10,
-            4, 10, 9,
-            9, 5, 4
-        };
+        // 前 FLOOR_INDEX_COUNT 个是地面，之后 CUBE_INDEX_COUNT 个是立方体
+        std::vector<uint32_t> indices;
+        for (uint32_t face = 0; face < 7; face++) {
+            uint32_t base = face * 4;
+            indices.insert(indices.end(), {base, base + 1, base + 2, base + 2, base + 3, base});
+        }
 
         VkDeviceSize bufferSize = sizeof(indices[0]) * indices.size();
 
@@ -789,17 +1077,22 @@ private:
     }
 
     void createDescriptorPool() {
-        std::array<VkDescriptorPoolSize, 2> poolSizes{};
+        // 每帧 4 个采样描述符，每张矩贴图的两个模糊描述符集各有 1 个采样与 1 个存储图像
+        uint32_t blurSetCount = static_cast<uint32_t>(momentMaps.size() * 2);
+
+        std::array<VkDescriptorPoolSize, 3> poolSizes{};
         poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
         poolSizes[0].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
         poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        poolSizes[1].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+        poolSizes[1].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT * 4) + blurSetCount;
+        poolSizes[2].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        poolSizes[2].descriptorCount = blurSetCount;
 
         VkDescriptorPoolCreateInfo poolInfo{};
         poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
         poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
         poolInfo.pPoolSizes = poolSizes.data();
-        poolInfo.maxSets = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+        poolInfo.maxSets = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT) + blurSetCount;
 
         if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
             throw std::runtime_error("failed to create descriptor pool!");
@@ -826,12 +1119,21 @@ private:
             bufferInfo.offset = 0;
             bufferInfo.range = sizeof(UniformBufferObject);
 
-            VkDescriptorImageInfo imageInfo{};
-            imageInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-            imageInfo.imageView = depthMapView;
-            imageInfo.sampler = depthMapSampler;
+            // 阴影通道结束时深度贴图、两张矩贴图与点光源阴影图集都处于 SHADER_READ_ONLY_OPTIMAL
+            std::array<VkDescriptorImageInfo, 4> imageInfos{};
+            imageInfos[0].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            imageInfos[0].imageView = depthMapView;
+            imageInfos[0].sampler = depthMapSampler;
+            for (size_t map = 0; map < momentMaps.size(); map++) {
+                imageInfos[map + 1].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+                imageInfos[map + 1].imageView = momentMaps[map].view;
+                imageInfos[map + 1].sampler = momentSampler;
+            }
+            imageInfos[3].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            imageInfos[3].imageView = pointShadowAtlasView;
+            imageInfos[3].sampler = pointShadowSampler;
 
-            std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
+            std::array<VkWriteDescriptorSet, 5> descriptorWrites{};
 
             descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
             descriptorWrites[0].dstSet = descriptorSets[i];
@@ -841,18 +1143,55 @@ private:
             descriptorWrites[0].descriptorCount = 1;
             descriptorWrites[0].pBufferInfo = &bufferInfo;
 
-            descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            descriptorWrites[1].dstSet = descriptorSets[i];
-            descriptorWrites[1].dstBinding = 1;
-            descriptorWrites[1].dstArrayElement = 0;
-            descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-            descriptorWrites[1].descriptorCount = 1;
-            descriptorWrites[1].pImageInfo = &imageInfo;
+            for (uint32_t binding = 1; binding < descriptorWrites.size(); binding++) {
+                descriptorWrites[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                descriptorWrites[binding].dstSet = descriptorSets[i];
+                descriptorWrites[binding].dstBinding = binding;
+                descriptorWrites[binding].dstArrayElement = 0;
+                descriptorWrites[binding].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+                descriptorWrites[binding].descriptorCount = 1;
+                descriptorWrites[binding].pImageInfo = &imageInfos[binding - 1];
+            }
 
             vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
         }
     }
 
+    void createCommandBuffers() {
+        commandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = commandPool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
+
+        if (vkAllocateCommandBuffers(device, &allocInfo, commandBuffers.data()) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate command buffers!");
+        }
+    }
+
+    void createTimestampQueries() {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+        timestampsSupported = properties.limits.timestampComputeAndGraphics == VK_TRUE;
+        timestampPeriod = properties.limits.timestampPeriod;
+        lastReportTime = std::chrono::high_resolution_clock::now();
+        if (!timestampsSupported) {
+            std::cout << "GPU timestamps not supported, pass times will not be reported" << std::endl;
+            return;
+        }
+
+        VkQueryPoolCreateInfo queryPoolInfo{};
+        queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        queryPoolInfo.queryCount = TIMESTAMPS_PER_FRAME * MAX_FRAMES_IN_FLIGHT;
+
+        if (vkCreateQueryPool(device, &queryPoolInfo, nullptr, &timestampQueryPool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create timestamp query pool!");
+        }
+    }
+
     void createSyncObjects() {
         imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
         renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
@@ -876,84 +1215,131 @@ private:
 
     // Shadow mapping functions
     void createDepthPass() {
+        depthPass = createShadowPass(VK_FORMAT_UNDEFINED, ShadowPassType::Composite);
+        staticDepthPass = createShadowPass(VK_FORMAT_UNDEFINED, ShadowPassType::Cache);
+        pointShadowPass = createShadowPass(VK_FORMAT_UNDEFINED, ShadowPassType::PointLight);
+    }
+
+    // 光源视角的渲染通道。momentFormat 为 VK_FORMAT_UNDEFINED 时只有深度附件，否则第 0 个附件是矩贴图的第 0 层。
+    // 合成通道结束时矩转到 GENERAL 供模糊，深度转到 SHADER_READ_ONLY_OPTIMAL（PCF 直接采样，矩路径下只是满足光照描述符的布局要求）
+    VkRenderPass createShadowPass(VkFormat momentFormat, ShadowPassType type) {
+        bool cachePass = type == ShadowPassType::Cache;
+        std::vector<VkAttachmentDescription> attachments;
+        VkAttachmentLoadOp loadOp = type == ShadowPassType::Composite ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+        VkImageLayout initialLayout = type == ShadowPassType::Composite ? VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
+
+        if (momentFormat != VK_FORMAT_UNDEFINED) {
+            VkAttachmentDescription colorAttachment{};
+            colorAttachment.format = momentFormat;
+            colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+            colorAttachment.loadOp = loadOp;
+            colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+            colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+            colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            colorAttachment.initialLayout = initialLayout;
+            colorAttachment.finalLayout = cachePass ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL;
+            attachments.push_back(colorAttachment);
+        }
+
         VkAttachmentDescription depthAttachment{};
         depthAttachment.format = VK_FORMAT_D32_SFLOAT;
         depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-        depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        depthAttachment.loadOp = loadOp;
         depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
         depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-        depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+        depthAttachment.initialLayout = initialLayout;
+        depthAttachment.finalLayout = cachePass ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        attachments.push_back(depthAttachment);
+
+        VkAttachmentReference colorAttachmentRef{};
+        colorAttachmentRef.attachment = 0;
+        colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
         VkAttachmentReference depthAttachmentRef{};
-        depthAttachmentRef.attachment = 0;
+        depthAttachmentRef.attachment = static_cast<uint32_t>(attachments.size() - 1);
         depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
         VkSubpassDescription subpass{};
         subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-        subpass.colorAttachmentCount = 0;
+        subpass.colorAttachmentCount = momentFormat != VK_FORMAT_UNDEFINED ? 1 : 0;
+        subpass.pColorAttachments = momentFormat != VK_FORMAT_UNDEFINED ? &colorAttachmentRef : nullptr;
         subpass.pDepthStencilAttachment = &depthAttachmentRef;
 
-        VkSubpassDependency dependency{};
-        dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-        dependency.dstSubpass = 0;
-        dependency.srcStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-        dependency.srcAccessMask = 0;
-        dependency.dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-        dependency.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        // 进入：缓存通道等上一帧对缓存的复制读完；合成通道等本帧的复制写完，以及上一帧的采样、模糊与 mip 生成结束。
+        // 离开：写入对复制、模糊与光照通道可见
+        std::array<VkSubpassDependency, 2> dependencies{};
+        dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+        dependencies[0].dstSubpass = 0;
+        dependencies[0].srcStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        dependencies[0].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+                                        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+        dependencies[1].srcSubpass = 0;
+        dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+        dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        dependencies[1].dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        dependencies[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
 
         VkRenderPassCreateInfo renderPassInfo{};
         renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-        renderPassInfo.attachmentCount = 1;
-        renderPassInfo.pAttachments = &depthAttachment;
+        renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+        renderPassInfo.pAttachments = attachments.data();
         renderPassInfo.subpassCount = 1;
         renderPassInfo.pSubpasses = &subpass;
-        renderPassInfo.dependencyCount = 1;
-        renderPassInfo.pDependencies = &dependency;
-
-        if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &depthPass) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create depth pass!");
-        }
-    }
-
-    void createDepthPipelineLayout() {
-        VkDescriptorSetLayoutBinding uboLayoutBinding{};
-        uboLayoutBinding.binding = 0;
-        uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        uboLayoutBinding.descriptorCount = 1;
-        uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-        uboLayoutBinding.pImmutableSamplers = nullptr;
-
-        VkDescriptorSetLayoutCreateInfo layoutInfo{};
-        layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-        layoutInfo.bindingCount = 1;
-        layoutInfo.pBindings = &uboLayoutBinding;
-
-        if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &depthDescriptorSetLayout) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create depth descriptor set layout!");
+        renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+        renderPassInfo.pDependencies = dependencies.data();
+
+        // 点光源：帧缓冲附件是 6 层的数组视图，视图 i 写入第 i 层；6 个视图的几何相同，标记为相关便于驱动合并处理
+        uint32_t viewMask = (1u << 6) - 1;
+        VkRenderPassMultiviewCreateInfo multiviewInfo{};
+        multiviewInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_MULTIVIEW_CREATE_INFO;
+        multiviewInfo.subpassCount = 1;
+        multiviewInfo.pViewMasks = &viewMask;
+        multiviewInfo.correlationMaskCount = 1;
+        multiviewInfo.pCorrelationMasks = &viewMask;
+        if (type == ShadowPassType::PointLight) {
+            renderPassInfo.pNext = &multiviewInfo;
         }
 
-        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-        pipelineLayoutInfo.setLayoutCount = 1;
-        pipelineLayoutInfo.pSetLayouts = &depthDescriptorSetLayout;
-
-        if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &depthPipelineLayout) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create depth pipeline layout!");
+        VkRenderPass pass;
+        if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &pass) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create shadow pass!");
         }
+        return pass;
     }
 
     void createDepthPipeline() {
-        auto vertexShaderCode = readFile("shaders/depth.vert");
+        depthPipeline = createShadowPipeline(depthPass, "shaders/depth.spv", "", true, {SHADOW_WIDTH, SHADOW_HEIGHT});
+        pointShadowPipeline = createShadowPipeline(pointShadowPass, "shaders/point_depth.spv", "", true, {POINT_SHADOW_SIZE, POINT_SHADOW_SIZE});
+    }
 
-        VkShaderModule vertexShaderModule = createShaderModule(vertexShaderCode);
+    // 光源视角的管线：只有顶点着色器时只写深度（带深度偏移），给出片段着色器时写入矩（不需要偏移）
+    VkPipeline createShadowPipeline(VkRenderPass pass, const std::string& vertexShaderFile, const std::string& fragmentShaderFile, bool depthBias, VkExtent2D extent) {
+        auto vertexShaderCode = readFile(vertexShaderFile);
 
-        VkPipelineShaderStageCreateInfo vertexShaderStageInfo{};
-        vertexShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-        vertexShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-        vertexShaderStageInfo.module = vertexShaderModule;
-        vertexShaderStageInfo.pName = "main";
+        VkShaderModule vertexShaderModule = createShaderModule(vertexShaderCode);
+        VkShaderModule fragmentShaderModule = VK_NULL_HANDLE;
+
+        std::vector<VkPipelineShaderStageCreateInfo> shaderStages(1);
+        shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+        shaderStages[0].module = vertexShaderModule;
+        shaderStages[0].pName = "main";
+
+        if (!fragmentShaderFile.empty()) {
+            fragmentShaderModule = createShaderModule(readFile(fragmentShaderFile));
+
+            VkPipelineShaderStageCreateInfo fragmentShaderStageInfo{};
+            fragmentShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+            fragmentShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+            fragmentShaderStageInfo.module = fragmentShaderModule;
+            fragmentShaderStageInfo.pName = "main";
+            shaderStages.push_back(fragmentShaderStageInfo);
+        }
 
         VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
         auto bindingDescription = Vertex::getBindingDescription();
@@ -972,14 +1358,14 @@ private:
         VkViewport viewport{};
         viewport.x = 0.0f;
         viewport.y = 0.0f;
-        viewport.width = (float) SHADOW_WIDTH;
-        viewport.height = (float) SHADOW_HEIGHT;
+        viewport.width = (float) extent.width;
+        viewport.height = (float) extent.height;
         viewport.minDepth = 0.0f;
         viewport.maxDepth = 1.0f;
 
         VkRect2D scissor{};
         scissor.offset = {0, 0};
-        scissor.extent = {SHADOW_WIDTH, SHADOW_HEIGHT};
+        scissor.extent = extent;
 
         VkPipelineViewportStateCreateInfo viewportState{};
         viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
@@ -995,8 +1381,8 @@ private:
         rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
         rasterizer.lineWidth = 1.0f;
         rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
-        rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
-        rasterizer.depthBiasEnable = VK_TRUE;
+        rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+        rasterizer.depthBiasEnable = depthBias ? VK_TRUE : VK_FALSE;
         rasterizer.depthBiasConstantFactor = 1.25f;
         rasterizer.depthBiasClamp = 0.0f;
         rasterizer.depthBiasSlopeFactor = 1.75f;
@@ -1014,59 +1400,325 @@ private:
         depthStencil.depthBoundsTestEnable = VK_FALSE;
         depthStencil.stencilTestEnable = VK_FALSE;
 
+        VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+        colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+        colorBlendAttachment.blendEnable = VK_FALSE;
+
+        VkPipelineColorBlendStateCreateInfo colorBlending{};
+        colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+        colorBlending.logicOpEnable = VK_FALSE;
+        colorBlending.attachmentCount = 1;
+        colorBlending.pAttachments = &colorBlendAttachment;
+
         VkGraphicsPipelineCreateInfo pipelineInfo{};
         pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-        pipelineInfo.stageCount = 1;
-        pipelineInfo.pStages = &vertexShaderStageInfo;
+        pipelineInfo.stageCount = static_cast<uint32_t>(shaderStages.size());
+        pipelineInfo.pStages = shaderStages.data();
         pipelineInfo.pVertexInputState = &vertexInputInfo;
         pipelineInfo.pInputAssemblyState = &inputAssembly;
         pipelineInfo.pViewportState = &viewportState;
         pipelineInfo.pRasterizationState = &rasterizer;
         pipelineInfo.pMultisampleState = &multisampling;
         pipelineInfo.pDepthStencilState = &depthStencil;
-        pipelineInfo.pColorBlendState = nullptr;
+        pipelineInfo.pColorBlendState = fragmentShaderModule != VK_NULL_HANDLE ? &colorBlending : nullptr;
         pipelineInfo.pDynamicState = nullptr;
-        pipelineInfo.layout = depthPipelineLayout;
-        pipelineInfo.renderPass = depthPass;
+        pipelineInfo.layout = pipelineLayout;
+        pipelineInfo.renderPass = pass;
         pipelineInfo.subpass = 0;
         pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
         pipelineInfo.basePipelineIndex = -1;
 
-        if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &depthPipeline) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create depth pipeline!");
+        VkPipeline pipeline;
+        if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create shadow pipeline!");
         }
 
+        if (fragmentShaderModule != VK_NULL_HANDLE) {
+            vkDestroyShaderModule(device, fragmentShaderModule, nullptr);
+        }
         vkDestroyShaderModule(device, vertexShaderModule, nullptr);
+
+        return pipeline;
     }
 
     void createDepthMapFramebuffer() {
-        std::array<VkImageView, 1> attachments = {
-            depthMapView
-        };
+        depthMapFramebuffer = createShadowFramebuffer(depthPass, {depthMapView});
+        staticDepthFramebuffer = createShadowFramebuffer(staticDepthPass, {staticDepthMapView});
 
+        // multiview 的帧缓冲只有 1 层，附件的 6 层由视图索引选择
+        for (int32_t light = 0; light < MAX_POINT_LIGHTS; light++) {
+            pointShadowFramebuffers[light] = createShadowFramebuffer(pointShadowPass, {pointShadowFaceViews[light]}, {POINT_SHADOW_SIZE, POINT_SHADOW_SIZE});
+        }
+    }
+
+    VkFramebuffer createShadowFramebuffer(VkRenderPass pass, const std::vector<VkImageView>& attachments, VkExtent2D extent = {SHADOW_WIDTH, SHADOW_HEIGHT}) {
         VkFramebufferCreateInfo framebufferInfo{};
         framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-        framebufferInfo.renderPass = depthPass;
+        framebufferInfo.renderPass = pass;
         framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
         framebufferInfo.pAttachments = attachments.data();
-        framebufferInfo.width = SHADOW_WIDTH;
-        framebufferInfo.height = SHADOW_HEIGHT;
+        framebufferInfo.width = extent.width;
+        framebufferInfo.height = extent.height;
         framebufferInfo.layers = 1;
 
-        if (vkCreateFramebuffer(device, &framebufferInfo, nullptr, &depthMapFramebuffer) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create depth map framebuffer!");
+        VkFramebuffer framebuffer;
+        if (vkCreateFramebuffer(device, &framebufferInfo, nullptr, &framebuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create shadow framebuffer!");
+        }
+        return framebuffer;
+    }
+
+    // 矩阴影贴图：VSM 用 RG32F 存 (d, d²)，EVSM 用 RGBA16F 存正负指数变换后的深度及其平方。
+    // 两张都常驻，运行时切换不需要重新创建资源
+    void createMomentShadowMaps() {
+        momentMaps[0].format = VK_FORMAT_R32G32_SFLOAT;
+        momentMaps[1].format = VK_FORMAT_R16G16B16A16_SFLOAT;
+
+        for (MomentShadowMap& map : momentMaps) {
+            createImage(SHADOW_WIDTH, SHADOW_HEIGHT, SHADOW_MIP_LEVELS, map.format, VK_IMAGE_TILING_OPTIMAL,
+                        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT |
+                        VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, map.image, map.imageMemory);
+            map.view = createImageView(map.image, map.format, VK_IMAGE_ASPECT_COLOR_BIT, SHADOW_MIP_LEVELS);
+            map.levelView = createImageView(map.image, map.format, VK_IMAGE_ASPECT_COLOR_BIT);
+
+            createImage(SHADOW_WIDTH, SHADOW_HEIGHT, 1, map.format, VK_IMAGE_TILING_OPTIMAL,
+                        VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT,
+                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, map.blurImage, map.blurImageMemory);
+            map.blurView = createImageView(map.blurImage, map.format, VK_IMAGE_ASPECT_COLOR_BIT);
+
+            createImage(SHADOW_WIDTH, SHADOW_HEIGHT, 1, map.format, VK_IMAGE_TILING_OPTIMAL,
+                        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, map.staticImage, map.staticImageMemory);
+            map.staticView = createImageView(map.staticImage, map.format, VK_IMAGE_ASPECT_COLOR_BIT);
+
+            // 两个通道的附件格式相同，同一条管线可以在两个通道中使用
+            map.renderPass = createShadowPass(map.format, ShadowPassType::Composite);
+            map.staticRenderPass = createShadowPass(map.format, ShadowPassType::Cache);
+            map.pipeline = createShadowPipeline(map.renderPass, "shaders/depth.spv", "shaders/moments.spv", false, {SHADOW_WIDTH, SHADOW_HEIGHT});
+
+            // 颜色为矩，深度测试借用阴影深度贴图
+            map.framebuffer = createShadowFramebuffer(map.renderPass, {map.levelView, depthMapView});
+            map.staticFramebuffer = createShadowFramebuffer(map.staticRenderPass, {map.staticView, staticDepthMapView});
+
+            // 光照管线的描述符集同时引用两张矩贴图，未使用的一张也要处于可采样的布局
+            VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+            recordImageBarrier(commandBuffer, map.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                               0, VK_ACCESS_SHADER_READ_BIT,
+                               VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                               0, SHADOW_MIP_LEVELS);
+            endSingleTimeCommands(commandBuffer);
+        }
+
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+        VkPhysicalDeviceFeatures supportedFeatures;
+        vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+
+        // 掠射角下阴影贴图在屏幕上被强烈压缩，各向异性过滤避免远处的阴影糊成一片
+        VkSamplerCreateInfo samplerInfo{};
+        samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+        samplerInfo.magFilter = VK_FILTER_LINEAR;
+        samplerInfo.minFilter = VK_FILTER_LINEAR;
+        samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.anisotropyEnable = supportedFeatures.samplerAnisotropy;
+        samplerInfo.maxAnisotropy = std::min(8.0f, properties.limits.maxSamplerAnisotropy);
+        samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+        samplerInfo.unnormalizedCoordinates = VK_FALSE;
+        samplerInfo.compareEnable = VK_FALSE;
+        samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+        samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+        samplerInfo.mipLodBias = 0.0f;
+        samplerInfo.minLod = 0.0f;
+        samplerInfo.maxLod = (float) SHADOW_MIP_LEVELS;
+
+        if (vkCreateSampler(device, &samplerInfo, nullptr, &momentSampler) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create moment map sampler!");
+        }
+
+        samplerInfo.magFilter = VK_FILTER_NEAREST;
+        samplerInfo.minFilter = VK_FILTER_NEAREST;
+        samplerInfo.anisotropyEnable = VK_FALSE;
+        samplerInfo.maxAnisotropy = 1.0f;
+        samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+        samplerInfo.maxLod = 0.0f;
+
+        if (vkCreateSampler(device, &samplerInfo, nullptr, &blurSampler) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create blur sampler!");
+        }
+    }
+
+    // 可分离模糊：binding 0 为输入（texelFetch），binding 1 为输出的存储图像
+    void createBlurPipelines() {
+        std::array<VkDescriptorSetLayoutBinding, 2> bindings{};
+        bindings[0].binding = 0;
+        bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        bindings[0].descriptorCount = 1;
+        bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        bindings[1].binding = 1;
+        bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        bindings[1].descriptorCount = 1;
+        bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        VkDescriptorSetLayoutCreateInfo layoutInfo{};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+        layoutInfo.pBindings = bindings.data();
+
+        if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &blurDescriptorSetLayout) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create blur descriptor set layout!");
+        }
+
+        VkPushConstantRange pushConstantRange{};
+        pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        pushConstantRange.offset = 0;
+        pushConstantRange.size = sizeof(BlurConstants);
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = 1;
+        pipelineLayoutInfo.pSetLayouts = &blurDescriptorSetLayout;
+        pipelineLayoutInfo.pushConstantRangeCount = 1;
+        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+        if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &blurPipelineLayout) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create blur pipeline layout!");
+        }
+
+        // 存储图像的格式写在着色器里，每种格式一份 SPIR-V
+        momentMaps[0].blurPipeline = createBlurPipeline("shaders/moment_blur_rg32f.spv");
+        momentMaps[1].blurPipeline = createBlurPipeline("shaders/moment_blur_rgba16f.spv");
+    }
+
+    VkPipeline createBlurPipeline(const std::string& filename) {
+        auto computeShaderCode = readFile(filename);
+        VkShaderModule computeShaderModule = createShaderModule(computeShaderCode);
+
+        VkPipelineShaderStageCreateInfo computeShaderStageInfo{};
+        computeShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        computeShaderStageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        computeShaderStageInfo.module = computeShaderModule;
+        computeShaderStageInfo.pName = "main";
+
+        VkComputePipelineCreateInfo pipelineInfo{};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.stage = computeShaderStageInfo;
+        pipelineInfo.layout = blurPipelineLayout;
+
+        VkPipeline pipeline;
+        if (vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create blur pipeline!");
+        }
+
+        vkDestroyShaderModule(device, computeShaderModule, nullptr);
+
+        return pipeline;
+    }
+
+    // 模糊期间矩贴图第 0 层与中间图像都处于 GENERAL
+    void createBlurDescriptorSets() {
+        for (MomentShadowMap& map : momentMaps) {
+            std::array<VkDescriptorSetLayout, 2> layouts = {blurDescriptorSetLayout, blurDescriptorSetLayout};
+
+            VkDescriptorSetAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+            allocInfo.descriptorPool = descriptorPool;
+            allocInfo.descriptorSetCount = static_cast<uint32_t>(layouts.size());
+            allocInfo.pSetLayouts = layouts.data();
+
+            if (vkAllocateDescriptorSets(device, &allocInfo, map.blurDescriptorSets.data()) != VK_SUCCESS) {
+                throw std::runtime_error("failed to allocate blur descriptor sets!");
+            }
+
+            std::array<VkImageView, 2> sources = {map.levelView, map.blurView};
+            std::array<VkImageView, 2> targets = {map.blurView, map.levelView};
+
+            for (size_t pass = 0; pass < 2; pass++) {
+                VkDescriptorImageInfo sourceInfo{};
+                sourceInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+                sourceInfo.imageView = sources[pass];
+                sourceInfo.sampler = blurSampler;
+
+                VkDescriptorImageInfo targetInfo{};
+                targetInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+                targetInfo.imageView = targets[pass];
+
+                std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
+                descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                descriptorWrites[0].dstSet = map.blurDescriptorSets[pass];
+                descriptorWrites[0].dstBinding = 0;
+                descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+                descriptorWrites[0].descriptorCount = 1;
+                descriptorWrites[0].pImageInfo = &sourceInfo;
+
+                descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                descriptorWrites[1].dstSet = map.blurDescriptorSets[pass];
+                descriptorWrites[1].dstBinding = 1;
+                descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+                descriptorWrites[1].descriptorCount = 1;
+                descriptorWrites[1].pImageInfo = &targetInfo;
+
+                vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+            }
         }
     }
 
     void mainLoop() {
         while (!glfwWindowShouldClose(window)) {
             glfwPollEvents();
+            processInput();
             drawFrame();
         }
 
         vkDeviceWaitIdle(device);
     }
 
+    // F 键切换阴影过滤方式，[ 与 ] 调整矩阴影的漏光抑制
+    void processInput() {
+        bool filterKeyPressed = glfwGetKey(window, GLFW_KEY_F) == GLFW_PRESS;
+        if (filterKeyPressed && !filterKeyWasPressed) {
+            settings.filter = (settings.filter + 1) % SHADOW_FILTER_COUNT;
+            std::cout << "shadow filter: " << SHADOW_FILTER_NAMES[settings.filter] << std::endl;
+        }
+        filterKeyWasPressed = filterKeyPressed;
+
+        bool decreaseKeyPressed = glfwGetKey(window, GLFW_KEY_LEFT_BRACKET) == GLFW_PRESS;
+        bool increaseKeyPressed = glfwGetKey(window, GLFW_KEY_RIGHT_BRACKET) == GLFW_PRESS;
+        bool decrease = decreaseKeyPressed && !decreaseKeyWasPressed;
+        bool increase = increaseKeyPressed && !increaseKeyWasPressed;
+        if (decrease || increase) {
+            settings.lightBleedReduction = std::clamp(settings.lightBleedReduction + (increase ? 0.05f : -0.05f), 0.0f, 0.95f);
+            std::cout << "light bleeding reduction: " << settings.lightBleedReduction << std::endl;
+        }
+        decreaseKeyWasPressed = decreaseKeyPressed;
+        increaseKeyWasPressed = increaseKeyPressed;
+
+        // C 键开关阴影缓存，L 键暂停或继续光源旋转
+        bool cacheKeyPressed = glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS;
+        if (cacheKeyPressed && !cacheKeyWasPressed) {
+            settings.shadowCache = !settings.shadowCache;
+            std::cout << "shadow cache: " << (settings.shadowCache ? "on" : "off") << std::endl;
+        }
+        cacheKeyWasPressed = cacheKeyPressed;
+
+        bool lightKeyPressed = glfwGetKey(window, GLFW_KEY_L) == GLFW_PRESS;
+        if (lightKeyPressed && !lightKeyWasPressed) {
+            settings.animateLight = !settings.animateLight;
+            std::cout << "light animation: " << (settings.animateLight ? "on" : "off") << std::endl;
+        }
+        lightKeyWasPressed = lightKeyPressed;
+
+        // P 键依次切换点光源数量 0 到 MAX_POINT_LIGHTS
+        bool pointLightKeyPressed = glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS;
+        if (pointLightKeyPressed && !pointLightKeyWasPressed) {
+            settings.pointLightCount = (settings.pointLightCount + 1) % (MAX_POINT_LIGHTS + 1);
+            std::cout << "point lights: " << settings.pointLightCount << std::endl;
+        }
+        pointLightKeyWasPressed = pointLightKeyPressed;
+    }
+
     void drawFrame() {
         vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
 
@@ -1080,7 +1732,10 @@ private:
             throw std::runtime_error("failed to acquire swap chain image!");
         }
 
+        readTimestamps();
         updateUniformBuffer();
+
+        vkResetCommandBuffer(commandBuffers[currentFrame], 0);
         recordCommandBuffer(imageIndex);
 
         vkResetFences(device, 1, &inFlightFences[currentFrame]);
@@ -1126,11 +1781,62 @@ private:
         currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
     }
 
+    // 读取这个帧槽位上一次提交的时间戳（栅栏已经等待过，不会阻塞），每秒输出一次平均值
+    void readTimestamps() {
+        if (!timestampsSupported || !timestampsPending[currentFrame]) {
+            return;
+        }
+
+        std::array<uint64_t, TIMESTAMPS_PER_FRAME> timestamps{};
+        VkResult result = vkGetQueryPoolResults(device, timestampQueryPool, static_cast<uint32_t>(currentFrame * TIMESTAMPS_PER_FRAME),
+                                                TIMESTAMPS_PER_FRAME, sizeof(timestamps), timestamps.data(), sizeof(uint64_t),
+                                                VK_QUERY_RESULT_64_BIT);
+        timestampsPending[currentFrame] = false;
+        if (result != VK_SUCCESS) {
+            return;
+        }
+
+        double nanosecondsToMilliseconds = timestampPeriod / 1e6;
+        shadowMilliseconds += (timestamps[1] - timestamps[0]) * nanosecondsToMilliseconds;
+        blurMilliseconds += (timestamps[2] - timestamps[1]) * nanosecondsToMilliseconds;
+        pointShadowMilliseconds += (timestamps[3] - timestamps[2]) * nanosecondsToMilliseconds;
+        lightingMilliseconds += (timestamps[4] - timestamps[3]) * nanosecondsToMilliseconds;
+        timedFrames++;
+
+        auto now = std::chrono::high_resolution_clock::now();
+        if (std::chrono::duration<float, std::chrono::seconds::period>(now - lastReportTime).count() >= 1.0f) {
+            std::cout << SHADOW_FILTER_NAMES[settings.filter] << ": shadow pass " << shadowMilliseconds / timedFrames << " ms";
+            if (settings.filter != SHADOW_FILTER_PCF) {
+                std::cout << ", blur (radius " << settings.blurRadius << ") + mips " << blurMilliseconds / timedFrames << " ms";
+            }
+            std::cout << ", " << settings.pointLightCount << " point light shadows " << pointShadowMilliseconds / timedFrames << " ms"
+                      << " (" << reportPointCasterCulls << "/" << reportPointCasterDraws + reportPointCasterCulls << " casters culled)"
+                      << ", lighting pass " << lightingMilliseconds / timedFrames << " ms"
+                      << ", static shadow pass skipped " << reportStaticSkips << "/" << reportStaticRenders + reportStaticSkips
+                      << " frames (" << staticShadowPassSkips << " total)" << std::endl;
+            reportStaticRenders = 0;
+            reportStaticSkips = 0;
+            reportPointCasterDraws = 0;
+            reportPointCasterCulls = 0;
+            shadowMilliseconds = 0.0;
+            pointShadowMilliseconds = 0.0;
+            blurMilliseconds = 0.0;
+            lightingMilliseconds = 0.0;
+            timedFrames = 0;
+            lastReportTime = now;
+        }
+    }
+
     void updateUniformBuffer() {
         static auto startTime = std::chrono::high_resolution_clock::now();
 
         auto currentTime = std::chrono::high_resolution_clock::now();
         float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
+        static float previousTime = time;
+        if (settings.animateLight) {
+            lightTime += time - previousTime;
+        }
+        previousTime = time;
 
         UniformBufferObject ubo{};
 
@@ -1139,19 +1845,23 @@ private:
         ubo.view = glm::lookAt(ubo.cameraPos, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
 
         // Light position and view matrix
-        glm::vec3 lightPos = glm::vec3(5.0f * sin(time * 0.5f), 5.0f, 5.0f * cos(time * 0.5f));
+        glm::vec3 lightPos = glm::vec3(5.0f * sin(lightTime * 0.5f), 5.0f, 5.0f * cos(lightTime * 0.5f));
         ubo.lightPos = lightPos;
         glm::mat4 lightView = glm::lookAt(lightPos, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
 
-        // Light projection matrix (orthographic)
+        // Light projection matrix (orthographic)，与相机投影一样翻转 Y，两个通道的三角形环绕方向一致
         float nearPlane = 0.1f;
         float farPlane = 20.0f;
         float orthoSize = 10.0f;
         glm::mat4 lightProjection = glm::ortho(-orthoSize, orthoSize, -orthoSize, orthoSize, nearPlane, farPlane);
-        ubo.lightSpaceMatrix = lightProjection * lightView;
+        lightProjection[1][1] *= -1;
+        lightSpaceMatrix = lightProjection * lightView;
+        ubo.lightSpaceMatrix = lightSpaceMatrix;
 
-        // Model matrix for cube
-        ubo.model = glm::rotate(glm::mat4(1.0f), time * glm::radians(45.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        // 立方体悬在地面上方旋转，地面不动
+        cubeModel = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 1.5f, 0.0f));
+        cubeModel = glm::rotate(cubeModel, time * glm::radians(45.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        floorModel = glm::mat4(1.0f);
 
         // Projection matrix
         ubo.proj = glm::perspective(glm::radians(45.0f), swapChainExtent.width / (float) swapChainExtent.height, 0.1f, 100.0f);
@@ -1159,58 +1869,127 @@ private:
 
         ubo.time = time;
 
+        ubo.shadowFilter = settings.filter;
+        ubo.lightBleedReduction = settings.lightBleedReduction;
+        ubo.evsmPositiveExponent = settings.evsmExponent;
+        ubo.evsmNegativeExponent = settings.evsmExponent;
+
+        // 点光源在立方体周围以不同高度旋转，与方向光一起暂停
+        const glm::vec3 pointLightColors[MAX_POINT_LIGHTS] = {
+            {4.0f, 2.4f, 1.2f}, {1.2f, 2.4f, 4.0f}, {1.6f, 4.0f, 1.6f}, {4.0f, 1.6f, 3.2f}
+        };
+        // 立方体各面的方向与上方向，顺序为 +X -X +Y -Y +Z -Z
+        const glm::vec3 faceDirections[6] = {
+            {1.0f, 0.0f, 0.0f}, {-1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}, {0.0f, -1.0f, 0.0f}, {0.0f, 0.0f, 1.0f}, {0.0f, 0.0f, -1.0f}
+        };
+        const glm::vec3 faceUps[6] = {
+            {0.0f, -1.0f, 0.0f}, {0.0f, -1.0f, 0.0f}, {0.0f, 0.0f, 1.0f}, {0.0f, 0.0f, -1.0f}, {0.0f, -1.0f, 0.0f}, {0.0f, -1.0f, 0.0f}
+        };
+        glm::mat4 faceProjection = glm::perspective(glm::radians(90.0f), 1.0f, POINT_SHADOW_NEAR, POINT_LIGHT_RANGE);
+        faceProjection[1][1] *= -1;
+
+        ubo.pointLightCount = settings.pointLightCount;
+        for (int32_t light = 0; light < settings.pointLightCount; light++) {
+            float angle = lightTime * 0.8f + light * 2.0f * glm::pi<float>() / settings.pointLightCount;
+            glm::vec3 position = glm::vec3(3.0f * cos(angle), 1.0f + 0.5f * light, 3.0f * sin(angle));
+            pointLightPositions[light] = position;
+            ubo.pointLights[light] = glm::vec4(position, POINT_LIGHT_RANGE);
+            ubo.pointLightColors[light] = glm::vec4(pointLightColors[light], 1.0f);
+            for (int face = 0; face < 6; face++) {
+                glm::mat4 faceView = glm::lookAt(position, position + faceDirections[face], faceUps[face]);
+                pointLightMatrices[light * 6 + face] = faceProjection * faceView;
+                ubo.pointLightMatrices[light * 6 + face] = pointLightMatrices[light * 6 + face];
+            }
+        }
+
         memcpy(uniformBuffersMapped[currentFrame], &ubo, sizeof(ubo));
     }
 
+    // 地面与立方体，各自的模型矩阵用 push constant 传递
+    void drawScene(VkCommandBuffer commandBuffer) {
+        drawStaticCasters(commandBuffer);
+        drawDynamicCasters(commandBuffer);
+    }
+
+    void bindSceneBuffers(VkCommandBuffer commandBuffer) {
+        VkBuffer vertexBuffers[] = {vertexBuffer};
+        VkDeviceSize offsets[] = {0};
+        vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+        vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+    }
+
+    // 静态投射物：地面
+    void drawStaticCasters(VkCommandBuffer commandBuffer) {
+        bindSceneBuffers(commandBuffer);
+
+        ObjectConstants floorConstants{floorModel, 0};
+        vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(ObjectConstants), &floorConstants);
+        vkCmdDrawIndexed(commandBuffer, FLOOR_INDEX_COUNT, 1, 0, 0, 0);
+    }
+
+    // 动态投射物：旋转的立方体
+    void drawDynamicCasters(VkCommandBuffer commandBuffer) {
+        bindSceneBuffers(commandBuffer);
+
+        ObjectConstants cubeConstants{cubeModel, 0};
+        vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(ObjectConstants), &cubeConstants);
+        vkCmdDrawIndexed(commandBuffer, CUBE_INDEX_COUNT, 1, FLOOR_INDEX_COUNT, 0, 0);
+    }
+
     void recordCommandBuffer(uint32_t imageIndex) {
+        VkCommandBuffer commandBuffer = commandBuffers[currentFrame];
+
         VkCommandBufferBeginInfo beginInfo{};
         beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 
-        if (vkBeginCommandBuffer(commandBuffers[currentFrame], &beginInfo) != VK_SUCCESS) {
+        if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
             throw std::runtime_error("failed to begin recording command buffer!");
         }
 
-        // First pass: render depth map from light's perspective
-        VkRenderPassBeginInfo renderPassInfo{};
-        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-        renderPassInfo.renderPass = depthPass;
-        renderPassInfo.framebuffer = depthMapFramebuffer;
-        renderPassInfo.renderArea.offset = {0, 0};
-        renderPassInfo.renderArea.extent = {SHADOW_WIDTH, SHADOW_HEIGHT};
+        uint32_t firstQuery = static_cast<uint32_t>(currentFrame * TIMESTAMPS_PER_FRAME);
+        if (timestampsSupported) {
+            vkCmdResetQueryPool(commandBuffer, timestampQueryPool, firstQuery, TIMESTAMPS_PER_FRAME);
+            vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestampQueryPool, firstQuery);
+        }
 
-        std::array<VkClearValue, 1> clearValues{};
-        clearValues[0].depthStencil = {1.0f, 0};
-        renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-        renderPassInfo.pClearValues = clearValues.data();
+        // First pass: render depth map (or moments) from light's perspective
+        recordShadowPasses(commandBuffer);
 
-        vkCmdBeginRenderPass(commandBuffers[currentFrame], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        if (timestampsSupported) {
+            vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestampQueryPool, firstQuery + 1);
+        }
 
-        vkCmdBindPipeline(commandBuffers[currentFrame], VK_PIPELINE_BIND_POINT_GRAPHICS, depthPipeline);
-        vkCmdBindDescriptorSets(commandBuffers[currentFrame], VK_PIPELINE_BIND_POINT_GRAPHICS, depthPipelineLayout, 0, 1, &descriptorSets[currentFrame], 0, nullptr);
+        if (settings.filter != SHADOW_FILTER_PCF) {
+            recordMomentBlur(commandBuffer, momentMaps[settings.filter - 1]);
+        }
 
-        VkBuffer vertexBuffers[] = {vertexBuffer};
-        VkDeviceSize offsets[] = {0};
-        vkCmdBindVertexBuffers(commandBuffers[currentFrame], 0, 1, vertexBuffers, offsets);
-        vkCmdBindIndexBuffer(commandBuffers[currentFrame], indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+        if (timestampsSupported) {
+            vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestampQueryPool, firstQuery + 2);
+        }
 
-        vkCmdDrawIndexed(commandBuffers[currentFrame], 24, 1, 0, 0, 0);
+        recordPointShadowPasses(commandBuffer);
 
-        vkCmdEndRenderPass(commandBuffers[currentFrame]);
+        if (timestampsSupported) {
+            vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestampQueryPool, firstQuery + 3);
+        }
 
         // Second pass: render scene with shadows
+        VkRenderPassBeginInfo renderPassInfo{};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
         renderPassInfo.renderPass = renderPass;
         renderPassInfo.framebuffer = swapChainFramebuffers[imageIndex];
+        renderPassInfo.renderArea.offset = {0, 0};
         renderPassInfo.renderArea.extent = swapChainExtent;
 
         std::array<VkClearValue, 2> clearValuesScene{};
-        clearValuesScene[0].color = {0.1f, 0.1f, 0.1f, 1.0f};
+        clearValuesScene[0].color = {{0.1f, 0.1f, 0.1f, 1.0f}};
         clearValuesScene[1].depthStencil = {1.0f, 0};
         renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValuesScene.size());
         renderPassInfo.pClearValues = clearValuesScene.data();
 
-        vkCmdBeginRenderPass(commandBuffers[currentFrame], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
 
-        vkCmdBindPipeline(commandBuffers[currentFrame], VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
 
         VkViewport viewport{};
         viewport.x = 0.0f;
@@ -1219,27 +1998,299 @@ private:
         viewport.height = (float) swapChainExtent.height;
         viewport.minDepth = 0.0f;
         viewport.maxDepth = 1.0f;
-        vkCmdSetViewport(commandBuffers[currentFrame], 0, 1, &viewport);
+        vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
 
         VkRect2D scissor{};
         scissor.offset = {0, 0};
         scissor.extent = swapChainExtent;
-        vkCmdSetScissor(commandBuffers[currentFrame], 0, 1, &scissor);
+        vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
-        vkCmdBindDescriptorSets(commandBuffers[currentFrame], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[currentFrame], 0, nullptr);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[currentFrame], 0, nullptr);
 
-        vkCmdBindVertexBuffers(commandBuffers[currentFrame], 0, 1, vertexBuffers, offsets);
-        vkCmdBindIndexBuffer(commandBuffers[currentFrame], indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+        drawScene(commandBuffer);
 
-        vkCmdDrawIndexed(commandBuffers[currentFrame], 24, 1, 0, 0, 0);
+        vkCmdEndRenderPass(commandBuffer);
 
-        vkCmdEndRenderPass(commandBuffers[currentFrame]);
+        if (timestampsSupported) {
+            vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestampQueryPool, firstQuery + 4);
+            timestampsPending[currentFrame] = true;
+        }
 
-        if (vkEndCommandBuffer(commandBuffers[currentFrame]) != VK_SUCCESS) {
+        if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
             throw std::runtime_error("failed to record command buffer!");
         }
     }
 
+    // 每个点光源一个 multiview 通道，一次绘制写入立方体的 6 个面。投射物的包围球与 6 个面的视锥体都不相交时不绘制，
+    // 作用范围内没有任何投射物的光源只清除深度
+    void recordPointShadowPasses(VkCommandBuffer commandBuffer) {
+        struct Caster {
+            glm::mat4 model;
+            uint32_t firstIndex;
+            uint32_t indexCount;
+            float radius;
+        };
+        const std::array<Caster, 2> casters = {{
+            {floorModel, 0, FLOOR_INDEX_COUNT, FLOOR_BOUNDING_RADIUS},
+            {cubeModel, FLOOR_INDEX_COUNT, CUBE_INDEX_COUNT, CUBE_BOUNDING_RADIUS}
+        }};
+
+        std::array<VkClearValue, 1> clearValues{};
+        clearValues[0].depthStencil = {1.0f, 0};
+
+        for (int32_t light = 0; light < settings.pointLightCount; light++) {
+            VkRenderPassBeginInfo renderPassInfo{};
+            renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+            renderPassInfo.renderPass = pointShadowPass;
+            renderPassInfo.framebuffer = pointShadowFramebuffers[light];
+            renderPassInfo.renderArea.offset = {0, 0};
+            renderPassInfo.renderArea.extent = {POINT_SHADOW_SIZE, POINT_SHADOW_SIZE};
+            renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+            renderPassInfo.pClearValues = clearValues.data();
+
+            vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pointShadowPipeline);
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[currentFrame], 0, nullptr);
+            bindSceneBuffers(commandBuffer);
+
+            for (const Caster& caster : casters) {
+                glm::vec3 center = glm::vec3(caster.model * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+                bool visible = false;
+                for (int face = 0; face < 6 && !visible; face++) {
+                    visible = sphereInFrustum(pointLightMatrices[light * 6 + face], center, caster.radius);
+                }
+                if (!visible) {
+                    reportPointCasterCulls++;
+                    continue;
+                }
+                reportPointCasterDraws++;
+
+                ObjectConstants constants{caster.model, light};
+                vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(ObjectConstants), &constants);
+                vkCmdDrawIndexed(commandBuffer, caster.indexCount, 1, caster.firstIndex, 0, 0);
+            }
+
+            vkCmdEndRenderPass(commandBuffer);
+        }
+    }
+
+    // 缓存失效时先把静态投射物渲染进缓存，然后把缓存复制到本帧的阴影贴图，再叠加动态投射物
+    void recordShadowPasses(VkCommandBuffer commandBuffer) {
+        bool momentFilter = settings.filter != SHADOW_FILTER_PCF;
+        MomentShadowMap* map = momentFilter ? &momentMaps[settings.filter - 1] : nullptr;
+
+        bool cacheHit = settings.shadowCache && shadowCacheValid && cachedFilter == settings.filter &&
+                        cachedLightSpaceMatrix == lightSpaceMatrix && cachedStaticModel == floorModel;
+        if (cacheHit) {
+            staticShadowPassSkips++;
+            reportStaticSkips++;
+        } else {
+            // 最远深度（1）的矩，没有被任何物体覆盖的 texel 不产生阴影
+            std::array<VkClearValue, 2> clearValues{};
+            clearValues[0].color = {{1.0f, 1.0f, 0.0f, 0.0f}};
+            if (settings.filter == SHADOW_FILTER_EVSM) {
+                float positive = std::exp(settings.evsmExponent);
+                float negative = -std::exp(-settings.evsmExponent);
+                clearValues[0].color = {{positive, positive * positive, negative, negative * negative}};
+            }
+            clearValues[1].depthStencil = {1.0f, 0};
+
+            VkRenderPassBeginInfo renderPassInfo{};
+            renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+            renderPassInfo.renderPass = momentFilter ? map->staticRenderPass : staticDepthPass;
+            renderPassInfo.framebuffer = momentFilter ? map->staticFramebuffer : staticDepthFramebuffer;
+            renderPassInfo.renderArea.offset = {0, 0};
+            renderPassInfo.renderArea.extent = {SHADOW_WIDTH, SHADOW_HEIGHT};
+            renderPassInfo.clearValueCount = momentFilter ? 2 : 1;
+            renderPassInfo.pClearValues = momentFilter ? clearValues.data() : &clearValues[1];
+
+            vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, momentFilter ? map->pipeline : depthPipeline);
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[currentFrame], 0, nullptr);
+
+            drawStaticCasters(commandBuffer);
+
+            vkCmdEndRenderPass(commandBuffer);
+
+            shadowCacheValid = true;
+            cachedFilter = settings.filter;
+            cachedLightSpaceMatrix = lightSpaceMatrix;
+            cachedStaticModel = floorModel;
+            staticShadowPassRenders++;
+            reportStaticRenders++;
+        }
+
+        // 阴影贴图的旧内容整个被覆盖，只需等上一帧的光照通道（以及模糊与 mip 生成）用完
+        std::array<VkImageMemoryBarrier, 2> barriers{};
+        barriers[0] = imageBarrier(depthMap, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                   0, VK_ACCESS_TRANSFER_WRITE_BIT, 0, 1, VK_IMAGE_ASPECT_DEPTH_BIT);
+        if (momentFilter) {
+            barriers[1] = imageBarrier(map->image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                       0, VK_ACCESS_TRANSFER_WRITE_BIT, 0, 1);
+        }
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, momentFilter ? 2 : 1, barriers.data());
+
+        VkImageCopy region{};
+        region.srcSubresource.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+        region.srcSubresource.mipLevel = 0;
+        region.srcSubresource.baseArrayLayer = 0;
+        region.srcSubresource.layerCount = 1;
+        region.dstSubresource = region.srcSubresource;
+        region.extent = {SHADOW_WIDTH, SHADOW_HEIGHT, 1};
+        vkCmdCopyImage(commandBuffer, staticDepthMap, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                       depthMap, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+        if (momentFilter) {
+            region.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            region.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            vkCmdCopyImage(commandBuffer, map->staticImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                           map->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+        }
+
+        // 动态投射物以缓存的深度做深度测试，比静态投射物更近的地方覆盖深度与矩
+        VkRenderPassBeginInfo renderPassInfo{};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        renderPassInfo.renderPass = momentFilter ? map->renderPass : depthPass;
+        renderPassInfo.framebuffer = momentFilter ? map->framebuffer : depthMapFramebuffer;
+        renderPassInfo.renderArea.offset = {0, 0};
+        renderPassInfo.renderArea.extent = {SHADOW_WIDTH, SHADOW_HEIGHT};
+        renderPassInfo.clearValueCount = 0;
+        renderPassInfo.pClearValues = nullptr;
+
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, momentFilter ? map->pipeline : depthPipeline);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[currentFrame], 0, nullptr);
+
+        drawDynamicCasters(commandBuffer);
+
+        vkCmdEndRenderPass(commandBuffer);
+    }
+
+    // 矩贴图第 0 层（GENERAL）：水平模糊写入中间图像，垂直模糊写回；然后逐级 blit 生成 mip，
+    // 最后整张贴图转到 SHADER_READ_ONLY_OPTIMAL
+    void recordMomentBlur(VkCommandBuffer commandBuffer, const MomentShadowMap& map) {
+        if (settings.blurRadius > 0) {
+            // 离散高斯权重，sigma 取半径的一半，归一化使总和为 1
+            BlurConstants constants{};
+            constants.radius = settings.blurRadius;
+            float sigma = settings.blurRadius * 0.5f;
+            float sum = 0.0f;
+            for (int32_t i = 0; i <= settings.blurRadius; i++) {
+                constants.weights[i] = std::exp(-float(i * i) / (2.0f * sigma * sigma));
+                sum += i == 0 ? constants.weights[i] : 2.0f * constants.weights[i];
+            }
+            for (int32_t i = 0; i <= settings.blurRadius; i++) {
+                constants.weights[i] /= sum;
+            }
+
+            uint32_t groupCountX = (SHADOW_WIDTH + 7) / 8;
+            uint32_t groupCountY = (SHADOW_HEIGHT + 7) / 8;
+
+            // 中间图像的旧内容不需要保留，但上一次垂直模糊对它的读取必须先完成
+            recordImageBarrier(commandBuffer, map.blurImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL,
+                               0, VK_ACCESS_SHADER_WRITE_BIT,
+                               VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1);
+
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, map.blurPipeline);
+
+            constants.direction = glm::ivec2(1, 0);
+            vkCmdPushConstants(commandBuffer, blurPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(BlurConstants), &constants);
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, blurPipelineLayout, 0, 1, &map.blurDescriptorSets[0], 0, nullptr);
+            vkCmdDispatch(commandBuffer, groupCountX, groupCountY, 1);
+
+            // 中间图像写完再读；矩贴图读完再写
+            std::array<VkImageMemoryBarrier, 2> barriers{};
+            barriers[0] = imageBarrier(map.blurImage, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL,
+                                       VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, 0, 1);
+            barriers[1] = imageBarrier(map.image, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL,
+                                       VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_SHADER_WRITE_BIT, 0, 1);
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                                 0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+
+            constants.direction = glm::ivec2(0, 1);
+            vkCmdPushConstants(commandBuffer, blurPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(BlurConstants), &constants);
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, blurPipelineLayout, 0, 1, &map.blurDescriptorSets[1], 0, nullptr);
+            vkCmdDispatch(commandBuffer, groupCountX, groupCountY, 1);
+
+            recordImageBarrier(commandBuffer, map.image, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                               VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+                               VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1);
+        } else {
+            recordImageBarrier(commandBuffer, map.image, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                               VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+                               VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1);
+        }
+
+        // 其余各级的旧内容不需要保留，等上一帧的光照通道读完即可覆盖
+        recordImageBarrier(commandBuffer, map.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                           0, VK_ACCESS_TRANSFER_WRITE_BIT,
+                           VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 1, SHADOW_MIP_LEVELS - 1);
+
+        int32_t mipWidth = SHADOW_WIDTH;
+        int32_t mipHeight = SHADOW_HEIGHT;
+        for (uint32_t level = 1; level < SHADOW_MIP_LEVELS; level++) {
+            VkImageBlit blit{};
+            blit.srcOffsets[0] = {0, 0, 0};
+            blit.srcOffsets[1] = {mipWidth, mipHeight, 1};
+            blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            blit.srcSubresource.mipLevel = level - 1;
+            blit.srcSubresource.baseArrayLayer = 0;
+            blit.srcSubresource.layerCount = 1;
+            mipWidth = std::max(mipWidth / 2, 1);
+            mipHeight = std::max(mipHeight / 2, 1);
+            blit.dstOffsets[0] = {0, 0, 0};
+            blit.dstOffsets[1] = {mipWidth, mipHeight, 1};
+            blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            blit.dstSubresource.mipLevel = level;
+            blit.dstSubresource.baseArrayLayer = 0;
+            blit.dstSubresource.layerCount = 1;
+
+            vkCmdBlitImage(commandBuffer, map.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                           map.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+
+            recordImageBarrier(commandBuffer, map.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                               VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+                               VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, level, 1);
+        }
+
+        recordImageBarrier(commandBuffer, map.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                           VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+                           VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, SHADOW_MIP_LEVELS);
+    }
+
+    VkImageMemoryBarrier imageBarrier(VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout,
+                                      VkAccessFlags srcAccessMask, VkAccessFlags dstAccessMask,
+                                      uint32_t baseMipLevel, uint32_t levelCount,
+                                      VkImageAspectFlags aspectMask = VK_IMAGE_ASPECT_COLOR_BIT) {
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.oldLayout = oldLayout;
+        barrier.newLayout = newLayout;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = image;
+        barrier.subresourceRange.aspectMask = aspectMask;
+        barrier.subresourceRange.baseMipLevel = baseMipLevel;
+        barrier.subresourceRange.levelCount = levelCount;
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount = 1;
+        barrier.srcAccessMask = srcAccessMask;
+        barrier.dstAccessMask = dstAccessMask;
+        return barrier;
+    }
+
+    void recordImageBarrier(VkCommandBuffer commandBuffer, VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout,
+                            VkAccessFlags srcAccessMask, VkAccessFlags dstAccessMask,
+                            VkPipelineStageFlags srcStageMask, VkPipelineStageFlags dstStageMask,
+                            uint32_t baseMipLevel, uint32_t levelCount) {
+        VkImageMemoryBarrier barrier = imageBarrier(image, oldLayout, newLayout, srcAccessMask, dstAccessMask, baseMipLevel, levelCount);
+        vkCmdPipelineBarrier(commandBuffer, srcStageMask, dstStageMask, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    }
+
     void recreateSwapChain() {
         int width = 0, height = 0;
         glfwGetFramebufferSize(window, &width, &height);
@@ -1256,16 +2307,20 @@ private:
         createImageViews();
         createRenderPass();
         createGraphicsPipeline();
+        createSceneDepthResources();
         createFramebuffers();
     }
 
     void cleanupSwapChain() {
+        vkDestroyImageView(device, sceneDepthImageView, nullptr);
+        vkDestroyImage(device, sceneDepthImage, nullptr);
+        vkFreeMemory(device, sceneDepthImageMemory, nullptr);
+
         for (auto framebuffer : swapChainFramebuffers) {
             vkDestroyFramebuffer(device, framebuffer, nullptr);
         }
 
         vkDestroyPipeline(device, graphicsPipeline, nullptr);
-        vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
         vkDestroyRenderPass(device, renderPass, nullptr);
 
         for (auto imageView : swapChainImageViews) {
@@ -1284,16 +2339,59 @@ private:
             vkDestroyFence(device, inFlightFences[i], nullptr);
         }
 
+        if (timestampQueryPool != VK_NULL_HANDLE) {
+            vkDestroyQueryPool(device, timestampQueryPool, nullptr);
+        }
+
+        for (MomentShadowMap& map : momentMaps) {
+            vkDestroyPipeline(device, map.blurPipeline, nullptr);
+            vkDestroyPipeline(device, map.pipeline, nullptr);
+            vkDestroyFramebuffer(device, map.framebuffer, nullptr);
+            vkDestroyRenderPass(device, map.renderPass, nullptr);
+            vkDestroyFramebuffer(device, map.staticFramebuffer, nullptr);
+            vkDestroyRenderPass(device, map.staticRenderPass, nullptr);
+            vkDestroyImageView(device, map.staticView, nullptr);
+            vkDestroyImage(device, map.staticImage, nullptr);
+            vkFreeMemory(device, map.staticImageMemory, nullptr);
+            vkDestroyImageView(device, map.blurView, nullptr);
+            vkDestroyImage(device, map.blurImage, nullptr);
+            vkFreeMemory(device, map.blurImageMemory, nullptr);
+            vkDestroyImageView(device, map.levelView, nullptr);
+            vkDestroyImageView(device, map.view, nullptr);
+            vkDestroyImage(device, map.image, nullptr);
+            vkFreeMemory(device, map.imageMemory, nullptr);
+        }
+        vkDestroySampler(device, momentSampler, nullptr);
+        vkDestroySampler(device, blurSampler, nullptr);
+        vkDestroyPipelineLayout(device, blurPipelineLayout, nullptr);
+        vkDestroyDescriptorSetLayout(device, blurDescriptorSetLayout, nullptr);
+
         vkDestroySampler(device, depthMapSampler, nullptr);
         vkDestroyImageView(device, depthMapView, nullptr);
         vkDestroyImage(device, depthMap, nullptr);
         vkFreeMemory(device, depthMapMemory, nullptr);
 
         vkDestroyPipeline(device, depthPipeline, nullptr);
-        vkDestroyPipelineLayout(device, depthPipelineLayout, nullptr);
         vkDestroyRenderPass(device, depthPass, nullptr);
         vkDestroyFramebuffer(device, depthMapFramebuffer, nullptr);
 
+        for (int32_t light = 0; light < MAX_POINT_LIGHTS; light++) {
+            vkDestroyFramebuffer(device, pointShadowFramebuffers[light], nullptr);
+            vkDestroyImageView(device, pointShadowFaceViews[light], nullptr);
+        }
+        vkDestroyPipeline(device, pointShadowPipeline, nullptr);
+        vkDestroyRenderPass(device, pointShadowPass, nullptr);
+        vkDestroySampler(device, pointShadowSampler, nullptr);
+        vkDestroyImageView(device, pointShadowAtlasView, nullptr);
+        vkDestroyImage(device, pointShadowAtlas, nullptr);
+        vkFreeMemory(device, pointShadowAtlasMemory, nullptr);
+
+        vkDestroyFramebuffer(device, staticDepthFramebuffer, nullptr);
+        vkDestroyRenderPass(device, staticDepthPass, nullptr);
+        vkDestroyImageView(device, staticDepthMapView, nullptr);
+        vkDestroyImage(device, staticDepthMap, nullptr);
+        vkFreeMemory(device, staticDepthMapMemory, nullptr);
+
         for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
             vkDestroyBuffer(device, uniformBuffers[i], nullptr);
             vkFreeMemory(device, uniformBuffersMemory[i], nullptr);
@@ -1306,8 +2404,8 @@ private:
         vkFreeMemory(device, vertexBufferMemory, nullptr);
 
         vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+        vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
         vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
-        vkDestroyDescriptorSetLayout(device, depthDescriptorSetLayout, nullptr);
 
         vkDestroyCommandPool(device, commandPool, nullptr);
 
@@ -1392,7 +2490,36 @@ private:
         VkPhysicalDeviceFeatures supportedFeatures;
         vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
 
-        return indices.isComplete() && extensionsSupported && swapChainAdequate && supportedFeatures.depthClamp;
+        bool momentFormatsSupported = supportsMomentFormat(device, VK_FORMAT_R32G32_SFLOAT) &&
+                                      supportsMomentFormat(device, VK_FORMAT_R16G16B16A16_SFLOAT);
+
+        // 点光源阴影需要 Vulkan 1.1 的 multiview，一次绘制写入立方体的 6 个面
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(device, &properties);
+        bool multiviewSupported = false;
+        if (properties.apiVersion >= VK_API_VERSION_1_1) {
+            VkPhysicalDeviceMultiviewFeatures multiviewFeatures{};
+            multiviewFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MULTIVIEW_FEATURES;
+            VkPhysicalDeviceFeatures2 features2{};
+            features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+            features2.pNext = &multiviewFeatures;
+            vkGetPhysicalDeviceFeatures2(device, &features2);
+            multiviewSupported = multiviewFeatures.multiview == VK_TRUE;
+        }
+
+        return indices.isComplete() && extensionsSupported && swapChainAdequate && supportedFeatures.depthClamp &&
+               supportedFeatures.shaderStorageImageExtendedFormats && momentFormatsSupported && multiviewSupported;
+    }
+
+    // 矩贴图要作为渲染目标、存储图像、线性过滤采样，并用线性 blit 生成 mip
+    bool supportsMomentFormat(VkPhysicalDevice device, VkFormat format) {
+        VkFormatProperties props;
+        vkGetPhysicalDeviceFormatProperties(device, format, &props);
+
+        VkFormatFeatureFlags required = VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT | VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT |
+                                        VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT |
+                                        VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT;
+        return (props.optimalTilingFeatures & required) == required;
     }
 
     QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device) {
@@ -1404,9 +2531,10 @@ private:
         std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
         vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
 
+        // 模糊的计算着色器与阴影、光照通道录制在同一个命令缓冲区中
         int i = 0;
         for (const auto& queueFamily : queueFamilies) {
-            if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+            if ((queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) && (queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT)) {
                 indices.graphicsFamily = i;
             }
 
@@ -1528,15 +2656,15 @@ private:
         throw std::runtime_error("failed to find supported format!");
     }
 
-    void createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory) {
+    void createImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory, uint32_t arrayLayers = 1) {
         VkImageCreateInfo imageInfo{};
         imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
         imageInfo.imageType = VK_IMAGE_TYPE_2D;
         imageInfo.extent.width = width;
         imageInfo.extent.height = height;
         imageInfo.extent.depth = 1;
-        imageInfo.mipLevels = 1;
-        imageInfo.arrayLayers = 1;
+        imageInfo.mipLevels = mipLevels;
+        imageInfo.arrayLayers = arrayLayers;
         imageInfo.format = format;
         imageInfo.tiling = tiling;
         imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
@@ -1577,17 +2705,18 @@ private:
         throw std::runtime_error("failed to find suitable memory type!");
     }
 
-    VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags) {
+    VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t levelCount = 1,
+                                VkImageViewType viewType = VK_IMAGE_VIEW_TYPE_2D, uint32_t baseArrayLayer = 0, uint32_t layerCount = 1) {
         VkImageViewCreateInfo viewInfo{};
         viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
         viewInfo.image = image;
-        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.viewType = viewType;
         viewInfo.format = format;
         viewInfo.subresourceRange.aspectMask = aspectFlags;
         viewInfo.subresourceRange.baseMipLevel = 0;
-        viewInfo.subresourceRange.levelCount = 1;
-        viewInfo.subresourceRange.baseArrayLayer = 0;
-        viewInfo.subresourceRange.layerCount = 1;
+        viewInfo.subresourceRange.levelCount = levelCount;
+        viewInfo.subresourceRange.baseArrayLayer = baseArrayLayer;
+        viewInfo.subresourceRange.layerCount = layerCount;
 
         VkImageView imageView;
         if (vkCreateImageView(device, &viewInfo, nullptr, &imageView) != VK_SUCCESS) {
@@ -1623,7 +2752,7 @@ private:
         vkBindBufferMemory(device, buffer, bufferMemory, 0);
     }
 
-    void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
+    VkCommandBuffer beginSingleTimeCommands() {
         VkCommandBufferAllocateInfo allocInfo{};
         allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
         allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
@@ -1639,10 +2768,10 @@ private:
 
         vkBeginCommandBuffer(commandBuffer, &beginInfo);
 
-        VkBufferCopy copyRegion{};
-        copyRegion.size = size;
-        vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
+        return commandBuffer;
+    }
 
+    void endSingleTimeCommands(VkCommandBuffer commandBuffer) {
         vkEndCommandBuffer(commandBuffer);
 
         VkSubmitInfo submitInfo{};
@@ -1656,11 +2785,21 @@ private:
         vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
     }
 
+    void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
+        VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+
+        VkBufferCopy copyRegion{};
+        copyRegion.size = size;
+        vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
+
+        endSingleTimeCommands(commandBuffer);
+    }
+
     static std::vector<char> readFile(const std::string& filename) {
         std::ifstream file(filename, std::ios::ate | std::ios::binary);
 
         if (!file.is_open()) {
-            throw std::runtime_error("failed to open file!");
+            throw std::runtime_error("failed to open file " + filename + "!");
         }
 
         size_t fileSize = (size_t) file.tellg();
@@ -1689,8 +2828,55 @@ private:
     }
 };
 
-int main() {
-    VulkanShadowRenderer app;
+int main(int argc, char** argv) {
+    // 可选参数：--shadow-filter pcf|vsm|evsm（运行时按 F 切换）、--light-bleed R（0 到 0.95，运行时按 [ ] 调整）、
+    // --evsm-exponent C（不超过 EVSM_MAX_EXPONENT）、--moment-blur N（0 到 MAX_BLUR_RADIUS texel）、
+    // --no-shadow-cache（每帧都重新渲染静态投射物，运行时按 C 切换）、--static-light（光源不旋转，运行时按 L 切换）、
+    // --point-lights N（0 到 MAX_POINT_LIGHTS 个带立方体阴影的点光源，运行时按 P 切换）
+    ShadowSettings settings;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--shadow-filter" && i + 1 < argc) {
+            std::string filter = argv[++i];
+            auto name = std::find_if(std::begin(SHADOW_FILTER_NAMES), std::end(SHADOW_FILTER_NAMES), [&](const char* candidate) {
+                std::string lower = candidate;
+                std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return (char) std::tolower(c); });
+                return lower == filter;
+            });
+            if (name == std::end(SHADOW_FILTER_NAMES)) {
+                std::cerr << "unknown shadow filter: " << filter << std::endl;
+                return EXIT_FAILURE;
+            }
+            settings.filter = static_cast<int32_t>(name - std::begin(SHADOW_FILTER_NAMES));
+        } else if (arg == "--light-bleed" && i + 1 < argc) {
+            settings.lightBleedReduction = std::stof(argv[++i]);
+        } else if (arg == "--evsm-exponent" && i + 1 < argc) {
+            settings.evsmExponent = std::stof(argv[++i]);
+        } else if (arg == "--moment-blur" && i + 1 < argc) {
+            settings.blurRadius = std::stoi(argv[++i]);
+        } else if (arg == "--no-shadow-cache") {
+            settings.shadowCache = false;
+        } else if (arg == "--static-light") {
+            settings.animateLight = false;
+        } else if (arg == "--point-lights" && i + 1 < argc) {
+            settings.pointLightCount = std::stoi(argv[++i]);
+        } else {
+            std::cerr << "usage: " << argv[0] << " [--shadow-filter pcf|vsm|evsm] [--light-bleed R] [--evsm-exponent C] [--moment-blur N]"
+                      << " [--no-shadow-cache] [--static-light] [--point-lights N]" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (settings.lightBleedReduction < 0.0f || settings.lightBleedReduction > 0.95f ||
+        settings.evsmExponent <= 0.0f || settings.evsmExponent > EVSM_MAX_EXPONENT ||
+        settings.blurRadius < 0 || settings.blurRadius > MAX_BLUR_RADIUS ||
+        settings.pointLightCount < 0 || settings.pointLightCount > MAX_POINT_LIGHTS) {
+        std::cerr << "light bleed must be in [0, 0.95], EVSM exponent in (0, " << EVSM_MAX_EXPONENT
+                  << "], blur radius in [0, " << MAX_BLUR_RADIUS << "], point lights in [0, " << MAX_POINT_LIGHTS << "]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    VulkanShadowRenderer app(settings);
 
     try {
         app.run();
@@ -1700,4 +2886,4 @@ int main() {
     }
 
     return EXIT_SUCCESS;
-}
\ No newline at end of file
+}